@@ -0,0 +1,171 @@
+#include "xmadaptive.h"
+#include "xmserver.h"
+#include "xmmalloc.h"
+
+#include <stdint.h>
+
+// 对象最近的读写次数
+typedef struct objectAccess
+{
+    // 上一次衰减计数的时间，单位和 LRU 时钟相同
+    unsigned int clock;
+    // 衰减之后的读次数和写次数
+    uint32_t reads;
+    uint32_t writes;
+    // OBJECT_ACCESS_READ_HOT 和 OBJECT_ACCESS_WRITE_HOT
+    int state;
+} objectAccess;
+
+static unsigned int accessHash(const void *key)
+{
+    return dictGenHashFunction(&key, sizeof(key));
+}
+
+static void accessDestructor(void *privdata, void *val)
+{
+    objectAccess *a = val;
+
+    DICT_NOTUSED(privdata);
+    if (a->state)
+        server.stat_encoding_hot_keys--;
+    xm_free(a);
+}
+
+static dictType accessDictType = {
+    accessHash,      /* hash function */
+    NULL,            /* key dup */
+    NULL,            /* val dup */
+    NULL,            /* key compare */
+    NULL,            /* key destructor */
+    accessDestructor /* val destructor */
+};
+
+// 对象指针 -> objectAccess
+static dict *objectAccesses = NULL;
+
+static objectAccess *objectFetchAccess(robj *o)
+{
+    if (!server.encoding_adaptive || objectAccesses == NULL)
+        return NULL;
+    return dictFetchValue(objectAccesses, o);
+}
+
+// 读和写都低于离开热状态的阈值
+static int objectAccessCold(objectAccess *a)
+{
+    return a->reads < REDIS_ENCODING_COLD_READS && a->writes < REDIS_ENCODING_COLD_WRITES;
+}
+
+// 根据计数更新一种热状态，进入和离开使用不同的阈值
+static int objectAccessUpdate(int state, int flag, uint32_t ops, uint32_t hot, uint32_t cold)
+{
+    if (!(state & flag) && ops >= hot)
+        return state | flag;
+    if ((state & flag) && ops < cold)
+        return state & ~flag;
+    return state;
+}
+
+void objectTrackAccess(robj *o, int write)
+{
+    objectTrackAccessAt(o, write, LRU_CLOCK());
+}
+
+void objectTrackAccessAt(robj *o, int write, unsigned int clock)
+{
+    objectAccess *a;
+    unsigned int periods;
+    int state;
+
+    if (!server.encoding_adaptive)
+        return;
+
+    if (objectAccesses == NULL)
+        objectAccesses = dictCreate(&accessDictType, NULL);
+
+    if ((a = dictFetchValue(objectAccesses, o)) == NULL)
+    {
+        a = xm_malloc(sizeof(*a));
+        a->clock = clock;
+        a->reads = a->writes = 0;
+        a->state = 0;
+        dictAdd(objectAccesses, o, a);
+    }
+
+    // 每经过一个衰减周期计数减半，不足一个周期的时间留到下一次
+    periods = ((clock - a->clock) & REDIS_LRU_CLOCK_MAX) / REDIS_ENCODING_DECAY_SECONDS;
+    if (periods > 0)
+    {
+        a->reads = periods >= 32 ? 0 : a->reads >> periods;
+        a->writes = periods >= 32 ? 0 : a->writes >> periods;
+        a->clock = (a->clock + periods * REDIS_ENCODING_DECAY_SECONDS) & REDIS_LRU_CLOCK_MAX;
+    }
+
+    if (write)
+    {
+        if (a->writes < UINT32_MAX / 2)
+            a->writes++;
+    }
+    else if (a->reads < UINT32_MAX / 2)
+    {
+        a->reads++;
+    }
+
+    // 读和写分别判断，衰减之后没有被访问的那一种计数也可能离开热状态
+    state = objectAccessUpdate(a->state, OBJECT_ACCESS_READ_HOT, a->reads,
+                               REDIS_ENCODING_HOT_READS, REDIS_ENCODING_COLD_READS);
+    state = objectAccessUpdate(state, OBJECT_ACCESS_WRITE_HOT, a->writes,
+                               REDIS_ENCODING_HOT_WRITES, REDIS_ENCODING_COLD_WRITES);
+    if (!a->state && state)
+        server.stat_encoding_hot_keys++;
+    else if (a->state && !state)
+        server.stat_encoding_hot_keys--;
+    a->state = state;
+}
+
+int objectAccessState(robj *o)
+{
+    objectAccess *a = objectFetchAccess(o);
+
+    if (a == NULL)
+        return 0;
+    return a->state | (objectAccessCold(a) ? OBJECT_ACCESS_COLD : 0);
+}
+
+int objectEncodingExceeds(robj *o, size_t len, size_t limit)
+{
+    objectAccess *a = objectFetchAccess(o);
+    size_t adjusted = limit;
+
+    if (a != NULL)
+    {
+        if (a->state & OBJECT_ACCESS_WRITE_HOT)
+            adjusted = limit / REDIS_ENCODING_WRITE_HOT_FACTOR;
+        else if (a->state & OBJECT_ACCESS_READ_HOT)
+            adjusted = limit / REDIS_ENCODING_READ_HOT_FACTOR;
+        else if (objectAccessCold(a))
+            adjusted = limit * REDIS_ENCODING_COLD_FACTOR;
+    }
+    if (len <= adjusted)
+        return 0;
+    // 只统计按配置的边界条件本来不需要转换的情况
+    if (len <= limit)
+        server.stat_encoding_promotions++;
+    return 1;
+}
+
+int objectEncodingShouldCompact(robj *o, size_t len, size_t limit)
+{
+    objectAccess *a = objectFetchAccess(o);
+
+    // 只有冷键、并且长度不到边界条件的一半时才转换回去，
+    // 转换之后还能再增长一段，不会因为一两次写入就又转换回来
+    return a != NULL && !a->state && objectAccessCold(a) && len <= limit / 2;
+}
+
+void objectFreeAccess(robj *o)
+{
+    if (objectAccesses == NULL)
+        return;
+    dictDelete(objectAccesses, o);
+}
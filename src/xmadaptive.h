@@ -0,0 +1,37 @@
+#ifndef HXM_ADAPTIVE_H
+#define HXM_ADAPTIVE_H
+
+#include "xmobject.h"
+
+/*
+自适应编码转换
+
+每个键最近的读次数和写次数分别计数，保存在以对象指针为键的字典中，不占用 robj 的空间。
+计数每经过 REDIS_ENCODING_DECAY_SECONDS 秒减半，读和写各自有进入和离开热状态的阈值，
+两个阈值之间的差距避免编码来回转换。
+
+写热的键在紧凑编码上的每次写入都要移动后面的所有字节，所以边界条件缩小得最多；
+只有读热的键在紧凑编码上只是查找变慢，边界条件缩小得少一些；
+读和写都冷的键放宽边界条件，足够小时还会转换回紧凑编码。
+*/
+
+// objectAccessState 返回的状态
+#define OBJECT_ACCESS_READ_HOT (1 << 0)  // 读次数达到 REDIS_ENCODING_HOT_READS ，降到 COLD_READS 以下才离开
+#define OBJECT_ACCESS_WRITE_HOT (1 << 1) // 写次数达到 REDIS_ENCODING_HOT_WRITES ，降到 COLD_WRITES 以下才离开
+#define OBJECT_ACCESS_COLD (1 << 2)      // 读和写都低于离开热状态的阈值
+
+// 记录一次对对象的读（write 为 0）或写操作，只在 server.encoding_adaptive 打开时生效
+void objectTrackAccess(robj *o, int write);
+// 和 objectTrackAccess 相同，但使用给定的 LRU 时钟 clock 衰减计数
+void objectTrackAccessAt(robj *o, int write, unsigned int clock);
+// 返回对象当前的 OBJECT_ACCESS_* 状态，没有访问记录时返回 0
+int objectAccessState(robj *o);
+// 检查长度为 len 的紧凑编码对象是否超过了边界条件，需要转换为非紧凑编码
+// limit 为配置的边界条件，自适应模式下写热和读热的键边界条件变小，冷键的边界条件变大
+int objectEncodingExceeds(robj *o, size_t len, size_t limit);
+// 对象已经是非紧凑编码，长度为 len ，检查它是否足够冷、足够小，应该转换回紧凑编码
+int objectEncodingShouldCompact(robj *o, size_t len, size_t limit);
+// 释放对象的访问记录，在对象被释放时调用
+void objectFreeAccess(robj *o);
+
+#endif
@@ -1,7 +1,338 @@
 #include <stdlib.h>
+#include <string.h>
 #include "xmadlist.h"
 #include "xmmalloc.h"
 
+/*******************************位置索引*************************************/
+
+// 在第 slot 个槽的节点数量上加上 delta
+static void _listIndexTreeAdd(listNodeIndex *idx, unsigned long slot, long delta)
+{
+    unsigned long i;
+    for (i = slot + 1; i <= idx->size; i += i & (~i + 1))
+        idx->tree[i] += delta;
+}
+
+// 根据每个块的节点数量重建整个树状数组，O(size)
+static void _listIndexTreeRebuild(listNodeIndex *idx)
+{
+    unsigned long i, j;
+
+    memset(idx->tree, 0, (idx->size + 1) * sizeof(unsigned long));
+    for (i = 1; i <= idx->size; i++)
+    {
+        if (idx->chunks[i - 1])
+            idx->tree[i] += idx->chunks[i - 1]->count;
+        j = i + (i & (~i + 1));
+        if (j <= idx->size)
+            idx->tree[j] += idx->tree[i];
+    }
+}
+
+// 重新分配槽数组，将有效槽移动到中间，两端各留出与有效槽数量相当的空位
+static void _listIndexResize(listNodeIndex *idx, unsigned long n)
+{
+    unsigned long used = idx->hi - idx->lo;
+    unsigned long size = (used > n ? used : n) * 2 + 8;
+    unsigned long lo = (size - used) / 2;
+    listIndexChunk **chunks = xm_calloc(size * sizeof(listIndexChunk *));
+
+    if (used)
+        memcpy(chunks + lo, idx->chunks + idx->lo, used * sizeof(listIndexChunk *));
+    xm_free(idx->chunks);
+    idx->chunks = chunks;
+    idx->size = size;
+    idx->lo = lo;
+    idx->hi = lo + used;
+    idx->tree = xm_realloc(idx->tree, (size + 1) * sizeof(unsigned long));
+    _listIndexTreeRebuild(idx);
+}
+
+static void _listIndexFreeChunks(listNodeIndex *idx)
+{
+    unsigned long i;
+    for (i = idx->lo; i < idx->hi; i++)
+        xm_free(idx->chunks[i]);
+    idx->lo = idx->hi = idx->size / 2;
+}
+
+// 遍历链表，重建整个索引
+// 每个块只装 3/4 ，为之后在中间插入留出空间
+static void _listIndexBuild(list *list)
+{
+    listNodeIndex *idx = list->index;
+    unsigned int fill = AL_INDEX_CHUNK_SIZE / 4 * 3;
+    unsigned long n = (list->len + fill - 1) / fill;
+    listNode *node = list->head;
+    listIndexChunk *c;
+
+    _listIndexFreeChunks(idx);
+    xm_free(idx->chunks);
+    idx->chunks = NULL;
+    idx->lo = idx->hi = 0;
+    _listIndexResize(idx, n);
+
+    while (node)
+    {
+        c = xm_malloc(sizeof(*c));
+        c->count = 0;
+        while (node && c->count < fill)
+        {
+            c->nodes[c->count++] = node;
+            node = node->next;
+        }
+        idx->chunks[idx->hi++] = c;
+    }
+    _listIndexTreeRebuild(idx);
+    idx->valid = 1;
+}
+
+// 找到第 index 个节点所在的槽，以及它在块中的位置，O(log n)
+static void _listIndexFind(listNodeIndex *idx, unsigned long index, unsigned long *slot, unsigned int *off)
+{
+    unsigned long pos = 0, step = 1;
+
+    while ((step << 1) <= idx->size)
+        step <<= 1;
+
+    // 找到前缀和不超过 index 的最长前缀
+    for (; step; step >>= 1)
+    {
+        if (pos + step <= idx->size && idx->tree[pos + step] <= index)
+        {
+            pos += step;
+            index -= idx->tree[pos];
+        }
+    }
+    *slot = pos;
+    *off = index;
+}
+
+static listIndexChunk *_listIndexNewChunk(void)
+{
+    listIndexChunk *c = xm_malloc(sizeof(*c));
+    c->count = 0;
+    return c;
+}
+
+// 将节点记录为第一个节点
+static void _listIndexPushHead(list *list, listNode *node)
+{
+    listNodeIndex *idx = list->index;
+    listIndexChunk *c;
+
+    if (idx == NULL || !idx->valid)
+        return;
+    if (idx->lo == idx->hi || idx->chunks[idx->lo]->count == AL_INDEX_CHUNK_SIZE)
+    {
+        if (idx->lo == 0)
+            _listIndexResize(idx, 0);
+        idx->chunks[--idx->lo] = _listIndexNewChunk();
+    }
+    c = idx->chunks[idx->lo];
+    memmove(c->nodes + 1, c->nodes, c->count * sizeof(listNode *));
+    c->nodes[0] = node;
+    c->count++;
+    _listIndexTreeAdd(idx, idx->lo, 1);
+}
+
+// 将节点记录为最后一个节点
+static void _listIndexPushTail(list *list, listNode *node)
+{
+    listNodeIndex *idx = list->index;
+    listIndexChunk *c;
+
+    if (idx == NULL || !idx->valid)
+        return;
+    if (idx->lo == idx->hi || idx->chunks[idx->hi - 1]->count == AL_INDEX_CHUNK_SIZE)
+    {
+        if (idx->hi == idx->size)
+            _listIndexResize(idx, 0);
+        idx->chunks[idx->hi++] = _listIndexNewChunk();
+    }
+    c = idx->chunks[idx->hi - 1];
+    c->nodes[c->count++] = node;
+    _listIndexTreeAdd(idx, idx->hi - 1, 1);
+}
+
+// 删除第一个节点的记录，块为空时释放块
+static void _listIndexPopHead(list *list)
+{
+    listNodeIndex *idx = list->index;
+    listIndexChunk *c;
+
+    if (idx == NULL || !idx->valid)
+        return;
+    c = idx->chunks[idx->lo];
+    memmove(c->nodes, c->nodes + 1, (c->count - 1) * sizeof(listNode *));
+    c->count--;
+    _listIndexTreeAdd(idx, idx->lo, -1);
+    if (c->count == 0)
+    {
+        xm_free(c);
+        idx->chunks[idx->lo++] = NULL;
+    }
+}
+
+// 删除最后一个节点的记录，块为空时释放块
+static void _listIndexPopTail(list *list)
+{
+    listNodeIndex *idx = list->index;
+    listIndexChunk *c;
+
+    if (idx == NULL || !idx->valid)
+        return;
+    c = idx->chunks[idx->hi - 1];
+    c->count--;
+    _listIndexTreeAdd(idx, idx->hi - 1, -1);
+    if (c->count == 0)
+    {
+        xm_free(c);
+        idx->chunks[--idx->hi] = NULL;
+    }
+}
+
+// 将节点记录到第 index 个位置上，0 < index < len
+// 块已满时先尝试把一个节点挪到相邻的块中，相邻的块也满了才分裂成两个块，
+// 分裂需要移动之后的槽并重建树状数组
+static void _listIndexInsert(list *list, unsigned long index, listNode *node)
+{
+    listNodeIndex *idx = list->index;
+    listIndexChunk *c, *split;
+    unsigned long slot;
+    unsigned int off, half;
+
+    if (idx == NULL || !idx->valid)
+        return;
+    _listIndexFind(idx, index, &slot, &off);
+    c = idx->chunks[slot];
+
+    // 后一个块有空位，把最后一个节点挪过去
+    if (c->count == AL_INDEX_CHUNK_SIZE && slot + 1 < idx->hi &&
+        idx->chunks[slot + 1]->count < AL_INDEX_CHUNK_SIZE)
+    {
+        split = idx->chunks[slot + 1];
+        memmove(split->nodes + 1, split->nodes, split->count * sizeof(listNode *));
+        split->nodes[0] = c->nodes[--c->count];
+        split->count++;
+        _listIndexTreeAdd(idx, slot, -1);
+        _listIndexTreeAdd(idx, slot + 1, 1);
+    }
+    // 前一个块有空位，把第一个节点挪过去
+    else if (c->count == AL_INDEX_CHUNK_SIZE && slot > idx->lo &&
+             idx->chunks[slot - 1]->count < AL_INDEX_CHUNK_SIZE)
+    {
+        split = idx->chunks[slot - 1];
+        // 新节点本身就是前一个块的最后一个节点
+        if (off == 0)
+        {
+            split->nodes[split->count++] = node;
+            _listIndexTreeAdd(idx, slot - 1, 1);
+            return;
+        }
+        split->nodes[split->count++] = c->nodes[0];
+        memmove(c->nodes, c->nodes + 1, (c->count - 1) * sizeof(listNode *));
+        c->count--;
+        off--;
+        _listIndexTreeAdd(idx, slot - 1, 1);
+        _listIndexTreeAdd(idx, slot, -1);
+    }
+
+    if (c->count == AL_INDEX_CHUNK_SIZE)
+    {
+        if (idx->hi == idx->size)
+        {
+            slot -= idx->lo;
+            _listIndexResize(idx, 0);
+            slot += idx->lo;
+        }
+        // 后一半节点移动到新块，新块放在 slot + 1
+        half = c->count / 2;
+        split = _listIndexNewChunk();
+        split->count = c->count - half;
+        memcpy(split->nodes, c->nodes + half, split->count * sizeof(listNode *));
+        c->count = half;
+        memmove(idx->chunks + slot + 2, idx->chunks + slot + 1,
+                (idx->hi - slot - 1) * sizeof(listIndexChunk *));
+        idx->chunks[slot + 1] = split;
+        idx->hi++;
+        if (off > half)
+        {
+            c = split;
+            off -= half;
+        }
+        memmove(c->nodes + off + 1, c->nodes + off, (c->count - off) * sizeof(listNode *));
+        c->nodes[off] = node;
+        c->count++;
+        _listIndexTreeRebuild(idx);
+    }
+    else
+    {
+        memmove(c->nodes + off + 1, c->nodes + off, (c->count - off) * sizeof(listNode *));
+        c->nodes[off] = node;
+        c->count++;
+        _listIndexTreeAdd(idx, slot, 1);
+    }
+}
+
+// 删除第 index 个节点的记录，0 < index < len - 1
+// 块变空时释放块，需要移动之后的槽并重建树状数组
+static void _listIndexDelete(list *list, unsigned long index)
+{
+    listNodeIndex *idx = list->index;
+    listIndexChunk *c;
+    unsigned long slot;
+    unsigned int off;
+
+    if (idx == NULL || !idx->valid)
+        return;
+    _listIndexFind(idx, index, &slot, &off);
+    c = idx->chunks[slot];
+    memmove(c->nodes + off, c->nodes + off + 1, (c->count - off - 1) * sizeof(listNode *));
+    c->count--;
+    if (c->count == 0)
+    {
+        xm_free(c);
+        memmove(idx->chunks + slot, idx->chunks + slot + 1, (idx->hi - slot - 1) * sizeof(listIndexChunk *));
+        idx->chunks[--idx->hi] = NULL;
+        _listIndexTreeRebuild(idx);
+    }
+    else
+    {
+        _listIndexTreeAdd(idx, slot, -1);
+    }
+}
+
+// 在链表中间按节点增删、又不知道节点的位置时，只能让索引失效
+static void _listIndexInvalidate(list *list)
+{
+    if (list->index)
+        list->index->valid = 0;
+}
+
+void listEnableIndex(list *list)
+{
+    if (list->index)
+        return;
+    list->index = xm_calloc(sizeof(listNodeIndex));
+    _listIndexBuild(list);
+}
+
+void listDisableIndex(list *list)
+{
+    listNodeIndex *idx = list->index;
+
+    if (idx == NULL)
+        return;
+    _listIndexFreeChunks(idx);
+    xm_free(idx->chunks);
+    xm_free(idx->tree);
+    xm_free(idx);
+    list->index = NULL;
+}
+
+/*******************************链表*************************************/
+
 //创建成功返回链表，失败返回 NULL
 list *listCreate(void)
 {
@@ -14,6 +345,7 @@ list *listCreate(void)
     list->dup = NULL;
     list->free = NULL;
     list->match = NULL;
+    list->index = NULL;
     return list;
 }
 
@@ -32,6 +364,7 @@ void listRelease(list *list)
         xm_free(current);               //释放每个节点
         current = next;
     }
+    listDisableIndex(list);
     xm_free(list); //释放链表结构
 }
 
@@ -54,6 +387,7 @@ list *listAddNodeHead(list *list, void *value)
         list->head = node;
     }
     list->len++;
+    _listIndexPushHead(list, node);
     return list;
 }
 
@@ -76,10 +410,16 @@ list *listAddNodeTail(list *list, void *value)
         list->tail = node;
     }
     list->len++;
+    _listIndexPushTail(list, node);
     return list;
 }
 
 list *listInsertNode(list *list, listNode *old_node, void *value, int after)
+{
+    return listInsertNodeWithIndex(list, old_node, value, after, -1);
+}
+
+list *listInsertNodeWithIndex(list *list, listNode *old_node, void *value, int after, long index)
 {
     listNode *node;
     if ((node = xm_malloc(sizeof(*node))) == NULL)
@@ -99,7 +439,7 @@ list *listInsertNode(list *list, listNode *old_node, void *value, int after)
     else
     {
         node->next = old_node;
-        old_node->prev = node;
+        node->prev = old_node->prev;
         if (list->head == old_node)
         {
             list->head = node;
@@ -115,11 +455,34 @@ list *listInsertNode(list *list, listNode *old_node, void *value, int after)
         node->next->prev = node;
     }
     list->len++;
+    // 插到表头、表尾，或者调用者给出了 old_node 的位置时原地更新索引
+    if (list->head == node)
+        _listIndexPushHead(list, node);
+    else if (list->tail == node)
+        _listIndexPushTail(list, node);
+    else if (index >= 0)
+        _listIndexInsert(list, after ? index + 1 : index, node);
+    else
+        _listIndexInvalidate(list);
     return list;
 }
 
 void listDelNode(list *list, listNode *node)
 {
+    listDelNodeWithIndex(list, node, -1);
+}
+
+void listDelNodeWithIndex(list *list, listNode *node, long index)
+{
+    if (node == list->head)
+        _listIndexPopHead(list);
+    else if (node == list->tail)
+        _listIndexPopTail(list);
+    else if (index >= 0)
+        _listIndexDelete(list, index);
+    else
+        _listIndexInvalidate(list);
+
     if (node->prev != NULL)
         node->prev->next = node->next;
     if (node->next != NULL)
@@ -183,15 +546,16 @@ list *listDup(list *orig)
     list *copy;
     if ((copy = listCreate()) == NULL)
         return NULL;
-    listIter *iter;
+    // 迭代器分配在栈上，不需要释放
+    listIter iter;
     listNode *node;
 
     copy->dup = orig->dup;
     copy->free = orig->free;
     copy->match = orig->match;
 
-    iter = listGetIterator(orig, AL_START_HEAD);
-    while ((node = listNext(iter)) != NULL)
+    listRewind(orig, &iter);
+    while ((node = listNext(&iter)) != NULL)
     {
         void *value;
         //如果链表有设置值复制函数 dup ，那么对值的复制将使用复制函数进行，否则，新节点将和旧节点共享同一个指针
@@ -202,7 +566,6 @@ list *listDup(list *orig)
             if (value == NULL)
             {
                 listRelease(copy);
-                listReleaseIterator(iter);
                 return NULL;
             }
         }
@@ -214,12 +577,9 @@ list *listDup(list *orig)
         if (listAddNodeTail(copy, value) == NULL)
         {
             listRelease(copy);
-            listReleaseIterator(iter);
             return NULL;
         }
     }
-    // 别忘记释放迭代器
-    listReleaseIterator(iter);
     return copy;
 }
 
@@ -228,6 +588,8 @@ void listRotate(list *list)
     listNode *tail = list->tail;
     if (tail == list->head)
         return;
+    _listIndexPopTail(list);
+    _listIndexPushHead(list, tail);
     tail->prev->next = NULL;
     list->tail = tail->prev;
     tail->prev = NULL;
@@ -238,18 +600,17 @@ void listRotate(list *list)
 
 listNode *listSearchKey(list *list, void *key)
 {
-    listIter *iter;
-    iter = listGetIterator(list, AL_START_HEAD);
+    // 迭代器分配在栈上，不需要释放
+    listIter iter;
     listNode *node;
-    while ((node = listNext(iter)) != NULL)
+    listRewind(list, &iter);
+    while ((node = listNext(&iter)) != NULL)
     {
         //对比操作由链表的 match 函数负责进行，如果没有设置 match 函数，那么直接通过对比值的指针来决定是否匹配。
         if (list->match)
         {
             if (list->match(node->value, key))
             {
-                // 别忘记释放迭代器
-                listReleaseIterator(iter);
                 return node;
             }
         }
@@ -257,13 +618,10 @@ listNode *listSearchKey(list *list, void *key)
         {
             if (key == node->value)
             {
-                listReleaseIterator(iter);
                 return node;
             }
         }
     }
-    // 别忘记释放迭代器
-    listReleaseIterator(iter);
     return NULL;
 }
 
@@ -287,6 +645,22 @@ listNode *listIndex(list *list, long index)
         return node;
     }
     */
+    // 有位置索引时直接定位
+    if (list->index)
+    {
+        unsigned long slot;
+        unsigned int off;
+
+        if (index < 0)
+            index += list->len;
+        if (index < 0 || (unsigned long)index >= list->len)
+            return NULL;
+        if (!list->index->valid)
+            _listIndexBuild(list);
+        _listIndexFind(list->index, index, &slot, &off);
+        return list->index->chunks[slot]->nodes[off];
+    }
+
     if (index < 0)
     {
         index = (-index) - 1;
@@ -302,4 +676,112 @@ listNode *listIndex(list *list, long index)
             node = node->next;
     }
     return node;
-}
\ No newline at end of file
+}
+
+list *listInsertNodeAt(list *list, long index, void *value)
+{
+    listNode *old_node, *node;
+
+    if (index < 0 || (unsigned long)index > list->len)
+        return NULL;
+    if (index == 0)
+        return listAddNodeHead(list, value);
+    if ((unsigned long)index == list->len)
+        return listAddNodeTail(list, value);
+
+    // 插到原来第 index 个节点之前
+    old_node = listIndex(list, index);
+    if ((node = xm_malloc(sizeof(*node))) == NULL)
+        return NULL;
+    node->value = value;
+    node->next = old_node;
+    node->prev = old_node->prev;
+    old_node->prev->next = node;
+    old_node->prev = node;
+    list->len++;
+    _listIndexInsert(list, index, node);
+    return list;
+}
+
+/*******************************侵入式链表*************************************/
+
+void ilistInit(ilist *list)
+{
+    list->head.prev = list->head.next = &list->head;
+    list->len = 0;
+}
+
+// 在 prev 和 next 之间插入 node
+static void _ilistLink(ilistNode *prev, ilistNode *node, ilistNode *next)
+{
+    node->prev = prev;
+    node->next = next;
+    prev->next = node;
+    next->prev = node;
+}
+
+void ilistAddHead(ilist *list, ilistNode *node)
+{
+    if (list->head.next == NULL)
+        ilistInit(list);
+    _ilistLink(&list->head, node, list->head.next);
+    list->len++;
+}
+
+void ilistAddTail(ilist *list, ilistNode *node)
+{
+    if (list->head.next == NULL)
+        ilistInit(list);
+    _ilistLink(list->head.prev, node, &list->head);
+    list->len++;
+}
+
+void ilistDel(ilist *list, ilistNode *node)
+{
+    node->prev->next = node->next;
+    node->next->prev = node->prev;
+    node->prev = node->next = NULL;
+    list->len--;
+}
+
+void ilistMove(ilist *dst, ilist *src)
+{
+    ilistInit(dst);
+    if (src->len == 0)
+        return;
+    // 让首尾节点改为指向 dst 的哨兵
+    dst->head.next = src->head.next;
+    dst->head.prev = src->head.prev;
+    dst->head.next->prev = &dst->head;
+    dst->head.prev->next = &dst->head;
+    dst->len = src->len;
+    ilistInit(src);
+}
+
+void ilistRewind(ilist *list, ilistIter *it, int direction)
+{
+    it->end = &list->head;
+    it->direction = direction;
+    // 空链表的哨兵可能还没有初始化
+    if (list->len == 0)
+        it->next = it->end;
+    else if (direction == AL_START_HEAD)
+        it->next = list->head.next;
+    else
+        it->next = list->head.prev;
+}
+
+ilistNode *ilistNext(ilistIter *it)
+{
+    ilistNode *current = it->next;
+
+    // 回到哨兵节点，迭代完毕
+    if (current == it->end)
+        return NULL;
+    // 先记录下一个节点，这样当前节点被删除也不影响迭代
+    if (it->direction == AL_START_HEAD)
+        it->next = current->next;
+    else
+        it->next = current->prev;
+    return current;
+}
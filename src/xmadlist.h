@@ -1,6 +1,8 @@
 #ifndef HXM_ADLIST_H
 #define HXM_ADLIST_H
 
+#include <stddef.h>
+
 //节点
 typedef struct listNode
 {
@@ -9,6 +11,30 @@ typedef struct listNode
     void *value;
 } listNode;
 
+// 位置索引中每个块最多保存的节点指针数量
+#define AL_INDEX_CHUNK_SIZE 256
+
+// 位置索引的块，按顺序保存一段连续节点的指针
+typedef struct listIndexChunk
+{
+    unsigned int count;
+    listNode *nodes[AL_INDEX_CHUNK_SIZE];
+} listIndexChunk;
+
+// 链表的位置索引，由块数组和块大小上的树状数组组成，按索引定位节点为 O(log n)
+// 槽数组两端留有空位，在表头表尾增加块时不需要移动其他块
+typedef struct listNodeIndex
+{
+    // 为 0 时索引已失效，下次按位置访问时重建
+    int valid;
+    // 槽的数量，以及有效槽的范围 [lo, hi)
+    unsigned long size, lo, hi;
+    // 块数组，空位为 NULL
+    listIndexChunk **chunks;
+    // 树状数组，下标从 1 开始，tree[i] 记录若干个连续块的节点数量之和
+    unsigned long *tree;
+} listNodeIndex;
+
 //链表
 typedef struct list
 {
@@ -19,6 +45,8 @@ typedef struct list
     void *(*dup)(void *ptr);            //复制链表节点所保存的值
     void (*free)(void *ptr);            //释放链表节点所保存的值
     int (*match)(void *ptr, void *key); //用于对比链表节点所保存的值和另一个输入值是否相等
+
+    listNodeIndex *index; //位置索引，为 NULL 时按位置访问需要遍历链表
 } list;
 
 //链表迭代器
@@ -55,6 +83,10 @@ list *listAddNodeTail(list *list, void *value);
 list *listInsertNode(list *list, listNode *old_node, void *value, int after);
 // 删除指定结点
 void listDelNode(list *list, listNode *node);
+// 和 listInsertNode 、listDelNode 相同，但调用者给出了节点的位置 index（old_node 或者 node 是第 index 个节点），
+// 在链表中间增删时位置索引原地更新而不是失效。index 为负数时表示位置未知
+list *listInsertNodeWithIndex(list *list, listNode *old_node, void *value, int after, long index);
+void listDelNodeWithIndex(list *list, listNode *node, long index);
 
 //复制整个链表
 list *listDup(list *orig);
@@ -64,6 +96,14 @@ void listRotate(list *list);
 listNode *listSearchKey(list *list, void *key);
 //返回链表在给定索引上的值。 索引以 0 为起始，也可以是负数，-1 表示链表最后一个节点，如果索引超出范围（out of range），返回 NULL
 listNode *listIndex(list *list, long index);
+//将值插入到索引 index 上，插入之后新节点的索引为 index ，index 的范围为 [0, len]
+list *listInsertNodeAt(list *list, long index, void *value);
+//为链表建立位置索引，之后 listIndex 和 listInsertNodeAt 为 O(log n)
+//表头表尾的增删、以及给出了位置的中间增删会同步更新索引，
+//不知道位置时在中间按节点增删会让索引失效，下次按位置访问时重建
+void listEnableIndex(list *list);
+//释放链表的位置索引
+void listDisableIndex(list *list);
 
 // 从表头向表尾进行迭代
 #define AL_START_HEAD 0
@@ -79,4 +119,53 @@ void listRewind(list *list, listIter *li);
 //将迭代器的方向设置为 AL_START_TAIL, 并将迭代指针重新指向表尾节点。
 void listRewindTail(list *list, listIter *li);
 
+/*******************************侵入式链表*************************************/
+// 节点直接嵌入在宿主结构体中，增删节点不需要分配内存，通过 ilistEntry 从节点取回宿主结构体
+// 链表是带哨兵的环形链表，哨兵就是 ilist 中的 head ，所以空链表中 head 的前后指针都指向自己
+// 全部为 0 的 ilist 也是合法的空链表，第一次添加节点时才初始化哨兵，所以可以直接嵌入在全局或 calloc 出的结构体中
+
+//侵入式链表节点
+typedef struct ilistNode
+{
+    struct ilistNode *prev;
+    struct ilistNode *next;
+} ilistNode;
+
+//侵入式链表
+typedef struct ilist
+{
+    ilistNode head;    //哨兵节点
+    unsigned long len; //链表所包含的节点数量
+} ilist;
+
+//侵入式链表迭代器，总是在栈上分配
+typedef struct ilistIter
+{
+    ilistNode *next;  // 下一个要返回的节点
+    ilistNode *end;   // 哨兵节点
+    int direction;    // 迭代的方向
+} ilistIter;
+
+//从节点指针 ptr 取回类型为 type 的宿主结构体，member 为节点在结构体中的成员名
+#define ilistEntry(ptr, type, member) ((type *)((char *)(ptr) - offsetof(type, member)))
+
+#define ilistLength(l) ((l)->len)
+#define ilistFirst(l) ((l)->len ? (l)->head.next : NULL)
+#define ilistLast(l) ((l)->len ? (l)->head.prev : NULL)
+
+//初始化一个空的侵入式链表
+void ilistInit(ilist *list);
+//将节点添加到表头
+void ilistAddHead(ilist *list, ilistNode *node);
+//将节点添加到表尾
+void ilistAddTail(ilist *list, ilistNode *node);
+//将节点从链表中摘下，节点的内存由调用者负责
+void ilistDel(ilist *list, ilistNode *node);
+//将 src 的所有节点按原顺序移动到空链表 dst 中，之后 src 为空链表
+void ilistMove(ilist *dst, ilist *src);
+//初始化栈上的迭代器，direction 为 AL_START_HEAD 或 AL_START_TAIL
+void ilistRewind(ilist *list, ilistIter *it, int direction);
+//返回迭代器当前所指向的节点，并把迭代器往下移，迭代完毕返回 NULL 。允许删除当前节点
+ilistNode *ilistNext(ilistIter *it);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,452 @@
+#include "xmblocked.h"
+#include "xmt_list.h"
+#include "xmt_string.h"
+#include "xmmalloc.h"
+
+#include <assert.h>
+
+static void dictListDestructor(void *privdata, void *val)
+{
+    DICT_NOTUSED(privdata);
+    listRelease((list *)val);
+}
+
+// 键为对象，值为等待这个键的客户端链表
+dictType keylistDictType = {
+    dictEncObjHash,            /* hash function */
+    NULL,                      /* key dup */
+    NULL,                      /* val dup */
+    dictEncObjKeyCompare,      /* key compare */
+    dictRedisObjectDestructor, /* key destructor */
+    dictListDestructor         /* val destructor */
+};
+
+/****************************超时堆******************************/
+
+// 以 bpop.timeout 为序的小根堆，每个客户端记录自己在堆中的位置，
+// 所以客户端提前解除阻塞时也可以在 O(log n) 内从堆中删除
+
+#define bpopHeapTimeout(i) (server.bpop_timeouts[i]->bpop.timeout)
+
+static void bpopHeapSet(unsigned long i, redisClient *c)
+{
+    server.bpop_timeouts[i] = c;
+    c->bpop.heap_index = i;
+}
+
+static void bpopHeapSiftUp(unsigned long i)
+{
+    redisClient *c = server.bpop_timeouts[i];
+
+    while (i > 0 && bpopHeapTimeout((i - 1) / 2) > c->bpop.timeout)
+    {
+        bpopHeapSet(i, server.bpop_timeouts[(i - 1) / 2]);
+        i = (i - 1) / 2;
+    }
+    bpopHeapSet(i, c);
+}
+
+static void bpopHeapSiftDown(unsigned long i)
+{
+    redisClient *c = server.bpop_timeouts[i];
+    unsigned long child;
+
+    while ((child = 2 * i + 1) < server.bpop_timeouts_used)
+    {
+        // 选出较小的子节点
+        if (child + 1 < server.bpop_timeouts_used &&
+            bpopHeapTimeout(child + 1) < bpopHeapTimeout(child))
+            child++;
+        if (bpopHeapTimeout(child) >= c->bpop.timeout)
+            break;
+        bpopHeapSet(i, server.bpop_timeouts[child]);
+        i = child;
+    }
+    bpopHeapSet(i, c);
+}
+
+static void bpopHeapInsert(redisClient *c)
+{
+    if (server.bpop_timeouts_used == server.bpop_timeouts_size)
+    {
+        server.bpop_timeouts_size = server.bpop_timeouts_size ? server.bpop_timeouts_size * 2 : 16;
+        server.bpop_timeouts = xm_realloc(server.bpop_timeouts,
+                                          server.bpop_timeouts_size * sizeof(redisClient *));
+    }
+    bpopHeapSet(server.bpop_timeouts_used, c);
+    bpopHeapSiftUp(server.bpop_timeouts_used++);
+}
+
+static void bpopHeapRemove(redisClient *c)
+{
+    unsigned long i = c->bpop.heap_index;
+    redisClient *last;
+
+    c->bpop.heap_index = -1;
+    last = server.bpop_timeouts[--server.bpop_timeouts_used];
+    if (last == c)
+        return;
+
+    // 用堆的最后一个客户端填补空位，再根据它的超时时间向上或向下调整
+    bpopHeapSet(i, last);
+    if (i > 0 && bpopHeapTimeout((i - 1) / 2) > last->bpop.timeout)
+        bpopHeapSiftUp(i);
+    else
+        bpopHeapSiftDown(i);
+}
+
+/****************************阻塞与解除阻塞******************************/
+
+int getTimeoutFromObjectOrReply(redisClient *c, robj *object, mstime_t *timeout)
+{
+    long long tval;
+
+    if (getLongLongFromObject(object, &tval) != REDIS_OK)
+    {
+        addReplyError(c, "timeout is not an integer or out of range");
+        return REDIS_ERR;
+    }
+
+    if (tval < 0)
+    {
+        addReplyError(c, "timeout is negative");
+        return REDIS_ERR;
+    }
+
+    // 转换成绝对时间，0 仍然表示永不超时
+    if (tval > 0)
+        tval = tval * 1000 + mstime();
+
+    *timeout = tval;
+    return REDIS_OK;
+}
+
+void blockForKeys(redisClient *c, robj **keys, int numkeys, mstime_t timeout, robj *target, int where)
+{
+    dictEntry *de;
+    list *l;
+    int j;
+
+    c->bpop.timeout = timeout;
+    c->bpop.where = where;
+    c->bpop.target = target;
+    if (target != NULL)
+        incrRefCount(target);
+    if (c->bpop.keys == NULL)
+        c->bpop.keys = dictCreate(&setDictType, NULL);
+
+    for (j = 0; j < numkeys; j++)
+    {
+        // 同一个键只阻塞一次
+        if (dictFind(c->bpop.keys, keys[j]) != NULL)
+            continue;
+
+        // 将客户端添加到等待这个键的链表的末尾，先阻塞的客户端先被服务
+        de = dictFind(c->db->blocking_keys, keys[j]);
+        if (de == NULL)
+        {
+            l = listCreate();
+            dictAdd(c->db->blocking_keys, keys[j], l);
+            incrRefCount(keys[j]);
+        }
+        else
+        {
+            l = dictGetVal(de);
+        }
+        listAddNodeTail(l, c);
+
+        // 记下客户端在链表中的节点，解除阻塞时直接删除
+        dictAdd(c->bpop.keys, keys[j], listLast(l));
+        incrRefCount(keys[j]);
+    }
+
+    // 只有设置了超时时间的客户端才进入超时堆
+    c->bpop.heap_index = -1;
+    if (timeout != 0)
+        bpopHeapInsert(c);
+
+    c->flags |= REDIS_BLOCKED;
+    c->btype = REDIS_BLOCKED_LIST;
+    server.bpop_blocked_clients++;
+}
+
+void unblockClient(redisClient *c)
+{
+    dictIterator *di;
+    dictEntry *de, *kde;
+    list *l;
+
+    if (!(c->flags & REDIS_BLOCKED))
+        return;
+
+    // 从每个键的等待链表中删除客户端
+    di = dictGetIterator(c->bpop.keys);
+    while ((de = dictNext(di)) != NULL)
+    {
+        robj *key = dictGetKey(de);
+
+        kde = dictFind(c->db->blocking_keys, key);
+        assert(kde != NULL);
+        l = dictGetVal(kde);
+        listDelNode(l, dictGetVal(de));
+        // 已经没有客户端等待这个键了
+        if (listLength(l) == 0)
+            dictDelete(c->db->blocking_keys, key);
+    }
+    dictReleaseIterator(di);
+    dictEmpty(c->bpop.keys, NULL);
+
+    if (c->bpop.heap_index != -1)
+        bpopHeapRemove(c);
+
+    if (c->bpop.target)
+    {
+        decrRefCount(c->bpop.target);
+        c->bpop.target = NULL;
+    }
+
+    c->flags &= ~REDIS_BLOCKED;
+    c->btype = REDIS_BLOCKED_NONE;
+    server.bpop_blocked_clients--;
+}
+
+void signalListAsReady(redisDb *db, robj *key)
+{
+    readyList *rl;
+
+    // 没有客户端因为这个键阻塞
+    if (dictFind(db->blocking_keys, key) == NULL)
+        return;
+
+    // 键已经被标记为就绪
+    if (dictFind(db->ready_keys, key) != NULL)
+        return;
+
+    rl = xm_malloc(sizeof(*rl));
+    rl->key = key;
+    rl->db = db;
+    incrRefCount(key);
+    ilistAddTail(&server.ready_keys, &rl->node);
+
+    // 同时记录到 db->ready_keys 中，避免同一个键被重复添加
+    incrRefCount(key);
+    dictAdd(db->ready_keys, key, NULL);
+}
+
+/****************************服务阻塞的客户端******************************/
+
+// RPOPLPUSH 的后半部分：将 value 推入 dstkey 的表头，并回复给客户端
+static void rpoplpushHandlePush(redisClient *c, robj *dstkey, robj *dstobj, robj *value)
+{
+    // 目标列表不存在时创建，dbAdd 会让等待目标键的客户端就绪
+    if (dstobj == NULL)
+    {
+        dstobj = createZiplistObject();
+        dbAdd(c->db, dstkey, dstobj);
+    }
+    listTypePush(dstobj, value, REDIS_HEAD);
+    addReplyBulk(c, value);
+}
+
+// 将弹出的 value 回复给被阻塞的客户端 receiver
+// 目标键的类型错误导致 BRPOPLPUSH 无法执行时回复错误并返回 REDIS_ERR ，调用者需要把 value 放回原列表
+static int serveClientBlockedOnList(redisClient *receiver, robj *key, robj *dstkey, robj *value)
+{
+    robj *dstobj;
+
+    // BLPOP 和 BRPOP 回复键名和值
+    if (dstkey == NULL)
+    {
+        addReplyMultiBulkLen(receiver, 2);
+        addReplyBulk(receiver, key);
+        addReplyBulk(receiver, value);
+        return REDIS_OK;
+    }
+
+    // BRPOPLPUSH
+    dstobj = lookupKeyWrite(receiver->db, dstkey);
+    if (dstobj != NULL && dstobj->type != REDIS_LIST)
+    {
+        addReply(receiver, shared.wrongtypeerr);
+        return REDIS_ERR;
+    }
+    rpoplpushHandlePush(receiver, dstkey, dstobj, value);
+    return REDIS_OK;
+}
+
+void handleClientsBlockedOnLists(void)
+{
+    // 服务客户端时可能会让新的键就绪（比如 BRPOPLPUSH 创建了目标列表），
+    // 所以一直处理到 ready_keys 为空
+    while (ilistLength(&server.ready_keys) != 0)
+    {
+        ilist l;
+
+        // 取出当前这一批，新就绪的键进入下一批
+        ilistMove(&l, &server.ready_keys);
+
+        while (ilistLength(&l) != 0)
+        {
+            readyList *rl = ilistEntry(ilistFirst(&l), readyList, node);
+            robj *o;
+
+            ilistDel(&l, &rl->node);
+
+            // 从 db->ready_keys 中删除，之后这个键可以再次被标记为就绪
+            dictDelete(rl->db->ready_keys, rl->key);
+
+            o = lookupKeyWrite(rl->db, rl->key);
+            if (o != NULL && o->type == REDIS_LIST)
+            {
+                dictEntry *de = dictFind(rl->db->blocking_keys, rl->key);
+                if (de)
+                {
+                    list *clients = dictGetVal(de);
+                    int numclients = listLength(clients);
+
+                    // 按阻塞的先后顺序服务客户端，直到列表被弹空
+                    // 最后一个客户端解除阻塞时 clients 会被释放，所以先记下客户端数量
+                    while (numclients--)
+                    {
+                        redisClient *receiver = listFirst(clients)->value;
+                        robj *dstkey = receiver->bpop.target;
+                        int where = receiver->bpop.where;
+                        robj *value = listTypePop(o, where);
+
+                        if (value == NULL)
+                            break;
+
+                        // unblockClient 会释放 target ，服务完之前先保留一个引用
+                        if (dstkey)
+                            incrRefCount(dstkey);
+                        unblockClient(receiver);
+
+                        if (serveClientBlockedOnList(receiver, rl->key, dstkey, value) == REDIS_ERR)
+                            // 目标键类型错误，把值放回去
+                            listTypePush(o, value, where);
+
+                        if (dstkey)
+                            decrRefCount(dstkey);
+                        decrRefCount(value);
+                    }
+                }
+
+                // 列表被弹空时删除键
+                if (listTypeLength(o) == 0)
+                    dbDelete(rl->db, rl->key);
+            }
+
+            decrRefCount(rl->key);
+            xm_free(rl);
+        }
+    }
+}
+
+void handleBlockedClientsTimeout(mstime_t now)
+{
+    redisClient *c;
+
+    // 堆顶就是最早超时的客户端，不需要遍历所有客户端
+    while (server.bpop_timeouts_used != 0 && bpopHeapTimeout(0) <= now)
+    {
+        c = server.bpop_timeouts[0];
+        addReply(c, c->bpop.target ? shared.nullbulk : shared.nullmultibulk);
+        unblockClient(c);
+    }
+}
+
+/****************************命令实现******************************/
+
+static void blockingPopGenericCommand(redisClient *c, int where)
+{
+    robj *o;
+    mstime_t timeout;
+    int j;
+
+    // 最后一个参数是超时时间
+    if (getTimeoutFromObjectOrReply(c, c->argv[c->argc - 1], &timeout) != REDIS_OK)
+        return;
+
+    // 按顺序检查各个键，找到第一个非空列表就直接弹出
+    for (j = 1; j < c->argc - 1; j++)
+    {
+        o = lookupKeyWrite(c->db, c->argv[j]);
+        if (o == NULL)
+            continue;
+        if (o->type != REDIS_LIST)
+        {
+            addReply(c, shared.wrongtypeerr);
+            return;
+        }
+        if (listTypeLength(o) != 0)
+        {
+            robj *value = listTypePop(o, where);
+
+            addReplyMultiBulkLen(c, 2);
+            addReplyBulk(c, c->argv[j]);
+            addReplyBulk(c, value);
+            decrRefCount(value);
+            if (listTypeLength(o) == 0)
+                dbDelete(c->db, c->argv[j]);
+            return;
+        }
+    }
+
+    // 事务中不能阻塞，当作超时处理
+    if (c->flags & REDIS_MULTI)
+    {
+        addReply(c, shared.nullmultibulk);
+        return;
+    }
+
+    // 所有键都为空，阻塞客户端
+    blockForKeys(c, c->argv + 1, c->argc - 2, timeout, NULL, where);
+}
+
+void blpopCommand(redisClient *c)
+{
+    blockingPopGenericCommand(c, REDIS_HEAD);
+}
+
+void brpopCommand(redisClient *c)
+{
+    blockingPopGenericCommand(c, REDIS_TAIL);
+}
+
+void brpoplpushCommand(redisClient *c)
+{
+    mstime_t timeout;
+    robj *srcobj, *dstobj, *value;
+
+    if (getTimeoutFromObjectOrReply(c, c->argv[3], &timeout) != REDIS_OK)
+        return;
+
+    srcobj = lookupKeyWrite(c->db, c->argv[1]);
+    if (srcobj == NULL)
+    {
+        // 事务中不能阻塞
+        if (c->flags & REDIS_MULTI)
+            addReply(c, shared.nullbulk);
+        else
+            blockForKeys(c, c->argv + 1, 1, timeout, c->argv[2], REDIS_TAIL);
+        return;
+    }
+    if (srcobj->type != REDIS_LIST)
+    {
+        addReply(c, shared.wrongtypeerr);
+        return;
+    }
+
+    // 源列表非空，直接执行 RPOPLPUSH
+    dstobj = lookupKeyWrite(c->db, c->argv[2]);
+    if (dstobj != NULL && dstobj->type != REDIS_LIST)
+    {
+        addReply(c, shared.wrongtypeerr);
+        return;
+    }
+    value = listTypePop(srcobj, REDIS_TAIL);
+    rpoplpushHandlePush(c, c->argv[2], dstobj, value);
+    decrRefCount(value);
+    if (listTypeLength(srcobj) == 0)
+        dbDelete(c->db, c->argv[1]);
+}
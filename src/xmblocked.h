@@ -0,0 +1,47 @@
+#ifndef HXM_BLOCKED_H
+#define HXM_BLOCKED_H
+
+#include "xmobject.h"
+#include "xmadlist.h"
+#include "xmredis.h"
+
+#include "xmserver.h"
+#include "xmclient.h"
+#include "xmdb.h"
+
+// 客户端的阻塞类型
+#define REDIS_BLOCKED_NONE 0 // 没有阻塞
+#define REDIS_BLOCKED_LIST 1 // 因为 BLPOP 、 BRPOP 、 BRPOPLPUSH 阻塞
+
+// 记录一个可以解除阻塞的键，保存在 server.ready_keys 中
+typedef struct readyList
+{
+    ilistNode node; // server.ready_keys 中的节点
+    redisDb *db;
+    robj *key;
+} readyList;
+
+// 根据给定对象设置阻塞的超时时间，单位为秒，保存到 *timeout 的是毫秒级的 UNIX 时间戳
+// 对象不是合法的超时时间时向客户端回复错误，并返回 REDIS_ERR
+int getTimeoutFromObjectOrReply(redisClient *c, robj *object, mstime_t *timeout);
+// 让客户端在 numkeys 个键上阻塞，timeout 为 0 表示永不超时
+// target 为 BRPOPLPUSH 的目标键，where 为弹出元素的位置
+void blockForKeys(redisClient *c, robj **keys, int numkeys, mstime_t timeout, robj *target, int where);
+// 解除客户端的阻塞状态，O(键的数量 + log(阻塞客户端数量))
+void unblockClient(redisClient *c);
+
+// 列表键 key 被创建时调用，如果有客户端因为这个键阻塞，那么将它标记为就绪，O(1)
+void signalListAsReady(redisDb *db, robj *key);
+// 为所有就绪的键服务被阻塞的客户端，在每次事件循环结束、进入休眠之前调用
+void handleClientsBlockedOnLists(void);
+// 让所有超时时间不晚于 now 的阻塞客户端超时，由服务器定时调用，O(超时的客户端数量 * log n)
+void handleBlockedClientsTimeout(mstime_t now);
+
+// BLPOP key [key ...] timeout
+void blpopCommand(redisClient *c);
+// BRPOP key [key ...] timeout
+void brpopCommand(redisClient *c);
+// BRPOPLPUSH source destination timeout
+void brpoplpushCommand(redisClient *c);
+
+#endif
@@ -0,0 +1,727 @@
+#include "xmbtree.h"
+#include "xmmalloc.h"
+
+#include "xmt_string.h"
+
+#include <stddef.h>
+#include <string.h>
+
+// 叶子节点不需要子节点数组，只分配到叶子的前后指针为止
+#define ZBT_LEAF_SIZE (offsetof(zbtreeNode, u) + sizeof(((zbtreeNode *)0)->u.leaf))
+#define ZBT_INNER_SIZE (sizeof(zbtreeNode))
+
+// 查找时使用的单调谓词：对树中从小到大排列的元素，返回值是若干个 0 之后跟着若干个 1
+typedef int zbtPredicate(double score, robj *obj, void *arg);
+
+/*************************************************************/
+
+static zbtreeNode *zbtCreateNode(int leaf)
+{
+    zbtreeNode *x = xm_malloc(leaf ? ZBT_LEAF_SIZE : ZBT_INNER_SIZE);
+
+    x->leaf = leaf;
+    x->n = 0;
+    x->objs[0] = NULL;
+    if (leaf)
+        x->u.leaf.prev = x->u.leaf.next = NULL;
+    return x;
+}
+
+// 释放节点及其子树，叶子节点中的成员和内部节点中的分隔键都会减少一个引用
+static void zbtFreeNode(zbtreeNode *x)
+{
+    int i;
+
+    if (x->leaf)
+    {
+        for (i = 0; i < x->n; i++)
+            decrRefCount(x->objs[i]);
+    }
+    else
+    {
+        for (i = 0; i < x->n; i++)
+        {
+            if (i > 0)
+                decrRefCount(x->objs[i]);
+            zbtFreeNode(x->u.inner.children[i]);
+        }
+    }
+    xm_free(x);
+}
+
+zbtree *zbtCreate(void)
+{
+    zbtree *zbt = xm_malloc(sizeof(*zbt));
+
+    zbt->root = zbtCreateNode(1);
+    zbt->head = zbt->tail = zbt->root;
+    zbt->length = 0;
+    zbt->height = 1;
+    return zbt;
+}
+
+void zbtFree(zbtree *zbt)
+{
+    zbtFreeNode(zbt->root);
+    xm_free(zbt);
+}
+
+// 比较 (s1, o1) 和 (s2, o2) 的大小，先比较分值，分值相同时比较成员
+static int zbtCompare(double s1, robj *o1, double s2, robj *o2)
+{
+    if (s1 < s2)
+        return -1;
+    if (s1 > s2)
+        return 1;
+    return compareStringObjects(o1, o2);
+}
+
+// 子树中的元素个数
+static unsigned long zbtNodeCount(zbtreeNode *x)
+{
+    unsigned long count = 0;
+    int i;
+
+    if (x->leaf)
+        return x->n;
+    for (i = 0; i < x->n; i++)
+        count += x->u.inner.counts[i];
+    return count;
+}
+
+// 叶子节点中第一个大于等于 (score, obj) 的元素的下标
+static int zbtLeafLowerBound(zbtreeNode *x, double score, robj *obj)
+{
+    int i = 0;
+
+    // 先按分值跳过，只有分值相同时才需要比较成员
+    while (i < x->n && x->scores[i] < score)
+        i++;
+    while (i < x->n && x->scores[i] == score && compareStringObjects(x->objs[i], obj) < 0)
+        i++;
+    return i;
+}
+
+// 内部节点中 (score, obj) 所在的子节点的下标，也就是最后一个下界小于等于它的子节点
+static int zbtInnerChild(zbtreeNode *x, double score, robj *obj)
+{
+    int i = 1;
+
+    while (i < x->n && zbtCompare(x->scores[i], x->objs[i], score, obj) <= 0)
+        i++;
+    return i - 1;
+}
+
+// 从根节点向下找到第一个使 pred 为真的元素，保存到 *p ，返回它之前的元素个数
+// 没有这样的元素时 p->leaf 为 NULL ，返回值为树的元素个数
+static inline unsigned long zbtSearch(zbtree *zbt, zbtPredicate *pred, void *arg, zbtPos *p)
+{
+    zbtreeNode *x = zbt->root;
+    unsigned long rank = 0;
+    int i;
+
+    while (!x->leaf)
+    {
+        // 分隔键是有序的，找到最后一个使 pred 为假的下界，目标不会在这个子节点之前
+        for (i = 1; i < x->n && !pred(x->scores[i], x->objs[i], arg); i++)
+            rank += x->u.inner.counts[i - 1];
+        x = x->u.inner.children[i - 1];
+    }
+    for (i = 0; i < x->n && !pred(x->scores[i], x->objs[i], arg); i++)
+        ;
+    rank += i;
+
+    // 这个叶子中的元素都不满足，那么目标就是下一个叶子的第一个元素
+    if (i == x->n)
+    {
+        x = x->u.leaf.next;
+        i = 0;
+    }
+    p->leaf = x;
+    p->i = i;
+    return rank;
+}
+
+int zbtNext(zbtPos *p)
+{
+    if (++p->i < p->leaf->n)
+        return 1;
+    p->leaf = p->leaf->u.leaf.next;
+    p->i = 0;
+    return p->leaf != NULL;
+}
+
+int zbtPrev(zbtPos *p)
+{
+    if (--p->i >= 0)
+        return 1;
+    p->leaf = p->leaf->u.leaf.prev;
+    if (p->leaf)
+        p->i = p->leaf->n - 1;
+    return p->leaf != NULL;
+}
+
+/***********************************插入*************************************/
+
+// 在节点 x 的第 i 个位置插入分值和成员，内部节点还要插入子节点和元素个数
+static void zbtNodeInsertAt(zbtreeNode *x, int i, double score, robj *obj, zbtreeNode *child, unsigned long count)
+{
+    int tail = x->n - i;
+
+    memmove(x->scores + i + 1, x->scores + i, tail * sizeof(double));
+    memmove(x->objs + i + 1, x->objs + i, tail * sizeof(robj *));
+    x->scores[i] = score;
+    x->objs[i] = obj;
+    if (!x->leaf)
+    {
+        memmove(x->u.inner.children + i + 1, x->u.inner.children + i, tail * sizeof(zbtreeNode *));
+        memmove(x->u.inner.counts + i + 1, x->u.inner.counts + i, tail * sizeof(unsigned long));
+        x->u.inner.children[i] = child;
+        x->u.inner.counts[i] = count;
+    }
+    x->n++;
+}
+
+// 删除节点 x 的第 i 个位置，不处理被删除的成员对象的引用
+static void zbtNodeDeleteAt(zbtreeNode *x, int i)
+{
+    int tail = x->n - i - 1;
+
+    memmove(x->scores + i, x->scores + i + 1, tail * sizeof(double));
+    memmove(x->objs + i, x->objs + i + 1, tail * sizeof(robj *));
+    if (!x->leaf)
+    {
+        memmove(x->u.inner.children + i, x->u.inner.children + i + 1, tail * sizeof(zbtreeNode *));
+        memmove(x->u.inner.counts + i, x->u.inner.counts + i + 1, tail * sizeof(unsigned long));
+    }
+    x->n--;
+}
+
+// 把已满的节点 x 的后一半移动到新节点中，返回新节点
+// 新节点第一个位置的分值和成员就是它的下界，对内部节点来说这个下界要移交给父节点
+static zbtreeNode *zbtSplit(zbtree *zbt, zbtreeNode *x)
+{
+    zbtreeNode *right = zbtCreateNode(x->leaf);
+    int mid = x->n / 2, moved = x->n - mid;
+
+    memcpy(right->scores, x->scores + mid, moved * sizeof(double));
+    memcpy(right->objs, x->objs + mid, moved * sizeof(robj *));
+    if (x->leaf)
+    {
+        right->u.leaf.prev = x;
+        right->u.leaf.next = x->u.leaf.next;
+        if (x->u.leaf.next)
+            x->u.leaf.next->u.leaf.prev = right;
+        else
+            zbt->tail = right;
+        x->u.leaf.next = right;
+    }
+    else
+    {
+        memcpy(right->u.inner.children, x->u.inner.children + mid, moved * sizeof(zbtreeNode *));
+        memcpy(right->u.inner.counts, x->u.inner.counts + mid, moved * sizeof(unsigned long));
+    }
+    right->n = moved;
+    x->n = mid;
+    return right;
+}
+
+// 把 (score, obj) 插入以 x 为根的子树
+// x 分裂时返回新的右兄弟，*sepscore 和 *sepobj 保存右兄弟的下界，*sepobj 持有一个引用
+static zbtreeNode *zbtInsertNode(zbtree *zbt, zbtreeNode *x, double score, robj *obj,
+                                 double *sepscore, robj **sepobj)
+{
+    zbtreeNode *right = NULL, *child, *newchild;
+    unsigned long newcount;
+    int i;
+
+    if (x->leaf)
+    {
+        i = zbtLeafLowerBound(x, score, obj);
+        if (x->n == ZBT_MAX)
+        {
+            right = zbtSplit(zbt, x);
+            if (i > x->n)
+            {
+                i -= x->n;
+                x = right;
+            }
+        }
+        zbtNodeInsertAt(x, i, score, obj, NULL, 0);
+        if (right)
+        {
+            *sepscore = right->scores[0];
+            *sepobj = right->objs[0];
+            incrRefCount(*sepobj);
+        }
+        return right;
+    }
+
+    i = zbtInnerChild(x, score, obj);
+    child = x->u.inner.children[i];
+    x->u.inner.counts[i]++;
+    newchild = zbtInsertNode(zbt, child, score, obj, sepscore, sepobj);
+    if (newchild == NULL)
+        return NULL;
+
+    // 子节点分裂了，新的右兄弟插入到它的后面
+    newcount = zbtNodeCount(newchild);
+    x->u.inner.counts[i] -= newcount;
+    i++;
+    if (x->n == ZBT_MAX)
+    {
+        right = zbtSplit(zbt, x);
+        if (i > x->n)
+        {
+            i -= x->n;
+            x = right;
+        }
+    }
+    zbtNodeInsertAt(x, i, *sepscore, *sepobj, newchild, newcount);
+    if (right)
+    {
+        // 右兄弟的第一个分隔键上移到父节点
+        *sepscore = right->scores[0];
+        *sepobj = right->objs[0];
+        right->objs[0] = NULL;
+    }
+    return right;
+}
+
+void zbtInsert(zbtree *zbt, double score, robj *obj)
+{
+    zbtreeNode *right, *root;
+    double sepscore;
+    robj *sepobj;
+
+    right = zbtInsertNode(zbt, zbt->root, score, obj, &sepscore, &sepobj);
+    if (right)
+    {
+        // 根节点分裂，树长高一层
+        root = zbtCreateNode(0);
+        root->n = 2;
+        root->u.inner.children[0] = zbt->root;
+        root->u.inner.counts[0] = zbtNodeCount(zbt->root);
+        root->u.inner.children[1] = right;
+        root->u.inner.counts[1] = zbtNodeCount(right);
+        root->scores[1] = sepscore;
+        root->objs[1] = sepobj;
+        zbt->root = root;
+        zbt->height++;
+    }
+    zbt->length++;
+}
+
+/***********************************删除*************************************/
+
+// 内部节点 x 的第 i 个子节点的元素太少，和相邻的兄弟节点合并，或者从兄弟节点借一个
+static void zbtRebalance(zbtree *zbt, zbtreeNode *x, int i)
+{
+    int l = i > 0 ? i - 1 : i, r = l + 1;
+    zbtreeNode *left = x->u.inner.children[l], *right = x->u.inner.children[r];
+    unsigned long count;
+
+    if (left->n + right->n <= ZBT_MAX)
+    {
+        // 把右边的节点合并到左边，父节点中右边节点的下界成为左边节点中的分隔键
+        if (!left->leaf)
+        {
+            right->scores[0] = x->scores[r];
+            right->objs[0] = x->objs[r];
+            memcpy(left->u.inner.children + left->n, right->u.inner.children, right->n * sizeof(zbtreeNode *));
+            memcpy(left->u.inner.counts + left->n, right->u.inner.counts, right->n * sizeof(unsigned long));
+        }
+        else
+        {
+            decrRefCount(x->objs[r]);
+            left->u.leaf.next = right->u.leaf.next;
+            if (right->u.leaf.next)
+                right->u.leaf.next->u.leaf.prev = left;
+            else
+                zbt->tail = left;
+        }
+        memcpy(left->scores + left->n, right->scores, right->n * sizeof(double));
+        memcpy(left->objs + left->n, right->objs, right->n * sizeof(robj *));
+        left->n += right->n;
+        x->u.inner.counts[l] += x->u.inner.counts[r];
+        zbtNodeDeleteAt(x, r);
+        xm_free(right);
+    }
+    else if (i == l)
+    {
+        // 左边的元素太少，把右边节点的第一个元素（子节点）移动到左边
+        if (left->leaf)
+        {
+            zbtNodeInsertAt(left, left->n, right->scores[0], right->objs[0], NULL, 0);
+            zbtNodeDeleteAt(right, 0);
+            decrRefCount(x->objs[r]);
+            x->scores[r] = right->scores[0];
+            x->objs[r] = right->objs[0];
+            incrRefCount(x->objs[r]);
+            count = 1;
+        }
+        else
+        {
+            count = right->u.inner.counts[0];
+            zbtNodeInsertAt(left, left->n, x->scores[r], x->objs[r], right->u.inner.children[0], count);
+            x->scores[r] = right->scores[1];
+            x->objs[r] = right->objs[1];
+            zbtNodeDeleteAt(right, 0);
+            right->objs[0] = NULL;
+        }
+        x->u.inner.counts[l] += count;
+        x->u.inner.counts[r] -= count;
+    }
+    else
+    {
+        // 右边的元素太少，把左边节点的最后一个元素（子节点）移动到右边
+        int last = left->n - 1;
+
+        if (left->leaf)
+        {
+            zbtNodeInsertAt(right, 0, left->scores[last], left->objs[last], NULL, 0);
+            decrRefCount(x->objs[r]);
+            x->scores[r] = right->scores[0];
+            x->objs[r] = right->objs[0];
+            incrRefCount(x->objs[r]);
+            count = 1;
+        }
+        else
+        {
+            count = left->u.inner.counts[last];
+            // 原来的下界成为右边节点第一个子节点之后的分隔键
+            right->scores[0] = x->scores[r];
+            right->objs[0] = x->objs[r];
+            zbtNodeInsertAt(right, 0, 0, NULL, left->u.inner.children[last], count);
+            x->scores[r] = left->scores[last];
+            x->objs[r] = left->objs[last];
+        }
+        left->n--;
+        x->u.inner.counts[l] -= count;
+        x->u.inner.counts[r] += count;
+    }
+}
+
+// 从以 x 为根的子树中删除 (score, obj) ，删除成功返回 1
+static int zbtDeleteNode(zbtree *zbt, zbtreeNode *x, double score, robj *obj)
+{
+    int i;
+
+    if (x->leaf)
+    {
+        i = zbtLeafLowerBound(x, score, obj);
+        if (i == x->n || x->scores[i] != score || !equalStringObjects(x->objs[i], obj))
+            return 0;
+        decrRefCount(x->objs[i]);
+        zbtNodeDeleteAt(x, i);
+        return 1;
+    }
+
+    i = zbtInnerChild(x, score, obj);
+    if (!zbtDeleteNode(zbt, x->u.inner.children[i], score, obj))
+        return 0;
+    x->u.inner.counts[i]--;
+    if (x->u.inner.children[i]->n < ZBT_MIN)
+        zbtRebalance(zbt, x, i);
+    return 1;
+}
+
+int zbtDelete(zbtree *zbt, double score, robj *obj)
+{
+    zbtreeNode *root = zbt->root;
+
+    if (!zbtDeleteNode(zbt, root, score, obj))
+        return 0;
+    // 根节点只剩下一个子节点时，树变矮一层
+    if (!root->leaf && root->n == 1)
+    {
+        zbt->root = root->u.inner.children[0];
+        xm_free(root);
+        zbt->height--;
+    }
+    zbt->length--;
+    return 1;
+}
+
+/***********************************查找*************************************/
+
+static int zbtPredGteMin(double score, robj *obj, void *arg)
+{
+    return zslValueGteMin(score, arg);
+}
+
+static int zbtPredGtMax(double score, robj *obj, void *arg)
+{
+    return !zslValueLteMax(score, arg);
+}
+
+static int zbtPredLexGteMin(double score, robj *obj, void *arg)
+{
+    return zslLexValueGteMin(obj, arg);
+}
+
+static int zbtPredLexGtMax(double score, robj *obj, void *arg)
+{
+    return !zslLexValueLteMax(obj, arg);
+}
+
+// 用来查找给定元素的谓词参数
+typedef struct zbtKey
+{
+    double score;
+    robj *obj;
+} zbtKey;
+
+static int zbtPredGteKey(double score, robj *obj, void *arg)
+{
+    zbtKey *key = arg;
+
+    if (score != key->score)
+        return score > key->score;
+    return compareStringObjects(obj, key->obj) >= 0;
+}
+
+int zbtIsInRange(zbtree *zbt, zrangespec *range)
+{
+    // 先排除总为空的范围值
+    if (range->min > range->max ||
+        (range->min == range->max && (range->minex || range->maxex)))
+        return 0;
+    if (zbt->length == 0)
+        return 0;
+    // 最大的元素小于最小值，或者最小的元素大于最大值
+    if (!zslValueGteMin(zbt->tail->scores[zbt->tail->n - 1], range) ||
+        !zslValueLteMax(zbt->head->scores[0], range))
+        return 0;
+    return 1;
+}
+
+int zbtIsInLexRange(zbtree *zbt, zlexrangespec *range)
+{
+    if (compareStringObjectsForLexRange(range->min, range->max) > 0 ||
+        (compareStringObjects(range->min, range->max) == 0 &&
+         (range->minex || range->maxex)))
+        return 0;
+    if (zbt->length == 0)
+        return 0;
+    if (!zslLexValueGteMin(zbt->tail->objs[zbt->tail->n - 1], range) ||
+        !zslLexValueLteMax(zbt->head->objs[0], range))
+        return 0;
+    return 1;
+}
+
+int zbtFirstInRange(zbtree *zbt, zrangespec *range, zbtPos *p)
+{
+    if (!zbtIsInRange(zbt, range))
+        return 0;
+    zbtSearch(zbt, zbtPredGteMin, range, p);
+    return p->leaf != NULL && zslValueLteMax(zbtPosScore(p), range);
+}
+
+int zbtLastInRange(zbtree *zbt, zrangespec *range, zbtPos *p)
+{
+    if (!zbtIsInRange(zbt, range))
+        return 0;
+    // 找到第一个大于最大值的元素，它的前一个元素就是范围内的最后一个元素
+    zbtSearch(zbt, zbtPredGtMax, range, p);
+    if (p->leaf == NULL)
+    {
+        p->leaf = zbt->tail;
+        p->i = zbt->tail->n - 1;
+    }
+    else if (!zbtPrev(p))
+    {
+        return 0;
+    }
+    return zslValueGteMin(zbtPosScore(p), range);
+}
+
+int zbtFirstInLexRange(zbtree *zbt, zlexrangespec *range, zbtPos *p)
+{
+    if (!zbtIsInLexRange(zbt, range))
+        return 0;
+    zbtSearch(zbt, zbtPredLexGteMin, range, p);
+    return p->leaf != NULL && zslLexValueLteMax(zbtPosObj(p), range);
+}
+
+int zbtLastInLexRange(zbtree *zbt, zlexrangespec *range, zbtPos *p)
+{
+    if (!zbtIsInLexRange(zbt, range))
+        return 0;
+    zbtSearch(zbt, zbtPredLexGtMax, range, p);
+    if (p->leaf == NULL)
+    {
+        p->leaf = zbt->tail;
+        p->i = zbt->tail->n - 1;
+    }
+    else if (!zbtPrev(p))
+    {
+        return 0;
+    }
+    return zslLexValueGteMin(zbtPosObj(p), range);
+}
+
+unsigned long zbtGetRank(zbtree *zbt, double score, robj *o)
+{
+    zbtKey key = {score, o};
+    unsigned long rank;
+    zbtPos p;
+
+    rank = zbtSearch(zbt, zbtPredGteKey, &key, &p);
+    if (p.leaf == NULL || zbtPosScore(&p) != score || !equalStringObjects(zbtPosObj(&p), o))
+        return 0;
+    return rank + 1;
+}
+
+int zbtGetElementByRank(zbtree *zbt, unsigned long rank, zbtPos *p)
+{
+    zbtreeNode *x = zbt->root;
+    int i;
+
+    if (rank < 1 || rank > zbt->length)
+        return 0;
+    // 转换为以 0 为起始值的排位，沿着子树的元素个数向下走
+    rank--;
+    while (!x->leaf)
+    {
+        for (i = 0; rank >= x->u.inner.counts[i]; i++)
+            rank -= x->u.inner.counts[i];
+        x = x->u.inner.children[i];
+    }
+    p->leaf = x;
+    p->i = rank;
+    return 1;
+}
+
+// 返回满足 gte 的第一个元素的排位，还要满足 lte 才算在范围内
+static unsigned long zbtRankOfFirst(zbtree *zbt, zbtPredicate *gte, zbtPredicate *gt, void *range)
+{
+    unsigned long rank;
+    zbtPos p;
+
+    rank = zbtSearch(zbt, gte, range, &p);
+    if (p.leaf == NULL || gt(zbtPosScore(&p), zbtPosObj(&p), range))
+        return 0;
+    return rank + 1;
+}
+
+// 不满足 gt 的元素个数就是最后一个不大于最大值的元素的排位，它还要满足 gte 才算在范围内
+static unsigned long zbtRankOfLast(zbtree *zbt, zbtPredicate *gte, zbtPredicate *gt, void *range)
+{
+    unsigned long rank;
+    zbtPos p;
+
+    rank = zbtSearch(zbt, gt, range, &p);
+    if (rank == 0)
+        return 0;
+    if (p.leaf == NULL)
+    {
+        p.leaf = zbt->tail;
+        p.i = zbt->tail->n - 1;
+    }
+    else
+    {
+        zbtPrev(&p);
+    }
+    return gte(zbtPosScore(&p), zbtPosObj(&p), range) ? rank : 0;
+}
+
+unsigned long zbtRankOfFirstInRange(zbtree *zbt, zrangespec *range)
+{
+    if (!zbtIsInRange(zbt, range))
+        return 0;
+    return zbtRankOfFirst(zbt, zbtPredGteMin, zbtPredGtMax, range);
+}
+
+unsigned long zbtRankOfLastInRange(zbtree *zbt, zrangespec *range)
+{
+    if (!zbtIsInRange(zbt, range))
+        return 0;
+    return zbtRankOfLast(zbt, zbtPredGteMin, zbtPredGtMax, range);
+}
+
+unsigned long zbtRankOfFirstInLexRange(zbtree *zbt, zlexrangespec *range)
+{
+    if (!zbtIsInLexRange(zbt, range))
+        return 0;
+    return zbtRankOfFirst(zbt, zbtPredLexGteMin, zbtPredLexGtMax, range);
+}
+
+unsigned long zbtRankOfLastInLexRange(zbtree *zbt, zlexrangespec *range)
+{
+    if (!zbtIsInLexRange(zbt, range))
+        return 0;
+    return zbtRankOfLast(zbt, zbtPredLexGteMin, zbtPredLexGtMax, range);
+}
+
+/*********************************范围删除***********************************/
+
+// 删除 p 指向的元素，同时从字典中删除
+// 字典和树各持有成员对象的一个引用，先从字典中删除，树中的引用保证比较时对象仍然有效
+static void zbtDeleteAtPos(zbtree *zbt, zbtPos *p, dict *dict)
+{
+    double score = zbtPosScore(p);
+    robj *obj = zbtPosObj(p);
+
+    dictDelete(dict, obj);
+    zbtDelete(zbt, score, obj);
+}
+
+unsigned long zbtDeleteRangeByScore(zbtree *zbt, zrangespec *range, dict *dict)
+{
+    unsigned long removed = 0;
+    zbtPos p;
+
+    // 删除会调整树的结构，每次都重新查找范围内的第一个元素
+    while (zbtFirstInRange(zbt, range, &p))
+    {
+        zbtDeleteAtPos(zbt, &p, dict);
+        removed++;
+    }
+    return removed;
+}
+
+unsigned long zbtDeleteRangeByLex(zbtree *zbt, zlexrangespec *range, dict *dict)
+{
+    unsigned long removed = 0;
+    zbtPos p;
+
+    while (zbtFirstInLexRange(zbt, range, &p))
+    {
+        zbtDeleteAtPos(zbt, &p, dict);
+        removed++;
+    }
+    return removed;
+}
+
+unsigned long zbtDeleteRangeByRank(zbtree *zbt, unsigned int start, unsigned int end, dict *dict)
+{
+    unsigned long removed = 0;
+    zbtPos p;
+
+    // 删除排位为 start 的元素之后，后面的元素依次补上这个排位
+    while (start + removed <= end && zbtGetElementByRank(zbt, start, &p))
+    {
+        zbtDeleteAtPos(zbt, &p, dict);
+        removed++;
+    }
+    return removed;
+}
+
+static size_t zbtNodeBytes(zbtreeNode *x)
+{
+    size_t bytes;
+    int i;
+
+    if (x->leaf)
+        return ZBT_LEAF_SIZE;
+    bytes = ZBT_INNER_SIZE;
+    for (i = 0; i < x->n; i++)
+        bytes += zbtNodeBytes(x->u.inner.children[i]);
+    return bytes;
+}
+
+size_t zbtBytes(zbtree *zbt)
+{
+    return sizeof(*zbt) + zbtNodeBytes(zbt->root);
+}
@@ -0,0 +1,118 @@
+#ifndef HXM_BTREE_H
+#define HXM_BTREE_H
+
+#include "xmobject.h"
+#include "xmdict.h"
+#include "xmskiplist.h"
+
+/*
+带排位信息的 B+ 树，作为有序集合的另一种排序索引
+
+元素按 (score, member) 排序，全部保存在叶子节点中，叶子节点之间用前后指针连成链表。
+内部节点为每个子节点保存一个分隔键和子树中的元素个数，
+所以按排位查找和计算排位都只需要从根走到叶子，复杂度为 O(log N) 。
+
+和跳跃表相比，每个节点连续保存 ZBT_MAX 个分值，查找时在一个节点内顺序比较，
+每层只访问一个节点，缓存未命中的次数远少于跳跃表逐个节点追指针。
+
+分隔键的规则：内部节点中 objs[i] / scores[i]（i >= 1）是第 i 个子节点的下界，
+第 i - 1 个子节点中的所有元素都小于它，第 i 个子节点中的所有元素都大于等于它。
+删除元素时分隔键不一定随之更新，所以分隔键持有成员对象的一个引用。
+*/
+
+// 每个节点最多的元素（子节点）个数
+// 叶子节点的分值数组正好是两个缓存行，在节点内顺序查找时硬件预取可以很好地工作
+#define ZBT_MAX 16
+// 非根节点的元素（子节点）个数小于这个值时，和兄弟节点合并或者从兄弟节点借一个
+#define ZBT_MIN (ZBT_MAX / 4)
+
+typedef struct zbtreeNode
+{
+    // 是否为叶子节点
+    unsigned char leaf;
+    // 叶子节点中为元素个数，内部节点中为子节点个数
+    unsigned char n;
+    // 叶子节点中为元素的分值和成员，内部节点中为子节点的分隔键，下标 0 不使用
+    double scores[ZBT_MAX];
+    robj *objs[ZBT_MAX];
+    union
+    {
+        // 叶子节点：前后相邻的叶子节点
+        struct
+        {
+            struct zbtreeNode *prev, *next;
+        } leaf;
+        // 内部节点：子节点，以及每个子树中的元素个数
+        struct
+        {
+            struct zbtreeNode *children[ZBT_MAX];
+            unsigned long counts[ZBT_MAX];
+        } inner;
+    } u;
+} zbtreeNode;
+
+typedef struct zbtree
+{
+    // 根节点，空树的根是一个空的叶子节点
+    zbtreeNode *root;
+    // 最左和最右的叶子节点
+    zbtreeNode *head, *tail;
+    // 元素个数
+    unsigned long length;
+    // 树的高度，只有一个叶子节点时为 1
+    int height;
+} zbtree;
+
+// 指向树中的一个元素，leaf 为 NULL 时表示不指向任何元素
+typedef struct zbtPos
+{
+    zbtreeNode *leaf;
+    int i;
+} zbtPos;
+
+#define zbtPosScore(p) ((p)->leaf->scores[(p)->i])
+#define zbtPosObj(p) ((p)->leaf->objs[(p)->i])
+
+// 创建一棵空树
+zbtree *zbtCreate(void);
+// 释放树，以及树中所有成员对象的引用
+void zbtFree(zbtree *zbt);
+// 插入成员 obj ，分值为 score ，树接管调用者持有的 obj 的引用
+// 调用者需要保证树中没有相同的成员
+void zbtInsert(zbtree *zbt, double score, robj *obj);
+// 删除分值为 score 的成员 obj ，删除成功返回 1 ，元素不存在返回 0
+int zbtDelete(zbtree *zbt, double score, robj *obj);
+
+// 将 p 移动到下一个（前一个）元素，已经没有元素时返回 0
+int zbtNext(zbtPos *p);
+int zbtPrev(zbtPos *p);
+
+// 如果树中有分值在 range 范围内的元素，返回 1 ，否则返回 0
+int zbtIsInRange(zbtree *zbt, zrangespec *range);
+int zbtIsInLexRange(zbtree *zbt, zlexrangespec *range);
+// 找到第一个（最后一个）在范围内的元素保存到 *p ，找到返回 1 ，否则返回 0
+int zbtFirstInRange(zbtree *zbt, zrangespec *range, zbtPos *p);
+int zbtLastInRange(zbtree *zbt, zrangespec *range, zbtPos *p);
+int zbtFirstInLexRange(zbtree *zbt, zlexrangespec *range, zbtPos *p);
+int zbtLastInLexRange(zbtree *zbt, zlexrangespec *range, zbtPos *p);
+
+// 返回给定成员和分值的元素的排位，以 1 为起始值，元素不存在时返回 0
+unsigned long zbtGetRank(zbtree *zbt, double score, robj *o);
+// 找到排位为 rank 的元素（以 1 为起始值）保存到 *p ，rank 超出范围时返回 0
+int zbtGetElementByRank(zbtree *zbt, unsigned long rank, zbtPos *p);
+// 返回第一个（最后一个）在范围内的元素的排位，以 1 为起始值，没有时返回 0
+unsigned long zbtRankOfFirstInRange(zbtree *zbt, zrangespec *range);
+unsigned long zbtRankOfLastInRange(zbtree *zbt, zrangespec *range);
+unsigned long zbtRankOfFirstInLexRange(zbtree *zbt, zlexrangespec *range);
+unsigned long zbtRankOfLastInLexRange(zbtree *zbt, zlexrangespec *range);
+
+// 删除所有分值（成员）在给定范围之内的元素，同时从字典中删除，返回被删除的元素个数
+unsigned long zbtDeleteRangeByScore(zbtree *zbt, zrangespec *range, dict *dict);
+unsigned long zbtDeleteRangeByLex(zbtree *zbt, zlexrangespec *range, dict *dict);
+// 删除排位在 [start, end] 之内的元素，排位以 1 为起始值，同时从字典中删除
+unsigned long zbtDeleteRangeByRank(zbtree *zbt, unsigned int start, unsigned int end, dict *dict);
+
+// 返回树占用的内存字节数
+size_t zbtBytes(zbtree *zbt);
+
+#endif
@@ -0,0 +1,211 @@
+#include "xmclient.h"
+#include "xmzplist.h"
+#include "xmt_string.h"
+#include "xmredis.h"
+#include "xmmalloc.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+/**************************输出缓冲区****************************************/
+
+// 尝试将回复写入固定大小的回复缓冲区 c->buf
+// 如果 reply 链表中已经有内容，或者 buf 剩余空间不足，那么返回 REDIS_ERR
+static int _addReplyToBuffer(redisClient *c, const char *s, size_t len)
+{
+    size_t available = sizeof(c->buf) - c->bufpos;
+
+    // 一旦开始使用 reply 链表，后面的回复都只能追加到链表中，保证回复的顺序
+    if (ilistLength(&c->reply) > 0)
+        return REDIS_ERR;
+
+    if (len > available)
+        return REDIS_ERR;
+
+    memcpy(c->buf + c->bufpos, s, len);
+    c->bufpos += len;
+    return REDIS_OK;
+}
+
+// 将回复追加到 reply 链表中
+// 先填满表尾块的剩余空间，放不下的部分写入新块，新块至少 REDIS_REPLY_CHUNK_BYTES 字节，
+// 块的节点和缓冲区一起分配，每个块只需要一次内存分配
+static void _addReplyStringToList(redisClient *c, const char *s, size_t len)
+{
+    ilistNode *ln = ilistLast(&c->reply);
+    clientReplyBlock *tail;
+    size_t avail, size;
+
+    if (ln != NULL)
+    {
+        tail = ilistEntry(ln, clientReplyBlock, node);
+        avail = tail->size - tail->used;
+        if (avail > len)
+            avail = len;
+        memcpy(tail->buf + tail->used, s, avail);
+        tail->used += avail;
+        s += avail;
+        len -= avail;
+    }
+
+    if (len > 0)
+    {
+        size = len > REDIS_REPLY_CHUNK_BYTES ? len : REDIS_REPLY_CHUNK_BYTES;
+        tail = xm_malloc(sizeof(*tail) + size);
+        tail->size = size;
+        tail->used = len;
+        memcpy(tail->buf, s, len);
+        ilistAddTail(&c->reply, &tail->node);
+        c->reply_bytes += size;
+    }
+}
+
+// 释放回复链表中的所有块
+void freeClientReplyList(redisClient *c)
+{
+    ilistIter it;
+    ilistNode *ln;
+
+    ilistRewind(&c->reply, &it, AL_START_HEAD);
+    while ((ln = ilistNext(&it)) != NULL)
+    {
+        ilistDel(&c->reply, ln);
+        xm_free(ilistEntry(ln, clientReplyBlock, node));
+    }
+    c->reply_bytes = 0;
+}
+
+void addReplyString(redisClient *c, char *s, size_t len)
+{
+    if (_addReplyToBuffer(c, s, len) != REDIS_OK)
+        _addReplyStringToList(c, s, len);
+}
+
+/**************************回复协议****************************************/
+
+void addReply(redisClient *c, robj *obj)
+{
+    char buf[32];
+    int len;
+
+    if (obj->encoding == REDIS_ENCODING_INT)
+    {
+        len = ll2string(buf, sizeof(buf), (long)obj->ptr);
+        addReplyString(c, buf, len);
+    }
+    else
+    {
+        addReplyString(c, obj->ptr, sdslen(obj->ptr));
+    }
+}
+
+void addReplyError(redisClient *c, char *err)
+{
+    addReplyString(c, "-ERR ", 5);
+    addReplyString(c, err, strlen(err));
+    addReplyString(c, "\r\n", 2);
+}
+
+void addReplyLongLongWithPrefix(redisClient *c, long long ll, char prefix)
+{
+    char buf[128];
+    int len;
+
+    // 格式化到栈上的缓冲区，不需要分配内存
+    buf[0] = prefix;
+    len = ll2string(buf + 1, sizeof(buf) - 1, ll);
+    buf[len + 1] = '\r';
+    buf[len + 2] = '\n';
+    addReplyString(c, buf, len + 3);
+}
+
+void addReplyLongLong(redisClient *c, long long ll)
+{
+    addReplyLongLongWithPrefix(c, ll, ':');
+}
+
+void addReplyMultiBulkLen(redisClient *c, long length)
+{
+    addReplyLongLongWithPrefix(c, length, '*');
+}
+
+void addReplyBulkCBuffer(redisClient *c, void *p, size_t len)
+{
+    addReplyLongLongWithPrefix(c, len, '$');
+    addReplyString(c, p, len);
+    addReplyString(c, "\r\n", 2);
+}
+
+void addReplyBulkLongLong(redisClient *c, long long ll)
+{
+    char buf[64];
+    int len;
+
+    len = ll2string(buf, sizeof(buf), ll);
+    addReplyBulkCBuffer(c, buf, len);
+}
+
+void addReplyDouble(redisClient *c, double d)
+{
+    char buf[128];
+    int len;
+
+    if (isinf(d))
+    {
+        addReplyBulkCBuffer(c, d > 0 ? "inf" : "-inf", d > 0 ? 3 : 4);
+        return;
+    }
+    len = snprintf(buf, sizeof(buf), "%.17g", d);
+    addReplyBulkCBuffer(c, buf, len);
+}
+
+void addReplyBulk(redisClient *c, robj *obj)
+{
+    // 整数编码的对象直接格式化，不用先转换成字符串对象
+    if (obj->encoding == REDIS_ENCODING_INT)
+        addReplyBulkLongLong(c, (long)obj->ptr);
+    else
+        addReplyBulkCBuffer(c, obj->ptr, sdslen(obj->ptr));
+}
+
+void addReplyZiplistEntry(redisClient *c, unsigned char *p)
+{
+    unsigned char *vstr;
+    unsigned int vlen;
+    long long vlong;
+
+    // vstr 指向 ziplist 内部的字节，直接复制到输出缓冲区
+    if (!ziplistGet(p, &vstr, &vlen, &vlong))
+        return;
+    if (vstr)
+        addReplyBulkCBuffer(c, vstr, vlen);
+    else
+        addReplyBulkLongLong(c, vlong);
+}
+
+// 占位块最多需要保存 *<20 位整数>\r\n
+#define REDIS_DEFERRED_LEN_BYTES 32
+
+void *addDeferredMultiBulkLength(redisClient *c)
+{
+    clientReplyBlock *b = xm_malloc(sizeof(*b) + REDIS_DEFERRED_LEN_BYTES);
+
+    // size 为 0 ，_addReplyStringToList 不会往这个块中写入，后面的回复都进入新块
+    b->size = 0;
+    b->used = 0;
+    ilistAddTail(&c->reply, &b->node);
+    return b;
+}
+
+void setDeferredMultiBulkLength(redisClient *c, void *node, long length)
+{
+    clientReplyBlock *b = node;
+
+    b->buf[0] = '*';
+    b->used = 1 + ll2string(b->buf + 1, REDIS_DEFERRED_LEN_BYTES - 3, length);
+    b->buf[b->used++] = '\r';
+    b->buf[b->used++] = '\n';
+    b->size = b->used;
+    c->reply_bytes += b->size;
+}
@@ -1,6 +1,70 @@
 #ifndef HXM_CLIENT_H
 #define HXM_CLIENT_H
 
+#include "xmobject.h"
+#include "xmsds.h"
+#include "xmadlist.h"
+#include "xmdict.h"
+#include "xmredis.h"
+
+// 客户端固定回复缓冲区的大小
+#define REDIS_REPLY_CHUNK_BYTES (16*1024)
+
+// 客户端状态标志
+#define REDIS_MULTI (1 << 3)   // 客户端正处于事务中
+#define REDIS_BLOCKED (1 << 4) // 客户端正因为 BLPOP 等命令而阻塞
+#define REDIS_STREAMING (1 << 5) // 客户端的回复正在分批生成，生成完之前不处理新的命令
+
+// 回复链表中的一个块，节点和缓冲区在同一次分配中
+typedef struct clientReplyBlock
+{
+    ilistNode node; // 回复链表中的节点
+    size_t size;    // buf 的容量
+    size_t used;    // buf 中已经使用的字节数
+    char buf[];
+} clientReplyBlock;
+
+// 客户端因为 BLPOP 、 BRPOP 、 BRPOPLPUSH 而阻塞时的状态
+typedef struct blockingState
+{
+    // 阻塞的超时时间，UNIX 时间戳，单位为毫秒，为 0 表示永不超时
+    mstime_t timeout;
+    // 客户端在超时堆中的位置，不在堆中时为 -1
+    long heap_index;
+    // 造成客户端阻塞的键，值为客户端在该键的等待链表中的节点，解除阻塞时不需要查找链表
+    dict *keys;
+    // BRPOPLPUSH 的目标键，其他命令为 NULL
+    robj *target;
+    // 从列表的表头还是表尾弹出
+    int where;
+} blockingState;
+
+// 大哈希的 HGETALL 等命令分批回复时的状态，每个事件循环只生成一个时间片的回复
+typedef struct streamingState
+{
+    ilistNode node;       // server.streaming_clients 中的节点
+    robj *o;              // 正在回复的对象，持有一个引用
+    unsigned long cursor; // dictScan 的游标
+    int flags;            // 回复域还是值，REDIS_HASH_KEY 和 REDIS_HASH_VALUE 的组合
+    void *lenblock;       // 多条批量回复长度的占位块，回复完毕时填入
+    long emitted;         // 已经回复的元素个数
+} streamingState;
+
+// 事务队列中的一个命令
+typedef struct multiCmd
+{
+    robj **argv;              // 参数
+    int argc;                 // 参数数量
+    struct redisCommand *cmd; // 命令的实现函数
+} multiCmd;
+
+// 事务状态
+typedef struct multiState
+{
+    multiCmd *commands; // 事务队列，按入队的顺序排列
+    int count;          // 已入队的命令数量
+} multiState;
+
 typedef struct redisClient
 {
 
@@ -52,8 +116,8 @@ typedef struct redisClient
     // 输出缓冲区
     char buf[REDIS_REPLY_CHUNK_BYTES]; // 固定大小的回复缓冲区
     int bufpos;                        // 回复偏移量，buf数组中已经使用的字节量
-    list *reply;                       // 可变大小的输出缓冲区，回复链表
-    unsigned long reply_bytes;         // 回复链表中对象的总大小
+    ilist reply;                       // 可变大小的输出缓冲区，clientReplyBlock 组成的回复链表
+    unsigned long reply_bytes;         // 回复链表中块的总大小
 
     // 已发送字节，处理 short write 用
     int sentlen; /* Amount of bytes already sent in the current
@@ -102,23 +166,77 @@ typedef struct redisClient
     // 阻塞状态
     blockingState bpop; /* blocking state */
 
+    // 分批回复的状态，带有 REDIS_STREAMING 标志时有效
+    streamingState stream;
+
     // 最后被写入的全局复制偏移量
     long long woff; /* Last write global replication offset. */
 
-    // 被监视的键
-    list *watched_keys; /* Keys WATCHED for MULTI/EXEC CAS */
+    // 被监视的键，由 watchedKey 结构组成
+    ilist watched_keys; /* Keys WATCHED for MULTI/EXEC CAS */
 
     // 这个字典记录了客户端所有订阅的频道
     // 键为频道名字，值为 NULL
     // 也即是，一个频道的集合
     dict *pubsub_channels; /* channels a client is interested in (SUBSCRIBE) */
 
-    // 链表，包含多个 pubsubPattern 结构
+    // 链表，包含多个 pubsubPattern 结构，通过 pubsubPattern.client_node 链接
     // 记录了所有订阅频道的客户端的信息
     // 新 pubsubPattern 结构总是被添加到表尾
-    list *pubsub_patterns; /* patterns a client is interested in (SUBSCRIBE) */
+    ilist pubsub_patterns; /* patterns a client is interested in (SUBSCRIBE) */
     sds peerid;            /* Cached peer ID. */
 
 } redisClient;
 
+// 客户端 WATCH 的一个键
+typedef struct watchedKey
+{
+    ilistNode node; // redisClient.watched_keys 中的节点
+    robj *key;
+    redisDb *db;
+} watchedKey;
+
+// 一个模式订阅，同时位于 server.pubsub_patterns 和订阅客户端的 pubsub_patterns 中
+typedef struct pubsubPattern
+{
+    ilistNode server_node; // server.pubsub_patterns 中的节点
+    ilistNode client_node; // redisClient.pubsub_patterns 中的节点
+    redisClient *client;
+    robj *pattern;
+} pubsubPattern;
+
+/**************************回复函数****************************************/
+// 回复先写入固定大小的 buf ，写满之后再追加到 reply 链表中
+// 这些函数不会为回复内容创建 robj ，字符串和整数都直接格式化到输出缓冲区
+
+// 释放回复链表中的所有块
+void freeClientReplyList(redisClient *c);
+// 将长度为 len 的 s 原样追加到回复中
+void addReplyString(redisClient *c, char *s, size_t len);
+// 以 prefix 开头，追加整数 ll 并以 \r\n 结尾，例如 *<count>\r\n
+void addReplyLongLongWithPrefix(redisClient *c, long long ll, char prefix);
+// 将对象保存的字符串原样追加到回复中
+void addReply(redisClient *c, robj *obj);
+// 回复一个错误 -ERR <err>\r\n
+void addReplyError(redisClient *c, char *err);
+// 回复一个整数 :<ll>\r\n
+void addReplyLongLong(redisClient *c, long long ll);
+// 回复多条批量回复的长度 *<length>\r\n
+void addReplyMultiBulkLen(redisClient *c, long length);
+// 回复一个 C 缓冲区中的批量回复 $<len>\r\n<p>\r\n
+void addReplyBulkCBuffer(redisClient *c, void *p, size_t len);
+// 将整数格式化为批量回复
+void addReplyBulkLongLong(redisClient *c, long long ll);
+// 将浮点数格式化为批量回复，无穷大回复 inf 或者 -inf
+void addReplyDouble(redisClient *c, double d);
+// 将字符串对象作为批量回复
+void addReplyBulk(redisClient *c, robj *obj);
+// 直接从 ziplist 节点 p 中取值作为批量回复，整数节点就地格式化
+void addReplyZiplistEntry(redisClient *c, unsigned char *p);
+// 在回复中为还不知道的多条批量回复长度占一个位置，返回占位的块
+// 之后的回复都会追加到 reply 链表中，占位块本身不接收内容
+void *addDeferredMultiBulkLength(redisClient *c);
+// 把长度 length 填入 addDeferredMultiBulkLength 返回的占位块
+void setDeferredMultiBulkLength(redisClient *c, void *node, long length);
+
 #endif
\ No newline at end of file
@@ -1,5 +1,17 @@
 #include "xmdb.h"
+#include "xmblocked.h"
+#include "xmt_string.h"
+#include "xmt_zset.h"
+#include "xmintset.h"
+#include "xmroaring.h"
+#include "xmzplist.h"
+
 #include <assert.h>
+#include <ctype.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <strings.h>
 
 int removeExpire(redisDb *db, robj *key)
 {
@@ -174,6 +186,10 @@ void dbAdd(redisDb *db, robj *key, robj *val)
     // 如果键已经存在，那么停止
     assert(retval == REDIS_OK);
 
+    // 新建的列表键可能正有客户端在等待
+    if (val->type == REDIS_LIST)
+        signalListAsReady(db, key);
+
     // 如果开启了集群模式，那么将键保存到槽里面
     //if (server.cluster_enabled)
     //slotToKeyAdd(key);
@@ -314,4 +330,256 @@ int selectDb(redisClient *c, int id)
     c->db = &server.db[id];
 
     return REDIS_OK;
-}
\ No newline at end of file
+}
+
+/****************************SCAN******************************/
+
+// 不带 COUNT 选项时每次返回的元素个数
+#define REDIS_SCAN_DEFAULT_COUNT 10
+// 字典很稀疏时 dictScan 访问的大多是空桶，最多访问 COUNT 的这个倍数个桶就返回
+#define REDIS_SCAN_MAX_ITERATIONS_FACTOR 10
+// 压缩位图的游标是下一个元素的值，符号位取反之后按无符号数保存，游标 0 正好对应最小的元素
+#define REDIS_SCAN_ROARING_BIAS ((unsigned long)1 << 63)
+
+// dictScan 的回调，privdata[0] 为保存结果的链表，privdata[1] 为被迭代的对象，为 NULL 时迭代的是数据库
+// 链表中的对象都持有一个引用，回复之后统一释放
+static void scanCallback(void *privdata, const dictEntry *de)
+{
+    void **pd = privdata;
+    list *keys = pd[0];
+    robj *o = pd[1];
+    robj *key, *val = NULL;
+
+    if (o == NULL)
+    {
+        // 数据库的键是 sds ，要复制一份，过期检查可能会删除这个键
+        sds sdskey = dictGetKey(de);
+        key = createStringObject(sdskey, sdslen(sdskey));
+    }
+    else
+    {
+        key = dictGetKey(de);
+        incrRefCount(key);
+        if (o->type == REDIS_HASH && o->encoding == REDIS_ENCODING_INTHT)
+        {
+            val = createStringObjectFromLongLong(dictGetSignedIntegerVal(de));
+        }
+        else if (o->type == REDIS_HASH)
+        {
+            val = dictGetVal(de);
+            incrRefCount(val);
+        }
+        else if (o->type == REDIS_ZSET && (o->encoding == REDIS_ENCODING_BTREE || o->encoding == REDIS_ENCODING_TSERIES))
+        {
+            val = createStringObjectFromLongDouble(dictGetDoubleVal(de));
+        }
+        else if (o->type == REDIS_ZSET)
+        {
+            val = createStringObjectFromLongDouble(zsetNodeFromKey(key)->score);
+        }
+    }
+
+    listAddNodeTail(keys, key);
+    if (val)
+        listAddNodeTail(keys, val);
+}
+
+int parseScanCursorOrReply(redisClient *c, robj *o, unsigned long *cursor)
+{
+    char *eptr;
+
+    // 游标是无符号整数，不能有多余的字符
+    errno = 0;
+    *cursor = strtoul(o->ptr, &eptr, 10);
+    if (isspace(((char *)o->ptr)[0]) || eptr[0] != '\0' || errno == ERANGE)
+    {
+        addReplyError(c, "invalid cursor");
+        return REDIS_ERR;
+    }
+    return REDIS_OK;
+}
+
+void scanGenericCommand(redisClient *c, robj *o, unsigned long cursor)
+{
+    list *keys = listCreate();
+    listNode *node;
+    long long count = REDIS_SCAN_DEFAULT_COUNT;
+    dict *ht = NULL;
+    char buf[32];
+    int i;
+
+    // 1. 解析选项，SCAN cursor 之后从第 2 个参数开始，HSCAN key cursor 之后从第 3 个参数开始
+    // 只支持 COUNT 选项，不支持 MATCH 选项
+    for (i = (o == NULL) ? 2 : 3; i < c->argc; i += 2)
+    {
+        if (!strcasecmp(c->argv[i]->ptr, "count") && i + 1 < c->argc)
+        {
+            if (getLongLongFromObject(c->argv[i + 1], &count) != REDIS_OK)
+            {
+                addReplyError(c, "value is not an integer or out of range");
+                goto cleanup;
+            }
+            if (count < 1)
+            {
+                addReplyError(c, "syntax error");
+                goto cleanup;
+            }
+        }
+        else
+        {
+            addReplyError(c, "syntax error");
+            goto cleanup;
+        }
+    }
+
+    // 2. 迭代元素
+    if (o == NULL)
+        ht = c->db->dict;
+    else if ((o->type == REDIS_SET || o->type == REDIS_HASH) && o->encoding == REDIS_ENCODING_HT)
+        ht = o->ptr;
+    else if (o->type == REDIS_HASH && o->encoding == REDIS_ENCODING_INTHT)
+        ht = o->ptr;
+    else if (o->type == REDIS_ZSET && (o->encoding == REDIS_ENCODING_SKIPLIST || o->encoding == REDIS_ENCODING_BTREE ||
+                                       o->encoding == REDIS_ENCODING_TSERIES))
+        ht = ((zset *)o->ptr)->dict;
+
+    if (ht)
+    {
+        // 字典编码时 COUNT 只是一个提示，dictScan 每次迭代一个桶，返回的元素个数可能多于 COUNT
+        void *privdata[2];
+        long long maxiterations = count * REDIS_SCAN_MAX_ITERATIONS_FACTOR;
+
+        privdata[0] = keys;
+        privdata[1] = o;
+        do
+        {
+            cursor = dictScan(ht, cursor, scanCallback, privdata);
+        } while (cursor && maxiterations-- && listLength(keys) < (unsigned long)count);
+    }
+    else if (o->encoding == REDIS_ENCODING_ROARING)
+    {
+        // 压缩位图可能非常大，按值的顺序每次返回 COUNT 个元素，
+        // 游标记录下一个元素的值，两次调用之间的增删不会让一直存在的元素被跳过
+        roaringIterator it;
+        int64_t v;
+        long long n = 0;
+
+        roaringInitIteratorFrom(o->ptr, &it, (int64_t)(cursor ^ REDIS_SCAN_ROARING_BIAS));
+        cursor = 0;
+        while (roaringNext(&it, &v))
+        {
+            if (n == count)
+            {
+                cursor = (unsigned long)v ^ REDIS_SCAN_ROARING_BIAS;
+                break;
+            }
+            listAddNodeTail(keys, createStringObjectFromLongLong(v));
+            n++;
+        }
+    }
+    else if (o->encoding == REDIS_ENCODING_LEXSET)
+    {
+        // 成员序列没有字典，按字典序每次返回 COUNT 个元素，
+        // 游标是下一个元素之前的元素个数加上累计删除过的元素个数，两次调用之间删除了元素时起点往前退，
+        // 一直存在的元素不会被跳过，最多被重复返回
+        zlexset *zlx = ((zset *)o->ptr)->zlx;
+        unsigned long rank = cursor > zlx->deleted ? cursor - zlx->deleted : 0;
+        long long n = 0;
+        zlxPos p;
+
+        zlxPosInit(&p, zlx);
+        cursor = 0;
+        if (zlxGetElementByRank(zlx, rank + 1, &p))
+        {
+            do
+            {
+                if (n == count)
+                {
+                    cursor = rank + n + zlx->deleted;
+                    break;
+                }
+                listAddNodeTail(keys, createStringObject(zlxPosKey(&p), sdslen(zlxPosKey(&p))));
+                listAddNodeTail(keys, createStringObjectFromLongDouble(zlx->score));
+                n++;
+            } while (zlxNext(&p));
+        }
+        zlxPosRelease(&p);
+    }
+    else if (o->encoding == REDIS_ENCODING_INTSET)
+    {
+        // intset 和 ziplist 的元素个数都有上限，一次全部返回
+        int64_t ll;
+        uint32_t pos = 0;
+
+        while (intsetGet(o->ptr, pos++, &ll))
+            listAddNodeTail(keys, createStringObjectFromLongLong(ll));
+        cursor = 0;
+    }
+    else if (o->encoding == REDIS_ENCODING_ZIPLIST)
+    {
+        // 哈希和有序集合的 ziplist 中域和值（成员和分值）交替保存，按顺序返回即可
+        unsigned char *p = ziplistIndex(o->ptr, 0);
+        unsigned char *vstr;
+        unsigned int vlen;
+        long long vll;
+
+        while (p)
+        {
+            ziplistGet(p, &vstr, &vlen, &vll);
+            listAddNodeTail(keys, vstr ? createStringObject((char *)vstr, vlen) : createStringObjectFromLongLong(vll));
+            p = ziplistNext(o->ptr, p);
+        }
+        cursor = 0;
+    }
+    else
+    {
+        // redisPanic("Not handled encoding in SCAN.");
+    }
+
+    // 3. 迭代数据库时，跳过已经过期的键
+    if (o == NULL)
+    {
+        node = listFirst(keys);
+        while (node)
+        {
+            listNode *next = listNextNode(node);
+            robj *kobj = listNodeValue(node);
+
+            if (expireIfNeeded(c->db, kobj))
+            {
+                decrRefCount(kobj);
+                listDelNode(keys, node);
+            }
+            node = next;
+        }
+    }
+
+    // 4. 回复游标和元素，游标可能超出 long long 的范围，按无符号数格式化
+    addReplyMultiBulkLen(c, 2);
+    addReplyBulkCBuffer(c, buf, snprintf(buf, sizeof(buf), "%lu", cursor));
+    addReplyMultiBulkLen(c, listLength(keys));
+    while ((node = listFirst(keys)) != NULL)
+    {
+        robj *kobj = listNodeValue(node);
+        addReplyBulk(c, kobj);
+        decrRefCount(kobj);
+        listDelNode(keys, node);
+    }
+
+cleanup:
+    while ((node = listFirst(keys)) != NULL)
+    {
+        decrRefCount(listNodeValue(node));
+        listDelNode(keys, node);
+    }
+    listRelease(keys);
+}
+
+void scanCommand(redisClient *c)
+{
+    unsigned long cursor;
+
+    if (parseScanCursorOrReply(c, c->argv[1], &cursor) == REDIS_ERR)
+        return;
+    scanGenericCommand(c, NULL, cursor);
+}
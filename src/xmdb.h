@@ -109,7 +109,12 @@ unsigned int getKeysInSlot(unsigned int hashslot, robj **keys, unsigned int coun
 unsigned int countKeysInSlot(unsigned int hashslot);
 unsigned int delKeysInSlot(unsigned int hashslot);
 int verifyClusterConfigWithData(void);
+// SCAN 、 HSCAN 、 SSCAN 、 ZSCAN 的通用实现，o 为 NULL 时迭代当前数据库，支持 COUNT 选项
+// 字典编码时基于 dictScan ，压缩位图按值的顺序分批返回，其他紧凑编码一次返回全部元素，游标为 0
 void scanGenericCommand(redisClient *c, robj *o, unsigned long cursor);
+// 把 o 解析为 SCAN 的游标，不是合法的游标时向客户端回复错误，并返回 REDIS_ERR
 int parseScanCursorOrReply(redisClient *c, robj *o, unsigned long *cursor);
+// SCAN cursor [COUNT count]
+void scanCommand(redisClient *c);
 
 #endif
@@ -5,6 +5,7 @@
 #include <limits.h>
 #include <assert.h>
 #include "xmmalloc.h"
+#include "xmrand.h"
 #include "xmdict.h"
 
 /* 通过 dictEnableResize() 和 dictDisableResize() 两个函数，
@@ -30,8 +31,6 @@ static int _dictReset(dictht *ht);
 static int _dictExpandIfNeeded(dict *d);
 // 返回可以将 key 插入到哈希表的索引位置,如果 key 已经存在于哈希表，那么返回 -1
 static int _dictKeyIndex(dict *d, const void *key);
-// 在字典中插入key，返回插入的那个节点
-static dictEntry *dictAddRaw(dict *d, void *key);
 // 删除字典中给定的键值
 static int dictGenericDelete(dict *d, const void *key, int nofree);
 // 翻转二进制字符
@@ -205,7 +204,7 @@ int dictAdd(dict *d, void *key, void *val)
     return DICT_OK;
 }
 
-static dictEntry *dictAddRaw(dict *d, void *key)
+dictEntry *dictAddRaw(dict *d, void *key)
 {
     int index;
     dictEntry *entry;
@@ -245,7 +244,7 @@ int dictReplace(dict *d, void *key, void *val)
     return 0;
 }
 
-static dictEntry *dictReplaceRaw(dict *d, void *key)
+dictEntry *dictReplaceRaw(dict *d, void *key)
 {
     // 使用 key 在字典中查找节点
     dictEntry *entry = dictFind(d, key);
@@ -640,7 +639,7 @@ dictEntry *dictGetRandomKey(dict *d)
     {
         do
         {
-            h = random() % (d->ht[0].size + d->ht[1].size);
+            h = xm_random_below(d->ht[0].size + d->ht[1].size);
             he = (h >= d->ht[0].size) ? d->ht[1].table[h - d->ht[0].size] : d->ht[0].table[h];
         } while (he == NULL);
     }
@@ -649,7 +648,7 @@ dictEntry *dictGetRandomKey(dict *d)
     {
         do
         {
-            h = random() & d->ht[0].sizemask;
+            h = xm_random() & d->ht[0].sizemask;
             he = d->ht[0].table[h];
         } while (he == NULL);
     }
@@ -664,7 +663,7 @@ dictEntry *dictGetRandomKey(dict *d)
         listlen++;
     }
     // 取模，得出随机节点的索引
-    listele = random() % listlen;
+    listele = xm_random_below(listlen);
     he = orighe;
     // 按索引查找节点
     while (listele--)
@@ -689,7 +688,7 @@ int dictGetRandomKeys(dict *d, dictEntry **des, int count)
         for (j = 0; j < 2; j++)
         {
             // 随机得到一个开始的索引值
-            unsigned int i = random() & d->ht[j].sizemask;
+            unsigned int i = xm_random() & d->ht[j].sizemask;
             int size = d->ht[j].size;
 
             //保证每个桶都被搜查了一遍
@@ -28,6 +28,7 @@ typedef struct dictEntry
         void *val;
         uint64_t u64;
         int64_t s64;
+        double d;
     } v;
     //指向另一个哈希表节点的指针， 这个指针可以将多个哈希值相同的键值对连接在一次， 以此来解决键冲突（collision）的问题。
     struct dictEntry *next;
@@ -65,10 +66,14 @@ typedef struct dictType
 
 // 哈希对象中字典的默认特定函数结构
 extern dictType hashDictType;
+// 值都是整数的哈希对象使用的字典，值保存在节点的 v.s64 中，没有值对象
+extern dictType hashIntDictType;
 // 集合对象中字典的默认特定函数结构
 extern dictType setDictType;
 // 有序集合对象中字典的默认特定函数结构
 extern dictType zsetDictType;
+// 键为对象，值为链表的字典，用于 db->blocking_keys
+extern dictType keylistDictType;
 
 //字典
 typedef struct dict
@@ -138,6 +143,13 @@ typedef struct dictIterator
         entry->v.u64 = _val_;                   \
     } while (0)
 
+// 将一个浮点数设为节点的值
+#define dictSetDoubleVal(entry, _val_) \
+    do                                 \
+    {                                  \
+        entry->v.d = _val_;            \
+    } while (0)
+
 // 释放给定字典节点的键
 #define dictFreeKey(d, entry)     \
     if ((d)->type->keyDestructor) \
@@ -168,6 +180,8 @@ typedef struct dictIterator
 #define dictGetSignedIntegerVal(he) ((he)->v.s64)
 // 返回给定节点的无符号整数值
 #define dictGetUnsignedIntegerVal(he) ((he)->v.u64)
+// 返回给定节点的浮点数值
+#define dictGetDoubleVal(he) ((he)->v.d)
 // 返回给定字典的大小，两个哈希表都要统计
 #define dictSlots(d) ((d)->ht[0].size + (d)->ht[1].size)
 // 返回字典的已有节点数量
@@ -185,6 +199,8 @@ int htNeedsResize(dict *dict);
 int dictResize(dict *d);
 // 尝试将给定键值对添加到字典中，只有给定键 key 不存在于字典时，添加操作才会成功,成功返回1失败返回0
 int dictAdd(dict *d, void *key, void *val);
+// 在字典中插入 key ，返回插入的节点，由调用者设置节点的值。键已经存在时返回 NULL
+dictEntry *dictAddRaw(dict *d, void *key);
 // 返回包含该key值的节点，可能是已存在的，不存在则是是新创建的
 dictEntry *dictReplaceRaw(dict *d, void *key);
 // 将给定的键值对添加到字典里面， 如果键已经存在于字典，那么用新值取代原有的值。键是新加的返回1，取代的返回0
@@ -262,6 +278,8 @@ unsigned int dictGenCaseHashFunction(const unsigned char *buf, int len);
 // extern dictType dictTypeHeapStringCopyKeyValue;
 
 unsigned int dictEncObjHash(const void *key);
+// 比较两个 sds 键是否相等
+int dictSdsKeyCompare(void *privdata, const void *key1, const void *key2);
 int dictEncObjKeyCompare(void *privdata, const void *key1, const void *key2);
 void dictRedisObjectDestructor(void *privdata, void *val);
 
@@ -0,0 +1,366 @@
+#include "xmgeohash.h"
+
+#include <stddef.h>
+
+// 计算距离使用的地球半径，单位为米
+#define EARTH_RADIUS_IN_METERS 6372797.560856
+// 墨卡托投影下赤道长度的一半
+#define MERCATOR_MAX 20037726.37
+
+#define D_R (M_PI / 180.0)
+
+static inline double deg_rad(double ang) { return ang * D_R; }
+static inline double rad_deg(double ang) { return ang / D_R; }
+
+/*********************************按位交错***********************************/
+
+// 把 x 的 32 位分散到结果的偶数位上，y 的 32 位分散到奇数位上
+// 每一步把相邻的两半拉开一倍的距离，只用移位和掩码，没有循环和分支
+static inline uint64_t interleave64(uint32_t xlo, uint32_t ylo)
+{
+    static const uint64_t B[] = {0x5555555555555555ULL, 0x3333333333333333ULL, 0x0F0F0F0F0F0F0F0FULL,
+                                 0x00FF00FF00FF00FFULL, 0x0000FFFF0000FFFFULL};
+    static const unsigned int S[] = {1, 2, 4, 8, 16};
+    uint64_t x = xlo, y = ylo;
+
+    x = (x | (x << S[4])) & B[4];
+    y = (y | (y << S[4])) & B[4];
+    x = (x | (x << S[3])) & B[3];
+    y = (y | (y << S[3])) & B[3];
+    x = (x | (x << S[2])) & B[2];
+    y = (y | (y << S[2])) & B[2];
+    x = (x | (x << S[1])) & B[1];
+    y = (y | (y << S[1])) & B[1];
+    x = (x | (x << S[0])) & B[0];
+    y = (y | (y << S[0])) & B[0];
+
+    return x | (y << 1);
+}
+
+// interleave64 的逆运算，偶数位收拢到结果的低 32 位，奇数位收拢到高 32 位
+static inline uint64_t deinterleave64(uint64_t interleaved)
+{
+    static const uint64_t B[] = {0x5555555555555555ULL, 0x3333333333333333ULL, 0x0F0F0F0F0F0F0F0FULL,
+                                 0x00FF00FF00FF00FFULL, 0x0000FFFF0000FFFFULL, 0x00000000FFFFFFFFULL};
+    static const unsigned int S[] = {0, 1, 2, 4, 8, 16};
+    uint64_t x = interleaved, y = interleaved >> 1;
+
+    x = (x | (x >> S[0])) & B[0];
+    y = (y | (y >> S[0])) & B[0];
+    x = (x | (x >> S[1])) & B[1];
+    y = (y | (y >> S[1])) & B[1];
+    x = (x | (x >> S[2])) & B[2];
+    y = (y | (y >> S[2])) & B[2];
+    x = (x | (x >> S[3])) & B[3];
+    y = (y | (y >> S[3])) & B[3];
+    x = (x | (x >> S[4])) & B[4];
+    y = (y | (y >> S[4])) & B[4];
+    x = (x | (x >> S[5])) & B[5];
+    y = (y | (y >> S[5])) & B[5];
+
+    return x | (y << 32);
+}
+
+/*********************************编码和解码***********************************/
+
+int geohashEncode(double longitude, double latitude, uint8_t step, GeoHashBits *hash)
+{
+    double lat_offset, long_offset;
+
+    if (hash == NULL || step == 0 || step > GEO_STEP_MAX)
+        return 0;
+    if (longitude < GEO_LONG_MIN || longitude > GEO_LONG_MAX ||
+        latitude < GEO_LAT_MIN || latitude > GEO_LAT_MAX)
+        return 0;
+
+    // 归一化到 [0, 2^step) ，正好落在上边界的坐标归入最后一个格子
+    lat_offset = (latitude - GEO_LAT_MIN) / (GEO_LAT_MAX - GEO_LAT_MIN) * (1ULL << step);
+    long_offset = (longitude - GEO_LONG_MIN) / (GEO_LONG_MAX - GEO_LONG_MIN) * (1ULL << step);
+    if (lat_offset >= (1ULL << step))
+        lat_offset = (1ULL << step) - 1;
+    if (long_offset >= (1ULL << step))
+        long_offset = (1ULL << step) - 1;
+
+    hash->bits = interleave64((uint32_t)lat_offset, (uint32_t)long_offset);
+    hash->step = step;
+    return 1;
+}
+
+int geohashDecode(GeoHashBits hash, GeoHashArea *area)
+{
+    uint64_t hash_sep;
+    uint32_t ilato, ilono;
+    double lat_scale = GEO_LAT_MAX - GEO_LAT_MIN;
+    double long_scale = GEO_LONG_MAX - GEO_LONG_MIN;
+
+    if (GEOHASH_IS_ZERO(hash) || area == NULL)
+        return 0;
+
+    hash_sep = deinterleave64(hash.bits);
+    ilato = (uint32_t)hash_sep;
+    ilono = (uint32_t)(hash_sep >> 32);
+
+    area->hash = hash;
+    area->latitude.min = GEO_LAT_MIN + (ilato * 1.0 / (1ULL << hash.step)) * lat_scale;
+    area->latitude.max = GEO_LAT_MIN + ((ilato + 1) * 1.0 / (1ULL << hash.step)) * lat_scale;
+    area->longitude.min = GEO_LONG_MIN + (ilono * 1.0 / (1ULL << hash.step)) * long_scale;
+    area->longitude.max = GEO_LONG_MIN + ((ilono + 1) * 1.0 / (1ULL << hash.step)) * long_scale;
+    return 1;
+}
+
+int geohashDecodeToLongLat(GeoHashBits hash, double *longitude, double *latitude)
+{
+    GeoHashArea area;
+
+    if (!geohashDecode(hash, &area))
+        return 0;
+
+    // 取格子的中心，浮点误差可能让它稍微越过边界
+    *longitude = (area.longitude.min + area.longitude.max) / 2;
+    *latitude = (area.latitude.min + area.latitude.max) / 2;
+    if (*longitude > GEO_LONG_MAX)
+        *longitude = GEO_LONG_MAX;
+    if (*longitude < GEO_LONG_MIN)
+        *longitude = GEO_LONG_MIN;
+    if (*latitude > GEO_LAT_MAX)
+        *latitude = GEO_LAT_MAX;
+    if (*latitude < GEO_LAT_MIN)
+        *latitude = GEO_LAT_MIN;
+    return 1;
+}
+
+int geohashEncodeScore(double longitude, double latitude, uint64_t *score)
+{
+    GeoHashBits hash;
+
+    if (!geohashEncode(longitude, latitude, GEO_STEP_MAX, &hash))
+        return 0;
+    *score = hash.bits;
+    return 1;
+}
+
+int geohashDecodeScore(uint64_t score, double *longitude, double *latitude)
+{
+    GeoHashBits hash = {score, GEO_STEP_MAX};
+
+    return geohashDecodeToLongLat(hash, longitude, latitude);
+}
+
+void geohashScoreRange(GeoHashBits hash, uint64_t *min, uint64_t *max)
+{
+    // 低位补 0 对齐到 52 位，下一个格子的起点就是这个格子的上界
+    *min = hash.bits << (GEO_STEP_MAX * 2 - hash.step * 2);
+    *max = (hash.bits + 1) << (GEO_STEP_MAX * 2 - hash.step * 2);
+}
+
+/*********************************相邻格子***********************************/
+
+// 经度方向移动一个格子，经度在奇数位上。越过 ±180 度时自然回绕到另一边
+static void geohashMoveX(GeoHashBits *hash, int d)
+{
+    uint64_t x = hash->bits & 0xaaaaaaaaaaaaaaaaULL;
+    uint64_t y = hash->bits & 0x5555555555555555ULL;
+    uint64_t zz = 0x5555555555555555ULL >> (64 - hash->step * 2);
+
+    // 把偶数位都置 1 之后做加减法，进位和借位会穿过这些位，只作用在奇数位上
+    if (d > 0)
+    {
+        x = x + (zz + 1);
+    }
+    else
+    {
+        x = x | zz;
+        x = x - (zz + 1);
+    }
+    x &= (0xaaaaaaaaaaaaaaaaULL >> (64 - hash->step * 2));
+    hash->bits = x | y;
+}
+
+// 纬度方向移动一个格子，纬度在偶数位上
+static void geohashMoveY(GeoHashBits *hash, int d)
+{
+    uint64_t x = hash->bits & 0xaaaaaaaaaaaaaaaaULL;
+    uint64_t y = hash->bits & 0x5555555555555555ULL;
+    uint64_t zz = 0xaaaaaaaaaaaaaaaaULL >> (64 - hash->step * 2);
+
+    if (d > 0)
+    {
+        y = y + (zz + 1);
+    }
+    else
+    {
+        y = y | zz;
+        y = y - (zz + 1);
+    }
+    y &= (0x5555555555555555ULL >> (64 - hash->step * 2));
+    hash->bits = x | y;
+}
+
+void geohashNeighbors(const GeoHashBits *hash, GeoHashNeighbors *neighbors)
+{
+    neighbors->east = *hash;
+    neighbors->west = *hash;
+    neighbors->north = *hash;
+    neighbors->south = *hash;
+    neighbors->south_east = *hash;
+    neighbors->south_west = *hash;
+    neighbors->north_east = *hash;
+    neighbors->north_west = *hash;
+
+    geohashMoveX(&neighbors->east, 1);
+    geohashMoveX(&neighbors->west, -1);
+    geohashMoveY(&neighbors->north, 1);
+    geohashMoveY(&neighbors->south, -1);
+
+    geohashMoveX(&neighbors->south_east, 1);
+    geohashMoveY(&neighbors->south_east, -1);
+    geohashMoveX(&neighbors->south_west, -1);
+    geohashMoveY(&neighbors->south_west, -1);
+    geohashMoveX(&neighbors->north_east, 1);
+    geohashMoveY(&neighbors->north_east, 1);
+    geohashMoveX(&neighbors->north_west, -1);
+    geohashMoveY(&neighbors->north_west, 1);
+}
+
+/*********************************半径查询***********************************/
+
+// 找到边长不小于 range_meters 的最小格子对应的 step
+static uint8_t geohashEstimateStepsByRadius(double range_meters, double lat)
+{
+    int step = 1;
+
+    if (range_meters == 0)
+        return GEO_STEP_MAX;
+    while (range_meters < MERCATOR_MAX)
+    {
+        range_meters *= 2;
+        step++;
+    }
+    // 留出余量，保证 9 个格子能覆盖整个圆
+    step -= 2;
+
+    // 高纬度的格子在经度方向上很窄，需要更大的格子
+    if (lat > 66 || lat < -66)
+    {
+        step--;
+        if (lat > 80 || lat < -80)
+            step--;
+    }
+
+    if (step < 1)
+        step = 1;
+    if (step > GEO_STEP_MAX)
+        step = GEO_STEP_MAX;
+    return step;
+}
+
+// 包含整个圆的经纬度矩形，bounds 依次为最小经度、最小纬度、最大经度、最大纬度
+static void geohashBoundingBox(double longitude, double latitude, double radius, double *bounds)
+{
+    bounds[0] = longitude - rad_deg(radius / EARTH_RADIUS_IN_METERS / cos(deg_rad(latitude)));
+    bounds[2] = longitude + rad_deg(radius / EARTH_RADIUS_IN_METERS / cos(deg_rad(latitude)));
+    bounds[1] = latitude - rad_deg(radius / EARTH_RADIUS_IN_METERS);
+    bounds[3] = latitude + rad_deg(radius / EARTH_RADIUS_IN_METERS);
+}
+
+int geohashGetAreasByRadius(double longitude, double latitude, double radius, GeoHashRadius *r)
+{
+    GeoHashArea area, north, south, east, west;
+    GeoHashNeighbors *n = &r->neighbors;
+    const GeoHashBits zero = {0, 0};
+    double bounds[4];
+    uint8_t steps;
+
+    geohashBoundingBox(longitude, latitude, radius, bounds);
+    steps = geohashEstimateStepsByRadius(radius, latitude);
+
+    if (!geohashEncode(longitude, latitude, steps, &r->hash))
+        return 0;
+    geohashNeighbors(&r->hash, n);
+    geohashDecode(r->hash, &area);
+
+    // 圆心靠近格子边缘时，估计的格子可能太小，相邻的格子覆盖不到圆的边缘，这时换成大一级的格子
+    geohashDecode(n->north, &north);
+    geohashDecode(n->south, &south);
+    geohashDecode(n->east, &east);
+    geohashDecode(n->west, &west);
+    if (steps > 1 && (north.latitude.max < bounds[3] || south.latitude.min > bounds[1] ||
+                      east.longitude.max < bounds[2] || west.longitude.min > bounds[0]))
+    {
+        steps--;
+        geohashEncode(longitude, latitude, steps, &r->hash);
+        geohashNeighbors(&r->hash, n);
+        geohashDecode(r->hash, &area);
+    }
+
+    // 圆没有越过中心格子的某条边时，那一侧的格子不需要查询
+    // 只有一级的格子太大，这样判断的误差也大，保留所有格子
+    if (steps >= 2)
+    {
+        if (area.latitude.min < bounds[1])
+        {
+            n->south = zero;
+            n->south_west = zero;
+            n->south_east = zero;
+        }
+        if (area.latitude.max > bounds[3])
+        {
+            n->north = zero;
+            n->north_east = zero;
+            n->north_west = zero;
+        }
+        if (area.longitude.min < bounds[0])
+        {
+            n->west = zero;
+            n->south_west = zero;
+            n->north_west = zero;
+        }
+        if (area.longitude.max > bounds[2])
+        {
+            n->east = zero;
+            n->south_east = zero;
+            n->north_east = zero;
+        }
+    }
+    r->area = area;
+    return 1;
+}
+
+/*********************************距离***********************************/
+
+double geohashGetDistance(double lon1, double lat1, double lon2, double lat2)
+{
+    GeoHashCircle c;
+
+    geohashCircleInit(&c, lon1, lat1, 0);
+    return geohashHavToDistance(geohashCircleHav(&c, lon2, lat2));
+}
+
+void geohashCircleInit(GeoHashCircle *c, double longitude, double latitude, double radius)
+{
+    double s, half = radius / EARTH_RADIUS_IN_METERS / 2;
+
+    c->lonr = deg_rad(longitude);
+    c->latr = deg_rad(latitude);
+    c->coslat = cos(c->latr);
+    // 距离 d 的半正矢值为 sin(d / 2R)^2 ，半径超过半个地球周长时包含所有位置
+    if (half >= M_PI / 2)
+    {
+        c->maxhav = 1.0;
+    }
+    else
+    {
+        s = sin(half);
+        c->maxhav = s * s;
+    }
+}
+
+double geohashHavToDistance(double hav)
+{
+    // 浮点误差可能让 hav 稍微超出 [0, 1]
+    if (hav < 0)
+        hav = 0;
+    if (hav > 1)
+        hav = 1;
+    return 2.0 * EARTH_RADIUS_IN_METERS * asin(sqrt(hav));
+}
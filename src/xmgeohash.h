@@ -0,0 +1,117 @@
+#ifndef HXM_GEOHASH_H
+#define HXM_GEOHASH_H
+
+#include <stdint.h>
+#include <math.h>
+
+/*
+地理位置索引使用的 geohash 编码
+
+经度和纬度各自归一化之后取 26 位整数，按位交错成一个 52 位整数：纬度占偶数位，经度占奇数位。
+这个整数可以用 double 精确表示，直接作为有序集合的分值保存，所以地理位置索引就是一个普通的有序集合。
+
+只保留高 2 * step 位时，相当于把地图划分成 2^step * 2^step 个格子，
+同一个格子中的所有位置的分值落在一个连续的区间 [min, max) 中。
+半径查询先根据半径选择格子的大小，使中心所在的格子和周围的 8 个格子能覆盖整个圆，
+再对这 9 个分值区间分别做范围查询，最后用球面距离过滤掉圆外的位置。
+*/
+
+// 每个坐标最多使用的位数，两个坐标交错之后一共 52 位
+#define GEO_STEP_MAX 26
+
+// 和 EPSG:3857 的范围一致，超过这个纬度的位置不能编码
+#define GEO_LAT_MIN -85.05112878
+#define GEO_LAT_MAX 85.05112878
+#define GEO_LONG_MIN -180
+#define GEO_LONG_MAX 180
+
+typedef struct
+{
+    // 交错之后的编码，只有低 2 * step 位有效
+    uint64_t bits;
+    uint8_t step;
+} GeoHashBits;
+
+typedef struct
+{
+    double min;
+    double max;
+} GeoHashRange;
+
+// 一个编码对应的格子
+typedef struct
+{
+    GeoHashBits hash;
+    GeoHashRange longitude;
+    GeoHashRange latitude;
+} GeoHashArea;
+
+// 周围的 8 个格子，不需要查询的格子的 bits 和 step 都为 0
+typedef struct
+{
+    GeoHashBits north;
+    GeoHashBits east;
+    GeoHashBits west;
+    GeoHashBits south;
+    GeoHashBits north_east;
+    GeoHashBits south_east;
+    GeoHashBits north_west;
+    GeoHashBits south_west;
+} GeoHashNeighbors;
+
+// 覆盖一次半径查询的 9 个格子
+typedef struct
+{
+    GeoHashBits hash;
+    GeoHashArea area;
+    GeoHashNeighbors neighbors;
+} GeoHashRadius;
+
+// 半径查询的圆，只和圆心有关的三角函数预先算好
+// 候选位置只需要算出半正矢值 hav 和 maxhav 比较，不用算反三角函数，
+// hav 随距离单调递增，排序也直接按 hav 进行，只有回复距离时才换算成米
+typedef struct
+{
+    double lonr, latr;
+    double coslat;
+    double maxhav;
+} GeoHashCircle;
+
+#define GEOHASH_IS_ZERO(h) ((h).bits == 0 && (h).step == 0)
+
+// 把 (longitude, latitude) 编码为 2 * step 位的 geohash ，坐标超出范围时返回 0
+int geohashEncode(double longitude, double latitude, uint8_t step, GeoHashBits *hash);
+// 把 hash 解码为它对应的格子
+int geohashDecode(GeoHashBits hash, GeoHashArea *area);
+// 把 hash 解码为格子中心的坐标
+int geohashDecodeToLongLat(GeoHashBits hash, double *longitude, double *latitude);
+// 计算 hash 周围的 8 个格子
+void geohashNeighbors(const GeoHashBits *hash, GeoHashNeighbors *neighbors);
+
+// 52 位编码和有序集合分值之间的转换
+int geohashEncodeScore(double longitude, double latitude, uint64_t *score);
+int geohashDecodeScore(uint64_t score, double *longitude, double *latitude);
+// 格子中所有位置的分值所在的区间 [*min, *max)
+void geohashScoreRange(GeoHashBits hash, uint64_t *min, uint64_t *max);
+
+// 选择格子的大小并计算覆盖以 (longitude, latitude) 为圆心、半径为 radius 米的圆的 9 个格子
+int geohashGetAreasByRadius(double longitude, double latitude, double radius, GeoHashRadius *r);
+
+// 两个位置之间的球面距离，单位为米
+double geohashGetDistance(double lon1, double lat1, double lon2, double lat2);
+// 初始化半径为 radius 米的圆
+void geohashCircleInit(GeoHashCircle *c, double longitude, double latitude, double radius);
+// 计算位置到圆心的半正矢值，位置在圆内时不超过 c->maxhav
+// 查询时对每个候选位置都要调用，定义在头文件中以便内联
+static inline double geohashCircleHav(const GeoHashCircle *c, double longitude, double latitude)
+{
+    double latr = latitude * (M_PI / 180.0);
+    double u = sin((latr - c->latr) / 2);
+    double v = sin((longitude * (M_PI / 180.0) - c->lonr) / 2);
+
+    return u * u + c->coslat * cos(latr) * v * v;
+}
+// 把半正矢值换算成距离，单位为米
+double geohashHavToDistance(double hav);
+
+#endif
@@ -6,8 +6,13 @@
 
 #include "xmintset.h"
 #include "xmmalloc.h"
+#include "xmrand.h"
 #include "xmendianconv.h"
 
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
 
 // 返回适用于传入值 v 的编码方式
 static uint8_t _intsetValueEncoding(int64_t v)
@@ -91,6 +96,7 @@ intset *intsetNew(void)
     // 初始的编码方式是int16
     is->encoding = intrev32ifbe(INTSET_ENC_INT16);
     is->length = 0;
+    return is;
 }
 
 //调整整数集合的内存空间大小，使其能容纳len个元素
@@ -108,10 +114,9 @@ static intset *intsetResize(intset *is, uint32_t len)
     return is;
 }
 
-// 在集合 is 的底层数组中查找值 value 所在的索引。
-// 成功找到 value 时，函数返回 1 ，并将 *pos 的值设为 value 所在的索引。
-// 没有找到时返回0，并将 *pos 的值设为 value 可以插入到数组中的位置。如果后面有元素需要后移
-static uint8_t intsetSearch(intset *is, int64_t value, uint32_t *pos)
+#if (BYTE_ORDER != LITTLE_ENDIAN)
+// 通用的二分查找，每次比较都通过 _intsetGet 解码，用于大端法的主机
+static uint8_t _intsetSearchGeneric(intset *is, int64_t value, uint32_t *pos)
 {
     //采用二分法查找，先初始化min,max和mid
     int min = 0, max = intrev32ifbe(is->length) - 1, mid = -1;
@@ -178,6 +183,127 @@ static uint8_t intsetSearch(intset *is, int64_t value, uint32_t *pos)
         return 0;
     }
 }
+#endif
+
+/****************************按编码特化的查找******************************/
+
+// 底层数组按小端法保存，在小端法主机上可以直接把 contents 当作对应类型的数组访问，
+// 所以为三种编码各生成一组查找函数，比较时不再需要 memcpy 和字节序转换
+//
+// _intsetLowerBoundXX(a, n, v) 返回有序数组 a[0..n) 中第一个不小于 v 的元素的索引：
+//   先做无分支的二分查找（循环体中的条件赋值会被编译成 cmov ，不会有分支预测失败），
+//   剩下的范围不超过一个缓存行时，统计其中小于 v 的元素个数，
+//   这一步在支持 AVX2 时每次比较 32 字节，否则由编译器自动向量化
+// _intsetGallopXX(a, from, n, v) 从 from 开始以 1, 2, 4, ... 的步长向后试探，
+//   再在最后一段里做 _intsetLowerBoundXX ，查找位置靠近 from 时只需要 O(log 距离)
+
+// 一个缓存行的字节数
+#define INTSET_CACHE_LINE 64
+
+#define INTSET_SEARCH_KERNELS(T, suffix)                                      \
+    static uint32_t _intsetLowerBound##suffix(const T *a, uint32_t n, T v)    \
+    {                                                                         \
+        const T *base = a;                                                    \
+        uint32_t len = n, half, i, cnt = 0;                                   \
+        while (len > INTSET_CACHE_LINE / sizeof(T))                           \
+        {                                                                     \
+            half = len / 2;                                                   \
+            base = (base[half - 1] < v) ? base + half : base;                 \
+            len -= half;                                                      \
+        }                                                                     \
+        i = _intsetCountLess##suffix(base, len, v, &cnt);                     \
+        for (; i < len; i++)                                                  \
+            cnt += base[i] < v;                                               \
+        return (base - a) + cnt;                                              \
+    }                                                                         \
+                                                                              \
+    static uint32_t _intsetGallop##suffix(const T *a, uint32_t from, uint32_t n, T v) \
+    {                                                                         \
+        uint32_t step = 1, lo = from, hi;                                     \
+        if (from >= n || a[from] >= v)                                        \
+            return from;                                                      \
+        while (lo + step < n && a[lo + step] < v)                             \
+        {                                                                     \
+            lo += step;                                                       \
+            step <<= 1;                                                       \
+        }                                                                     \
+        hi = (lo + step < n) ? lo + step : n;                                 \
+        return lo + 1 + _intsetLowerBound##suffix(a + lo + 1, hi - lo - 1, v);\
+    }
+
+// 统计 a[0..len) 开头若干个完整向量中小于 v 的元素个数，累加到 *cnt ，返回已经处理的元素个数
+#ifdef __AVX2__
+#define INTSET_COUNT_LESS_AVX2(T, suffix, set1)                               \
+    static uint32_t _intsetCountLess##suffix(const T *a, uint32_t len, T v, uint32_t *cnt) \
+    {                                                                         \
+        const uint32_t width = 32 / sizeof(T);                                \
+        __m256i key = _mm256_set1_epi##set1(v);                               \
+        uint32_t i;                                                           \
+        for (i = 0; i + width <= len; i += width)                             \
+        {                                                                     \
+            __m256i block = _mm256_loadu_si256((const __m256i *)(a + i));     \
+            /* key > block 的位置全为 1 ，每个元素占 sizeof(T) 个字节 */          \
+            uint32_t mask = _mm256_movemask_epi8(_mm256_cmpgt_epi##suffix(key, block)); \
+            *cnt += __builtin_popcount(mask) / sizeof(T);                     \
+        }                                                                     \
+        return i;                                                             \
+    }
+
+INTSET_COUNT_LESS_AVX2(int16_t, 16, 16)
+INTSET_COUNT_LESS_AVX2(int32_t, 32, 32)
+INTSET_COUNT_LESS_AVX2(int64_t, 64, 64x)
+#else
+#define INTSET_COUNT_LESS_SCALAR(T, suffix)                                   \
+    static uint32_t _intsetCountLess##suffix(const T *a, uint32_t len, T v, uint32_t *cnt) \
+    {                                                                         \
+        (void)a, (void)len, (void)v, (void)cnt;                               \
+        return 0;                                                             \
+    }
+
+INTSET_COUNT_LESS_SCALAR(int16_t, 16)
+INTSET_COUNT_LESS_SCALAR(int32_t, 32)
+INTSET_COUNT_LESS_SCALAR(int64_t, 64)
+#endif
+
+INTSET_SEARCH_KERNELS(int16_t, 16)
+INTSET_SEARCH_KERNELS(int32_t, 32)
+INTSET_SEARCH_KERNELS(int64_t, 64)
+
+// 在集合 is 的底层数组中查找值 value 所在的索引。
+// 成功找到 value 时，函数返回 1 ，并将 *pos 的值设为 value 所在的索引。
+// 没有找到时返回0，并将 *pos 的值设为 value 可以插入到数组中的位置。如果后面有元素需要后移
+// 调用者需要保证 value 可以用集合当前的编码表示
+static uint8_t intsetSearch(intset *is, int64_t value, uint32_t *pos)
+{
+#if (BYTE_ORDER == LITTLE_ENDIAN)
+    uint32_t len = is->length, p;
+    uint8_t found;
+
+    if (is->encoding == INTSET_ENC_INT64)
+    {
+        const int64_t *a = (const int64_t *)is->contents;
+        p = _intsetLowerBound64(a, len, value);
+        found = p < len && a[p] == value;
+    }
+    else if (is->encoding == INTSET_ENC_INT32)
+    {
+        const int32_t *a = (const int32_t *)is->contents;
+        p = _intsetLowerBound32(a, len, (int32_t)value);
+        found = p < len && a[p] == value;
+    }
+    else
+    {
+        const int16_t *a = (const int16_t *)is->contents;
+        p = _intsetLowerBound16(a, len, (int16_t)value);
+        found = p < len && a[p] == value;
+    }
+    if (pos)
+        *pos = p;
+    return found;
+#else
+    return _intsetSearchGeneric(is, value, pos);
+#endif
+}
 
 /*
 已经确定了需要升级才会调用这个函数
@@ -322,6 +448,32 @@ intset *intsetRemove(intset *is, int64_t value, int *success)
     return is;
 }
 
+intset *intsetRemovePositions(intset *is, const uint32_t *pos, uint32_t n)
+{
+    uint32_t len = intrev32ifbe(is->length), size = intrev32ifbe(is->encoding);
+    uint32_t i, from, to, end;
+
+    if (n == 0)
+        return is;
+
+    // 每一段保留下来的元素只移动一次
+    to = pos[0];
+    for (i = 0; i < n; i++)
+    {
+        from = pos[i] + 1;
+        end = (i + 1 < n) ? pos[i + 1] : len;
+        if (end > from)
+        {
+            memmove(is->contents + (size_t)to * size, is->contents + (size_t)from * size,
+                    (size_t)(end - from) * size);
+            to += end - from;
+        }
+    }
+    is = intsetResize(is, len - n);
+    is->length = intrev32ifbe(len - n);
+    return is;
+}
+
 //存在返回1，不存在返回-1
 uint8_t intsetFind(intset *is, int64_t value)
 {
@@ -329,10 +481,204 @@ uint8_t intsetFind(intset *is, int64_t value)
     return valenc <= intrev32ifbe(is->encoding) && intsetSearch(is, value, NULL);
 }
 
+// intsetFindMany 中排序用的 (值, 原始下标) 对
+typedef struct intsetProbe
+{
+    int64_t value;
+    uint32_t idx;
+} intsetProbe;
+
+// 按值对 probes 做 LSD 基数排序，每趟处理 8 位，tmp 是同样大小的辅助数组
+// 只对 (value - min) 实际用到的字节排序，所有元素在某个字节上都相同时跳过这一趟
+static intsetProbe *_intsetProbeSort(intsetProbe *probes, intsetProbe *tmp, uint32_t n)
+{
+    uint32_t count[256], i, shift;
+    uint64_t min = (uint64_t)probes[0].value, range = 0;
+    intsetProbe *swap;
+
+    // 以最小值为基准转成无符号数，负数也能按字节排序
+    for (i = 1; i < n; i++)
+        if (probes[i].value < (int64_t)min)
+            min = (uint64_t)probes[i].value;
+    for (i = 0; i < n; i++)
+        range |= (uint64_t)probes[i].value - min;
+
+    for (shift = 0; shift < 64 && (range >> shift) != 0; shift += 8)
+    {
+        uint32_t sum = 0, c;
+
+        memset(count, 0, sizeof(count));
+        for (i = 0; i < n; i++)
+            count[(((uint64_t)probes[i].value - min) >> shift) & 0xff]++;
+        if (count[(((uint64_t)probes[0].value - min) >> shift) & 0xff] == n)
+            continue;
+        for (i = 0; i < 256; i++)
+        {
+            c = count[i];
+            count[i] = sum;
+            sum += c;
+        }
+        for (i = 0; i < n; i++)
+            tmp[count[(((uint64_t)probes[i].value - min) >> shift) & 0xff]++] = probes[i];
+        swap = probes;
+        probes = tmp;
+        tmp = swap;
+    }
+    return probes;
+}
+
+void intsetFindMany(intset *is, const int64_t *values, uint32_t n, uint8_t *found)
+{
+#if (BYTE_ORDER == LITTLE_ENDIAN)
+    intsetProbe *buf, *probes;
+    uint32_t i, pos = 0, len = is->length;
+    uint8_t enc = is->encoding;
+
+    if (n == 0)
+        return;
+    if (n == 1)
+    {
+        found[0] = intsetFind(is, values[0]);
+        return;
+    }
+
+    // 按值排序候选元素，之后只需要从前往后扫描一遍集合
+    buf = xm_malloc(sizeof(intsetProbe) * n * 2);
+    for (i = 0; i < n; i++)
+    {
+        buf[i].value = values[i];
+        buf[i].idx = i;
+    }
+    probes = _intsetProbeSort(buf, buf + n, n);
+
+    for (i = 0; i < n; i++)
+    {
+        int64_t v = probes[i].value;
+        uint8_t hit = 0;
+
+        // 当前编码放不下的值一定不在集合中，而且不会影响扫描位置
+        if (_intsetValueEncoding(v) <= enc)
+        {
+            // 从上一个候选元素的位置开始倍增查找，候选元素密集时每次只前进很短的距离
+            if (enc == INTSET_ENC_INT64)
+            {
+                const int64_t *a = (const int64_t *)is->contents;
+                pos = _intsetGallop64(a, pos, len, v);
+                hit = pos < len && a[pos] == v;
+            }
+            else if (enc == INTSET_ENC_INT32)
+            {
+                const int32_t *a = (const int32_t *)is->contents;
+                pos = _intsetGallop32(a, pos, len, (int32_t)v);
+                hit = pos < len && a[pos] == v;
+            }
+            else
+            {
+                const int16_t *a = (const int16_t *)is->contents;
+                pos = _intsetGallop16(a, pos, len, (int16_t)v);
+                hit = pos < len && a[pos] == v;
+            }
+        }
+        found[probes[i].idx] = hit;
+    }
+    xm_free(buf);
+#else
+    uint32_t i;
+    for (i = 0; i < n; i++)
+        found[i] = intsetFind(is, values[i]);
+#endif
+}
+
+intset *intsetAddMany(intset *is, const int64_t *values, uint32_t n, uint32_t *added)
+{
+    intsetProbe *buf, *sorted;
+    uint32_t len = intrev32ifbe(is->length), m = 0, i;
+    uint8_t curenc = intrev32ifbe(is->encoding), newenc = curenc;
+    int64_t oldv = 0;
+    int32_t oi, ni;
+    uint32_t w, gap = 0;
+
+    if (added)
+        *added = 0;
+    if (n == 0)
+        return is;
+
+    // 排序并去掉重复的值，sorted[0..m) 严格递增
+    buf = xm_malloc(sizeof(intsetProbe) * n * 2);
+    for (i = 0; i < n; i++)
+    {
+        buf[i].value = values[i];
+        buf[i].idx = i;
+    }
+    sorted = _intsetProbeSort(buf, buf + n, n);
+    for (i = 0; i < n; i++)
+        if (m == 0 || sorted[i].value != sorted[m - 1].value)
+            sorted[m++] = sorted[i];
+
+    // 最小值和最大值决定是否需要升级，只升级一次
+    if (_intsetValueEncoding(sorted[0].value) > newenc)
+        newenc = _intsetValueEncoding(sorted[0].value);
+    if (_intsetValueEncoding(sorted[m - 1].value) > newenc)
+        newenc = _intsetValueEncoding(sorted[m - 1].value);
+
+    // 按最多需要的空间扩展一次，然后从后往前归并：
+    // 写入位置总是在还没读取的旧元素后面，所以可以原地完成，升级编码也一样
+    is->encoding = intrev32ifbe(newenc);
+    is = intsetResize(is, len + m);
+    oi = (int32_t)len - 1;
+    ni = (int32_t)m - 1;
+    w = len + m;
+    if (oi >= 0)
+        oldv = _intsetGetEncoded(is, oi, curenc);
+    while (ni >= 0)
+    {
+        int64_t v = sorted[ni].value;
+        if (oi >= 0 && oldv >= v)
+        {
+            _intsetSet(is, --w, oldv);
+            // 值已经在集合里，新值不用再写，空出一个位置
+            if (oldv == v)
+            {
+                ni--;
+                gap++;
+            }
+            if (--oi >= 0)
+                oldv = _intsetGetEncoded(is, oi, curenc);
+        }
+        else
+        {
+            _intsetSet(is, --w, v);
+            ni--;
+        }
+    }
+    // 剩下的旧元素只有在编码改变或者前面留出了空位时才需要移动
+    if (newenc != curenc || gap > 0)
+    {
+        for (; oi >= 0; oi--)
+            _intsetSet(is, --w, _intsetGetEncoded(is, oi, curenc));
+    }
+    else
+    {
+        w = 0;
+    }
+
+    // 有重复的值时，结果前面会空出 gap 个位置
+    if (gap > 0)
+    {
+        memmove(is->contents, is->contents + (size_t)w * newenc, (size_t)(len + m - w) * newenc);
+        is = intsetResize(is, len + m - gap);
+    }
+    is->length = intrev32ifbe(len + m - gap);
+    if (added)
+        *added = m - gap;
+    xm_free(buf);
+    return is;
+}
+
 int64_t intsetRandom(intset *is)
 {
-    //  rand() % intrev32ifbe(is->length) 根据元素数量计算一个随机索引
-    return _intsetGet(is, rand() % intrev32ifbe(is->length));
+    // 根据元素数量计算一个随机索引
+    return _intsetGet(is, xm_random_below(intrev32ifbe(is->length)));
 }
 
 //如果 pos 没超出数组的索引范围，那么返回 1 ，如果超出索引，那么返回 0
@@ -355,4 +701,348 @@ uint32_t intsetLen(intset *is)
 size_t intsetBlobLen(intset *is)
 {
     return sizeof(intset) + intrev32ifbe(is->length) * intrev32ifbe(is->encoding);
-}
\ No newline at end of file
+}
+/****************************集合运算******************************/
+
+// 两个集合的大小相差超过这个倍数时，对小集合中的每个元素在大集合中倍增查找，
+// 否则按顺序归并两个数组
+#define INTSET_GALLOP_RATIO 32
+
+#define INTSET_OP_INTER 0
+#define INTSET_OP_UNION 1
+#define INTSET_OP_DIFF 2
+
+// 为三种编码各生成一组集合运算函数，输入是两个有序数组，结果写入 out ，返回结果的元素个数
+// 归并部分没有分支：每一步都先写出候选值，再根据比较结果决定输出位置和两个下标是否前进
+#define INTSET_SETOP_KERNELS(T, suffix)                                       \
+    static uint32_t _intsetInter##suffix(const T *a, uint32_t na, const T *b, uint32_t nb, T *out) \
+    {                                                                         \
+        uint32_t i = 0, j = 0, k = 0;                                         \
+        if (na > nb)                                                          \
+            return _intsetInter##suffix(b, nb, a, na, out);                   \
+        if (na == 0)                                                          \
+            return 0;                                                         \
+        if (nb / na >= INTSET_GALLOP_RATIO)                                   \
+        {                                                                     \
+            for (; i < na && j < nb; i++)                                     \
+            {                                                                 \
+                j = _intsetGallop##suffix(b, j, nb, a[i]);                    \
+                out[k] = a[i];                                                \
+                k += j < nb && b[j] == a[i];                                  \
+            }                                                                 \
+            return k;                                                         \
+        }                                                                     \
+        _intsetInterBlock##suffix(a, na, b, nb, &i, &j, out, &k);             \
+        while (i < na && j < nb)                                              \
+        {                                                                     \
+            T va = a[i], vb = b[j];                                           \
+            out[k] = va;                                                      \
+            k += va == vb;                                                    \
+            i += va <= vb;                                                    \
+            j += vb <= va;                                                    \
+        }                                                                     \
+        return k;                                                             \
+    }                                                                         \
+                                                                              \
+    static uint32_t _intsetUnion##suffix(const T *a, uint32_t na, const T *b, uint32_t nb, T *out) \
+    {                                                                         \
+        uint32_t i = 0, j = 0, k = 0, p;                                      \
+        if (na > nb)                                                          \
+            return _intsetUnion##suffix(b, nb, a, na, out);                   \
+        if (na == 0 || nb / na >= INTSET_GALLOP_RATIO)                        \
+        {                                                                     \
+            /* 小集合的元素把大集合切成若干段，每段整体复制 */                 \
+            for (; i < na; i++)                                               \
+            {                                                                 \
+                p = _intsetGallop##suffix(b, j, nb, a[i]);                    \
+                memcpy(out + k, b + j, (p - j) * sizeof(T));                  \
+                k += p - j;                                                   \
+                out[k++] = a[i];                                              \
+                j = p + (p < nb && b[p] == a[i]);                             \
+            }                                                                 \
+        }                                                                     \
+        else                                                                  \
+        {                                                                     \
+            while (i < na && j < nb)                                          \
+            {                                                                 \
+                T va = a[i], vb = b[j];                                       \
+                out[k++] = va <= vb ? va : vb;                                \
+                i += va <= vb;                                                \
+                j += vb <= va;                                                \
+            }                                                                 \
+            memcpy(out + k, a + i, (na - i) * sizeof(T));                     \
+            k += na - i;                                                      \
+        }                                                                     \
+        memcpy(out + k, b + j, (nb - j) * sizeof(T));                         \
+        return k + nb - j;                                                    \
+    }                                                                         \
+                                                                              \
+    static uint32_t _intsetDiff##suffix(const T *a, uint32_t na, const T *b, uint32_t nb, T *out) \
+    {                                                                         \
+        uint32_t i = 0, j = 0, k = 0, p;                                      \
+        if (nb == 0 || na / nb >= INTSET_GALLOP_RATIO)                        \
+        {                                                                     \
+            /* b 的元素很少，在 a 中找到它们的位置，中间的段整体复制 */          \
+            for (; j < nb && i < na; j++)                                     \
+            {                                                                 \
+                p = _intsetGallop##suffix(a, i, na, b[j]);                    \
+                memcpy(out + k, a + i, (p - i) * sizeof(T));                  \
+                k += p - i;                                                   \
+                i = p + (p < na && a[p] == b[j]);                             \
+            }                                                                 \
+        }                                                                     \
+        else if (na == 0 || nb / na >= INTSET_GALLOP_RATIO)                   \
+        {                                                                     \
+            for (; i < na && j < nb; i++)                                     \
+            {                                                                 \
+                j = _intsetGallop##suffix(b, j, nb, a[i]);                    \
+                out[k] = a[i];                                                \
+                k += j >= nb || b[j] != a[i];                                 \
+            }                                                                 \
+        }                                                                     \
+        else                                                                  \
+        {                                                                     \
+            while (i < na && j < nb)                                          \
+            {                                                                 \
+                T va = a[i], vb = b[j];                                       \
+                out[k] = va;                                                  \
+                k += va < vb;                                                 \
+                i += va <= vb;                                                \
+                j += vb <= va;                                                \
+            }                                                                 \
+        }                                                                     \
+        memcpy(out + k, a + i, (na - i) * sizeof(T));                        \
+        return k + na - i;                                                    \
+    }
+
+// 大小相近的两个集合求交集时，用向量比较跳过 b 中整块小于 a[i] 的元素，
+// 再用一次比较判断 a[i] 是否在当前块中，块的大小是 32 字节
+// 没有 AVX2 时什么都不做，由调用者的归并循环处理全部元素
+#ifdef __AVX2__
+#define INTSET_INTER_BLOCK_AVX2(T, suffix, set1)                              \
+    static void _intsetInterBlock##suffix(const T *a, uint32_t na, const T *b, uint32_t nb, \
+                                          uint32_t *pi, uint32_t *pj, T *out, uint32_t *pk) \
+    {                                                                         \
+        const uint32_t width = 32 / sizeof(T);                                \
+        uint32_t i = *pi, j = *pj, k = *pk;                                   \
+        while (i < na && j + width <= nb)                                     \
+        {                                                                     \
+            T v = a[i];                                                       \
+            __m256i block;                                                    \
+            if (b[j + width - 1] < v)                                         \
+            {                                                                 \
+                j += width;                                                   \
+                continue;                                                     \
+            }                                                                 \
+            block = _mm256_loadu_si256((const __m256i *)(b + j));             \
+            out[k] = v;                                                       \
+            k += _mm256_movemask_epi8(_mm256_cmpeq_epi##suffix(_mm256_set1_epi##set1(v), block)) != 0; \
+            i++;                                                              \
+        }                                                                     \
+        *pi = i;                                                              \
+        *pj = j;                                                              \
+        *pk = k;                                                              \
+    }
+
+INTSET_INTER_BLOCK_AVX2(int16_t, 16, 16)
+INTSET_INTER_BLOCK_AVX2(int32_t, 32, 32)
+INTSET_INTER_BLOCK_AVX2(int64_t, 64, 64x)
+#else
+#define INTSET_INTER_BLOCK_SCALAR(T, suffix)                                  \
+    static void _intsetInterBlock##suffix(const T *a, uint32_t na, const T *b, uint32_t nb, \
+                                          uint32_t *pi, uint32_t *pj, T *out, uint32_t *pk) \
+    {                                                                         \
+        (void)a, (void)na, (void)b, (void)nb, (void)pi, (void)pj, (void)out, (void)pk; \
+    }
+
+INTSET_INTER_BLOCK_SCALAR(int16_t, 16)
+INTSET_INTER_BLOCK_SCALAR(int32_t, 32)
+INTSET_INTER_BLOCK_SCALAR(int64_t, 64)
+#endif
+
+INTSET_SETOP_KERNELS(int16_t, 16)
+INTSET_SETOP_KERNELS(int32_t, 32)
+INTSET_SETOP_KERNELS(int64_t, 64)
+
+// 返回集合 is 中的元素按编码 enc 排成的本机字节序数组
+// 集合本身就是这个编码并且主机是小端法时直接返回 contents ，否则新分配一个数组，
+// 调用者用 _intsetFreeArray 释放
+static void *_intsetAsArray(intset *is, uint8_t enc)
+{
+    uint32_t i, len = intrev32ifbe(is->length);
+    void *arr;
+
+#if (BYTE_ORDER == LITTLE_ENDIAN)
+    if (is->encoding == enc)
+        return is->contents;
+#endif
+    arr = xm_malloc((size_t)len * enc + 1);
+    for (i = 0; i < len; i++)
+    {
+        if (enc == INTSET_ENC_INT64)
+            ((int64_t *)arr)[i] = _intsetGet(is, i);
+        else if (enc == INTSET_ENC_INT32)
+            ((int32_t *)arr)[i] = _intsetGet(is, i);
+        else
+            ((int16_t *)arr)[i] = _intsetGet(is, i);
+    }
+    return arr;
+}
+
+static void _intsetFreeArray(intset *is, void *arr)
+{
+    if (arr != (void *)is->contents)
+        xm_free(arr);
+}
+
+// 对 a 和 b 做一次集合运算，返回新的整数集合
+// 运算在两个集合中较大的编码上进行，结果按实际用到的最大编码重新编码，并收缩到正好的大小
+static intset *_intsetSetOp(intset *a, intset *b, int op)
+{
+    uint8_t enc = intrev32ifbe(a->encoding), newenc;
+    uint32_t na = intrev32ifbe(a->length), nb = intrev32ifbe(b->length), cap, len, i;
+    void *pa, *pb;
+    intset *res;
+
+    if (intrev32ifbe(b->encoding) > enc)
+        enc = intrev32ifbe(b->encoding);
+    if (op == INTSET_OP_INTER)
+        cap = na < nb ? na : nb;
+    else if (op == INTSET_OP_UNION)
+        cap = na + nb;
+    else
+        cap = na;
+
+    pa = _intsetAsArray(a, enc);
+    pb = _intsetAsArray(b, enc);
+    res = xm_malloc(sizeof(intset) + (size_t)cap * enc);
+
+#define INTSET_RUN_SETOP(T, suffix)                                                                    \
+    do                                                                                                 \
+    {                                                                                                  \
+        if (op == INTSET_OP_INTER)                                                                     \
+            len = _intsetInter##suffix((const T *)pa, na, (const T *)pb, nb, (T *)res->contents);      \
+        else if (op == INTSET_OP_UNION)                                                                \
+            len = _intsetUnion##suffix((const T *)pa, na, (const T *)pb, nb, (T *)res->contents);      \
+        else                                                                                           \
+            len = _intsetDiff##suffix((const T *)pa, na, (const T *)pb, nb, (T *)res->contents);       \
+    } while (0)
+
+    if (enc == INTSET_ENC_INT64)
+        INTSET_RUN_SETOP(int64_t, 64);
+    else if (enc == INTSET_ENC_INT32)
+        INTSET_RUN_SETOP(int32_t, 32);
+    else
+        INTSET_RUN_SETOP(int16_t, 16);
+#undef INTSET_RUN_SETOP
+
+    _intsetFreeArray(a, pa);
+    _intsetFreeArray(b, pb);
+
+    // 结果有序，只看首尾两个元素就能确定需要的编码
+    newenc = INTSET_ENC_INT16;
+    if (len > 0)
+    {
+        int64_t first, last;
+        if (enc == INTSET_ENC_INT64)
+            first = ((int64_t *)res->contents)[0], last = ((int64_t *)res->contents)[len - 1];
+        else if (enc == INTSET_ENC_INT32)
+            first = ((int32_t *)res->contents)[0], last = ((int32_t *)res->contents)[len - 1];
+        else
+            first = ((int16_t *)res->contents)[0], last = ((int16_t *)res->contents)[len - 1];
+        newenc = _intsetValueEncoding(first);
+        if (_intsetValueEncoding(last) > newenc)
+            newenc = _intsetValueEncoding(last);
+    }
+
+    // 从前往后改写成新编码，新编码不比原编码大，写入位置不会超过还没读的元素
+    res->encoding = intrev32ifbe(newenc);
+    res->length = intrev32ifbe(len);
+    if (newenc != enc || BYTE_ORDER == BIG_ENDIAN)
+    {
+        for (i = 0; i < len; i++)
+        {
+            int64_t v;
+            if (enc == INTSET_ENC_INT64)
+                v = ((int64_t *)res->contents)[i];
+            else if (enc == INTSET_ENC_INT32)
+                v = ((int32_t *)res->contents)[i];
+            else
+                v = ((int16_t *)res->contents)[i];
+            _intsetSet(res, i, v);
+        }
+    }
+    return intsetResize(res, len);
+}
+
+// 按元素个数从小到大排列集合指针，集合的个数很少，插入排序就够了
+static void _intsetSortByLength(intset **sets, uint32_t n)
+{
+    uint32_t i, j;
+    for (i = 1; i < n; i++)
+    {
+        intset *cur = sets[i];
+        for (j = i; j > 0 && intrev32ifbe(sets[j - 1]->length) > intrev32ifbe(cur->length); j--)
+            sets[j] = sets[j - 1];
+        sets[j] = cur;
+    }
+}
+
+// 依次对 sets[0..n) 做集合运算，每一步的结果都是新分配的集合
+static intset *_intsetFoldSetOp(intset **sets, uint32_t n, int op)
+{
+    intset *res, *tmp;
+    uint32_t i;
+
+    if (n == 1)
+    {
+        res = xm_malloc(intsetBlobLen(sets[0]));
+        memcpy(res, sets[0], intsetBlobLen(sets[0]));
+        return res;
+    }
+    res = _intsetSetOp(sets[0], sets[1], op);
+    for (i = 2; i < n; i++)
+    {
+        // 交集已经为空，后面的集合不用再看了
+        if (op == INTSET_OP_INTER && intrev32ifbe(res->length) == 0)
+            break;
+        tmp = _intsetSetOp(res, sets[i], op);
+        xm_free(res);
+        res = tmp;
+    }
+    return res;
+}
+
+intset *intsetIntersect(intset **sets, uint32_t n)
+{
+    intset *stackbuf[16], **sorted = n <= 16 ? stackbuf : xm_malloc(sizeof(intset *) * n);
+    intset *res;
+
+    // 从最小的集合开始求交，中间结果只会越来越小
+    memcpy(sorted, sets, sizeof(intset *) * n);
+    _intsetSortByLength(sorted, n);
+    res = _intsetFoldSetOp(sorted, n, INTSET_OP_INTER);
+    if (sorted != stackbuf)
+        xm_free(sorted);
+    return res;
+}
+
+intset *intsetUnion(intset **sets, uint32_t n)
+{
+    intset *stackbuf[16], **sorted = n <= 16 ? stackbuf : xm_malloc(sizeof(intset *) * n);
+    intset *res;
+
+    // 先合并小的集合，大集合只被复制尽量少的次数
+    memcpy(sorted, sets, sizeof(intset *) * n);
+    _intsetSortByLength(sorted, n);
+    res = _intsetFoldSetOp(sorted, n, INTSET_OP_UNION);
+    if (sorted != stackbuf)
+        xm_free(sorted);
+    return res;
+}
+
+intset *intsetDiff(intset **sets, uint32_t n)
+{
+    // 差集和顺序有关，只能从第一个集合开始依次减去后面的集合
+    return _intsetFoldSetOp(sets, n, INTSET_OP_DIFF);
+}
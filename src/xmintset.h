@@ -24,10 +24,18 @@ typedef struct intset
 intset *intsetNew(void);
 //将给定元素添加到整数集合里面
 intset *intsetAdd(intset *is, int64_t value, uint8_t *success);
+//批量添加 values 中的 n 个值，值可以无序、可以重复，*added 设为实际新增的元素个数
+//先排序去重，最多升级一次编码，再把新值和原数组一次归并进去，只扩展一次空间
+intset *intsetAddMany(intset *is, const int64_t *values, uint32_t n, uint32_t *added);
 //从整数集合中移除给定元素
 intset *intsetRemove(intset *is, int64_t value, int *success);
+//一次移除底层数组中位于 pos[0..n) 的元素，pos 必须严格递增，剩下的元素只移动一次
+intset *intsetRemovePositions(intset *is, const uint32_t *pos, uint32_t n);
 //检查给定值是否存在于集合
 uint8_t intsetFind(intset *is, int64_t value);
+//批量检查 values 中的 n 个值是否存在于集合，found[i] 设为 values[i] 的检查结果
+//候选元素先排序，再从前往后扫描一遍集合，比逐个调用 intsetFind 的缓存命中率更高
+void intsetFindMany(intset *is, const int64_t *values, uint32_t n, uint8_t *found);
 //从整数集合中随机返回一个元素
 int64_t intsetRandom(intset *is);
 //取出底层数组在给定索引上的元素，保存在value指针中
@@ -37,4 +45,13 @@ uint32_t intsetLen(intset *is);
 //返回整数集合占用的内存字节数
 size_t intsetBlobLen(intset *is);
 
+//集合运算，sets 中至少有一个集合，返回新创建的整数集合，输入的集合不会被修改
+//结果使用能容纳所有结果元素的最小编码
+//求 sets[0..n) 的交集
+intset *intsetIntersect(intset **sets, uint32_t n);
+//求 sets[0..n) 的并集
+intset *intsetUnion(intset **sets, uint32_t n);
+//求 sets[0] 减去 sets[1..n) 的差集
+intset *intsetDiff(intset **sets, uint32_t n);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,778 @@
+#include "xmlexset.h"
+#include "xmmalloc.h"
+
+#include "xmt_string.h"
+
+#include <string.h>
+
+// 查找的边界：满足边界的成员是从某个成员开始的一段后缀
+// strict 为 0 时查找第一个不小于 s 的成员，为 1 时查找第一个大于 s 的成员
+// inf 为 -1 表示 "-" ，所有成员都满足；为 1 表示 "+" ，没有成员满足
+typedef struct zlxBound
+{
+    const char *s;
+    size_t len;
+    int strict;
+    int inf;
+} zlxBound;
+
+// 块解码之后的成员，首尾相接地保存在 arena 中
+typedef struct zlxEntries
+{
+    sds arena;
+    size_t offs[ZLX_BLOCK_ENTRIES + 1];
+    size_t lens[ZLX_BLOCK_ENTRIES + 1];
+    int n;
+} zlxEntries;
+
+#define zlxEntry(e, i) ((e)->arena + (e)->offs[i])
+
+/*********************************变长整数***********************************/
+
+// 每个字节保存 7 位，低位在前，除了最后一个字节以外最高位都是 1
+
+static inline unsigned int zlxVarintLen(size_t v)
+{
+    unsigned int len = 1;
+
+    while (v >= 0x80)
+    {
+        v >>= 7;
+        len++;
+    }
+    return len;
+}
+
+static inline unsigned int zlxVarintEncode(unsigned char *p, size_t v)
+{
+    unsigned int len = 0;
+
+    while (v >= 0x80)
+    {
+        p[len++] = (unsigned char)(v | 0x80);
+        v >>= 7;
+    }
+    p[len++] = (unsigned char)v;
+    return len;
+}
+
+static inline unsigned int zlxVarintDecode(const unsigned char *p, size_t *v)
+{
+    size_t x = 0;
+    unsigned int len = 0, shift = 0;
+
+    do
+    {
+        x |= (size_t)(p[len] & 0x7f) << shift;
+        shift += 7;
+    } while (p[len++] & 0x80);
+    *v = x;
+    return len;
+}
+
+/*********************************比较***********************************/
+
+static inline size_t zlxCommonPrefix(const char *a, size_t alen, const char *b, size_t blen)
+{
+    size_t i = 0, n = alen < blen ? alen : blen;
+
+    while (i < n && a[i] == b[i])
+        i++;
+    return i;
+}
+
+// 从第 from 个字节开始比较 key 和边界，返回 key 是否满足边界，*lcp 保存两者的公共前缀长度
+// 调用者需要保证前 from 个字节相同
+static int zlxBoundTest(const char *key, size_t klen, zlxBound *bd, size_t from, size_t *lcp)
+{
+    size_t i;
+    int cmp;
+
+    if (bd->inf)
+        return bd->inf < 0;
+    i = from + zlxCommonPrefix(key + from, klen - from, bd->s + from, bd->len - from);
+    *lcp = i;
+    if (i < klen && i < bd->len)
+        cmp = (unsigned char)key[i] - (unsigned char)bd->s[i];
+    else
+        cmp = (klen > bd->len) - (klen < bd->len);
+    return bd->strict ? cmp > 0 : cmp >= 0;
+}
+
+// 字典序范围的一端对应的边界
+// GteMin ：第一个不小于（开区间时大于）最小值的成员；GtMax ：第一个大于（开区间时不小于）最大值的成员
+static void zlxBoundFromLexItem(zlxBound *bd, robj *item, int strict)
+{
+    bd->inf = item == shared.minstring ? -1 : (item == shared.maxstring ? 1 : 0);
+    bd->s = bd->inf ? NULL : item->ptr;
+    bd->len = bd->inf ? 0 : sdslen(item->ptr);
+    bd->strict = strict;
+}
+
+/***********************************块*************************************/
+
+// 在块头数组的第 b 个位置腾出一个空位
+static void zlxHeadersInsert(zlexset *zlx, unsigned long b)
+{
+    if (zlx->nblocks == zlx->capacity)
+    {
+        zlx->capacity = zlx->capacity ? zlx->capacity * 2 : 4;
+        zlx->headers = xm_realloc(zlx->headers, sizeof(zlxHeader) * zlx->capacity);
+    }
+    memmove(zlx->headers + b + 1, zlx->headers + b, sizeof(zlxHeader) * (zlx->nblocks - b));
+    zlx->nblocks++;
+}
+
+// 从块头数组中移走从第 b 个开始的 n 个块头，块本身由调用者释放
+static void zlxHeadersRemove(zlexset *zlx, unsigned long b, unsigned long n)
+{
+    memmove(zlx->headers + b, zlx->headers + b + n, sizeof(zlxHeader) * (zlx->nblocks - b - n));
+    zlx->nblocks -= n;
+}
+
+// 第 b 个块之后的排位已经过期
+// 插入和删除只记录位置，不立即更新后面所有块的排位，连续修改时每次都是 O(1) 的
+static inline void zlxInvalidateRanks(zlexset *zlx, unsigned long b)
+{
+    if (b < zlx->rankdirty)
+        zlx->rankdirty = b;
+}
+
+// 用到排位之前，从第一个过期的块开始重新计算每个块之前的元素个数
+static void zlxUpdateRanks(zlexset *zlx)
+{
+    unsigned long b = zlx->rankdirty;
+    unsigned long rank = b ? zlx->headers[b - 1].rank + zlx->headers[b - 1].count : 0;
+
+    for (; b < zlx->nblocks; b++)
+    {
+        zlx->headers[b].rank = rank;
+        rank += zlx->headers[b].count;
+    }
+    zlx->rankdirty = zlx->nblocks;
+}
+
+// 块的第一个成员是完整保存的，不用解码就能直接比较
+static inline const char *zlxFirstKey(zlxHeader *h, size_t *len)
+{
+    size_t shared;
+    unsigned int off;
+
+    off = zlxVarintDecode(h->buf, &shared);
+    off += zlxVarintDecode(h->buf + off, len);
+    return (const char *)h->buf + off;
+}
+
+// 解码从 off 开始的一个成员，把 *key 中的前一个成员改写成这个成员，返回下一个成员的起始位置
+// *shared 保存它和前一个成员的公共前缀长度
+static unsigned int zlxDecodeEntry(const unsigned char *buf, unsigned int off, sds *key, size_t *shared)
+{
+    size_t n;
+
+    off += zlxVarintDecode(buf + off, shared);
+    off += zlxVarintDecode(buf + off, &n);
+    sdsIncrLen(*key, (int)*shared - (int)sdslen(*key));
+    *key = sdscatlen(*key, buf + off, n);
+    return off + n;
+}
+
+static void zlxEntriesInit(zlxEntries *e)
+{
+    e->arena = sdsempty();
+    e->n = 0;
+}
+
+static void zlxEntriesAppend(zlxEntries *e, const char *s, size_t len)
+{
+    e->offs[e->n] = sdslen(e->arena);
+    e->lens[e->n] = len;
+    e->arena = sdscatlen(e->arena, s, len);
+    e->n++;
+}
+
+// 解码块中的所有成员
+static void zlxDecodeBlock(zlxHeader *h, zlxEntries *e)
+{
+    sds key = sdsempty();
+    size_t shared;
+    unsigned int off = 0, i;
+
+    zlxEntriesInit(e);
+    for (i = 0; i < h->count; i++)
+    {
+        off = zlxDecodeEntry(h->buf, off, &key, &shared);
+        zlxEntriesAppend(e, key, sdslen(key));
+    }
+    sdsfree(key);
+}
+
+// 第 i 个成员编码之后占用的字节数，from 是块中的第一个成员
+static size_t zlxEntryBytes(zlxEntries *e, int from, int i, size_t *shared)
+{
+    *shared = i == from ? 0 : zlxCommonPrefix(zlxEntry(e, i - 1), e->lens[i - 1], zlxEntry(e, i), e->lens[i]);
+    return zlxVarintLen(*shared) + zlxVarintLen(e->lens[i] - *shared) + e->lens[i] - *shared;
+}
+
+static size_t zlxEncodedBytes(zlxEntries *e, int from, int n)
+{
+    size_t bytes = 0, shared;
+    int i;
+
+    for (i = from; i < from + n; i++)
+        bytes += zlxEntryBytes(e, from, i, &shared);
+    return bytes;
+}
+
+// 把从第 from 个开始的 n 个成员编码到 h 的块中，块的大小正好放得下
+static void zlxEncodeBlock(zlxHeader *h, zlxEntries *e, int from, int n)
+{
+    size_t shared;
+    unsigned int used = 0;
+    int i;
+
+    h->buf = xm_realloc(h->buf, zlxEncodedBytes(e, from, n));
+    for (i = from; i < from + n; i++)
+    {
+        zlxEntryBytes(e, from, i, &shared);
+        used += zlxVarintEncode(h->buf + used, shared);
+        used += zlxVarintEncode(h->buf + used, e->lens[i] - shared);
+        memcpy(h->buf + used, zlxEntry(e, i) + shared, e->lens[i] - shared);
+        used += e->lens[i] - shared;
+    }
+    h->count = n;
+    h->used = used;
+}
+
+// 用 e 中的成员重写第 b 个块，没有成员时删除这个块，超过限制时分裂成两个块
+// 删除成员只会让元素个数变少，字节数的限制是软限制，所以只有插入时才需要分裂
+// 调用者之后需要从第 b 个块开始更新排位
+static void zlxRewriteBlock(zlexset *zlx, unsigned long b, zlxEntries *e)
+{
+    size_t total, prefix, shared;
+    int k, n = e->n;
+
+    if (n == 0)
+    {
+        xm_free(zlx->headers[b].buf);
+        zlxHeadersRemove(zlx, b, 1);
+        return;
+    }
+    if (n == 1 || (n <= ZLX_BLOCK_ENTRIES && zlxEncodedBytes(e, 0, n) <= ZLX_BLOCK_BYTES))
+    {
+        zlxEncodeBlock(&zlx->headers[b], e, 0, n);
+        return;
+    }
+
+    // 先按元素个数平分，某一半超过字节数限制时按字节数平分
+    k = n / 2;
+    if (zlxEncodedBytes(e, 0, k) > ZLX_BLOCK_BYTES || zlxEncodedBytes(e, k, n - k) > ZLX_BLOCK_BYTES)
+    {
+        total = zlxEncodedBytes(e, 0, n);
+        prefix = 0;
+        for (k = 1; k < n - 1; k++)
+        {
+            prefix += zlxEntryBytes(e, 0, k - 1, &shared);
+            if (prefix > total / 2)
+                break;
+        }
+    }
+    zlxHeadersInsert(zlx, b + 1);
+    zlx->headers[b + 1].buf = NULL;
+    zlxEncodeBlock(&zlx->headers[b], e, 0, k);
+    zlxEncodeBlock(&zlx->headers[b + 1], e, k, n - k);
+}
+
+// 重新取出最后一个成员
+static void zlxUpdateTail(zlexset *zlx)
+{
+    zlxPos p;
+
+    sdsclear(zlx->tail);
+    if (zlx->length == 0)
+        return;
+    zlxPosInit(&p, zlx);
+    zlxGetElementByRank(zlx, zlx->length, &p);
+    zlx->tail = sdscatlen(zlx->tail, p.key, sdslen(p.key));
+    zlxPosRelease(&p);
+}
+
+/*********************************位置***********************************/
+
+// 让 p 指向第 b 个块的第一个元素，b 等于 nblocks 时 p 不指向任何元素
+static void zlxPosBlockStart(zlxPos *p, unsigned long b)
+{
+    size_t shared;
+
+    p->b = b;
+    p->i = 0;
+    if (b < p->zlx->nblocks)
+        p->off = zlxDecodeEntry(p->zlx->headers[b].buf, 0, &p->key, &shared);
+}
+
+// 让 p 指向第 b 个块的第 i 个元素，需要从块的第一个元素开始解码
+static void zlxPosSeek(zlxPos *p, unsigned long b, int i)
+{
+    size_t shared;
+
+    zlxPosBlockStart(p, b);
+    for (; p->i < i; p->i++)
+        p->off = zlxDecodeEntry(p->zlx->headers[b].buf, p->off, &p->key, &shared);
+}
+
+void zlxPosInit(zlxPos *p, zlexset *zlx)
+{
+    p->zlx = zlx;
+    p->b = zlx->nblocks;
+    p->i = 0;
+    p->off = 0;
+    p->key = sdsempty();
+}
+
+void zlxPosRelease(zlxPos *p)
+{
+    sdsfree(p->key);
+}
+
+int zlxNext(zlxPos *p)
+{
+    size_t shared;
+
+    if (p->i + 1 < (int)p->zlx->headers[p->b].count)
+    {
+        p->off = zlxDecodeEntry(p->zlx->headers[p->b].buf, p->off, &p->key, &shared);
+        p->i++;
+        return 1;
+    }
+    zlxPosBlockStart(p, p->b + 1);
+    return zlxPosValid(p);
+}
+
+int zlxPrev(zlxPos *p)
+{
+    // 前缀压缩只能从前往后解码，往前移动时从块的第一个元素重新解码，块中最多 ZLX_BLOCK_ENTRIES 个元素
+    if (p->i > 0)
+    {
+        zlxPosSeek(p, p->b, p->i - 1);
+        return 1;
+    }
+    if (p->b == 0)
+    {
+        p->b = p->zlx->nblocks;
+        return 0;
+    }
+    zlxPosSeek(p, p->b - 1, p->zlx->headers[p->b - 1].count - 1);
+    return 1;
+}
+
+/***********************************查找*************************************/
+
+// 找到第一个满足边界的元素，保存到 *p ，返回它之前的元素个数
+// 没有这样的元素时 p 不指向任何元素，返回值为集合的元素个数
+static unsigned long zlxSearch(zlexset *zlx, zlxBound *bd, zlxPos *p)
+{
+    unsigned long lo = 0, hi = zlx->nblocks, mid, b;
+    zlxHeader *h;
+    const char *first;
+    size_t len, lcp = 0, shared;
+
+    if (zlx->length == 0 || bd->inf < 0)
+    {
+        zlxPosBlockStart(p, 0);
+        return 0;
+    }
+    if (bd->inf > 0)
+    {
+        p->b = zlx->nblocks;
+        return zlx->length;
+    }
+    zlxUpdateRanks(zlx);
+
+    // 二分查找第一个首元素满足边界的块，要找的元素在它前一个块中，或者就是它的首元素
+    while (lo < hi)
+    {
+        mid = lo + (hi - lo) / 2;
+        first = zlxFirstKey(&zlx->headers[mid], &len);
+        if (zlxBoundTest(first, len, bd, 0, &lcp))
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
+    if (lo == 0)
+    {
+        zlxPosBlockStart(p, 0);
+        return 0;
+    }
+
+    // 在前一个块中顺序查找。lcp 是前一个成员和边界的公共前缀长度，前一个成员不满足边界：
+    // 当前成员和前一个成员的公共前缀更长时，它和边界的比较结果与前一个成员相同，也不满足；
+    // 公共前缀更短时，它在第 shared 个字节上大于前一个成员，也就大于边界，一定满足；
+    // 只有两者相等时才需要从第 lcp 个字节开始比较
+    b = lo - 1;
+    h = &zlx->headers[b];
+    zlxPosBlockStart(p, b);
+    zlxBoundTest(p->key, sdslen(p->key), bd, 0, &lcp);
+    while (p->i + 1 < (int)h->count)
+    {
+        p->off = zlxDecodeEntry(h->buf, p->off, &p->key, &shared);
+        p->i++;
+        if (shared > lcp)
+            continue;
+        if (shared < lcp || zlxBoundTest(p->key, sdslen(p->key), bd, lcp, &lcp))
+            return h->rank + p->i;
+    }
+    zlxPosBlockStart(p, lo);
+    return lo < zlx->nblocks ? zlx->headers[lo].rank : zlx->length;
+}
+
+static void zlxBoundFromObject(zlxBound *bd, robj *o, int strict)
+{
+    bd->inf = 0;
+    bd->s = o->ptr;
+    bd->len = sdslen(o->ptr);
+    bd->strict = strict;
+}
+
+unsigned long zlxGetRank(zlexset *zlx, robj *o)
+{
+    unsigned long rank;
+    zlxBound bd;
+    zlxPos p;
+
+    o = getDecodedObject(o);
+    zlxBoundFromObject(&bd, o, 0);
+    zlxPosInit(&p, zlx);
+    rank = zlxSearch(zlx, &bd, &p);
+    if (!zlxPosValid(&p) || sdslen(p.key) != bd.len || memcmp(p.key, bd.s, bd.len) != 0)
+        rank = 0;
+    else
+        rank++;
+    zlxPosRelease(&p);
+    decrRefCount(o);
+    return rank;
+}
+
+// 找到排位为 rank 的元素所在的块，rank 以 0 为起始值：最后一个之前的元素个数不超过 rank 的块
+static unsigned long zlxBlockOfRank(zlexset *zlx, unsigned long rank)
+{
+    unsigned long lo = 0, hi = zlx->nblocks - 1, mid;
+
+    while (lo < hi)
+    {
+        mid = lo + (hi - lo + 1) / 2;
+        if (zlx->headers[mid].rank <= rank)
+            lo = mid;
+        else
+            hi = mid - 1;
+    }
+    return lo;
+}
+
+int zlxGetElementByRank(zlexset *zlx, unsigned long rank, zlxPos *p)
+{
+    unsigned long b;
+
+    if (rank < 1 || rank > zlx->length)
+        return 0;
+    zlxUpdateRanks(zlx);
+    b = zlxBlockOfRank(zlx, rank - 1);
+    zlxPosSeek(p, b, rank - 1 - zlx->headers[b].rank);
+    return 1;
+}
+
+static int zlxIsInLexRange(zlexset *zlx, zlexrangespec *range)
+{
+    if (compareStringObjectsForLexRange(range->min, range->max) > 0 ||
+        (compareStringObjects(range->min, range->max) == 0 &&
+         (range->minex || range->maxex)))
+        return 0;
+    return zlx->length > 0;
+}
+
+unsigned long zlxRankOfFirstInLexRange(zlexset *zlx, zlexrangespec *range)
+{
+    unsigned long rank = 0;
+    zlxBound min, max;
+    size_t lcp;
+    zlxPos p;
+
+    if (!zlxIsInLexRange(zlx, range))
+        return 0;
+    zlxBoundFromLexItem(&min, range->min, range->minex);
+    zlxBoundFromLexItem(&max, range->max, !range->maxex);
+    zlxPosInit(&p, zlx);
+    rank = zlxSearch(zlx, &min, &p);
+    // 第一个不小于最小值的元素还要不大于最大值
+    if (!zlxPosValid(&p) || zlxBoundTest(p.key, sdslen(p.key), &max, 0, &lcp))
+        rank = 0;
+    else
+        rank++;
+    zlxPosRelease(&p);
+    return rank;
+}
+
+unsigned long zlxRankOfLastInLexRange(zlexset *zlx, zlexrangespec *range)
+{
+    unsigned long rank;
+    zlxBound min, max;
+    size_t lcp;
+    zlxPos p;
+
+    if (!zlxIsInLexRange(zlx, range))
+        return 0;
+    zlxBoundFromLexItem(&min, range->min, range->minex);
+    zlxBoundFromLexItem(&max, range->max, !range->maxex);
+    zlxPosInit(&p, zlx);
+    // 不大于最大值的元素个数就是最后一个在范围内的元素的排位，它还要不小于最小值
+    rank = zlxSearch(zlx, &max, &p);
+    if (rank > 0)
+    {
+        zlxGetElementByRank(zlx, rank, &p);
+        if (!zlxBoundTest(p.key, sdslen(p.key), &min, 0, &lcp))
+            rank = 0;
+    }
+    zlxPosRelease(&p);
+    return rank;
+}
+
+/*************************************************************/
+
+zlexset *zlxCreate(double score)
+{
+    zlexset *zlx = xm_malloc(sizeof(*zlx));
+
+    zlx->headers = NULL;
+    zlx->nblocks = zlx->capacity = 0;
+    zlx->length = 0;
+    zlx->score = score;
+    zlx->tail = sdsempty();
+    zlx->deleted = 0;
+    zlx->rankdirty = 0;
+    return zlx;
+}
+
+void zlxFree(zlexset *zlx)
+{
+    unsigned long b;
+
+    for (b = 0; b < zlx->nblocks; b++)
+        xm_free(zlx->headers[b].buf);
+    xm_free(zlx->headers);
+    sdsfree(zlx->tail);
+    xm_free(zlx);
+}
+
+/*******************************插入和删除*********************************/
+
+// 找到成员 bd 应该所在的块：最后一个首元素不大于它的块，所有块的首元素都更大时是第一个块
+static unsigned long zlxFindBlock(zlexset *zlx, zlxBound *bd)
+{
+    unsigned long lo = 0, hi = zlx->nblocks, mid;
+    const char *first;
+    size_t len, lcp;
+
+    while (lo < hi)
+    {
+        mid = lo + (hi - lo) / 2;
+        first = zlxFirstKey(&zlx->headers[mid], &len);
+        if (zlxBoundTest(first, len, bd, 0, &lcp))
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
+    return lo ? lo - 1 : 0;
+}
+
+// 成员在 e 中的下标，不存在时返回它应该插入的位置，*found 表示是否找到
+static int zlxEntriesFind(zlxEntries *e, const char *s, size_t len, int *found)
+{
+    int i, cmp = 1;
+    size_t n;
+
+    for (i = 0; i < e->n; i++)
+    {
+        n = e->lens[i] < len ? e->lens[i] : len;
+        cmp = memcmp(zlxEntry(e, i), s, n);
+        if (cmp == 0)
+            cmp = (e->lens[i] > len) - (e->lens[i] < len);
+        if (cmp >= 0)
+            break;
+    }
+    *found = i < e->n && cmp == 0;
+    return i;
+}
+
+int zlxInsert(zlexset *zlx, robj *obj)
+{
+    zlxEntries e;
+    zlxBound bd;
+    zlxHeader *h;
+    unsigned long b;
+    size_t shared, cmplen;
+    int i, found, cmp;
+
+    obj = getDecodedObject(obj);
+    zlxBoundFromObject(&bd, obj, 1);
+
+    // 比最后一个成员大，追加到最后一个块的末尾，块已满时新建一个块
+    cmplen = sdslen(zlx->tail) < bd.len ? sdslen(zlx->tail) : bd.len;
+    cmp = memcmp(bd.s, zlx->tail, cmplen);
+    if (cmp == 0)
+        cmp = (bd.len > sdslen(zlx->tail)) - (bd.len < sdslen(zlx->tail));
+    if (zlx->length == 0 || cmp > 0)
+    {
+        h = zlx->nblocks ? &zlx->headers[zlx->nblocks - 1] : NULL;
+        if (h == NULL || h->count == ZLX_BLOCK_ENTRIES || h->used >= ZLX_BLOCK_BYTES)
+        {
+            zlxHeadersInsert(zlx, zlx->nblocks);
+            h = &zlx->headers[zlx->nblocks - 1];
+            h->buf = NULL;
+            h->rank = zlx->length;
+            h->count = h->used = 0;
+            shared = 0;
+        }
+        else
+        {
+            shared = zlxCommonPrefix(zlx->tail, sdslen(zlx->tail), bd.s, bd.len);
+        }
+        h->buf = xm_realloc(h->buf, h->used + zlxVarintLen(shared) + zlxVarintLen(bd.len - shared) + bd.len - shared);
+        h->used += zlxVarintEncode(h->buf + h->used, shared);
+        h->used += zlxVarintEncode(h->buf + h->used, bd.len - shared);
+        memcpy(h->buf + h->used, bd.s + shared, bd.len - shared);
+        h->used += bd.len - shared;
+        h->count++;
+        sdsclear(zlx->tail);
+        zlx->tail = sdscatlen(zlx->tail, bd.s, bd.len);
+        zlx->length++;
+        decrRefCount(obj);
+        return 1;
+    }
+    if (cmp == 0)
+    {
+        decrRefCount(obj);
+        return 0;
+    }
+
+    // 插入到中间，解码所在的块，插入之后重新编码
+    b = zlxFindBlock(zlx, &bd);
+    zlxDecodeBlock(&zlx->headers[b], &e);
+    i = zlxEntriesFind(&e, bd.s, bd.len, &found);
+    if (!found)
+    {
+        zlxEntriesAppend(&e, bd.s, bd.len);
+        memmove(e.offs + i + 1, e.offs + i, sizeof(size_t) * (e.n - 1 - i));
+        memmove(e.lens + i + 1, e.lens + i, sizeof(size_t) * (e.n - 1 - i));
+        e.offs[i] = sdslen(e.arena) - bd.len;
+        e.lens[i] = bd.len;
+        zlxRewriteBlock(zlx, b, &e);
+        zlx->length++;
+        zlxInvalidateRanks(zlx, b);
+    }
+    sdsfree(e.arena);
+    decrRefCount(obj);
+    return !found;
+}
+
+int zlxDelete(zlexset *zlx, robj *obj)
+{
+    zlxEntries e;
+    zlxBound bd;
+    unsigned long b;
+    int i, found;
+
+    if (zlx->length == 0)
+        return 0;
+    obj = getDecodedObject(obj);
+    zlxBoundFromObject(&bd, obj, 1);
+    b = zlxFindBlock(zlx, &bd);
+    zlxDecodeBlock(&zlx->headers[b], &e);
+    i = zlxEntriesFind(&e, bd.s, bd.len, &found);
+    if (found)
+    {
+        memmove(e.offs + i, e.offs + i + 1, sizeof(size_t) * (e.n - i - 1));
+        memmove(e.lens + i, e.lens + i + 1, sizeof(size_t) * (e.n - i - 1));
+        e.n--;
+        if (e.n == 0)
+            zlxRewriteBlock(zlx, b, &e);
+        else
+            zlxEncodeBlock(&zlx->headers[b], &e, 0, e.n);
+        zlx->length--;
+        zlx->deleted++;
+        zlxInvalidateRanks(zlx, b);
+        // 删除的是最后一个成员
+        if (sdslen(zlx->tail) == bd.len && memcmp(zlx->tail, bd.s, bd.len) == 0)
+            zlxUpdateTail(zlx);
+    }
+    sdsfree(e.arena);
+    decrRefCount(obj);
+    return found;
+}
+
+/*********************************范围删除***********************************/
+
+unsigned long zlxDeleteRangeByRank(zlexset *zlx, unsigned long start, unsigned long end)
+{
+    zlxEntries e, rest;
+    unsigned long first, b, dropfrom = 0, drop = 0;
+    zlxHeader *h;
+    int i, lo, hi, tail;
+
+    if (end > zlx->length)
+        end = zlx->length;
+    if (start < 1 || start > end)
+        return 0;
+    tail = end == zlx->length;
+    zlxUpdateRanks(zlx);
+
+    first = zlxBlockOfRank(zlx, start - 1);
+    for (b = first; b < zlx->nblocks && zlx->headers[b].rank < end; b++)
+    {
+        h = &zlx->headers[b];
+        // 范围和这个块的交集在块中的下标
+        lo = start > h->rank + 1 ? start - h->rank - 1 : 0;
+        hi = end - h->rank < h->count ? end - h->rank - 1 : h->count - 1;
+
+        // 整个块都在范围内，直接释放，这些块在块头数组中是连续的一段
+        if (lo == 0 && hi == (int)h->count - 1)
+        {
+            if (drop++ == 0)
+                dropfrom = b;
+            xm_free(h->buf);
+            continue;
+        }
+        // 只有范围两端的块需要重新编码剩下的元素
+        zlxDecodeBlock(h, &e);
+        zlxEntriesInit(&rest);
+        for (i = 0; i < e.n; i++)
+            if (i < lo || i > hi)
+                zlxEntriesAppend(&rest, zlxEntry(&e, i), e.lens[i]);
+        zlxEncodeBlock(h, &rest, 0, rest.n);
+        sdsfree(e.arena);
+        sdsfree(rest.arena);
+    }
+    zlxHeadersRemove(zlx, dropfrom, drop);
+    zlx->length -= end - start + 1;
+    zlx->deleted += end - start + 1;
+    zlxInvalidateRanks(zlx, first);
+    if (tail)
+        zlxUpdateTail(zlx);
+    return end - start + 1;
+}
+
+unsigned long zlxDeleteRangeByLex(zlexset *zlx, zlexrangespec *range)
+{
+    unsigned long first = zlxRankOfFirstInLexRange(zlx, range);
+
+    if (first == 0)
+        return 0;
+    return zlxDeleteRangeByRank(zlx, first, zlxRankOfLastInLexRange(zlx, range));
+}
+
+size_t zlxBytes(zlexset *zlx)
+{
+    size_t bytes = sizeof(*zlx) + sizeof(zlxHeader) * zlx->capacity + sdsAllocSize(zlx->tail);
+    unsigned long b;
+
+    for (b = 0; b < zlx->nblocks; b++)
+        bytes += zlx->headers[b].used;
+    return bytes;
+}
@@ -0,0 +1,104 @@
+#ifndef HXM_LEXSET_H
+#define HXM_LEXSET_H
+
+#include "xmobject.h"
+#include "xmsds.h"
+#include "xmskiplist.h"
+
+/*
+所有成员分值都相同的有序集合的排序索引，适合只按字典序查询的集合，比如自动补全
+
+分值都相同时元素只按成员排序，所以这里只保存成员，共同的分值保存一份，也不需要字典：
+按成员查找分值就是一次按字典序的二分查找。
+
+成员按字典序依次保存在块中，块中的每个成员只保存它和前一个成员的公共前缀长度以及剩下的后缀，
+共享长前缀的成员只占很少的字节。块的第一个成员保存完整的字符串。
+
+所有块头连续保存在一个数组中，块头记录块之前的元素个数（插入、删除之后推迟到用到排位时才更新），
+按成员查找时先用每个块的第一个成员在块头数组中二分查找，再在一个块中顺序解码；
+块内比较时利用公共前缀长度跳过已经比较过的前缀，大部分成员不需要真正比较字节。
+按字典序范围和排位查找的复杂度都是 O(log N) ，之后每取出一个元素只需要解码一个后缀，
+所以 ZRANGEBYLEX 加上 LIMIT 的复杂度是 O(log N + M) 。
+*/
+
+// 每个块最多的元素个数
+#define ZLX_BLOCK_ENTRIES 32
+// 块中编码之后的字节数超过这个值时分裂，只有一个元素的块不受限制
+#define ZLX_BLOCK_BYTES 512
+
+typedef struct zlxHeader
+{
+    // 编码之后的成员，每个成员依次是公共前缀长度、后缀长度两个变长整数，以及后缀
+    unsigned char *buf;
+    // 这个块之前的元素个数，块的下标不小于 zlexset.rankdirty 时已经过期
+    unsigned long rank;
+    // 元素个数，以及 buf 中已经使用的字节数
+    unsigned int count, used;
+} zlxHeader;
+
+typedef struct zlexset
+{
+    // 块头数组，按成员从小到大排列
+    zlxHeader *headers;
+    // 块的个数，以及块头数组的容量
+    unsigned long nblocks, capacity;
+    // 第一个排位已经过期的块，用到排位时才重新计算
+    unsigned long rankdirty;
+    // 元素个数
+    unsigned long length;
+    // 所有成员共同的分值
+    double score;
+    // 最后一个成员，追加到表尾时只需要和它比较，不用解码最后一个块
+    sds tail;
+    // 累计删除过的元素个数，只增不减，ZSCAN 用它修正游标
+    unsigned long deleted;
+} zlexset;
+
+// 指向集合中的一个元素
+// 前缀压缩的成员要从块中前一个成员解码，所以当前成员保存在 key 中，沿着块顺序移动时只需要解码后缀
+// 使用完需要调用 zlxPosRelease
+typedef struct zlxPos
+{
+    zlexset *zlx;
+    // 所在的块在块头数组中的下标，等于 nblocks 时表示不指向任何元素
+    unsigned long b;
+    int i;
+    // 下一个元素在块中的起始位置
+    unsigned int off;
+    sds key;
+} zlxPos;
+
+#define zlxPosKey(p) ((p)->key)
+#define zlxPosValid(p) ((p)->b < (p)->zlx->nblocks)
+
+// 创建一个空的集合，成员的分值都是 score
+zlexset *zlxCreate(double score);
+void zlxFree(zlexset *zlx);
+// 插入成员 obj ，插入成功返回 1 ，成员已经存在时返回 0 。比所有成员都大的成员直接追加到表尾
+int zlxInsert(zlexset *zlx, robj *obj);
+// 删除成员 obj ，删除成功返回 1 ，成员不存在时返回 0
+int zlxDelete(zlexset *zlx, robj *obj);
+
+// 初始化 p ，不指向任何元素
+void zlxPosInit(zlxPos *p, zlexset *zlx);
+void zlxPosRelease(zlxPos *p);
+// 将 p 移动到下一个（前一个）元素，已经没有元素时返回 0
+int zlxNext(zlxPos *p);
+int zlxPrev(zlxPos *p);
+
+// 返回成员 o 的排位，以 1 为起始值，成员不存在时返回 0
+unsigned long zlxGetRank(zlexset *zlx, robj *o);
+// 让 p 指向排位为 rank 的元素（以 1 为起始值），rank 超出范围时返回 0 ，p 需要已经初始化
+int zlxGetElementByRank(zlexset *zlx, unsigned long rank, zlxPos *p);
+// 返回第一个（最后一个）在范围内的元素的排位，以 1 为起始值，没有时返回 0
+unsigned long zlxRankOfFirstInLexRange(zlexset *zlx, zlexrangespec *range);
+unsigned long zlxRankOfLastInLexRange(zlexset *zlx, zlexrangespec *range);
+
+// 删除排位在 [start, end] 之内的元素，排位以 1 为起始值，返回被删除的元素个数
+unsigned long zlxDeleteRangeByRank(zlexset *zlx, unsigned long start, unsigned long end);
+unsigned long zlxDeleteRangeByLex(zlexset *zlx, zlexrangespec *range);
+
+// 返回集合占用的内存字节数
+size_t zlxBytes(zlexset *zlx);
+
+#endif
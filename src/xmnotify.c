@@ -1,4 +1,7 @@
+#include <string.h>
 #include "xmnotify.h"
+#include "xmt_string.h"
+#include "xmpubsub.h"
 
 int keyspaceEventsStringToFlags(char *classes)
 {
@@ -2,6 +2,8 @@
 #include "xmobject.h"
 #include "xmmalloc.h"
 #include "xmsds.h"
+#include "xmdict.h"
+#include "xmt_string.h"
 
 #include <math.h>
 #include <sys/time.h>
@@ -9,9 +11,12 @@
 #include <stdio.h>
 #include <limits.h>
 
+// 共享对象
+struct sharedObjects shared;
+
 // 返回微秒格式的 UNIX 时间
 // 1 秒 = 1 000 000 微秒
-static long long ustime(void)
+long long ustime(void)
 {
     struct timeval tv;
     long long ust;
@@ -24,7 +29,7 @@ static long long ustime(void)
 
 // 返回毫秒格式的 UNIX 时间
 // 1 秒 = 1 000 毫秒
-static long long mstime(void)
+long long mstime(void)
 {
     return ustime() / 1000;
 }
@@ -38,6 +43,17 @@ unsigned int getLRUClock(void)
 void createSharedObjects(void)
 {
     int j;
+    // 常用回复
+    shared.wrongtypeerr = createObject(REDIS_STRING, sdsnew(
+        "-WRONGTYPE Operation against a key holding the wrong kind of value\r\n"));
+    shared.nullbulk = createObject(REDIS_STRING, sdsnew("$-1\r\n"));
+    shared.nullmultibulk = createObject(REDIS_STRING, sdsnew("*-1\r\n"));
+    shared.emptymultibulk = createObject(REDIS_STRING, sdsnew("*0\r\n"));
+    shared.emptyscan = createObject(REDIS_STRING, sdsnew("*2\r\n$1\r\n0\r\n*0\r\n"));
+    shared.czero = createObject(REDIS_STRING, sdsnew(":0\r\n"));
+    // 字典序范围中表示最小和最大字符串的特殊对象，只按地址比较
+    shared.minstring = createObject(REDIS_STRING, sdsnew("minstring"));
+    shared.maxstring = createObject(REDIS_STRING, sdsnew("maxstring"));
     // 常用整数
     for (j = 0; j < REDIS_SHARED_INTEGERS; j++)
     {
@@ -62,6 +78,14 @@ void incrRefCount(robj *o)
     o->refcount++;
 }
 
+// 列表、集合、有序集合和哈希对象的释放函数，由各类型模块通过 objectRegisterFreeProc 注册
+static objectFreeProc *objectFreeProcs[REDIS_HASH + 1];
+
+void objectRegisterFreeProc(int type, objectFreeProc *proc)
+{
+    objectFreeProcs[type] = proc;
+}
+
 void decrRefCount(robj *o)
 {
     if (o->refcount <= 0)
@@ -70,29 +94,14 @@ void decrRefCount(robj *o)
     // 释放对象
     if (o->refcount == 1)
     {
-        switch (o->type)
-        {
-        case REDIS_STRING:
+        if (o->type == REDIS_STRING)
             freeStringObject(o);
-            break;
-            /*case REDIS_LIST:
-            freeListObject(o);
-            break;
-        case REDIS_SET:
-            freeSetObject(o);
-            break;
-        case REDIS_ZSET:
-            freeZsetObject(o);
-            break;
-        case REDIS_HASH:
-            freeHashObject(o);
-            break;
-        */
-
-        default:
+        // 容器对象的释放函数还要删除以对象指针为键的跳跃索引、域索引和访问记录，
+        // 否则之后分配在同一个地址上的对象会用到过期的记录
+        else if (o->type <= REDIS_HASH && objectFreeProcs[o->type] != NULL)
+            objectFreeProcs[o->type](o);
+        else
             printf("Unknown object type");
-            break;
-        }
         xm_free(o);
     }
     else
@@ -152,6 +161,16 @@ char *strEncoding(int encoding)
         return "skiplist";
     case REDIS_ENCODING_EMBSTR:
         return "embstr";
+    case REDIS_ENCODING_ROARING:
+        return "roaring";
+    case REDIS_ENCODING_INTHT:
+        return "inthashtable";
+    case REDIS_ENCODING_BTREE:
+        return "btree";
+    case REDIS_ENCODING_TSERIES:
+        return "tseries";
+    case REDIS_ENCODING_LEXSET:
+        return "lexset";
     default:
         return "unknown";
     }
@@ -171,3 +190,120 @@ unsigned long long estimateObjectIdleTime(robj *o)
                REDIS_LRU_CLOCK_RESOLUTION;
     }
 }
+
+/**********************ziplist 的位置跳跃索引******************************/
+
+// 跳跃索引不占用 robj 的空间，而是保存在以对象指针为键的字典中
+
+static unsigned int skipIndexHash(const void *key)
+{
+    return dictGenHashFunction(&key, sizeof(key));
+}
+
+static void skipIndexDestructor(void *privdata, void *val)
+{
+    DICT_NOTUSED(privdata);
+    ziplistSkipIndexRelease(val);
+}
+
+static dictType skipIndexDictType = {
+    skipIndexHash,       /* hash function */
+    NULL,                /* key dup */
+    NULL,                /* val dup */
+    NULL,                /* key compare */
+    NULL,                /* key destructor */
+    skipIndexDestructor  /* val destructor */
+};
+
+// 对象指针 -> zlSkipIndex
+static dict *objectSkipIndexes = NULL;
+
+zlSkipIndex *objectGetSkipIndex(robj *o)
+{
+    zlSkipIndex *si;
+
+    if (o->encoding != REDIS_ENCODING_ZIPLIST)
+        return NULL;
+
+    if (objectSkipIndexes == NULL)
+        objectSkipIndexes = dictCreate(&skipIndexDictType, NULL);
+
+    if ((si = dictFetchValue(objectSkipIndexes, o)) != NULL)
+        return si;
+
+    // 节点较少时直接遍历更划算
+    if (ziplistLen(o->ptr) < ZIPLIST_SKIP_INDEX_MIN_ENTRIES)
+        return NULL;
+
+    si = ziplistSkipIndexCreate(ZIPLIST_SKIP_INDEX_STEP);
+    dictAdd(objectSkipIndexes, o, si);
+    return si;
+}
+
+void objectTouchSkipIndex(robj *o, unsigned char *p)
+{
+    zlSkipIndex *si;
+
+    if (objectSkipIndexes == NULL)
+        return;
+    if ((si = dictFetchValue(objectSkipIndexes, o)) != NULL)
+        ziplistSkipIndexTouch(si, o->ptr, p);
+}
+
+void objectFreeSkipIndex(robj *o)
+{
+    if (objectSkipIndexes == NULL)
+        return;
+    dictDelete(objectSkipIndexes, o);
+}
+
+/**********************哈希 ziplist 的域索引******************************/
+
+// 和跳跃索引一样保存在以对象指针为键的字典中
+
+static void hashIndexDestructor(void *privdata, void *val)
+{
+    DICT_NOTUSED(privdata);
+    ziplistHashIndexRelease(val);
+}
+
+static dictType hashIndexDictType = {
+    skipIndexHash,      /* hash function */
+    NULL,               /* key dup */
+    NULL,               /* val dup */
+    NULL,               /* key compare */
+    NULL,               /* key destructor */
+    hashIndexDestructor /* val destructor */
+};
+
+// 对象指针 -> zlHashIndex
+static dict *objectHashIndexes = NULL;
+
+zlHashIndex *objectGetHashIndex(robj *o)
+{
+    zlHashIndex *hi;
+
+    if (o->type != REDIS_HASH || o->encoding != REDIS_ENCODING_ZIPLIST)
+        return NULL;
+
+    if (objectHashIndexes == NULL)
+        objectHashIndexes = dictCreate(&hashIndexDictType, NULL);
+
+    if ((hi = dictFetchValue(objectHashIndexes, o)) != NULL)
+        return hi;
+
+    // 域较少时直接遍历更划算
+    if (ziplistLen(o->ptr) / 2 < ZIPLIST_HASH_INDEX_MIN_FIELDS)
+        return NULL;
+
+    hi = ziplistHashIndexCreate();
+    dictAdd(objectHashIndexes, o, hi);
+    return hi;
+}
+
+void objectFreeHashIndex(robj *o)
+{
+    if (objectHashIndexes == NULL)
+        return;
+    dictDelete(objectHashIndexes, o);
+}
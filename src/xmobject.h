@@ -3,6 +3,8 @@
 
 #include <stdlib.h>
 
+#include "xmzplist.h"
+
 // Least Recently Used，和时间有关的宏和声明
 #define REDIS_LRU_BITS 24                               // 表示时间的无符号整数的位数
 #define REDIS_LRU_CLOCK_MAX ((1 << REDIS_LRU_BITS) - 1) // 时间的最大值
@@ -40,12 +42,23 @@ typedef struct redisObject
 #define REDIS_ENCODING_INTSET 6     //整数集合
 #define REDIS_ENCODING_SKIPLIST 7   //跳跃表和字典
 #define REDIS_ENCODING_EMBSTR 8     //embstr 编码的简单动态字符串
+#define REDIS_ENCODING_ROARING 9    //压缩位图
+#define REDIS_ENCODING_INTHT 10     //值都是整数的字典，值直接保存在字典节点中
+#define REDIS_ENCODING_BTREE 11     //B+ 树和字典
+#define REDIS_ENCODING_TSERIES 12   //差值编码的块序列和字典，分值都是整数
+#define REDIS_ENCODING_LEXSET 13    //前缀压缩的成员序列，分值都相同
 
 //共享对象
 #define REDIS_SHARED_INTEGERS 10000
 struct sharedObjects
 {
     robj *minstring, *maxstring;
+    robj *wrongtypeerr;          // -WRONGTYPE 错误回复
+    robj *nullbulk;              // $-1\r\n
+    robj *nullmultibulk;         // *-1\r\n
+    robj *emptymultibulk;        // *0\r\n
+    robj *emptyscan;             // 空键的 SCAN 回复，游标为 0 ，没有元素
+    robj *czero;                 // :0\r\n
     robj *integers[REDIS_SHARED_INTEGERS]; //共享的 REDIS_ENCODING_INT编码的对象
 };
 // 共享对象
@@ -60,6 +73,11 @@ robj *createObject(int type, void *ptr);
 int checkType(/*redisClient *c, */robj *o, int type);
 
 
+// 释放对象 o 的底层数据结构，o 本身由 decrRefCount 释放
+typedef void objectFreeProc(robj *o);
+// 注册 type 类型对象的释放函数，字符串对象由 decrRefCount 直接释放，不需要注册
+void objectRegisterFreeProc(int type, objectFreeProc *proc);
+
 // 为对象的引用计数增一
 void incrRefCount(robj *o);
 // 为对象的引用计数减一,当对象的引用计数降为 0 时，释放对象
@@ -75,6 +93,17 @@ char *strEncoding(int encoding);
 // 使用近似 LRU 算法，计算出给定对象的闲置时长,单位为ms
 unsigned long long estimateObjectIdleTime(robj *o);
 
+// 返回 ziplist 编码对象的位置跳跃索引，节点数量不足 ZIPLIST_SKIP_INDEX_MIN_ENTRIES 时返回 NULL
+zlSkipIndex *objectGetSkipIndex(robj *o);
+// 对象的 ziplist 在 p 处插入或删除节点之后调用，p 为 NULL 表示整个 ziplist 都被改写
+void objectTouchSkipIndex(robj *o, unsigned char *p);
+// 释放对象的跳跃索引，在 ziplist 被释放或者转换编码时调用
+void objectFreeSkipIndex(robj *o);
+// 返回哈希对象的 ziplist 域索引，不是 ziplist 编码或者域的数量不足 ZIPLIST_HASH_INDEX_MIN_FIELDS 时返回 NULL
+zlHashIndex *objectGetHashIndex(robj *o);
+// 释放对象的域索引，在 ziplist 被释放或者转换编码时调用
+void objectFreeHashIndex(robj *o);
+
 
 // OBJECT 命令的辅助函数，用于在不修改 LRU 时间的情况下，尝试获取 key 对象
 // robj *objectCommandLookup(/*redisClient *c,*/ robj *key);
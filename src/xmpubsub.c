@@ -0,0 +1,61 @@
+#include "xmpubsub.h"
+#include "xmclient.h"
+#include "xmt_string.h"
+
+int pubsubPublishMessage(robj *channel, robj *message)
+{
+    int receivers = 0;
+    dictEntry *de;
+    ilistIter it;
+    ilistNode *ln;
+
+    /* Send to clients listening for that channel */
+    // 取出所有订阅频道 channel 的客户端，向它们发送消息
+    if (server.pubsub_channels && (de = dictFind(server.pubsub_channels, channel)) != NULL)
+    {
+        list *list = dictGetVal(de);
+        listNode *node;
+        listIter li;
+
+        listRewind(list, &li);
+        while ((node = listNext(&li)) != NULL)
+        {
+            redisClient *c = node->value;
+
+            // 回复格式为 message <channel> <message>
+            addReplyMultiBulkLen(c, 3);
+            addReplyBulkCBuffer(c, "message", 7);
+            addReplyBulk(c, channel);
+            addReplyBulk(c, message);
+            receivers++;
+        }
+    }
+
+    /* Send to clients listening to matching channels */
+    // 把消息发送给订阅了匹配 channel 的模式的客户端
+    if (ilistLength(&server.pubsub_patterns))
+    {
+        // 模式匹配需要字符串形式的频道名
+        channel = getDecodedObject(channel);
+        ilistRewind(&server.pubsub_patterns, &it, AL_START_HEAD);
+        while ((ln = ilistNext(&it)) != NULL)
+        {
+            pubsubPattern *pat = ilistEntry(ln, pubsubPattern, server_node);
+
+            if (stringmatchlen((char *)pat->pattern->ptr, sdslen(pat->pattern->ptr),
+                               (char *)channel->ptr, sdslen(channel->ptr), 0))
+            {
+                // 回复格式为 pmessage <pattern> <channel> <message>
+                addReplyMultiBulkLen(pat->client, 4);
+                addReplyBulkCBuffer(pat->client, "pmessage", 8);
+                addReplyBulk(pat->client, pat->pattern);
+                addReplyBulk(pat->client, channel);
+                addReplyBulk(pat->client, message);
+                receivers++;
+            }
+        }
+        decrRefCount(channel);
+    }
+
+    return receivers;
+}
@@ -0,0 +1,18 @@
+#ifndef HXM_PUBSUB_H
+#define HXM_PUBSUB_H
+
+#include "xmobject.h"
+#include "xmserver.h"
+
+/*
+发布与订阅
+
+只移植了发布消息的部分，键空间通知通过它把事件发送给订阅者。
+订阅频道的客户端保存在 server.pubsub_channels 中，订阅模式的客户端保存在 server.pubsub_patterns 中。
+*/
+
+// 将 message 发送给所有订阅频道 channel 的客户端，以及订阅了匹配 channel 的模式的客户端
+// 返回收到消息的客户端数量
+int pubsubPublishMessage(robj *channel, robj *message);
+
+#endif
@@ -0,0 +1,27 @@
+#include "xmrand.h"
+
+#define WYRAND_ADD 0xa0761d6478bd642fULL
+#define WYRAND_XOR 0xe7037ed1a0b428dbULL
+
+static __thread uint64_t rand_state = WYRAND_ADD;
+
+void xm_srandom(uint64_t seed)
+{
+    rand_state = seed;
+}
+
+uint64_t xm_random(void)
+{
+    __uint128_t t;
+
+    rand_state += WYRAND_ADD;
+    t = (__uint128_t)rand_state * (rand_state ^ WYRAND_XOR);
+    return (uint64_t)(t >> 64) ^ (uint64_t)t;
+}
+
+uint64_t xm_random_below(uint64_t n)
+{
+    // 把 64 位随机数看作 [0, 1) 之间的小数再乘以 n ，只用一次乘法，不用除法
+    // 偏差不超过 n / 2^64 ，可以忽略
+    return (uint64_t)(((__uint128_t)xm_random() * n) >> 64);
+}
@@ -0,0 +1,22 @@
+#ifndef HXM_RAND_H
+#define HXM_RAND_H
+
+#include <stdint.h>
+
+/*
+跳跃表、字典、整数集合和集合取样共用的伪随机数生成器
+
+使用 wyrand 算法：状态只有一个 64 位整数，每次加上一个常数，再做一次 64x64->128 位乘法，
+不调用 libc ，也不加锁。状态是线程局部的，各个线程互不干扰。
+没有调用 xm_srandom 时种子固定，和 libc 的 random() 一样每次运行得到相同的序列，
+调用 xm_srandom 之后的序列只由种子决定，基准测试可以据此复现结果。
+*/
+
+// 设置当前线程的种子
+void xm_srandom(uint64_t seed);
+// 返回一个 64 位的随机数
+uint64_t xm_random(void);
+// 返回 [0, n) 之间的随机整数，n 不能为 0
+uint64_t xm_random_below(uint64_t n);
+
+#endif
@@ -4,6 +4,7 @@
 
 #include "xmsds.h"
 #include "xmt_string.h"
+#include "xmroaring.h"
 
 #include "lzf.h"
 
@@ -305,4 +306,57 @@ int rdbSaveLzfStringObject(rio *rdb, unsigned char *s, size_t len)
 writeerr:
     zfree(out);
     return -1;
-}
\ No newline at end of file
+}
+
+int rdbSaveRoaringObject(rio *rdb, robj *o)
+{
+    size_t len = roaringSerializedSize(o->ptr);
+    unsigned char *buf;
+    int n, nwritten = 0;
+
+    // 长度只能用 32 位保存
+    if (len > UINT32_MAX)
+        return -1;
+    buf = xm_malloc(len);
+    roaringSerialize(o->ptr, buf);
+
+    if ((n = rdbSaveLen(rdb, len)) == -1)
+        goto writeerr;
+    nwritten += n;
+    if ((n = rdbWriteRaw(rdb, buf, len)) == -1)
+        goto writeerr;
+    nwritten += n;
+
+    xm_free(buf);
+    return nwritten;
+
+writeerr:
+    xm_free(buf);
+    return -1;
+}
+
+robj *rdbLoadRoaringObject(rio *rdb)
+{
+    uint32_t len;
+    unsigned char *buf;
+    roaring *r;
+    robj *o;
+
+    if ((len = rdbLoadLen(rdb, NULL)) == REDIS_RDB_LENERR)
+        return NULL;
+    buf = xm_malloc(len ? len : 1);
+    if (len && rioRead(rdb, buf, len) == 0)
+    {
+        xm_free(buf);
+        return NULL;
+    }
+    // 反序列化时会检查容器的键、元素个数和内容是否一致
+    r = roaringDeserialize(buf, len);
+    xm_free(buf);
+    if (r == NULL)
+        return NULL;
+
+    o = createObject(REDIS_SET, r);
+    o->encoding = REDIS_ENCODING_ROARING;
+    return o;
+}
@@ -58,9 +58,10 @@ key_value_pairs: `<TYPE><key><value>`或者`<EXPIRETIME_MS><ms><TYPE><key><value
 #define REDIS_RDB_TYPE_SET_INTSET 11
 #define REDIS_RDB_TYPE_ZSET_ZIPLIST 12
 #define REDIS_RDB_TYPE_HASH_ZIPLIST 13
+#define REDIS_RDB_TYPE_SET_ROARING 14
 
 // 检查给定类型是否对象
-#define rdbIsObjectType(t) ((t >= 0 && t <= 4) || (t >= 10 && t <= 13))
+#define rdbIsObjectType(t) ((t >= 0 && t <= 4) || (t >= 10 && t <= 14))
 
 // RDB文件中的特殊操作标识符
 // 以 MS 计算的过期时间
@@ -114,6 +115,12 @@ void backgroundSaveDoneHandler(int exitcode, int bysignal);
 int rdbSaveKeyValuePair(rio *rdb, robj *key, robj *val, long long expiretime, long long now);
 robj *rdbLoadStringObject(rio *rdb);
 
+// 保存 ROARING 编码的集合：先写入序列化后的长度，再写入序列化的内容
+// 成功时返回写入的字节数，失败返回 -1
+int rdbSaveRoaringObject(rio *rdb, robj *o);
+// 载入 REDIS_RDB_TYPE_SET_ROARING 类型的集合，内容不合法时返回 NULL
+robj *rdbLoadRoaringObject(rio *rdb);
+
 
 
 #endif
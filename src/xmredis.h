@@ -8,4 +8,16 @@
 
 typedef long long mstime_t;
 
+// 运行 ID 的长度
+#define REDIS_RUN_ID_SIZE 40
+
+// 数据库和客户端结构互相引用，先声明类型名，结构分别定义在 xmdb.h 和 xmclient.h 中
+typedef struct redisDb redisDb;
+typedef struct redisClient redisClient;
+
+// 返回微秒格式的 UNIX 时间
+long long ustime(void);
+// 返回毫秒格式的 UNIX 时间
+long long mstime(void);
+
 #endif
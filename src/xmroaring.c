@@ -0,0 +1,1147 @@
+#include "xmroaring.h"
+#include "xmmalloc.h"
+#include "xmrand.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define ROARING_SIGN_BIT ((uint64_t)1 << 63)
+
+// 值的高 48 位作为容器的键，符号位取反后有符号数的大小顺序和无符号数一致
+#define roaringKey(v) ((((uint64_t)(v)) ^ ROARING_SIGN_BIT) >> 16)
+#define roaringLow(v) ((uint16_t)((uint64_t)(v)&0xffff))
+#define roaringValue(key, low) ((int64_t)((((uint64_t)(key) << 16) | (low)) ^ ROARING_SIGN_BIT))
+
+/****************************容器******************************/
+
+// 在有序数组 a[0..n) 中查找第一个不小于 v 的位置
+static uint32_t _arrayLowerBound(const uint16_t *a, uint32_t n, uint16_t v)
+{
+    uint32_t lo = 0, hi = n, mid;
+    while (lo < hi)
+    {
+        mid = (lo + hi) / 2;
+        if (a[mid] < v)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+// 在区间数组中查找最后一个 start 不大于 v 的区间，没有时返回 -1
+static int32_t _runFind(const roaringRun *runs, uint32_t n, uint16_t v)
+{
+    int32_t lo = 0, hi = (int32_t)n - 1, mid, res = -1;
+    while (lo <= hi)
+    {
+        mid = (lo + hi) / 2;
+        if (runs[mid].start <= v)
+        {
+            res = mid;
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid - 1;
+        }
+    }
+    return res;
+}
+
+static void _containerInitArray(roaringContainer *c, uint32_t cap)
+{
+    c->type = ROARING_ARRAY;
+    c->card = c->n = 0;
+    c->cap = cap;
+    c->data = xm_malloc(sizeof(uint16_t) * (cap ? cap : 1));
+}
+
+static void _containerInitBitmap(roaringContainer *c)
+{
+    c->type = ROARING_BITMAP;
+    c->card = c->n = c->cap = 0;
+    c->data = xm_calloc(sizeof(uint64_t) * ROARING_BITMAP_WORDS);
+}
+
+static void _containerFree(roaringContainer *c)
+{
+    xm_free(c->data);
+    c->data = NULL;
+}
+
+// 保证 ARRAY 容器至少还能放下一个元素，按两倍扩展
+static void _arrayReserve(roaringContainer *c, uint32_t need)
+{
+    if (need <= c->cap)
+        return;
+    c->cap = c->cap * 2 > need ? c->cap * 2 : need;
+    if (c->cap > ROARING_ARRAY_MAX)
+        c->cap = need > ROARING_ARRAY_MAX ? need : ROARING_ARRAY_MAX;
+    c->data = xm_realloc(c->data, sizeof(uint16_t) * c->cap);
+}
+
+// 把 ARRAY 或 RUN 容器原地转换为 BITMAP
+static void _containerToBitmap(roaringContainer *c)
+{
+    uint64_t *bits = xm_calloc(sizeof(uint64_t) * ROARING_BITMAP_WORDS);
+    uint32_t i, v;
+
+    if (c->type == ROARING_BITMAP)
+    {
+        xm_free(bits);
+        return;
+    }
+    if (c->type == ROARING_ARRAY)
+    {
+        uint16_t *a = c->data;
+        for (i = 0; i < c->n; i++)
+            bits[a[i] >> 6] |= (uint64_t)1 << (a[i] & 63);
+    }
+    else
+    {
+        roaringRun *runs = c->data;
+        for (i = 0; i < c->n; i++)
+            for (v = runs[i].start; v <= (uint32_t)runs[i].start + runs[i].len; v++)
+                bits[v >> 6] |= (uint64_t)1 << (v & 63);
+    }
+    xm_free(c->data);
+    c->data = bits;
+    c->type = ROARING_BITMAP;
+    c->n = c->cap = 0;
+}
+
+// 把 BITMAP 或 RUN 容器原地转换为 ARRAY ，调用者保证元素个数不超过 ROARING_ARRAY_MAX
+static void _containerToArray(roaringContainer *c)
+{
+    uint16_t *a;
+    uint32_t i, k = 0, v;
+
+    if (c->type == ROARING_ARRAY)
+        return;
+    a = xm_malloc(sizeof(uint16_t) * (c->card ? c->card : 1));
+    if (c->type == ROARING_BITMAP)
+    {
+        uint64_t *bits = c->data;
+        for (i = 0; i < ROARING_BITMAP_WORDS; i++)
+        {
+            uint64_t w = bits[i];
+            while (w)
+            {
+                a[k++] = i * 64 + __builtin_ctzll(w);
+                w &= w - 1;
+            }
+        }
+    }
+    else
+    {
+        roaringRun *runs = c->data;
+        for (i = 0; i < c->n; i++)
+            for (v = runs[i].start; v <= (uint32_t)runs[i].start + runs[i].len; v++)
+                a[k++] = v;
+    }
+    xm_free(c->data);
+    c->data = a;
+    c->type = ROARING_ARRAY;
+    c->n = c->cap = c->card;
+}
+
+// 把 RUN 容器展开成 ARRAY 或 BITMAP ，其他容器不变
+static void _containerUnrun(roaringContainer *c)
+{
+    if (c->type != ROARING_RUN)
+        return;
+    if (c->card <= ROARING_ARRAY_MAX)
+        _containerToArray(c);
+    else
+        _containerToBitmap(c);
+}
+
+static int _containerContains(roaringContainer *c, uint16_t low)
+{
+    if (c->type == ROARING_ARRAY)
+    {
+        uint16_t *a = c->data;
+        uint32_t pos = _arrayLowerBound(a, c->n, low);
+        return pos < c->n && a[pos] == low;
+    }
+    else if (c->type == ROARING_BITMAP)
+    {
+        uint64_t *bits = c->data;
+        return (bits[low >> 6] >> (low & 63)) & 1;
+    }
+    else
+    {
+        roaringRun *runs = c->data;
+        int32_t i = _runFind(runs, c->n, low);
+        return i >= 0 && low <= (uint32_t)runs[i].start + runs[i].len;
+    }
+}
+
+static int _containerAdd(roaringContainer *c, uint16_t low)
+{
+    if (c->type == ROARING_RUN)
+    {
+        if (_containerContains(c, low))
+            return 0;
+        _containerUnrun(c);
+    }
+
+    if (c->type == ROARING_ARRAY)
+    {
+        uint16_t *a = c->data;
+        uint32_t pos;
+
+        // 按顺序添加时新元素总在数组末尾
+        if (c->n > 0 && a[c->n - 1] < low)
+            pos = c->n;
+        else
+            pos = _arrayLowerBound(a, c->n, low);
+        if (pos < c->n && a[pos] == low)
+            return 0;
+        if (c->n == ROARING_ARRAY_MAX)
+        {
+            _containerToBitmap(c);
+            return _containerAdd(c, low);
+        }
+        _arrayReserve(c, c->n + 1);
+        a = c->data;
+        memmove(a + pos + 1, a + pos, sizeof(uint16_t) * (c->n - pos));
+        a[pos] = low;
+        c->n++;
+        c->card++;
+        return 1;
+    }
+    else
+    {
+        uint64_t *bits = c->data, mask = (uint64_t)1 << (low & 63);
+        if (bits[low >> 6] & mask)
+            return 0;
+        bits[low >> 6] |= mask;
+        c->card++;
+        return 1;
+    }
+}
+
+static int _containerRemove(roaringContainer *c, uint16_t low)
+{
+    if (c->type == ROARING_RUN)
+    {
+        if (!_containerContains(c, low))
+            return 0;
+        _containerUnrun(c);
+    }
+
+    if (c->type == ROARING_ARRAY)
+    {
+        uint16_t *a = c->data;
+        uint32_t pos = _arrayLowerBound(a, c->n, low);
+        if (pos >= c->n || a[pos] != low)
+            return 0;
+        memmove(a + pos, a + pos + 1, sizeof(uint16_t) * (c->n - pos - 1));
+        c->n--;
+        c->card--;
+        return 1;
+    }
+    else
+    {
+        uint64_t *bits = c->data, mask = (uint64_t)1 << (low & 63);
+        if (!(bits[low >> 6] & mask))
+            return 0;
+        bits[low >> 6] &= ~mask;
+        c->card--;
+        // 元素变少之后改回数组，省下空间
+        if (c->card <= ROARING_ARRAY_MAX / 2)
+            _containerToArray(c);
+        return 1;
+    }
+}
+
+// 取出容器中排第 rank 位的元素
+static uint16_t _containerSelect(roaringContainer *c, uint32_t rank)
+{
+    uint32_t i;
+
+    if (c->type == ROARING_ARRAY)
+    {
+        return ((uint16_t *)c->data)[rank];
+    }
+    else if (c->type == ROARING_BITMAP)
+    {
+        uint64_t *bits = c->data, w;
+        for (i = 0; i < ROARING_BITMAP_WORDS; i++)
+        {
+            uint32_t cnt = __builtin_popcountll(bits[i]);
+            if (rank < cnt)
+                break;
+            rank -= cnt;
+        }
+        w = bits[i];
+        while (rank--)
+            w &= w - 1;
+        return i * 64 + __builtin_ctzll(w);
+    }
+    else
+    {
+        roaringRun *runs = c->data;
+        for (i = 0; rank > runs[i].len; i++)
+            rank -= runs[i].len + 1;
+        return runs[i].start + rank;
+    }
+}
+
+// 返回容器按照 ARRAY、BITMAP、RUN 保存时分别需要的字节数中最小的那种表示
+static uint8_t _containerBestType(roaringContainer *c, uint32_t *nruns)
+{
+    uint32_t runs = 0, i;
+    size_t arraybytes, bitmapbytes, runbytes;
+
+    if (c->type == ROARING_RUN)
+    {
+        runs = c->n;
+    }
+    else if (c->type == ROARING_ARRAY)
+    {
+        uint16_t *a = c->data;
+        for (i = 0; i < c->n; i++)
+            runs += (i == 0 || a[i] != a[i - 1] + 1);
+    }
+    else
+    {
+        // 每个区间的起点是一个 1 ，并且它的前一位是 0
+        uint64_t *bits = c->data, prev = 0;
+        for (i = 0; i < ROARING_BITMAP_WORDS; i++)
+        {
+            runs += __builtin_popcountll(bits[i] & ~((bits[i] << 1) | (prev >> 63)));
+            prev = bits[i];
+        }
+    }
+    *nruns = runs;
+
+    arraybytes = c->card <= ROARING_ARRAY_MAX ? c->card * sizeof(uint16_t) : (size_t)-1;
+    bitmapbytes = ROARING_BITMAP_WORDS * sizeof(uint64_t);
+    runbytes = runs * sizeof(roaringRun);
+    if (runbytes < arraybytes && runbytes < bitmapbytes)
+        return ROARING_RUN;
+    return arraybytes <= bitmapbytes ? ROARING_ARRAY : ROARING_BITMAP;
+}
+
+// 把 ARRAY 或 BITMAP 容器转换为有 nruns 个区间的 RUN 容器
+static void _containerToRun(roaringContainer *c, uint32_t nruns)
+{
+    roaringRun *runs;
+    uint32_t k = 0, i;
+    int32_t prev = -2, v;
+
+    if (c->type == ROARING_RUN)
+        return;
+    runs = xm_malloc(sizeof(roaringRun) * (nruns ? nruns : 1));
+
+// 和上一个元素相邻时延长最后一个区间，否则开始一个新区间
+#define ROARING_APPEND_RUN(v)              \
+    do                                     \
+    {                                      \
+        if ((v) == prev + 1)               \
+            runs[k - 1].len++;             \
+        else                               \
+        {                                  \
+            runs[k].start = (v);           \
+            runs[k++].len = 0;             \
+        }                                  \
+        prev = (v);                        \
+    } while (0)
+
+    if (c->type == ROARING_ARRAY)
+    {
+        uint16_t *a = c->data;
+        for (i = 0; i < c->n; i++)
+        {
+            v = a[i];
+            ROARING_APPEND_RUN(v);
+        }
+    }
+    else
+    {
+        uint64_t *bits = c->data;
+        for (i = 0; i < ROARING_BITMAP_WORDS; i++)
+        {
+            uint64_t w = bits[i];
+            while (w)
+            {
+                v = i * 64 + __builtin_ctzll(w);
+                ROARING_APPEND_RUN(v);
+                w &= w - 1;
+            }
+        }
+    }
+#undef ROARING_APPEND_RUN
+
+    xm_free(c->data);
+    c->data = runs;
+    c->type = ROARING_RUN;
+    c->n = c->cap = k;
+}
+
+// 复制容器，RUN 容器被展开，结果只会是 ARRAY 或 BITMAP
+static void _containerCopyUnrun(roaringContainer *dst, roaringContainer *src)
+{
+    *dst = *src;
+    if (src->type == ROARING_BITMAP)
+    {
+        dst->data = xm_malloc(sizeof(uint64_t) * ROARING_BITMAP_WORDS);
+        memcpy(dst->data, src->data, sizeof(uint64_t) * ROARING_BITMAP_WORDS);
+    }
+    else if (src->type == ROARING_ARRAY)
+    {
+        dst->cap = src->n;
+        dst->data = xm_malloc(sizeof(uint16_t) * (src->n ? src->n : 1));
+        memcpy(dst->data, src->data, sizeof(uint16_t) * src->n);
+    }
+    else
+    {
+        dst->data = xm_malloc(sizeof(roaringRun) * src->n);
+        memcpy(dst->data, src->data, sizeof(roaringRun) * src->n);
+        _containerUnrun(dst);
+    }
+}
+
+// 求两个容器的交集，结果写入 dst ，返回结果的元素个数，为 0 时 dst 不需要释放
+static uint32_t _containerAnd(roaringContainer *dst, roaringContainer *a, roaringContainer *b)
+{
+    roaringContainer ta, tb;
+    uint32_t i, j;
+
+    // RUN 容器先展开，省得为每种组合各写一遍
+    if (a->type == ROARING_RUN || b->type == ROARING_RUN)
+    {
+        uint32_t card;
+        _containerCopyUnrun(&ta, a);
+        _containerCopyUnrun(&tb, b);
+        card = _containerAnd(dst, &ta, &tb);
+        _containerFree(&ta);
+        _containerFree(&tb);
+        return card;
+    }
+
+    if (a->type == ROARING_BITMAP && b->type == ROARING_BITMAP)
+    {
+        uint64_t *x = a->data, *y = b->data, *z;
+        _containerInitBitmap(dst);
+        z = dst->data;
+        for (i = 0; i < ROARING_BITMAP_WORDS; i++)
+        {
+            z[i] = x[i] & y[i];
+            dst->card += __builtin_popcountll(z[i]);
+        }
+        if (dst->card == 0)
+            _containerFree(dst);
+        else if (dst->card <= ROARING_ARRAY_MAX)
+            _containerToArray(dst);
+        return dst->card;
+    }
+
+    if (a->type == ROARING_BITMAP)
+    {
+        roaringContainer *t = a;
+        a = b;
+        b = t;
+    }
+    // 到这里 a 一定是 ARRAY
+    _containerInitArray(dst, a->n);
+    if (b->type == ROARING_BITMAP)
+    {
+        uint16_t *x = a->data, *z = dst->data;
+        uint64_t *bits = b->data;
+        for (i = 0; i < a->n; i++)
+        {
+            z[dst->n] = x[i];
+            dst->n += (bits[x[i] >> 6] >> (x[i] & 63)) & 1;
+        }
+    }
+    else
+    {
+        uint16_t *x = a->data, *y = b->data, *z = dst->data;
+        i = j = 0;
+        while (i < a->n && j < b->n)
+        {
+            uint16_t va = x[i], vb = y[j];
+            z[dst->n] = va;
+            dst->n += va == vb;
+            i += va <= vb;
+            j += vb <= va;
+        }
+    }
+    dst->card = dst->n;
+    if (dst->card == 0)
+        _containerFree(dst);
+    return dst->card;
+}
+
+// 求两个容器的并集，结果写入 dst ，返回结果的元素个数
+static uint32_t _containerOr(roaringContainer *dst, roaringContainer *a, roaringContainer *b)
+{
+    roaringContainer ta, tb;
+    uint32_t i, j;
+
+    if (a->type == ROARING_RUN || b->type == ROARING_RUN)
+    {
+        uint32_t card;
+        _containerCopyUnrun(&ta, a);
+        _containerCopyUnrun(&tb, b);
+        card = _containerOr(dst, &ta, &tb);
+        _containerFree(&ta);
+        _containerFree(&tb);
+        return card;
+    }
+
+    if (a->type == ROARING_ARRAY && b->type == ROARING_ARRAY)
+    {
+        uint16_t *x = a->data, *y = b->data, *z;
+        _containerInitArray(dst, a->n + b->n);
+        z = dst->data;
+        i = j = 0;
+        while (i < a->n && j < b->n)
+        {
+            uint16_t va = x[i], vb = y[j];
+            z[dst->n++] = va <= vb ? va : vb;
+            i += va <= vb;
+            j += vb <= va;
+        }
+        memcpy(z + dst->n, x + i, sizeof(uint16_t) * (a->n - i));
+        dst->n += a->n - i;
+        memcpy(z + dst->n, y + j, sizeof(uint16_t) * (b->n - j));
+        dst->n += b->n - j;
+        dst->card = dst->n;
+        if (dst->card > ROARING_ARRAY_MAX)
+            _containerToBitmap(dst);
+        return dst->card;
+    }
+
+    // 至少有一个是 BITMAP ，复制它再把另一个的元素并进来
+    if (a->type != ROARING_BITMAP)
+    {
+        roaringContainer *t = a;
+        a = b;
+        b = t;
+    }
+    _containerCopyUnrun(dst, a);
+    if (b->type == ROARING_BITMAP)
+    {
+        uint64_t *y = b->data, *z = dst->data;
+        dst->card = 0;
+        for (i = 0; i < ROARING_BITMAP_WORDS; i++)
+        {
+            z[i] |= y[i];
+            dst->card += __builtin_popcountll(z[i]);
+        }
+    }
+    else
+    {
+        uint16_t *y = b->data;
+        for (i = 0; i < b->n; i++)
+            _containerAdd(dst, y[i]);
+    }
+    return dst->card;
+}
+
+/****************************集合******************************/
+
+roaring *roaringNew(void)
+{
+    roaring *r = xm_malloc(sizeof(roaring));
+    r->size = r->cap = 0;
+    r->keys = NULL;
+    r->containers = NULL;
+    r->card = 0;
+    return r;
+}
+
+void roaringFree(roaring *r)
+{
+    uint32_t i;
+    for (i = 0; i < r->size; i++)
+        _containerFree(&r->containers[i]);
+    xm_free(r->keys);
+    xm_free(r->containers);
+    xm_free(r);
+}
+
+// 查找键为 key 的容器，找到时返回 1 ，*pos 为容器下标，否则 *pos 为新容器应该插入的位置
+static int _roaringFindKey(roaring *r, uint64_t key, uint32_t *pos)
+{
+    uint32_t lo = 0, hi = r->size, mid;
+
+    // 按顺序添加时总是落在最后一个容器
+    if (r->size > 0 && r->keys[r->size - 1] <= key)
+    {
+        *pos = r->keys[r->size - 1] == key ? r->size - 1 : r->size;
+        return r->keys[r->size - 1] == key;
+    }
+    while (lo < hi)
+    {
+        mid = (lo + hi) / 2;
+        if (r->keys[mid] < key)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    *pos = lo;
+    return lo < r->size && r->keys[lo] == key;
+}
+
+// 在 pos 位置插入键为 key 的容器 c
+static void _roaringInsertContainer(roaring *r, uint32_t pos, uint64_t key, roaringContainer *c)
+{
+    if (r->size == r->cap)
+    {
+        r->cap = r->cap ? r->cap * 2 : 4;
+        r->keys = xm_realloc(r->keys, sizeof(uint64_t) * r->cap);
+        r->containers = xm_realloc(r->containers, sizeof(roaringContainer) * r->cap);
+    }
+    memmove(r->keys + pos + 1, r->keys + pos, sizeof(uint64_t) * (r->size - pos));
+    memmove(r->containers + pos + 1, r->containers + pos, sizeof(roaringContainer) * (r->size - pos));
+    r->keys[pos] = key;
+    r->containers[pos] = *c;
+    r->size++;
+}
+
+static void _roaringRemoveContainer(roaring *r, uint32_t pos)
+{
+    _containerFree(&r->containers[pos]);
+    memmove(r->keys + pos, r->keys + pos + 1, sizeof(uint64_t) * (r->size - pos - 1));
+    memmove(r->containers + pos, r->containers + pos + 1, sizeof(roaringContainer) * (r->size - pos - 1));
+    r->size--;
+}
+
+int roaringAdd(roaring *r, int64_t value)
+{
+    uint64_t key = roaringKey(value);
+    uint32_t pos;
+
+    if (!_roaringFindKey(r, key, &pos))
+    {
+        roaringContainer c;
+        _containerInitArray(&c, 4);
+        _roaringInsertContainer(r, pos, key, &c);
+    }
+    if (!_containerAdd(&r->containers[pos], roaringLow(value)))
+        return 0;
+    r->card++;
+    return 1;
+}
+
+int roaringRemove(roaring *r, int64_t value)
+{
+    uint32_t pos;
+
+    if (!_roaringFindKey(r, roaringKey(value), &pos))
+        return 0;
+    if (!_containerRemove(&r->containers[pos], roaringLow(value)))
+        return 0;
+    if (r->containers[pos].card == 0)
+        _roaringRemoveContainer(r, pos);
+    r->card--;
+    return 1;
+}
+
+int roaringContains(roaring *r, int64_t value)
+{
+    uint32_t pos;
+
+    if (!_roaringFindKey(r, roaringKey(value), &pos))
+        return 0;
+    return _containerContains(&r->containers[pos], roaringLow(value));
+}
+
+uint64_t roaringCard(roaring *r)
+{
+    return r->card;
+}
+
+int roaringSelect(roaring *r, uint64_t rank, int64_t *value)
+{
+    uint32_t i;
+
+    if (rank >= r->card)
+        return 0;
+    for (i = 0; rank >= r->containers[i].card; i++)
+        rank -= r->containers[i].card;
+    *value = roaringValue(r->keys[i], _containerSelect(&r->containers[i], rank));
+    return 1;
+}
+
+void roaringSelectMany(roaring *r, const uint64_t *ranks, uint64_t n, int64_t *values)
+{
+    uint64_t k = 0, base = 0, local;
+    uint32_t ci = 0, pos, cum;
+    roaringContainer *c;
+
+    while (k < n)
+    {
+        // 找到 ranks[k] 所在的容器，base 为容器中第一个元素的排位
+        while (ranks[k] >= base + r->containers[ci].card)
+            base += r->containers[ci++].card;
+        c = &r->containers[ci];
+
+        // 落在同一个容器中的排位一起处理，位图和区间都只向前扫描一遍
+        pos = 0;
+        cum = 0;
+        for (; k < n && ranks[k] < base + c->card; k++)
+        {
+            local = ranks[k] - base;
+            if (c->type == ROARING_ARRAY)
+            {
+                values[k] = roaringValue(r->keys[ci], ((uint16_t *)c->data)[local]);
+            }
+            else if (c->type == ROARING_BITMAP)
+            {
+                uint64_t *bits = c->data, w;
+                uint32_t cnt;
+
+                // pos 为当前的字，cum 为它之前的所有字中的元素个数
+                while (cum + (cnt = __builtin_popcountll(bits[pos])) <= local)
+                {
+                    cum += cnt;
+                    pos++;
+                }
+                w = bits[pos];
+                for (cnt = local - cum; cnt > 0; cnt--)
+                    w &= w - 1;
+                values[k] = roaringValue(r->keys[ci], pos * 64 + __builtin_ctzll(w));
+            }
+            else
+            {
+                roaringRun *runs = c->data;
+
+                // pos 为当前的区间，cum 为它之前的所有区间中的元素个数
+                while (cum + runs[pos].len < local)
+                {
+                    cum += runs[pos].len + 1;
+                    pos++;
+                }
+                values[k] = roaringValue(r->keys[ci], runs[pos].start + (local - cum));
+            }
+        }
+    }
+}
+
+int64_t roaringRandom(roaring *r)
+{
+    int64_t value = 0;
+    uint64_t rank = xm_random_below(r->card);
+    roaringSelect(r, rank, &value);
+    return value;
+}
+
+size_t roaringBytes(roaring *r)
+{
+    size_t bytes = sizeof(roaring) + r->cap * (sizeof(uint64_t) + sizeof(roaringContainer));
+    uint32_t i;
+
+    for (i = 0; i < r->size; i++)
+    {
+        roaringContainer *c = &r->containers[i];
+        if (c->type == ROARING_ARRAY)
+            bytes += c->cap * sizeof(uint16_t);
+        else if (c->type == ROARING_BITMAP)
+            bytes += ROARING_BITMAP_WORDS * sizeof(uint64_t);
+        else
+            bytes += c->cap * sizeof(roaringRun);
+    }
+    return bytes;
+}
+
+roaring *roaringAnd(roaring *a, roaring *b)
+{
+    roaring *res = roaringNew();
+    uint32_t i = 0, j = 0;
+
+    // 按键归并，只有两边都有的桶才可能有交集
+    while (i < a->size && j < b->size)
+    {
+        if (a->keys[i] < b->keys[j])
+        {
+            i++;
+        }
+        else if (a->keys[i] > b->keys[j])
+        {
+            j++;
+        }
+        else
+        {
+            roaringContainer c;
+            if (_containerAnd(&c, &a->containers[i], &b->containers[j]) > 0)
+            {
+                _roaringInsertContainer(res, res->size, a->keys[i], &c);
+                res->card += c.card;
+            }
+            i++;
+            j++;
+        }
+    }
+    return res;
+}
+
+roaring *roaringOr(roaring *a, roaring *b)
+{
+    roaring *res = roaringNew();
+    uint32_t i = 0, j = 0;
+
+    while (i < a->size || j < b->size)
+    {
+        roaringContainer c;
+        uint64_t key;
+
+        if (j >= b->size || (i < a->size && a->keys[i] < b->keys[j]))
+        {
+            key = a->keys[i];
+            _containerCopyUnrun(&c, &a->containers[i++]);
+        }
+        else if (i >= a->size || b->keys[j] < a->keys[i])
+        {
+            key = b->keys[j];
+            _containerCopyUnrun(&c, &b->containers[j++]);
+        }
+        else
+        {
+            key = a->keys[i];
+            _containerOr(&c, &a->containers[i++], &b->containers[j++]);
+        }
+        _roaringInsertContainer(res, res->size, key, &c);
+        res->card += c.card;
+    }
+    return res;
+}
+
+void roaringRunOptimize(roaring *r)
+{
+    uint32_t i, nruns;
+
+    for (i = 0; i < r->size; i++)
+    {
+        roaringContainer *c = &r->containers[i];
+        uint8_t best = _containerBestType(c, &nruns);
+
+        if (best == c->type)
+            continue;
+        if (best == ROARING_RUN)
+        {
+            _containerUnrun(c);
+            _containerToRun(c, nruns);
+        }
+        else if (best == ROARING_ARRAY)
+        {
+            _containerToArray(c);
+        }
+        else
+        {
+            _containerToBitmap(c);
+        }
+    }
+}
+
+void roaringInitIterator(roaring *r, roaringIterator *it)
+{
+    it->r = r;
+    it->ci = 0;
+    it->pos = 0;
+    it->off = 0;
+}
+
+void roaringInitIteratorFrom(roaring *r, roaringIterator *it, int64_t value)
+{
+    uint16_t low = roaringLow(value);
+    roaringContainer *c;
+
+    roaringInitIterator(r, it);
+    // 没有对应的容器时，从第一个键更大的容器开始
+    if (!_roaringFindKey(r, roaringKey(value), &it->ci))
+        return;
+
+    c = &r->containers[it->ci];
+    if (c->type == ROARING_ARRAY)
+    {
+        it->pos = _arrayLowerBound(c->data, c->n, low);
+    }
+    else if (c->type == ROARING_BITMAP)
+    {
+        it->pos = low;
+    }
+    else
+    {
+        roaringRun *runs = c->data;
+        int32_t run = _runFind(runs, c->n, low);
+
+        // low 落在区间内时从区间中间开始，否则从下一个区间开始
+        if (run >= 0 && low <= runs[run].start + runs[run].len)
+        {
+            it->pos = run;
+            it->off = low - runs[run].start;
+        }
+        else
+        {
+            it->pos = run + 1;
+        }
+    }
+}
+
+int roaringNext(roaringIterator *it, int64_t *value)
+{
+    while (it->ci < it->r->size)
+    {
+        roaringContainer *c = &it->r->containers[it->ci];
+        uint64_t key = it->r->keys[it->ci];
+
+        if (c->type == ROARING_ARRAY)
+        {
+            if (it->pos < c->n)
+            {
+                *value = roaringValue(key, ((uint16_t *)c->data)[it->pos++]);
+                return 1;
+            }
+        }
+        else if (c->type == ROARING_BITMAP)
+        {
+            uint64_t *bits = c->data;
+            uint32_t word = it->pos >> 6;
+            if (word < ROARING_BITMAP_WORDS)
+            {
+                // 跳过当前字中已经迭代过的位
+                uint64_t w = bits[word] & (~(uint64_t)0 << (it->pos & 63));
+                while (w == 0 && ++word < ROARING_BITMAP_WORDS)
+                    w = bits[word];
+                if (w != 0)
+                {
+                    uint32_t low = word * 64 + __builtin_ctzll(w);
+                    it->pos = low + 1;
+                    *value = roaringValue(key, low);
+                    return 1;
+                }
+            }
+        }
+        else
+        {
+            roaringRun *runs = c->data;
+            if (it->pos < c->n)
+            {
+                *value = roaringValue(key, runs[it->pos].start + it->off);
+                if (it->off == runs[it->pos].len)
+                {
+                    it->pos++;
+                    it->off = 0;
+                }
+                else
+                {
+                    it->off++;
+                }
+                return 1;
+            }
+        }
+        // 当前容器已经迭代完
+        it->ci++;
+        it->pos = 0;
+        it->off = 0;
+    }
+    return 0;
+}
+
+/****************************序列化******************************/
+
+/*
+序列化格式，多字节整数都是小端法：
+  uint32 容器个数
+  每个容器：uint64 键，uint8 表示，uint32 元素个数，uint32 ARRAY 的元素个数或 RUN 的区间个数
+  之后是容器内容：ARRAY 为 n 个 uint16 ，BITMAP 为 1024 个 uint64 ，RUN 为 n 对 uint16 (start, len)
+*/
+
+#define ROARING_CONTAINER_HEADER (8 + 1 + 4 + 4)
+
+static unsigned char *_writeLE(unsigned char *p, uint64_t v, int bytes)
+{
+    int i;
+    for (i = 0; i < bytes; i++)
+        *p++ = (v >> (8 * i)) & 0xff;
+    return p;
+}
+
+static uint64_t _readLE(const unsigned char *p, int bytes)
+{
+    uint64_t v = 0;
+    int i;
+    for (i = 0; i < bytes; i++)
+        v |= (uint64_t)p[i] << (8 * i);
+    return v;
+}
+
+static size_t _containerPayloadSize(roaringContainer *c)
+{
+    if (c->type == ROARING_ARRAY)
+        return c->n * sizeof(uint16_t);
+    else if (c->type == ROARING_BITMAP)
+        return ROARING_BITMAP_WORDS * sizeof(uint64_t);
+    else
+        return c->n * 2 * sizeof(uint16_t);
+}
+
+size_t roaringSerializedSize(roaring *r)
+{
+    size_t bytes = 4 + (size_t)r->size * ROARING_CONTAINER_HEADER;
+    uint32_t i;
+
+    for (i = 0; i < r->size; i++)
+        bytes += _containerPayloadSize(&r->containers[i]);
+    return bytes;
+}
+
+size_t roaringSerialize(roaring *r, unsigned char *buf)
+{
+    unsigned char *p = buf;
+    uint32_t i, j;
+
+    p = _writeLE(p, r->size, 4);
+    for (i = 0; i < r->size; i++)
+    {
+        roaringContainer *c = &r->containers[i];
+        p = _writeLE(p, r->keys[i], 8);
+        p = _writeLE(p, c->type, 1);
+        p = _writeLE(p, c->card, 4);
+        p = _writeLE(p, c->n, 4);
+        if (c->type == ROARING_ARRAY)
+        {
+            for (j = 0; j < c->n; j++)
+                p = _writeLE(p, ((uint16_t *)c->data)[j], 2);
+        }
+        else if (c->type == ROARING_BITMAP)
+        {
+            for (j = 0; j < ROARING_BITMAP_WORDS; j++)
+                p = _writeLE(p, ((uint64_t *)c->data)[j], 8);
+        }
+        else
+        {
+            for (j = 0; j < c->n; j++)
+            {
+                p = _writeLE(p, ((roaringRun *)c->data)[j].start, 2);
+                p = _writeLE(p, ((roaringRun *)c->data)[j].len, 2);
+            }
+        }
+    }
+    return p - buf;
+}
+
+// 读出一个容器的内容并检查是否合法：元素严格递增、区间不重叠、元素个数和内容一致
+static int _containerDeserialize(roaringContainer *c, const unsigned char *p)
+{
+    uint32_t i, card = 0;
+
+    if (c->type == ROARING_ARRAY)
+    {
+        uint16_t *a;
+        if (c->n != c->card || c->n == 0 || c->n > ROARING_ARRAY_MAX)
+            return 0;
+        a = c->data = xm_malloc(sizeof(uint16_t) * c->n);
+        c->cap = c->n;
+        for (i = 0; i < c->n; i++)
+        {
+            a[i] = _readLE(p + 2 * i, 2);
+            if (i > 0 && a[i] <= a[i - 1])
+                return 0;
+        }
+    }
+    else if (c->type == ROARING_BITMAP)
+    {
+        uint64_t *bits;
+        if (c->n != 0)
+            return 0;
+        bits = c->data = xm_malloc(sizeof(uint64_t) * ROARING_BITMAP_WORDS);
+        c->cap = 0;
+        for (i = 0; i < ROARING_BITMAP_WORDS; i++)
+        {
+            bits[i] = _readLE(p + 8 * i, 8);
+            card += __builtin_popcountll(bits[i]);
+        }
+        if (card != c->card || card == 0)
+            return 0;
+    }
+    else
+    {
+        roaringRun *runs;
+        uint32_t end = 0;
+        if (c->n == 0 || c->n > 32768)
+            return 0;
+        runs = c->data = xm_malloc(sizeof(roaringRun) * c->n);
+        c->cap = c->n;
+        for (i = 0; i < c->n; i++)
+        {
+            runs[i].start = _readLE(p + 4 * i, 2);
+            runs[i].len = _readLE(p + 4 * i + 2, 2);
+            if ((i > 0 && runs[i].start <= end) || (uint32_t)runs[i].start + runs[i].len > 0xffff)
+                return 0;
+            end = runs[i].start + runs[i].len;
+            card += runs[i].len + 1;
+        }
+        if (card != c->card)
+            return 0;
+    }
+    return 1;
+}
+
+roaring *roaringDeserialize(const unsigned char *buf, size_t len)
+{
+    const unsigned char *p = buf, *end = buf + len;
+    roaring *r;
+    uint32_t size, i;
+
+    if (len < 4)
+        return NULL;
+    size = _readLE(p, 4);
+    p += 4;
+    // 每个容器至少占一个头部，先检查容器个数是否可信，再分配空间
+    if (size > (len - 4) / ROARING_CONTAINER_HEADER)
+        return NULL;
+
+    r = roaringNew();
+    if (size > 0)
+    {
+        r->cap = size;
+        r->keys = xm_malloc(sizeof(uint64_t) * size);
+        r->containers = xm_malloc(sizeof(roaringContainer) * size);
+    }
+    for (i = 0; i < size; i++)
+    {
+        roaringContainer *c = &r->containers[i];
+        size_t payload;
+
+        if ((size_t)(end - p) < ROARING_CONTAINER_HEADER)
+            goto err;
+        r->keys[i] = _readLE(p, 8);
+        c->type = p[8];
+        c->card = _readLE(p + 9, 4);
+        c->n = _readLE(p + 13, 4);
+        c->data = NULL;
+        p += ROARING_CONTAINER_HEADER;
+
+        if ((i > 0 && r->keys[i] <= r->keys[i - 1]) || r->keys[i] > (~(uint64_t)0 >> 16))
+            goto err;
+        if (c->type != ROARING_ARRAY && c->type != ROARING_BITMAP && c->type != ROARING_RUN)
+            goto err;
+        if (c->card == 0 || c->card > 65536 || c->n > 65536)
+            goto err;
+        payload = _containerPayloadSize(c);
+        if ((size_t)(end - p) < payload)
+            goto err;
+
+        // 先把容器计入集合，出错时统一释放
+        r->size = i + 1;
+        if (!_containerDeserialize(c, p))
+            goto err;
+        p += payload;
+        r->card += c->card;
+    }
+    if (p != end)
+        goto err;
+    return r;
+
+err:
+    roaringFree(r);
+    return NULL;
+}
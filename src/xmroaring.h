@@ -0,0 +1,120 @@
+#ifndef HXM_ROARING_H
+#define HXM_ROARING_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+压缩位图（Roaring bitmap），用来保存元素很多的整数集合
+
+64 位整数按高 48 位分桶，每个桶是一个容器，容器里只保存低 16 位，
+每个容器根据桶内元素的分布选择三种表示中的一种：
+  ARRAY  ：有序的 uint16_t 数组，元素个数不超过 ROARING_ARRAY_MAX ，每个元素 2 字节
+  BITMAP ：65536 位的位图，固定 8KB ，元素多的时候比数组省空间
+  RUN    ：若干个 [start, start + len] 的连续区间，连续整数很多时最省空间
+添加和删除时容器只在 ARRAY 和 BITMAP 之间转换，RUN 容器由 roaringRunOptimize 生成，
+被修改时先展开成另外两种表示
+*/
+
+// 容器的三种表示
+#define ROARING_ARRAY 1
+#define ROARING_BITMAP 2
+#define ROARING_RUN 3
+
+// ARRAY 容器最多保存的元素个数，超过之后改用 BITMAP ，此时两者的大小都是 8KB
+#define ROARING_ARRAY_MAX 4096
+// BITMAP 容器的 64 位字的个数
+#define ROARING_BITMAP_WORDS 1024
+
+// RUN 容器中的一个区间，包含 start 到 start + len 的所有整数
+typedef struct roaringRun
+{
+    uint16_t start;
+    uint16_t len;
+} roaringRun;
+
+typedef struct roaringContainer
+{
+    // 容器的表示，ROARING_ARRAY/ROARING_BITMAP/ROARING_RUN
+    uint8_t type;
+    // 容器中的元素个数，最多 65536
+    uint32_t card;
+    // ARRAY 容器中为元素个数，RUN 容器中为区间个数，BITMAP 容器不使用
+    uint32_t n;
+    // ARRAY 和 RUN 容器已经分配的空间能放下的元素（区间）个数
+    uint32_t cap;
+    // uint16_t 数组、uint64_t 位图或者 roaringRun 数组
+    void *data;
+} roaringContainer;
+
+typedef struct roaring
+{
+    // 容器个数
+    uint32_t size;
+    // keys 和 containers 已经分配的长度
+    uint32_t cap;
+    // 每个容器对应的高 48 位（符号位取反，按无符号数比较就是按原来的有符号数比较），严格递增
+    uint64_t *keys;
+    // 和 keys 一一对应的容器
+    roaringContainer *containers;
+    // 集合的元素总数
+    uint64_t card;
+} roaring;
+
+// 按从小到大的顺序遍历集合
+typedef struct roaringIterator
+{
+    roaring *r;
+    // 当前容器的下标
+    uint32_t ci;
+    // 容器内的位置：ARRAY 中为数组下标，BITMAP 中为下一个要检查的位，RUN 中为区间下标
+    uint32_t pos;
+    // RUN 容器中在当前区间内的偏移
+    uint32_t off;
+} roaringIterator;
+
+// 创建一个空集合
+roaring *roaringNew(void);
+// 释放集合
+void roaringFree(roaring *r);
+// 添加元素，添加成功返回 1 ，元素已经存在返回 0
+int roaringAdd(roaring *r, int64_t value);
+// 删除元素，删除成功返回 1 ，元素不存在返回 0
+int roaringRemove(roaring *r, int64_t value);
+// 检查元素是否在集合中
+int roaringContains(roaring *r, int64_t value);
+// 返回集合的元素个数
+uint64_t roaringCard(roaring *r);
+// 取出从小到大排第 rank 位（从 0 开始）的元素，rank 超出范围时返回 0
+int roaringSelect(roaring *r, uint64_t rank, int64_t *value);
+// 批量取出排位为 ranks[0..n) 的元素保存到 values 中，ranks 必须递增并且都在范围内，
+// 每个容器只扫描一遍
+void roaringSelectMany(roaring *r, const uint64_t *ranks, uint64_t n, int64_t *values);
+// 从非空集合中随机返回一个元素
+int64_t roaringRandom(roaring *r);
+// 返回集合占用的内存字节数
+size_t roaringBytes(roaring *r);
+
+// 求两个集合的交集，返回新集合
+roaring *roaringAnd(roaring *a, roaring *b);
+// 求两个集合的并集，返回新集合
+roaring *roaringOr(roaring *a, roaring *b);
+// 把适合的容器转换为 RUN 表示，每个容器都选三种表示中最小的一种
+void roaringRunOptimize(roaring *r);
+
+// 初始化迭代器，迭代期间不能修改集合
+void roaringInitIterator(roaring *r, roaringIterator *it);
+// 初始化迭代器，从第一个不小于 value 的元素开始迭代
+void roaringInitIteratorFrom(roaring *r, roaringIterator *it, int64_t value);
+// 取出下一个元素保存到 *value ，迭代完毕时返回 0
+int roaringNext(roaringIterator *it, int64_t *value);
+
+// 返回序列化之后的字节数
+size_t roaringSerializedSize(roaring *r);
+// 序列化到 buf 中，buf 至少要有 roaringSerializedSize 字节，返回写入的字节数
+// 格式与主机字节序无关，多字节整数都按小端法保存
+size_t roaringSerialize(roaring *r, unsigned char *buf);
+// 从 buf 中反序列化，数据不完整或者不合法时返回 NULL
+roaring *roaringDeserialize(const unsigned char *buf, size_t len);
+
+#endif
@@ -7,6 +7,9 @@
 #include <stdarg.h>
 #include <ctype.h>
 #include <limits.h>
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
 
 sds sdsnewlen(const void *init, size_t initlen)
 {
@@ -881,3 +884,196 @@ int string2l(const char *s, size_t slen, long *lval)
     *lval = (long)llval;
     return 1;
 }
+
+int d2string(char *buf, size_t len, double value)
+{
+    if (isnan(value))
+    {
+        len = snprintf(buf, len, "nan");
+    }
+    else if (isinf(value))
+    {
+        if (value < 0)
+            len = snprintf(buf, len, "-inf");
+        else
+            len = snprintf(buf, len, "inf");
+    }
+    else if (value == 0)
+    {
+        // 区分 +0 和 -0
+        if (1.0 / value < 0)
+            len = snprintf(buf, len, "-0");
+        else
+            len = snprintf(buf, len, "0");
+    }
+    else
+    {
+#if (DBL_MANT_DIG >= 52) && (LLONG_MAX == 0x7fffffffffffffffLL)
+        // 在 (-2^52, 2^52) 之内并且没有小数部分的值可以安全地转换成 long long ，
+        // 按整数输出比 %.17g 快，也更短
+        double min = -4503599627370495; // -(2^52-1)
+        double max = 4503599627370496;  // 2^52
+        if (value > min && value < max && value == ((double)((long long)value)))
+            len = ll2string(buf, len, (long long)value);
+        else
+#endif
+            len = snprintf(buf, len, "%.17g", value);
+    }
+    return len;
+}
+
+int stringmatchlen(const char *pattern, int patternLen, const char *string, int stringLen, int nocase)
+{
+    while (patternLen)
+    {
+        switch (pattern[0])
+        {
+        case '*':
+            // 连续的 * 和一个 * 相同
+            while (pattern[1] == '*')
+            {
+                pattern++;
+                patternLen--;
+            }
+            if (patternLen == 1)
+                return 1; // 最后一个字符是 * ，剩下的都匹配
+            // 依次尝试让 * 匹配 0 个、1 个……字符
+            while (stringLen)
+            {
+                if (stringmatchlen(pattern + 1, patternLen - 1, string, stringLen, nocase))
+                    return 1;
+                string++;
+                stringLen--;
+            }
+            return 0;
+        case '?':
+            if (stringLen == 0)
+                return 0;
+            string++;
+            stringLen--;
+            break;
+        case '[':
+        {
+            int not, match;
+
+            pattern++;
+            patternLen--;
+            not = pattern[0] == '^';
+            if (not)
+            {
+                pattern++;
+                patternLen--;
+            }
+            match = 0;
+            while (1)
+            {
+                if (pattern[0] == '\\' && patternLen >= 2)
+                {
+                    pattern++;
+                    patternLen--;
+                    if (pattern[0] == string[0])
+                        match = 1;
+                }
+                else if (pattern[0] == ']')
+                {
+                    break;
+                }
+                else if (patternLen == 0)
+                {
+                    // 没有闭合的 [ ，退回到最后一个字符
+                    pattern--;
+                    patternLen++;
+                    break;
+                }
+                else if (patternLen >= 3 && pattern[1] == '-')
+                {
+                    // 字符范围 a-z ，两端可以颠倒
+                    int start = pattern[0];
+                    int end = pattern[2];
+                    int c = string[0];
+                    if (start > end)
+                    {
+                        int t = start;
+                        start = end;
+                        end = t;
+                    }
+                    if (nocase)
+                    {
+                        start = tolower(start);
+                        end = tolower(end);
+                        c = tolower(c);
+                    }
+                    pattern += 2;
+                    patternLen -= 2;
+                    if (c >= start && c <= end)
+                        match = 1;
+                }
+                else
+                {
+                    if (!nocase)
+                    {
+                        if (pattern[0] == string[0])
+                            match = 1;
+                    }
+                    else
+                    {
+                        if (tolower((int)pattern[0]) == tolower((int)string[0]))
+                            match = 1;
+                    }
+                }
+                pattern++;
+                patternLen--;
+            }
+            if (not)
+                match = !match;
+            if (!match)
+                return 0;
+            string++;
+            stringLen--;
+            break;
+        }
+        case '\\':
+            // 转义字符，按普通字符比较下一个字符
+            if (patternLen >= 2)
+            {
+                pattern++;
+                patternLen--;
+            }
+            // 继续执行 default 分支
+        default:
+            if (!nocase)
+            {
+                if (pattern[0] != string[0])
+                    return 0;
+            }
+            else
+            {
+                if (tolower((int)pattern[0]) != tolower((int)string[0]))
+                    return 0;
+            }
+            string++;
+            stringLen--;
+            break;
+        }
+        pattern++;
+        patternLen--;
+        if (stringLen == 0)
+        {
+            // 字符串已经用完，模式剩下的只能都是 *
+            while (*pattern == '*')
+            {
+                pattern++;
+                patternLen--;
+            }
+            break;
+        }
+    }
+    if (patternLen == 0 && stringLen == 0)
+        return 1;
+    return 0;
+}
+
+int stringmatch(const char *pattern, const char *string, int nocase)
+{
+    return stringmatchlen(pattern, strlen(pattern), string, strlen(string), nocase);
+}
@@ -121,8 +121,9 @@ static inline size_t sdsavail(const sds s)
 }
 
 //定义和声明在util.c中
-//int stringmatchlen(const char *p, int plen, const char *s, int slen, int nocase);
-//int stringmatch(const char *p, const char *s, int nocase);
+// glob 风格的模式匹配，支持 * ? [] 和 \ 转义，匹配返回1，不匹配返回0，nocase为1时忽略大小写
+int stringmatchlen(const char *p, int plen, const char *s, int slen, int nocase);
+int stringmatch(const char *p, const char *s, int nocase);
 
 // 把以k m G等为单位的表示空间大小的值转化成整数，*err为1表示解析失败，为0表示成功
 long long memtoll(const char *p, int *err);
@@ -132,7 +133,8 @@ int ll2string(char *s, size_t len, long long value);
 int string2ll(const char *s, size_t slen, long long *value);
 int string2l(const char *s, size_t slen, long *value);
 
-//int d2string(char *buf, size_t len, double value);
+// 把 double 转换成可以被 strtod 解析的字符串，返回字符串的长度。整数值按整数格式输出
+int d2string(char *buf, size_t len, double value);
 //sds getAbsolutePath(char *filename);
 //int pathIsBaseName(char *path);
 
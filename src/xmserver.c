@@ -1,3 +1,15 @@
 #include "xmserver.h"
+#include "xmt_list.h"
+#include "xmt_set.h"
+#include "xmt_zset.h"
+#include "xmt_hash.h"
 
-struct redisServer server;
\ No newline at end of file
+struct redisServer server;
+
+void registerObjectTypes(void)
+{
+    objectRegisterFreeProc(REDIS_LIST, freeListObject);
+    objectRegisterFreeProc(REDIS_SET, freeSetObject);
+    objectRegisterFreeProc(REDIS_ZSET, freeZsetObject);
+    objectRegisterFreeProc(REDIS_HASH, freeHashObject);
+}
@@ -14,12 +14,30 @@
 // 同样的整数集合作为集合对象的底层编码时也存在数量的限制
 #define REDIS_SET_MAX_INTSET_ENTRIES 512
 
+// 自适应编码转换：根据每个键最近的读写次数调整上面的边界条件，见 xmadaptive.h
+// 读写次数每经过 REDIS_ENCODING_DECAY_SECONDS 秒减半
+#define REDIS_ENCODING_DECAY_SECONDS 10
+// 读次数达到 HOT 时成为读热键，降到 COLD 以下才不再是读热键，两个值之间的差距避免编码来回转换
+#define REDIS_ENCODING_HOT_READS 64
+#define REDIS_ENCODING_COLD_READS 8
+// 写入比读取代价高得多，写热键的阈值更低
+#define REDIS_ENCODING_HOT_WRITES 16
+#define REDIS_ENCODING_COLD_WRITES 2
+// 写热键的边界条件除以 WRITE_HOT ，只有读热的键除以 READ_HOT ，冷键乘以 COLD
+#define REDIS_ENCODING_WRITE_HOT_FACTOR 4
+#define REDIS_ENCODING_READ_HOT_FACTOR 2
+#define REDIS_ENCODING_COLD_FACTOR 4
+
+// 分批回复大对象时，每个客户端在一次事件循环中最多占用的时间，单位为微秒
+#define REDIS_STREAM_TIME_BUDGET 1000
+
 #include <sys/types.h>
 
 #include "stdlib.h"
 
 #include "xmdict.h"
 #include "xmadlist.h"
+#include "xmredis.h"
 
 #include "xmdb.h"
 
@@ -36,7 +54,22 @@ struct redisServer
     size_t list_max_ziplist_value;
     size_t zset_max_ziplist_entries;
     size_t zset_max_ziplist_value;
+    // 为真时有序集合超过压缩列表的边界条件后转换为 B+ 树编码，而不是跳跃表编码
+    int zset_btree_index;
+    // 为真时分值都是整数、并且按分值顺序追加的有序集合超过压缩列表的边界条件后转换为 TSERIES 编码
+    int zset_tseries_index;
+    // 为真时分值都相同的有序集合超过压缩列表的边界条件后转换为 LEXSET 编码
+    int zset_lexset_index;
     size_t set_max_intset_entries;
+    // 为真时根据每个键的访问频率调整编码的边界条件：冷键保持紧凑编码，热键提前转换
+    int encoding_adaptive;
+
+    // 自适应模式下提前转换为非紧凑编码的次数
+    long long stat_encoding_promotions;
+    // 自适应模式下冷键转换回紧凑编码的次数
+    long long stat_encoding_demotions;
+    // 当前读热或写热的键数量
+    long long stat_encoding_hot_keys;
 
     // 成功查找键的次数
     long long stat_keyspace_hits;
@@ -52,6 +85,23 @@ struct redisServer
     // 数据库
     redisDb *db;
 
+    /*******************阻塞操作**********************************/
+    // 正在被 BLPOP 等命令阻塞的客户端数量
+    unsigned int bpop_blocked_clients;
+    // 链表，保存 readyList 结构，记录了所有可以解除阻塞的键
+    // 在每次事件循环结束时统一处理
+    ilist ready_keys;
+    // 以超时时间为序的小根堆，保存了所有设置了超时时间的阻塞客户端
+    struct redisClient **bpop_timeouts;
+    // 堆中的客户端数量，以及堆数组的容量
+    unsigned long bpop_timeouts_used, bpop_timeouts_size;
+
+    /*******************分批回复**********************************/
+    // 正在分批接收回复的客户端，由 streamingState.node 链接，每次事件循环各处理一个时间片
+    ilist streaming_clients;
+    // 每个时间片的长度，单位为微秒，为 0 时使用 REDIS_STREAM_TIME_BUDGET
+    long long stream_time_budget;
+
     /******RDB或AOF持久化相关的标志*************************************************/
 
     // 负责执行 BGSAVE 的子进程的 ID， 没在执行 BGSAVE 时，设为 -1
@@ -69,8 +119,8 @@ struct redisServer
     // 链表中保存了所有订阅某个频道的客户端
     // 新客户端总是被添加到链表的表尾
     dict *pubsub_channels; 
-    // 这个链表记录了客户端订阅的所有模式的名字
-    list *pubsub_patterns;  
+    // 这个链表记录了客户端订阅的所有模式，由 pubsubPattern.server_node 链接
+    ilist pubsub_patterns;  
     // 可以被发布的通知的类型
     int notify_keyspace_events; 
 
@@ -92,4 +142,7 @@ struct redisServer
     int masterport;
 };
 
+// 向 xmobject.c 注册各类型对象的释放函数，在服务器初始化时、创建任何容器对象之前调用
+void registerObjectTypes(void);
+
 #endif
\ No newline at end of file
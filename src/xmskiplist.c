@@ -1,12 +1,15 @@
 #include "xmskiplist.h"
 #include "xmsds.h"
 #include "xmmalloc.h"
+#include "xmrand.h"
 
 #include "xmserver.h"
 
 #include "xmt_string.h"
 
 #include <assert.h>
+#include <string.h>
+#include <math.h>
 
 
 // 对比a，b对象表示的取值的大小
@@ -62,7 +65,7 @@ int zslParseLexRangeItem(robj *item, robj **dest, int *ex)
 }
 
 // 解析lex范围结构，成功返回REDIS_OK,且之后必须释放lex范围结构
-static int zslParseLexRange(robj *min, robj *max, zlexrangespec *spec)
+int zslParseLexRange(robj *min, robj *max, zlexrangespec *spec)
 {
     // 如果是整数编码，肯定解析失败
     if (min->encoding == REDIS_ENCODING_INT ||
@@ -97,7 +100,7 @@ void zslFreeLexRange(zlexrangespec *spec)
 
 // 对 min 和 max 进行分析，并将区间的值保存在 spec 中。
 // 分析成功返回 REDIS_OK ，分析出错导致失败返回 REDIS_ERR
-static int zslParseRange(robj *min, robj *max, zrangespec *spec)
+int zslParseRange(robj *min, robj *max, zrangespec *spec)
 {
     char *eptr;
 
@@ -166,7 +169,7 @@ static int zslParseRange(robj *min, robj *max, zrangespec *spec)
 // 创建一个层数为level的跳跃表节点，并将节点的成员对象设置为obj，分值设置为 score，随后返回
 static zskiplistNode *zslCreateNode(int level, double score, robj *obj);
 //释放给定的跳跃表节点
-static void zslFreeNode(zskiplistNode *node);
+void zslFreeNode(zskiplistNode *node);
 // 返回一个随机值，用作新跳跃表节点的层数。
 static int zslRandomLevel(void);
 static void zslDeleteNode(zskiplist *zsl, zskiplistNode *x, zskiplistNode **update);
@@ -174,11 +177,37 @@ static void zslDeleteNode(zskiplist *zsl, zskiplistNode *x, zskiplistNode **upda
 
 static zskiplistNode *zslCreateNode(int level, double score, robj *obj)
 {
-    //还要分配Level[]的空间
+    zskiplistNode *zn;
+    struct sdshdr *sh;
+    size_t len = 0;
+
+    // 整数编码的成员先转换为字符串，节点中只保存字符串
+    if (obj)
+    {
+        obj = getDecodedObject(obj);
+        len = sdslen(obj->ptr);
+    }
+
+    //还要分配Level[]的空间，成员的 sds 放在 level[] 之后
     //因为Level是zskiplistNode的最后一个成员，所以其空间在free时只用free node就能释放
-    zskiplistNode *zn = xm_malloc(sizeof(*zn) + level * sizeof(struct zskiplistLevel));
+    zn = xm_malloc(sizeof(*zn) + level * sizeof(struct zskiplistLevel) + sizeof(struct sdshdr) + len + 1);
     zn->score = score;
-    zn->obj = obj;
+    sh = (void *)(zn->level + level);
+    sh->len = len;
+    sh->free = 0;
+    if (obj)
+    {
+        memcpy(sh->buf, obj->ptr, len);
+        decrRefCount(obj);
+    }
+    sh->buf[len] = '\0';
+
+    // 和 createEmbeddedStringObject 的布局相同，只是 sds 不紧跟在 robj 之后
+    zn->obj.type = REDIS_STRING;
+    zn->obj.encoding = REDIS_ENCODING_EMBSTR;
+    zn->obj.ptr = sh->buf;
+    zn->obj.refcount = 1;
+    zn->obj.lru = 0;
     return zn;
 }
 
@@ -205,8 +234,7 @@ zskiplist *zslCreate(void)
 
 void zslFreeNode(zskiplistNode *node)
 {
-    decrRefCount(node->obj);
-    //level这个数组的空间不是额外分配的，不需要另外释放
+    //level这个数组和成员对象的空间都不是额外分配的，不需要另外释放
     xm_free(node);
 }
 
@@ -223,6 +251,7 @@ void zslFree(zskiplist *zsl)
         zslFreeNode(node);
         node = next;
     }
+    xm_free(zsl->header);
     xm_free(zsl);
 }
 
@@ -230,12 +259,11 @@ void zslFree(zskiplist *zsl)
 // 根据随机算法所使用的幂次定律，越大的值生成的几率越小
 static int zslRandomLevel(void)
 {
-    int level = 1;
-    //每次能成功的概率是ZSKIPLIST_P，也就是0.25
-    while ((random() & 0xFFFF) < (ZSKIPLIST_P * 0xFFFF))
-        level += 1;
-    //最终的level n的概率为ZSKIPLIST_P^(n-1)，也就是0.25^(n-1)
-    return (level < ZSKIPLIST_MAXLEVEL) ? level : ZSKIPLIST_MAXLEVEL;
+    // 每升一层需要再有两个最低位为 0 ，概率正好是 ZSKIPLIST_P ，也就是 0.25
+    // 最终的 level n 的概率为 0.25^(n-1) ，只需要取一次随机数
+    // 第 2 * (ZSKIPLIST_MAXLEVEL - 1) 位置 1 ，末尾的 0 最多有这么多个，层数不会超过 ZSKIPLIST_MAXLEVEL
+    uint64_t r = xm_random() | (1ULL << (2 * (ZSKIPLIST_MAXLEVEL - 1)));
+    return 1 + (__builtin_ctzll(r) >> 1);
 }
 
 zskiplistNode *zslInsert(zskiplist *zsl, double score, robj *obj)
@@ -260,7 +288,7 @@ zskiplistNode *zslInsert(zskiplist *zsl, double score, robj *obj)
                //分值更小
                (x->level[i].forward->score < score ||
                 //或者分值相同，但成员对象较小
-                (x->level[i].forward->score == score && compareStringObjects(x->level[i].forward->obj, obj) < 0)))
+                (x->level[i].forward->score == score && compareStringObjects(&x->level[i].forward->obj, obj) < 0)))
         {
             //更新rank[i]
             rank[i] += x->level[i].span;
@@ -330,6 +358,69 @@ zskiplistNode *zslInsert(zskiplist *zsl, double score, robj *obj)
     return x;
 }
 
+void zslBulkLoadInit(zslBulkLoader *bl, zskiplist *zsl)
+{
+    zskiplistNode *x = zsl->header;
+    unsigned long rank = 0;
+    int i;
+
+    bl->zsl = zsl;
+    // 沿着每一层走到最后一个节点，空表时都停留在表头
+    for (i = ZSKIPLIST_MAXLEVEL - 1; i >= 0; i--)
+    {
+        if (i < zsl->level)
+        {
+            while (x->level[i].forward)
+            {
+                rank += x->level[i].span;
+                x = x->level[i].forward;
+            }
+        }
+        bl->last[i] = x;
+        bl->rank[i] = rank;
+    }
+}
+
+zskiplistNode *zslBulkLoadAppend(zslBulkLoader *bl, double score, robj *obj)
+{
+    zskiplist *zsl = bl->zsl;
+    zskiplistNode *x;
+    unsigned long rank = zsl->length + 1;
+    int i, level;
+
+    level = zslRandomLevel();
+    // 新的层从表头开始，Init 时已经把它们记录为表头
+    if (level > zsl->level)
+        zsl->level = level;
+
+    x = zslCreateNode(level, score, obj);
+    // 新节点是每一层的最后一个节点，只需要连接到各层原来的最后一个节点之后
+    for (i = 0; i < level; i++)
+    {
+        bl->last[i]->level[i].forward = x;
+        bl->last[i]->level[i].span = rank - bl->rank[i];
+        x->level[i].forward = NULL;
+        x->level[i].span = 0;
+        bl->last[i] = x;
+        bl->rank[i] = rank;
+    }
+    // 比新节点高的层的跨度要到 Finish 时才补全，这样每次追加只修改新节点所在的层
+    x->backward = zsl->tail;
+    zsl->tail = x;
+    zsl->length++;
+    return x;
+}
+
+void zslBulkLoadFinish(zslBulkLoader *bl)
+{
+    zskiplist *zsl = bl->zsl;
+    int i;
+
+    // 各层最后一个节点的 forward 为 NULL ，跨度为它到表尾的距离，和 zslInsert 的做法一致
+    for (i = 0; i < zsl->level; i++)
+        bl->last[i]->level[i].span = zsl->length - bl->rank[i];
+}
+
 //内部删除函数,update中记录每一层中最接近被删除节点的前一个节点
 //不释放空间，释放空间的操作交给zslFreeNode
 static void zslDeleteNode(zskiplist *zsl, zskiplistNode *x, zskiplistNode **update)
@@ -381,7 +472,7 @@ int zslDelete(zskiplist *zsl, double score, robj *obj)
                //分值更小
                (x->level[i].forward->score < score ||
                 //或者分值相同，但成员对象较小，不同于zslGetRank用<=。是因为这里就是要记录前一个节点
-                (x->level[i].forward->score == score && compareStringObjects(x->level[i].forward->obj, obj) < 0)))
+                (x->level[i].forward->score == score && compareStringObjects(&x->level[i].forward->obj, obj) < 0)))
             // 沿着前进指针移动
             x = x->level[i].forward;
         // 记录沿途节点
@@ -390,7 +481,7 @@ int zslDelete(zskiplist *zsl, double score, robj *obj)
     //这个x是我们要找的节点
     x = x->level[0].forward;
     //只有在分值和对象都相同时才会删除
-    if (x && score == x->score && equalStringObjects(x->obj, obj))
+    if (x && score == x->score && equalStringObjects(&x->obj, obj))
     {
         zslDeleteNode(zsl, x, update);
         zslFreeNode(x);
@@ -455,17 +546,17 @@ int zslIsInLexRange(zskiplist *zsl, zlexrangespec *range)
 {
     zskiplistNode *x;
     // 先排除总为空的范围值
-    if (compareStringObjectsForLexRange(range->min, range->max) > 1 ||
+    if (compareStringObjectsForLexRange(range->min, range->max) > 0 ||
         (compareStringObjects(range->min, range->max) == 0 &&
          (range->minex || range->maxex)))
         return 0;
 
     x = zsl->tail;
 
-    if (x == NULL || !zslLexValueGteMin(x->obj, range))
+    if (x == NULL || !zslLexValueGteMin(&x->obj, range))
         return 0;
     x = zsl->header->level[0].forward;
-    if (x == NULL || !zslLexValueLteMax(x->obj, range))
+    if (x == NULL || !zslLexValueLteMax(&x->obj, range))
         return 0;
     return 1;
 }
@@ -509,13 +600,13 @@ zskiplistNode *zslFirstInLexRange(zskiplist *zsl, zlexrangespec *range)
     {
         // 当x的后一个对象大于范围中的最小值时，停止前进
         while (x->level[i].forward &&
-               !zslLexValueGteMin(x->level[i].forward->obj, range))
+               !zslLexValueGteMin(&x->level[i].forward->obj, range))
             x = x->level[i].forward;
     }
 
     x = x->level[0].forward;
 
-    if (!zslLexValueLteMax(x->obj, range))
+    if (!zslLexValueLteMax(&x->obj, range))
         return NULL;
     return x;
 }
@@ -552,17 +643,114 @@ zskiplistNode *zslLastInLexRange(zskiplist *zsl, zlexrangespec *range)
     {
 
         while (x->level[i].forward &&
-               zslLexValueLteMax(x->level[i].forward->obj, range))
+               zslLexValueLteMax(&x->level[i].forward->obj, range))
             x = x->level[i].forward;
     }
 
-    redisAssert(x != NULL);
+    assert(x != NULL);
 
-    if (!zslLexValueGteMin(x->obj, range))
+    if (!zslLexValueGteMin(&x->obj, range))
         return NULL;
     return x;
 }
 
+unsigned long zslRankOfFirstInRange(zskiplist *zsl, zrangespec *range)
+{
+    zskiplistNode *x;
+    unsigned long rank = 0;
+    int i;
+
+    if (!zslIsInRange(zsl, range))
+        return 0;
+    // 和 zslFirstInRange 的查找路径相同，沿途累加跨度
+    x = zsl->header;
+    for (i = zsl->level - 1; i >= 0; i--)
+    {
+        while (x->level[i].forward &&
+               !zslValueGteMin(x->level[i].forward->score, range))
+        {
+            rank += x->level[i].span;
+            x = x->level[i].forward;
+        }
+    }
+    // zslIsInRange 保证了后面一定还有节点
+    x = x->level[0].forward;
+    if (!zslValueLteMax(x->score, range))
+        return 0;
+    return rank + 1;
+}
+
+unsigned long zslRankOfLastInRange(zskiplist *zsl, zrangespec *range)
+{
+    zskiplistNode *x;
+    unsigned long rank = 0;
+    int i;
+
+    if (!zslIsInRange(zsl, range))
+        return 0;
+    x = zsl->header;
+    for (i = zsl->level - 1; i >= 0; i--)
+    {
+        while (x->level[i].forward &&
+               zslValueLteMax(x->level[i].forward->score, range))
+        {
+            rank += x->level[i].span;
+            x = x->level[i].forward;
+        }
+    }
+    // zslIsInRange 保证了第一个节点不大于最大值，所以 x 不会是表头
+    if (!zslValueGteMin(x->score, range))
+        return 0;
+    return rank;
+}
+
+unsigned long zslRankOfFirstInLexRange(zskiplist *zsl, zlexrangespec *range)
+{
+    zskiplistNode *x;
+    unsigned long rank = 0;
+    int i;
+
+    if (!zslIsInLexRange(zsl, range))
+        return 0;
+    x = zsl->header;
+    for (i = zsl->level - 1; i >= 0; i--)
+    {
+        while (x->level[i].forward &&
+               !zslLexValueGteMin(&x->level[i].forward->obj, range))
+        {
+            rank += x->level[i].span;
+            x = x->level[i].forward;
+        }
+    }
+    x = x->level[0].forward;
+    if (!zslLexValueLteMax(&x->obj, range))
+        return 0;
+    return rank + 1;
+}
+
+unsigned long zslRankOfLastInLexRange(zskiplist *zsl, zlexrangespec *range)
+{
+    zskiplistNode *x;
+    unsigned long rank = 0;
+    int i;
+
+    if (!zslIsInLexRange(zsl, range))
+        return 0;
+    x = zsl->header;
+    for (i = zsl->level - 1; i >= 0; i--)
+    {
+        while (x->level[i].forward &&
+               zslLexValueLteMax(&x->level[i].forward->obj, range))
+        {
+            rank += x->level[i].span;
+            x = x->level[i].forward;
+        }
+    }
+    if (!zslLexValueGteMin(&x->obj, range))
+        return 0;
+    return rank;
+}
+
 /* 如果没有包含给定分值和成员对象的节点，返回 0 ，否则返回排位。
 因为跳跃表的表头也被计算在内，所以返回的排位以 1 为起始值*/
 unsigned long zslGetRank(zskiplist *zsl, double score, robj *o)
@@ -582,7 +770,7 @@ unsigned long zslGetRank(zskiplist *zsl, double score, robj *o)
                 (x->level[i].forward->score == score &&
                  // 比对成员对象，注意这里是<=0，所以会到x是要查找的值才停止
                  // 和zslDelete不同，是因为这里是要找到指定的那个元素
-                 compareStringObjects(x->level[i].forward->obj, o) <= 0)))
+                 compareStringObjects(&x->level[i].forward->obj, o) <= 0)))
         {
 
             // 累积跨越的节点数量，计算rank
@@ -592,7 +780,7 @@ unsigned long zslGetRank(zskiplist *zsl, double score, robj *o)
         }
         // 此时x的后一个对像大于要查找的对象，只有x是可能的要找的对象
         // 必须确保不仅分值相等，而且成员对象也要相等
-        if (x->obj && equalStringObjects(x->obj, o))
+        if (x != zsl->header && equalStringObjects(&x->obj, o))
         {
             return rank;
         }
@@ -652,7 +840,7 @@ unsigned long zslDeleteRangeByScore(zskiplist *zsl, zrangespec *range, dict *dic
         // 记录下个节点的指针
         zskiplistNode *next = x->level[0].forward;
         zslDeleteNode(zsl, x, update);
-        dictDelete(dict, x->obj);
+        dictDelete(dict, &x->obj);
         zslFreeNode(x);
         removed++;
         x = next;
@@ -670,21 +858,21 @@ unsigned long zslDeleteRangeByLex(zskiplist *zsl, zlexrangespec *range, dict *di
     for (i = zsl->level - 1; i >= 0; i--)
     {
         while (x->level[i].forward &&
-               !zslLexValueGteMin(x->level[i].forward->obj, range))
+               !zslLexValueGteMin(&x->level[i].forward->obj, range))
             x = x->level[i].forward;
         update[i] = x;
     }
 
     x = x->level[0].forward;
 
-    while (x && zslLexValueLteMax(x->obj, range))
+    while (x && zslLexValueLteMax(&x->obj, range))
     {
         zskiplistNode *next = x->level[0].forward;
 
         // 从跳跃表中删除当前节点
         zslDeleteNode(zsl, x, update);
         // 从字典中删除当前节点
-        dictDelete(dict, x->obj);
+        dictDelete(dict, &x->obj);
         // 释放当前跳跃表节点的结构
         zslFreeNode(x);
 
@@ -728,7 +916,7 @@ unsigned long zslDeleteRangeByRank(zskiplist *zsl, unsigned int start, unsigned
         // 从跳跃表中删除节点
         zslDeleteNode(zsl, x, update);
         // 从字典中删除节点
-        dictDelete(dict, x->obj);
+        dictDelete(dict, &x->obj);
         // 释放节点结构
         zslFreeNode(x);
         // 为删除计数器增一
@@ -36,16 +36,27 @@ int zslValueGteMin(double value, zrangespec *spec);
 int zslValueLteMax(double value, zrangespec *spec);
 int zslLexValueGteMin(robj *value, zlexrangespec *spec);
 int zslLexValueLteMax(robj *value, zlexrangespec *spec);
+// 对比a，b对象表示的取值的大小，shared.minstring 和 shared.maxstring 表示最小和最大的字符串
+int compareStringObjectsForLexRange(robj *a, robj *b);
+// 解析 ZRANGEBYSCORE 风格的分值范围，"(" 前缀表示开区间，成功返回 REDIS_OK
+int zslParseRange(robj *min, robj *max, zrangespec *spec);
+// 解析 ZRANGEBYLEX 风格的字典序范围，成功返回 REDIS_OK ，之后必须调用 zslFreeLexRange 释放
+int zslParseLexRange(robj *min, robj *max, zlexrangespec *spec);
+void zslFreeLexRange(zlexrangespec *spec);
 /************************************************************************************/
 
 #define ZSKIPLIST_MAXLEVEL 32 // 跳跃表的最大层数
 #define ZSKIPLIST_P 0.25      //用于随机获得新节点层数的函数，最大节点每高一层的概率为0.25
 
 //跳跃表节点
+// 成员直接嵌入在节点中：obj 是一个 EMBSTR 编码的字符串对象，它的 sds 紧跟在 level 数组之后，
+// 和节点在同一块内存中，不再单独分配成员对象。obj 是节点的第一个成员，所以 &node->obj 就是节点的地址，
+// 有序集合的字典直接以它为键，通过键就能找到节点和分值。
+// obj 随节点一起释放，需要在节点删除之后继续使用成员的调用者要自己复制一份
 typedef struct zskiplistNode
 {
-    // 成员对象
-    robj *obj;
+    // 嵌入的成员对象
+    robj obj;
     // 分值
     double score;
     // 后退指针
@@ -80,8 +91,26 @@ void zslFreeNode(zskiplistNode *node);
 void zslFree(zskiplist *zsl);
 
 // 创建一个成员为 obj ，分值为 score 的新节点， 并将这个新节点插入到跳跃表zsl中。 函数的返回值为新节点。
+// obj 的内容被复制到节点中，调用者仍然持有自己的引用
 zskiplistNode *zslInsert(zskiplist *zsl, double score, robj *obj);
+
+// 批量构建跳跃表时使用的状态，记录每一层的最后一个节点以及它的排位
+// 新节点总是追加在表尾，不需要从最高层开始查找插入位置，构建 N 个节点的复杂度为 O(N)
+typedef struct zslBulkLoader
+{
+    zskiplist *zsl;
+    zskiplistNode *last[ZSKIPLIST_MAXLEVEL];
+    unsigned long rank[ZSKIPLIST_MAXLEVEL];
+} zslBulkLoader;
+
+// 开始往 zsl 的表尾批量追加节点，zsl 可以不为空
+void zslBulkLoadInit(zslBulkLoader *bl, zskiplist *zsl);
+// 在表尾追加成员为 obj ，分值为 score 的新节点并返回，调用者需要保证 (score, obj) 比表中所有节点都大
+zskiplistNode *zslBulkLoadAppend(zslBulkLoader *bl, double score, robj *obj);
+// 结束批量追加，补全指向表尾之后的各层跨度，之后才能对跳跃表做其他操作
+void zslBulkLoadFinish(zslBulkLoader *bl);
 // 从跳跃表 zsl 中删除包含给定节点 score 并且带有指定对象 obj 的节点。删除成功返回1，失败返回0
+// 节点的成员是字典的键，所以要先从字典中删除，再从跳跃表中删除
 int zslDelete(zskiplist *zsl, double score, robj *obj);
 
 // 如果给定的分值范围包含在跳跃表的分值范围之内，那么返回 1 ，否则返回 0
@@ -102,6 +131,13 @@ zskiplistNode *zslLastInLexRange(zskiplist *zsl, zlexrangespec *range);
 unsigned long zslGetRank(zskiplist *zsl, double score, robj *o);
 // 返回跳跃表在给定排位上的节点，排位的起始值为 1
 zskiplistNode *zslGetElementByRank(zskiplist *zsl, unsigned long rank);
+// 返回第一个（最后一个）在分值范围内的节点的排位，以 1 为起始值，没有这样的节点时返回 0
+// 只沿着查找路径累加跨度，不需要遍历范围内的节点，复杂度为 O(log N)
+unsigned long zslRankOfFirstInRange(zskiplist *zsl, zrangespec *range);
+unsigned long zslRankOfLastInRange(zskiplist *zsl, zrangespec *range);
+// 字典序范围的版本
+unsigned long zslRankOfFirstInLexRange(zskiplist *zsl, zlexrangespec *range);
+unsigned long zslRankOfLastInLexRange(zskiplist *zsl, zlexrangespec *range);
 
 // 删除所有分值在给定范围之内的节点。同时会从相应的字典中删除。返回值为被删除节点的数量
 unsigned long zslDeleteRangeByScore(zskiplist *zsl, zrangespec *range, dict *dict);
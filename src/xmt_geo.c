@@ -0,0 +1,467 @@
+#include "xmt_geo.h"
+#include "xmnotify.h"
+#include "xmmalloc.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+
+/**************************查询结果****************************************/
+
+void geoArrayInit(geoArray *ga, int sort, size_t count)
+{
+    ga->array = NULL;
+    ga->used = 0;
+    ga->size = 0;
+    ga->sort = sort;
+    ga->count = count;
+}
+
+void geoArrayFree(geoArray *ga)
+{
+    size_t i;
+
+    for (i = 0; i < ga->used; i++)
+        decrRefCount(ga->array[i].member);
+    xm_free(ga->array);
+}
+
+// 按 ga->sort 的顺序 a 是否排在 b 之后
+static inline int geoArrayAfter(geoArray *ga, double a, double b)
+{
+    return ga->sort == GEO_SORT_DESC ? a < b : a > b;
+}
+
+// 半正矢值为 hav 的位置是否会被保留，不会保留时调用者不需要为它创建成员对象
+static inline int geoArrayWants(geoArray *ga, double hav)
+{
+    return ga->count == 0 || ga->used < ga->count || geoArrayAfter(ga, ga->array[0].hav, hav);
+}
+
+static void geoHeapSiftUp(geoArray *ga, size_t i)
+{
+    geoPoint p = ga->array[i];
+
+    while (i > 0 && geoArrayAfter(ga, p.hav, ga->array[(i - 1) / 2].hav))
+    {
+        ga->array[i] = ga->array[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    ga->array[i] = p;
+}
+
+static void geoHeapSiftDown(geoArray *ga, size_t i)
+{
+    geoPoint p = ga->array[i];
+    size_t child;
+
+    while ((child = 2 * i + 1) < ga->used)
+    {
+        if (child + 1 < ga->used && geoArrayAfter(ga, ga->array[child + 1].hav, ga->array[child].hav))
+            child++;
+        if (!geoArrayAfter(ga, ga->array[child].hav, p.hav))
+            break;
+        ga->array[i] = ga->array[child];
+        i = child;
+    }
+    ga->array[i] = p;
+}
+
+// 加入一个位置，接管 member 的引用。调用者需要先用 geoArrayWants 确认它会被保留
+static void geoArrayAdd(geoArray *ga, double longitude, double latitude, double hav, robj *member)
+{
+    geoPoint *p;
+
+    // 堆满时替换掉堆顶，也就是当前排在最后的位置
+    if (ga->count && ga->used == ga->count)
+    {
+        decrRefCount(ga->array[0].member);
+        p = &ga->array[0];
+        p->longitude = longitude;
+        p->latitude = latitude;
+        p->hav = hav;
+        p->member = member;
+        geoHeapSiftDown(ga, 0);
+        return;
+    }
+
+    if (ga->used == ga->size)
+    {
+        ga->size = ga->size ? ga->size * 2 : 16;
+        if (ga->count && ga->size > ga->count)
+            ga->size = ga->count;
+        ga->array = xm_realloc(ga->array, sizeof(geoPoint) * ga->size);
+    }
+    p = &ga->array[ga->used++];
+    p->longitude = longitude;
+    p->latitude = latitude;
+    p->hav = hav;
+    p->member = member;
+    if (ga->count)
+        geoHeapSiftUp(ga, ga->used - 1);
+}
+
+static int geoPointCompareAsc(const void *a, const void *b)
+{
+    const geoPoint *x = a, *y = b;
+    return (x->hav > y->hav) - (x->hav < y->hav);
+}
+
+static int geoPointCompareDesc(const void *a, const void *b)
+{
+    return geoPointCompareAsc(b, a);
+}
+
+/**************************半径查询****************************************/
+
+// 遍历一个格子对应的分值区间，把圆内的位置加入 ga ，返回区间内的元素个数
+static unsigned long geoSearchArea(robj *zobj, GeoHashBits hash, GeoHashCircle *circle, geoArray *ga)
+{
+    zsetRangeIterator it;
+    zrangespec range;
+    unsigned long first, last;
+    uint64_t min, max;
+    unsigned char *eptr;
+    robj *obj;
+    double score, longitude, latitude, hav;
+
+    geohashScoreRange(hash, &min, &max);
+    range.min = min;
+    range.max = max;
+    range.minex = 0;
+    range.maxex = 1;
+
+    zsetRangeRanks(zobj, &range, &first, &last);
+    if (first == 0)
+        return 0;
+
+    zsetRangeInit(&it, zobj, first, last, 0);
+    while (zsetRangeNext(&it, &eptr, &obj, &score))
+    {
+        geohashDecodeScore((uint64_t)score, &longitude, &latitude);
+        hav = geohashCircleHav(circle, longitude, latitude);
+        if (hav > circle->maxhav || !geoArrayWants(ga, hav))
+            continue;
+        if (eptr)
+        {
+            obj = ziplistGetObject(eptr);
+        }
+        else if (zobj->encoding == REDIS_ENCODING_LEXSET)
+        {
+            // 成员序列返回的对象会被迭代器复用，需要复制
+            obj = createStringObject(obj->ptr, sdslen(obj->ptr));
+        }
+        else
+        {
+            incrRefCount(obj);
+        }
+        geoArrayAdd(ga, longitude, latitude, hav, obj);
+    }
+    zsetRangeRelease(&it);
+    return last - first + 1;
+}
+
+unsigned long geoSearch(robj *zobj, double longitude, double latitude, double radius, geoArray *ga)
+{
+    GeoHashRadius r;
+    GeoHashCircle circle;
+    GeoHashBits areas[9];
+    unsigned long scanned = 0;
+    int i, j;
+
+    if (!geohashGetAreasByRadius(longitude, latitude, radius, &r))
+        return 0;
+    geohashCircleInit(&circle, longitude, latitude, radius);
+
+    areas[0] = r.hash;
+    areas[1] = r.neighbors.north;
+    areas[2] = r.neighbors.south;
+    areas[3] = r.neighbors.east;
+    areas[4] = r.neighbors.west;
+    areas[5] = r.neighbors.north_east;
+    areas[6] = r.neighbors.north_west;
+    areas[7] = r.neighbors.south_east;
+    areas[8] = r.neighbors.south_west;
+
+    for (i = 0; i < 9; i++)
+    {
+        if (GEOHASH_IS_ZERO(areas[i]))
+            continue;
+        // 格子很大时相邻的格子可能回绕成同一个，同一个区间只查询一次
+        for (j = 0; j < i; j++)
+            if (areas[j].bits == areas[i].bits && areas[j].step == areas[i].step)
+                break;
+        if (j < i)
+            continue;
+        scanned += geoSearchArea(zobj, areas[i], &circle, ga);
+    }
+
+    if (ga->sort != GEO_SORT_NONE && ga->used > 1)
+        qsort(ga->array, ga->used, sizeof(geoPoint),
+              ga->sort == GEO_SORT_ASC ? geoPointCompareAsc : geoPointCompareDesc);
+    return scanned;
+}
+
+/**************************命令实现****************************************/
+
+// 解析单位，返回一个单位对应的米数，单位不合法时回复错误并返回 -1
+static double extractUnitOrReply(redisClient *c, robj *unit)
+{
+    char *u = unit->ptr;
+
+    if (!strcasecmp(u, "m"))
+        return 1;
+    else if (!strcasecmp(u, "km"))
+        return 1000;
+    else if (!strcasecmp(u, "ft"))
+        return 0.3048;
+    else if (!strcasecmp(u, "mi"))
+        return 1609.34;
+    addReplyError(c, "unsupported unit provided. please use m, km, ft, mi");
+    return -1;
+}
+
+// 解析经纬度，不是浮点数或者超出可以编码的范围时回复错误并返回 REDIS_ERR
+static int extractLongLatOrReply(redisClient *c, robj **argv, double *longitude, double *latitude)
+{
+    if (getDoubleFromObject(argv[0], longitude) != REDIS_OK ||
+        getDoubleFromObject(argv[1], latitude) != REDIS_OK)
+    {
+        addReplyError(c, "value is not a valid float");
+        return REDIS_ERR;
+    }
+    if (*longitude < GEO_LONG_MIN || *longitude > GEO_LONG_MAX ||
+        *latitude < GEO_LAT_MIN || *latitude > GEO_LAT_MAX)
+    {
+        addReplyError(c, "invalid longitude,latitude pair");
+        return REDIS_ERR;
+    }
+    return REDIS_OK;
+}
+
+// 距离保留 4 位小数
+static void addReplyDistance(redisClient *c, double d)
+{
+    char buf[128];
+    int len = snprintf(buf, sizeof(buf), "%.4f", d);
+    addReplyBulkCBuffer(c, buf, len);
+}
+
+void geoaddCommand(redisClient *c)
+{
+    robj *key = c->argv[1], *zobj;
+    double *xy;
+    uint64_t score;
+    long added = 0;
+    int i, elements;
+
+    if (c->argc < 5 || (c->argc - 2) % 3 != 0)
+    {
+        addReplyError(c, "syntax error. Try GEOADD key [x1] [y1] [name1] [x2] [y2] [name2] ... ");
+        return;
+    }
+
+    // 先检查所有坐标，有一个不合法时不做任何修改
+    elements = (c->argc - 2) / 3;
+    xy = xm_malloc(sizeof(double) * 2 * elements);
+    for (i = 0; i < elements; i++)
+    {
+        if (extractLongLatOrReply(c, c->argv + 2 + i * 3, &xy[i * 2], &xy[i * 2 + 1]) != REDIS_OK)
+        {
+            xm_free(xy);
+            return;
+        }
+    }
+
+    zobj = lookupKeyWrite(c->db, key);
+    if (zobj == NULL)
+    {
+        if (server.zset_max_ziplist_entries == 0 ||
+            stringObjectLen(c->argv[4]) > server.zset_max_ziplist_value)
+            zobj = createZsetObject();
+        else
+            zobj = createZsetZiplistObject();
+        dbAdd(c->db, key, zobj);
+    }
+    else if (zobj->type != REDIS_ZSET)
+    {
+        addReply(c, shared.wrongtypeerr);
+        xm_free(xy);
+        return;
+    }
+
+    for (i = 0; i < elements; i++)
+    {
+        geohashEncodeScore(xy[i * 2], xy[i * 2 + 1], &score);
+        added += zsetAdd(zobj, (double)score, c->argv[4 + i * 3]);
+    }
+    xm_free(xy);
+
+    // signalModifiedKey(c->db, key);
+    notifyKeyspaceEvent(REDIS_NOTIFY_ZSET, "zadd", key, c->db->id);
+    // server.dirty += elements;
+    addReplyLongLong(c, added);
+}
+
+// GEORADIUS key longitude latitude radius unit [WITHDIST] [WITHCOORD] [ASC|DESC] [COUNT count]
+// GEORADIUSBYMEMBER key member radius unit [WITHDIST] [WITHCOORD] [ASC|DESC] [COUNT count]
+static void georadiusGeneric(redisClient *c, int bymember)
+{
+    robj *zobj;
+    geoArray ga;
+    double longitude, latitude, radius, conversion, score;
+    long long count = 0;
+    int base = bymember ? 3 : 4, withdist = 0, withcoord = 0, sort = GEO_SORT_NONE;
+    int i, remaining, option_length;
+    size_t j;
+
+    if ((zobj = lookupKeyReadOrReply(c, c->argv[1], shared.emptymultibulk)) == NULL)
+        return;
+    if (zobj->type != REDIS_ZSET)
+    {
+        addReply(c, shared.wrongtypeerr);
+        return;
+    }
+
+    // 圆心是给定的坐标，或者给定成员的位置
+    if (bymember)
+    {
+        if (!zsetScore(zobj, c->argv[2], &score))
+        {
+            addReplyError(c, "could not decode requested zset member");
+            return;
+        }
+        geohashDecodeScore((uint64_t)score, &longitude, &latitude);
+    }
+    else if (extractLongLatOrReply(c, c->argv + 2, &longitude, &latitude) != REDIS_OK)
+    {
+        return;
+    }
+
+    if (getDoubleFromObject(c->argv[base], &radius) != REDIS_OK)
+    {
+        addReplyError(c, "need numeric radius");
+        return;
+    }
+    if (radius < 0)
+    {
+        addReplyError(c, "radius cannot be negative");
+        return;
+    }
+    if ((conversion = extractUnitOrReply(c, c->argv[base + 1])) < 0)
+        return;
+
+    for (i = base + 2; i < c->argc; i++)
+    {
+        char *arg = c->argv[i]->ptr;
+
+        remaining = c->argc - i - 1;
+        if (!strcasecmp(arg, "withdist"))
+        {
+            withdist = 1;
+        }
+        else if (!strcasecmp(arg, "withcoord"))
+        {
+            withcoord = 1;
+        }
+        else if (!strcasecmp(arg, "asc"))
+        {
+            sort = GEO_SORT_ASC;
+        }
+        else if (!strcasecmp(arg, "desc"))
+        {
+            sort = GEO_SORT_DESC;
+        }
+        else if (!strcasecmp(arg, "count") && remaining > 0)
+        {
+            if (getLongLongFromObject(c->argv[i + 1], &count) != REDIS_OK)
+            {
+                addReplyError(c, "value is not an integer or out of range");
+                return;
+            }
+            if (count <= 0)
+            {
+                addReplyError(c, "COUNT must be > 0");
+                return;
+            }
+            i++;
+        }
+        else
+        {
+            addReplyError(c, "syntax error");
+            return;
+        }
+    }
+
+    // 只保留 COUNT 个位置时默认保留最近的
+    if (count && sort == GEO_SORT_NONE)
+        sort = GEO_SORT_ASC;
+
+    geoArrayInit(&ga, sort, (size_t)count);
+    geoSearch(zobj, longitude, latitude, radius * conversion, &ga);
+
+    option_length = withdist + withcoord;
+    addReplyMultiBulkLen(c, ga.used);
+    for (j = 0; j < ga.used; j++)
+    {
+        geoPoint *p = &ga.array[j];
+
+        if (option_length)
+            addReplyMultiBulkLen(c, option_length + 1);
+        addReplyBulk(c, p->member);
+        if (withdist)
+            addReplyDistance(c, geohashHavToDistance(p->hav) / conversion);
+        if (withcoord)
+        {
+            addReplyMultiBulkLen(c, 2);
+            addReplyDouble(c, p->longitude);
+            addReplyDouble(c, p->latitude);
+        }
+    }
+    geoArrayFree(&ga);
+}
+
+void georadiusCommand(redisClient *c)
+{
+    georadiusGeneric(c, 0);
+}
+
+void georadiusbymemberCommand(redisClient *c)
+{
+    georadiusGeneric(c, 1);
+}
+
+void geodistCommand(redisClient *c)
+{
+    robj *zobj;
+    double conversion = 1, score1, score2, lon1, lat1, lon2, lat2;
+
+    if (c->argc == 5)
+    {
+        if ((conversion = extractUnitOrReply(c, c->argv[4])) < 0)
+            return;
+    }
+    else if (c->argc > 5)
+    {
+        addReplyError(c, "syntax error");
+        return;
+    }
+
+    if ((zobj = lookupKeyReadOrReply(c, c->argv[1], shared.nullbulk)) == NULL)
+        return;
+    if (zobj->type != REDIS_ZSET)
+    {
+        addReply(c, shared.wrongtypeerr);
+        return;
+    }
+
+    // 有一个成员不存在时回复空
+    if (!zsetScore(zobj, c->argv[2], &score1) || !zsetScore(zobj, c->argv[3], &score2))
+    {
+        addReply(c, shared.nullbulk);
+        return;
+    }
+    geohashDecodeScore((uint64_t)score1, &lon1, &lat1);
+    geohashDecodeScore((uint64_t)score2, &lon2, &lat2);
+    addReplyDistance(c, geohashGetDistance(lon1, lat1, lon2, lat2) / conversion);
+}
@@ -0,0 +1,61 @@
+#ifndef HXM_T_GEO_H
+#define HXM_T_GEO_H
+
+#include "xmt_zset.h"
+#include "xmgeohash.h"
+
+/*
+地理位置索引，建立在有序集合之上
+
+每个位置的经纬度编码成 52 位的 geohash ，作为成员的分值保存在普通的有序集合中，
+所以 ZRANGE 、ZREM 等有序集合命令都可以直接用在地理位置索引上。
+
+半径查询只需要对 geohashGetAreasByRadius 给出的最多 9 个分值区间做范围查询，
+每个区间先换算成排位再按排位遍历，和 ZRANGEBYSCORE 使用同一个迭代器，所有编码都适用。
+候选位置在循环中只比较半正矢值，不计算反三角函数；带 COUNT 时用大小为 COUNT 的堆保留最近（最远）的位置，
+不需要先收集所有圆内的位置再排序，被淘汰的 ziplist 成员也不会创建对象。
+*/
+
+// 结果的排序方式
+#define GEO_SORT_NONE 0
+#define GEO_SORT_ASC 1
+#define GEO_SORT_DESC 2
+
+// 查询到的一个位置
+typedef struct geoPoint
+{
+    double longitude, latitude;
+    // 到圆心的半正矢值，随距离单调递增
+    double hav;
+    // 成员对象，持有一个引用
+    robj *member;
+} geoPoint;
+
+// 查询结果
+// count 大于 0 时 array 是一个最多 count 个元素的堆，堆顶是已保留的位置中排序最靠后的一个
+typedef struct geoArray
+{
+    geoPoint *array;
+    size_t used, size;
+    int sort;
+    size_t count;
+} geoArray;
+
+// count 为 0 时不限个数，count 大于 0 时 sort 不能为 GEO_SORT_NONE
+void geoArrayInit(geoArray *ga, int sort, size_t count);
+void geoArrayFree(geoArray *ga);
+
+// 在有序集合 zobj 中查找到 (longitude, latitude) 的距离不超过 radius 米的位置，保存到 ga 中，并按 ga->sort 排好序
+// 返回检查过的候选位置个数
+unsigned long geoSearch(robj *zobj, double longitude, double latitude, double radius, geoArray *ga);
+
+// GEOADD key longitude latitude member [longitude latitude member ...]
+void geoaddCommand(redisClient *c);
+// GEORADIUS key longitude latitude radius m|km|ft|mi [WITHDIST] [WITHCOORD] [ASC|DESC] [COUNT count]
+void georadiusCommand(redisClient *c);
+// GEORADIUSBYMEMBER key member radius m|km|ft|mi [WITHDIST] [WITHCOORD] [ASC|DESC] [COUNT count]
+void georadiusbymemberCommand(redisClient *c);
+// GEODIST key member1 member2 [m|km|ft|mi]
+void geodistCommand(redisClient *c);
+
+#endif
@@ -1,7 +1,26 @@
 #include "xmt_hash.h"
+#include "xmmalloc.h"
+#include "xmnotify.h"
+#include "xmadaptive.h"
+
+#include <assert.h>
+#include <limits.h>
+#include <string.h>
 
 /***********字典的特定函数************************************************/
 
+int dictSdsKeyCompare(void *privdata, const void *key1, const void *key2)
+{
+    size_t l1, l2;
+
+    DICT_NOTUSED(privdata);
+    l1 = sdslen((sds)key1);
+    l2 = sdslen((sds)key2);
+    if (l1 != l2)
+        return 0;
+    return memcmp(key1, key2, l1) == 0;
+}
+
 unsigned int dictEncObjHash(const void *key)
 {
     robj *o = (robj *)key;
@@ -44,6 +63,11 @@ int dictEncObjKeyCompare(void *privdata, const void *key1,
         o2->encoding == REDIS_ENCODING_INT)
         return o1->ptr == o2->ptr;
 
+    // 两个都是字符串编码时直接比较，不用增减引用计数
+    if (sdsEncodedObject(o1) && sdsEncodedObject(o2))
+        return sdslen((sds)o1->ptr) == sdslen((sds)o2->ptr) &&
+               memcmp(o1->ptr, o2->ptr, sdslen((sds)o1->ptr)) == 0;
+
     o1 = getDecodedObject(o1);
     o2 = getDecodedObject(o2);
     cmp = dictSdsKeyCompare(privdata, o1->ptr, o2->ptr);
@@ -70,6 +94,16 @@ dictType hashDictType = {
     dictRedisObjectDestructor  /* val destructor */
 };
 
+// 值保存在节点的 v.s64 中，不需要释放
+dictType hashIntDictType = {
+    dictEncObjHash,            /* hash function */
+    NULL,                      /* key dup */
+    NULL,                      /* val dup */
+    dictEncObjKeyCompare,      /* key compare */
+    dictRedisObjectDestructor, /* key destructor */
+    NULL                       /* val destructor */
+};
+
 /******************************************************************/
 
 robj *createHashObject(void)
@@ -80,6 +114,25 @@ robj *createHashObject(void)
     return o;
 }
 
+void freeHashObject(robj *o)
+{
+    switch (o->encoding)
+    {
+    case REDIS_ENCODING_HT:
+    case REDIS_ENCODING_INTHT:
+        dictRelease((dict *)o->ptr);
+        break;
+    case REDIS_ENCODING_ZIPLIST:
+        objectFreeHashIndex(o);
+        xm_free(o->ptr);
+        break;
+    default:
+        // redisPanic("Unknown hash encoding type");
+        break;
+    }
+    objectFreeAccess(o);
+}
+
 void hashTypeTryConversion(robj *o, robj **argv, int start, int end)
 {
     int i;
@@ -102,7 +155,39 @@ void hashTypeTryConversion(robj *o, robj **argv, int start, int end)
     }
 }
 
+// 值对象可以无损地保存为整数时返回 1 ，整数转换回字符串之后和原来的字符串完全相同
+static int hashTypeValueIsInteger(robj *value, long long *ll)
+{
+    if (value->encoding == REDIS_ENCODING_INT)
+    {
+        *ll = (long)value->ptr;
+        return 1;
+    }
+    return sdsEncodedObject(value) && string2ll(value->ptr, sdslen(value->ptr), ll);
+}
+
+// ziplist 中所有的值都以整数保存时返回 1 ，ziplist 只会把能无损转换的字符串保存为整数
+static int hashTypeZiplistIntValues(unsigned char *zl)
+{
+    unsigned char *vptr, *vstr;
+    unsigned int vlen;
+    long long vll;
+
+    vptr = ziplistIndex(zl, 1);
+    while (vptr != NULL)
+    {
+        ziplistGet(vptr, &vstr, &vlen, &vll);
+        if (vstr != NULL)
+            return 0;
+        // 跳过下一个域
+        if ((vptr = ziplistNext(zl, vptr)) != NULL)
+            vptr = ziplistNext(zl, vptr);
+    }
+    return 1;
+}
+
 // 将一个 ziplist 编码的哈希对象 o 转换成其他编码
+// 转换成字典时，如果所有的值都是整数，那么使用 INTHT 编码
 void hashTypeConvertZiplist(robj *o, int enc)
 {
 
@@ -116,10 +201,11 @@ void hashTypeConvertZiplist(robj *o, int enc)
         hashTypeIterator *hi;
         dict *dict;
         int ret;
+        int intvals = hashTypeZiplistIntValues(o->ptr);
         // 创建哈希迭代器
         hi = hashTypeInitIterator(o);
         // 创建空白的新字典
-        dict = dictCreate(&hashDictType, NULL);
+        dict = dictCreate(intvals ? &hashIntDictType : &hashDictType, NULL);
 
         // 遍历整个 ziplist
         while (hashTypeNext(hi) != REDIS_ERR)
@@ -130,6 +216,18 @@ void hashTypeConvertZiplist(robj *o, int enc)
             field = hashTypeCurrentObject(hi, REDIS_HASH_KEY);
             field = tryObjectEncoding(field);
 
+            if (intvals)
+            {
+                // 值直接保存在节点中，不创建值对象
+                unsigned char *vstr;
+                unsigned int vlen;
+                long long vll;
+
+                hashTypeCurrentFromZiplist(hi, REDIS_HASH_VALUE, &vstr, &vlen, &vll);
+                dictSetSignedIntegerVal(dictAddRaw(dict, field), vll);
+                continue;
+            }
+
             // 取出 ziplist 里的值
             value = hashTypeCurrentObject(hi, REDIS_HASH_VALUE);
             value = tryObjectEncoding(value);
@@ -141,11 +239,12 @@ void hashTypeConvertZiplist(robj *o, int enc)
         // 释放 ziplist 的迭代器
         hashTypeReleaseIterator(hi);
 
-        // 释放对象原来的 ziplist
+        // 释放对象原来的 ziplist 和它的域索引
+        objectFreeHashIndex(o);
         xm_free(o->ptr);
 
         // 更新哈希的编码和值对象
-        o->encoding = REDIS_ENCODING_HT;
+        o->encoding = intvals ? REDIS_ENCODING_INTHT : REDIS_ENCODING_HT;
         o->ptr = dict;
     }
     else
@@ -154,6 +253,81 @@ void hashTypeConvertZiplist(robj *o, int enc)
     }
 }
 
+// 将一个 HT 或 INTHT 编码的哈希对象 o 转换成 ziplist 编码
+// 有域或者值超过 hash_max_ziplist_value 时放弃转换，对象保持原来的编码
+static void hashTypeConvertHashTable(robj *o, int enc)
+{
+    dictIterator *di;
+    dictEntry *de;
+    unsigned char *zl;
+
+    if (enc != REDIS_ENCODING_ZIPLIST)
+        return;
+
+    zl = ziplistNew();
+    di = dictGetIterator(o->ptr);
+    while ((de = dictNext(di)) != NULL)
+    {
+        robj *field = getDecodedObject(dictGetKey(de));
+        robj *value = NULL;
+        char buf[32];
+        char *vstr;
+        size_t vlen;
+        int fits;
+
+        if (o->encoding == REDIS_ENCODING_INTHT)
+        {
+            vlen = ll2string(buf, sizeof(buf), dictGetSignedIntegerVal(de));
+            vstr = buf;
+        }
+        else
+        {
+            value = getDecodedObject(dictGetVal(de));
+            vstr = value->ptr;
+            vlen = sdslen(value->ptr);
+        }
+        fits = sdslen(field->ptr) <= server.hash_max_ziplist_value &&
+               vlen <= server.hash_max_ziplist_value;
+
+        if (fits)
+        {
+            zl = ziplistPush(zl, field->ptr, sdslen(field->ptr), ZIPLIST_TAIL);
+            zl = ziplistPush(zl, (unsigned char *)vstr, vlen, ZIPLIST_TAIL);
+        }
+        decrRefCount(field);
+        if (value)
+            decrRefCount(value);
+        if (!fits)
+        {
+            dictReleaseIterator(di);
+            xm_free(zl);
+            return;
+        }
+    }
+    dictReleaseIterator(di);
+
+    // 释放字典以及其中的域和值对象
+    dictRelease(o->ptr);
+    o->encoding = REDIS_ENCODING_ZIPLIST;
+    o->ptr = zl;
+}
+
+// 把 INTHT 编码原地转换成 HT 编码：节点中的整数换成值对象，字典的类型换成 hashDictType
+// 键和节点都不变，不需要重新计算哈希值
+static void hashTypeConvertIntValues(robj *o)
+{
+    dict *d = o->ptr;
+    dictIterator *di = dictGetIterator(d);
+    dictEntry *de;
+
+    while ((de = dictNext(di)) != NULL)
+        dictSetVal(d, de, createStringObjectFromLongLong(dictGetSignedIntegerVal(de)));
+    dictReleaseIterator(di);
+
+    d->type = &hashDictType;
+    o->encoding = REDIS_ENCODING_HT;
+}
+
 void hashTypeConvert(robj *o, int enc)
 {
 
@@ -163,7 +337,14 @@ void hashTypeConvert(robj *o, int enc)
     }
     else if (o->encoding == REDIS_ENCODING_HT)
     {
-        //redisPanic("Not implemented");
+        hashTypeConvertHashTable(o, enc);
+    }
+    else if (o->encoding == REDIS_ENCODING_INTHT)
+    {
+        if (enc == REDIS_ENCODING_HT)
+            hashTypeConvertIntValues(o);
+        else
+            hashTypeConvertHashTable(o, enc);
     }
     else
     {
@@ -173,7 +354,7 @@ void hashTypeConvert(robj *o, int enc)
 
 void hashTypeTryObjectEncoding(robj *subject, robj **o1, robj **o2)
 {
-    if (subject->encoding == REDIS_ENCODING_HT)
+    if (subject->encoding == REDIS_ENCODING_HT || subject->encoding == REDIS_ENCODING_INTHT)
     {
         if (o1)
             *o1 = tryObjectEncoding(*o1);
@@ -182,6 +363,52 @@ void hashTypeTryObjectEncoding(robj *subject, robj **o1, robj **o2)
     }
 }
 
+// 记录一次访问，并在自适应模式下根据键的冷热调整编码：
+// 热键超过缩小之后的边界条件就提前转换为 HT ，冷键足够小时转换回 ziplist
+// 读操作只记录访问，编码留到下一次写入时再调整，HGET 、HEXISTS 不会改写值
+static void hashTypeAdapt(robj *o, int write)
+{
+    objectTrackAccess(o, write);
+    if (!server.encoding_adaptive || !write)
+        return;
+
+    if (o->encoding == REDIS_ENCODING_ZIPLIST &&
+        objectEncodingExceeds(o, hashTypeLength(o), server.hash_max_ziplist_entries))
+    {
+        hashTypeConvert(o, REDIS_ENCODING_HT);
+    }
+    else if ((o->encoding == REDIS_ENCODING_HT || o->encoding == REDIS_ENCODING_INTHT) &&
+             objectEncodingShouldCompact(o, hashTypeLength(o), server.hash_max_ziplist_entries) &&
+             !hashTypeStreaming(o))
+    {
+        hashTypeConvert(o, REDIS_ENCODING_ZIPLIST);
+        if (o->encoding == REDIS_ENCODING_ZIPLIST)
+            server.stat_encoding_demotions++;
+    }
+}
+
+// 返回 p 的后一个节点的偏移量，p 是最后一个节点时返回表尾标记的偏移量
+static size_t hashTypeZiplistNextOffset(unsigned char *zl, unsigned char *p)
+{
+    unsigned char *next = ziplistNext(zl, p);
+    return next ? (size_t)(next - zl) : ziplistBlobLen(zl) - 1;
+}
+
+// 修改 ziplist 中偏移量为 from 的域之后，更新域索引中的偏移量
+// oldnext 和 newnext 为修改前后被修改节点的后继节点的偏移量。
+// 后继节点保存前置节点长度的字段变长或者变短时，更后面的节点可能发生连锁更新，
+// 移动的距离不再一致，这时总字节数的变化和后继节点移动的距离不同，只能让索引失效
+static void hashTypeZiplistMoved(zlHashIndex *hi, unsigned char *zl, size_t oldbytes,
+                                 size_t from, size_t oldnext, size_t newnext)
+{
+    long delta = (long)newnext - (long)oldnext;
+
+    if ((long)ziplistBlobLen(zl) - (long)oldbytes != delta)
+        ziplistHashIndexReset(hi);
+    else
+        ziplistHashIndexMove(hi, zl, oldbytes, from, delta);
+}
+
 /* 从 ziplist 编码的 hash 中取出和 field 相对应的值。
  *
  * 参数：
@@ -204,18 +431,13 @@ int hashTypeGetFromZiplist(robj *o, robj *field,
     // 取出未编码的域
     field = getDecodedObject(field);
 
-    // 遍历 ziplist ，查找域的位置
+    // 借助域索引查找域的位置，域较少时仍然遍历 ziplist
     zl = o->ptr;
-    fptr = ziplistIndex(zl, ZIPLIST_HEAD);
+    fptr = ziplistHashIndexFind(objectGetHashIndex(o), zl, field->ptr, sdslen(field->ptr));
     if (fptr != NULL)
     {
-        // 定位包含域的节点，每次查找都要跳过一个节点，因为只查找键
-        fptr = ziplistFind(fptr, field->ptr, sdslen(field->ptr), 1);
-        if (fptr != NULL)
-        {
-            // 键已经找到，取出和它相对应的值的位置，就是它的后一个值
-            vptr = ziplistNext(zl, fptr);
-        }
+        // 键已经找到，取出和它相对应的值的位置，就是它的后一个值
+        vptr = ziplistNext(zl, fptr);
     }
     decrRefCount(field);
     // 从 ziplist 节点中取出值
@@ -249,6 +471,8 @@ robj *hashTypeGetObject(robj *o, robj *field)
 {
     robj *value = NULL;
 
+    hashTypeAdapt(o, 0);
+
     if (o->encoding == REDIS_ENCODING_ZIPLIST)
     {
         unsigned char *vstr = NULL;
@@ -278,6 +502,13 @@ robj *hashTypeGetObject(robj *o, robj *field)
             value = aux;
         }
     }
+    else if (o->encoding == REDIS_ENCODING_INTHT)
+    {
+        dictEntry *de = dictFind(o->ptr, field);
+
+        if (de != NULL)
+            value = createStringObjectFromLongLong(dictGetSignedIntegerVal(de));
+    }
     else
     {
         // redisPanic("Unknown hash encoding");
@@ -289,6 +520,8 @@ robj *hashTypeGetObject(robj *o, robj *field)
 
 int hashTypeExists(robj *o, robj *field)
 {
+    hashTypeAdapt(o, 0);
+
     if (o->encoding == REDIS_ENCODING_ZIPLIST)
     {
         unsigned char *vstr = NULL;
@@ -305,6 +538,11 @@ int hashTypeExists(robj *o, robj *field)
         if (hashTypeGetFromHashTable(o, field, &aux) == 0)
             return 1;
     }
+    else if (o->encoding == REDIS_ENCODING_INTHT)
+    {
+        if (dictFind(o->ptr, field) != NULL)
+            return 1;
+    }
     else
     {
         //redisPanic("Unknown hash encoding");
@@ -317,36 +555,48 @@ int hashTypeExists(robj *o, robj *field)
 int hashTypeSet(robj *o, robj *field, robj *value)
 {
     int update = 0;
+    long long vll;
+
+    hashTypeAdapt(o, 1);
+
+    // 值不是整数时，INTHT 编码要先转换成普通的 HT 编码
+    if (o->encoding == REDIS_ENCODING_INTHT && !hashTypeValueIsInteger(value, &vll))
+        hashTypeConvert(o, REDIS_ENCODING_HT);
 
     if (o->encoding == REDIS_ENCODING_ZIPLIST)
     {
         unsigned char *zl, *fptr, *vptr;
+        zlHashIndex *hi;
 
         // 解码成字符串或者数字
         field = getDecodedObject(field);
         value = getDecodedObject(value);
 
-        // 遍历整个 ziplist ，尝试查找并更新 field （如果它已经存在的话）
+        // 尝试查找并更新 field （如果它已经存在的话）
         zl = o->ptr;
-        fptr = ziplistIndex(zl, ZIPLIST_HEAD);
+        hi = objectGetHashIndex(o);
+        fptr = ziplistHashIndexFind(hi, zl, field->ptr, sdslen(field->ptr));
+        // 如果找到了field
         if (fptr != NULL)
         {
-            fptr = ziplistFind(fptr, field->ptr, sdslen(field->ptr), 1);
-            // 如果找到了field
-            if (fptr != NULL)
-            {
-                // 定位到值
-                vptr = ziplistNext(zl, fptr);
+            size_t foff = fptr - zl, oldbytes = ziplistBlobLen(zl), oldnext;
 
-                // 标识这次操作为更新操作
-                update = 1;
+            // 定位到值
+            vptr = ziplistNext(zl, fptr);
+            oldnext = hashTypeZiplistNextOffset(zl, vptr);
+
+            // 标识这次操作为更新操作
+            update = 1;
 
-                // 删除旧的键值对
-                zl = ziplistDelete(zl, &vptr);
+            // 删除旧的键值对
+            zl = ziplistDelete(zl, &vptr);
 
-                // 添加新的键值对
-                zl = ziplistInsert(zl, vptr, value->ptr, sdslen(value->ptr));
-            }
+            // 添加新的键值对
+            zl = ziplistInsert(zl, vptr, value->ptr, sdslen(value->ptr));
+
+            // 域节点本身没有移动，之后的节点一起移动了相同的距离
+            vptr = ziplistNext(zl, zl + foff);
+            hashTypeZiplistMoved(hi, zl, oldbytes, foff, oldnext, hashTypeZiplistNextOffset(zl, vptr));
         }
 
         // 如果这不是更新操作，那么这就是一个添加操作
@@ -355,6 +605,7 @@ int hashTypeSet(robj *o, robj *field, robj *value)
             // 将新的 field-value 对推入到 ziplist 的末尾
             zl = ziplistPush(zl, field->ptr, sdslen(field->ptr), ZIPLIST_TAIL);
             zl = ziplistPush(zl, value->ptr, sdslen(value->ptr), ZIPLIST_TAIL);
+            ziplistHashIndexAdd(hi, zl, ziplistIndex(zl, -2));
         }
 
         // 更新对象指针
@@ -365,7 +616,8 @@ int hashTypeSet(robj *o, robj *field, robj *value)
         decrRefCount(value);
 
         // 检查在添加操作完成之后，是否需要将 ZIPLIST 编码转换成 HT 编码
-        if (hashTypeLength(o) > server.hash_max_ziplist_entries)
+        // 自适应模式下冷键可以超过配置的边界条件，热键会更早转换
+        if (objectEncodingExceeds(o, hashTypeLength(o), server.hash_max_ziplist_entries))
             hashTypeConvert(o, REDIS_ENCODING_HT);
     }
     else if (o->encoding == REDIS_ENCODING_HT)
@@ -384,6 +636,22 @@ int hashTypeSet(robj *o, robj *field, robj *value)
 
         incrRefCount(value);
     }
+    else if (o->encoding == REDIS_ENCODING_INTHT)
+    {
+        dictEntry *de = dictFind(o->ptr, field);
+
+        // 计数器类的哈希大多是更新已有的域，先查找
+        if (de != NULL)
+        {
+            update = 1;
+        }
+        else
+        {
+            de = dictAddRaw(o->ptr, field);
+            incrRefCount(field);
+        }
+        dictSetSignedIntegerVal(de, vll);
+    }
     else
     {
         //  redisPanic("Unknown hash encoding");
@@ -397,36 +665,42 @@ int hashTypeDelete(robj *o, robj *field)
 {
     int deleted = 0;
 
+    hashTypeAdapt(o, 1);
+
     if (o->encoding == REDIS_ENCODING_ZIPLIST)
     {
         unsigned char *zl, *fptr;
+        zlHashIndex *hi;
 
         field = getDecodedObject(field);
 
         zl = o->ptr;
-        fptr = ziplistIndex(zl, ZIPLIST_HEAD);
+        hi = objectGetHashIndex(o);
+        // 定位到域
+        fptr = ziplistHashIndexFind(hi, zl, field->ptr, sdslen(field->ptr));
         if (fptr != NULL)
         {
-            // 定位到域
-            fptr = ziplistFind(fptr, field->ptr, sdslen(field->ptr), 1);
-            if (fptr != NULL)
-            {
-                // 删除键和值
-                zl = ziplistDelete(zl, &fptr);
-                zl = ziplistDelete(zl, &fptr);
-                o->ptr = zl;
-                deleted = 1;
-            }
+            size_t foff = fptr - zl, oldbytes = ziplistBlobLen(zl);
+            size_t oldnext = hashTypeZiplistNextOffset(zl, ziplistNext(zl, fptr));
+
+            ziplistHashIndexRemove(hi, zl, fptr);
+            // 删除键和值，之后 fptr 指向原来的后继节点
+            zl = ziplistDelete(zl, &fptr);
+            zl = ziplistDelete(zl, &fptr);
+            o->ptr = zl;
+            deleted = 1;
+            hashTypeZiplistMoved(hi, zl, oldbytes, foff, oldnext, fptr - zl);
         }
         decrRefCount(field);
     }
-    else if (o->encoding == REDIS_ENCODING_HT)
+    else if (o->encoding == REDIS_ENCODING_HT || o->encoding == REDIS_ENCODING_INTHT)
     {
         if (dictDelete((dict *)o->ptr, field) == REDIS_OK)
         {
             deleted = 1;
             // 删除成功时，看字典是否需要收缩
-            if (htNeedsResize(o->ptr))
+            // 分批回复期间不收缩，收缩之后 dictScan 可能会重复返回已经回复过的域
+            if (htNeedsResize(o->ptr) && !hashTypeStreaming(o))
                 dictResize(o->ptr);
         }
     }
@@ -438,6 +712,63 @@ int hashTypeDelete(robj *o, robj *field)
     return deleted;
 }
 
+int hashTypeIncrBy(robj *o, robj *field, long long incr, long long *result, char **err)
+{
+    long long value = 0;
+    robj *current, *new;
+
+    // INTHT 编码时直接修改节点中的整数，不需要创建或释放任何对象
+    // 记录访问之后冷键可能已经被转换回 ziplist ，这时走下面通用的路径
+    if (o->encoding == REDIS_ENCODING_INTHT)
+        hashTypeAdapt(o, 1);
+    if (o->encoding == REDIS_ENCODING_INTHT)
+    {
+        dictEntry *de = dictFind(o->ptr, field);
+
+        if (de != NULL)
+            value = dictGetSignedIntegerVal(de);
+        if ((incr < 0 && value < 0 && incr < (LLONG_MIN - value)) ||
+            (incr > 0 && value > 0 && incr > (LLONG_MAX - value)))
+        {
+            *err = "increment or decrement would overflow";
+            return REDIS_ERR;
+        }
+        if (de == NULL)
+        {
+            de = dictAddRaw(o->ptr, field);
+            incrRefCount(field);
+        }
+        value += incr;
+        dictSetSignedIntegerVal(de, value);
+        *result = value;
+        return REDIS_OK;
+    }
+
+    // 其他编码取出旧值，加上增量之后重新设置
+    if ((current = hashTypeGetObject(o, field)) != NULL)
+    {
+        if (getLongLongFromObject(current, &value) != REDIS_OK)
+        {
+            decrRefCount(current);
+            *err = "hash value is not an integer";
+            return REDIS_ERR;
+        }
+        decrRefCount(current);
+    }
+    if ((incr < 0 && value < 0 && incr < (LLONG_MIN - value)) ||
+        (incr > 0 && value > 0 && incr > (LLONG_MAX - value)))
+    {
+        *err = "increment or decrement would overflow";
+        return REDIS_ERR;
+    }
+    value += incr;
+    new = createStringObjectFromLongLong(value);
+    hashTypeSet(o, field, new);
+    decrRefCount(new);
+    *result = value;
+    return REDIS_OK;
+}
+
 unsigned long hashTypeLength(robj *o)
 {
     unsigned long length = ULONG_MAX;
@@ -446,7 +777,7 @@ unsigned long hashTypeLength(robj *o)
     {
         length = ziplistLen(o->ptr) / 2;
     }
-    else if (o->encoding == REDIS_ENCODING_HT)
+    else if (o->encoding == REDIS_ENCODING_HT || o->encoding == REDIS_ENCODING_INTHT)
     {
         length = dictSize((dict *)o->ptr);
     }
@@ -473,7 +804,7 @@ hashTypeIterator *hashTypeInitIterator(robj *subject)
         hi->fptr = NULL;
         hi->vptr = NULL;
     }
-    else if (hi->encoding == REDIS_ENCODING_HT)
+    else if (hi->encoding == REDIS_ENCODING_HT || hi->encoding == REDIS_ENCODING_INTHT)
     {
         hi->di = dictGetIterator(subject->ptr);
     }
@@ -489,7 +820,7 @@ hashTypeIterator *hashTypeInitIterator(robj *subject)
 void hashTypeReleaseIterator(hashTypeIterator *hi)
 {
     // 释放字典迭代器
-    if (hi->encoding == REDIS_ENCODING_HT)
+    if (hi->encoding == REDIS_ENCODING_HT || hi->encoding == REDIS_ENCODING_INTHT)
     {
         dictReleaseIterator(hi->di);
     }
@@ -532,7 +863,7 @@ int hashTypeNext(hashTypeIterator *hi)
         hi->fptr = fptr;
         hi->vptr = vptr;
     }
-    else if (hi->encoding == REDIS_ENCODING_HT)
+    else if (hi->encoding == REDIS_ENCODING_HT || hi->encoding == REDIS_ENCODING_INTHT)
     {
         if ((hi->de = dictNext(hi->di)) == NULL)
             return REDIS_ERR;
@@ -566,7 +897,9 @@ void hashTypeCurrentFromZiplist(hashTypeIterator *hi, int what,
 
 void hashTypeCurrentFromHashTable(hashTypeIterator *hi, int what, robj **dst)
 {
-    redisAssert(hi->encoding == REDIS_ENCODING_HT);
+    // INTHT 编码只有域是对象
+    assert(hi->encoding == REDIS_ENCODING_HT ||
+           (hi->encoding == REDIS_ENCODING_INTHT && (what & REDIS_HASH_KEY)));
 
     // 取出键
     if (what & REDIS_HASH_KEY)
@@ -603,7 +936,11 @@ robj *hashTypeCurrentObject(hashTypeIterator *hi, int what)
             dst = createStringObjectFromLongLong(vll);
         }
     }
-    else if (hi->encoding == REDIS_ENCODING_HT)
+    else if (hi->encoding == REDIS_ENCODING_INTHT && !(what & REDIS_HASH_KEY))
+    {
+        dst = createStringObjectFromLongLong(dictGetSignedIntegerVal(hi->de));
+    }
+    else if (hi->encoding == REDIS_ENCODING_HT || hi->encoding == REDIS_ENCODING_INTHT)
     {
         // 取出键或者值
         hashTypeCurrentFromHashTable(hi, what, &dst);
@@ -618,3 +955,274 @@ robj *hashTypeCurrentObject(hashTypeIterator *hi, int what)
     // 返回对象
     return dst;
 }
+
+void hashTypeReplyAll(redisClient *c, robj *o, int flags)
+{
+    unsigned long length = hashTypeLength(o);
+
+    // 同时回复域和值时，回复的元素数量是键值对数量的两倍
+    if ((flags & REDIS_HASH_KEY) && (flags & REDIS_HASH_VALUE))
+        length *= 2;
+    addReplyMultiBulkLen(c, length);
+
+    if (o->encoding == REDIS_ENCODING_ZIPLIST)
+    {
+        unsigned char *zl = o->ptr;
+        unsigned char *fptr, *vptr;
+
+        // 直接沿着 ziplist 前进，不需要分配迭代器
+        fptr = ziplistIndex(zl, 0);
+        while (fptr != NULL)
+        {
+            vptr = ziplistNext(zl, fptr);
+            if (flags & REDIS_HASH_KEY)
+                addReplyZiplistEntry(c, fptr);
+            if (flags & REDIS_HASH_VALUE)
+                addReplyZiplistEntry(c, vptr);
+            fptr = ziplistNext(zl, vptr);
+        }
+    }
+    else if (o->encoding == REDIS_ENCODING_HT || o->encoding == REDIS_ENCODING_INTHT)
+    {
+        hashTypeIterator *hi = hashTypeInitIterator(o);
+        robj *obj;
+
+        while (hashTypeNext(hi) != REDIS_ERR)
+        {
+            if (flags & REDIS_HASH_KEY)
+            {
+                hashTypeCurrentFromHashTable(hi, REDIS_HASH_KEY, &obj);
+                addReplyBulk(c, obj);
+            }
+            if ((flags & REDIS_HASH_VALUE) && o->encoding == REDIS_ENCODING_INTHT)
+            {
+                addReplyBulkLongLong(c, dictGetSignedIntegerVal(hi->de));
+            }
+            else if (flags & REDIS_HASH_VALUE)
+            {
+                hashTypeCurrentFromHashTable(hi, REDIS_HASH_VALUE, &obj);
+                addReplyBulk(c, obj);
+            }
+        }
+        hashTypeReleaseIterator(hi);
+    }
+    else
+    {
+        // redisPanic("Unknown hash encoding");
+    }
+}
+
+/**************************分批回复****************************************/
+
+// 每迭代这么多个桶检查一次时间，避免频繁调用 gettimeofday
+#define REDIS_STREAM_CHECK_INTERVAL 64
+
+// dictScan 的回调，把一个键值对写入客户端的回复
+static void hashTypeStreamCallback(void *privdata, const dictEntry *de)
+{
+    redisClient *c = privdata;
+
+    if (c->stream.flags & REDIS_HASH_KEY)
+    {
+        addReplyBulk(c, dictGetKey(de));
+        c->stream.emitted++;
+    }
+    if (c->stream.flags & REDIS_HASH_VALUE)
+    {
+        if (c->stream.o->encoding == REDIS_ENCODING_INTHT)
+            addReplyBulkLongLong(c, dictGetSignedIntegerVal(de));
+        else
+            addReplyBulk(c, dictGetVal(de));
+        c->stream.emitted++;
+    }
+}
+
+// 生成一个时间片的回复，全部回复完毕时填入回复长度并返回 1
+static int hashTypeStreamStep(redisClient *c)
+{
+    streamingState *st = &c->stream;
+    long long budget = server.stream_time_budget ? server.stream_time_budget : REDIS_STREAM_TIME_BUDGET;
+    long long start = ustime();
+    long steps = 0;
+
+    do
+    {
+        st->cursor = dictScan(st->o->ptr, st->cursor, hashTypeStreamCallback, c);
+        if (st->cursor == 0)
+        {
+            setDeferredMultiBulkLength(c, st->lenblock, st->emitted);
+            decrRefCount(st->o);
+            st->o = NULL;
+            st->lenblock = NULL;
+            return 1;
+        }
+    } while (++steps % REDIS_STREAM_CHECK_INTERVAL || ustime() - start < budget);
+
+    return 0;
+}
+
+void hashTypeStreamReply(redisClient *c, robj *o, int flags)
+{
+    streamingState *st = &c->stream;
+
+    // ziplist 编码的哈希很小，直接一次回复
+    if (o->encoding != REDIS_ENCODING_HT && o->encoding != REDIS_ENCODING_INTHT)
+    {
+        hashTypeReplyAll(c, o, flags);
+        return;
+    }
+
+    // 回复期间其他客户端可能删除或者覆盖这个键，持有一个引用保证对象不会被释放
+    incrRefCount(o);
+    st->o = o;
+    st->cursor = 0;
+    st->flags = flags;
+    st->emitted = 0;
+    // 回复的元素个数等回复完毕时才知道，期间增删的域可能回复也可能不回复
+    st->lenblock = addDeferredMultiBulkLength(c);
+
+    if (hashTypeStreamStep(c))
+        return;
+
+    // 一个时间片没有回复完，剩下的留到之后的事件循环
+    c->flags |= REDIS_STREAMING;
+    ilistAddTail(&server.streaming_clients, &st->node);
+}
+
+void handleStreamingClients(void)
+{
+    ilistIter it;
+    ilistNode *ln;
+    redisClient *c;
+
+    // 每个客户端处理一个时间片，回复完毕的客户端从链表中删除，可以继续执行命令
+    ilistRewind(&server.streaming_clients, &it, AL_START_HEAD);
+    while ((ln = ilistNext(&it)) != NULL)
+    {
+        c = ilistEntry(ln, redisClient, stream.node);
+        if (hashTypeStreamStep(c))
+        {
+            ilistDel(&server.streaming_clients, ln);
+            c->flags &= ~REDIS_STREAMING;
+        }
+    }
+}
+
+void hashTypeStreamAbort(redisClient *c)
+{
+    if (!(c->flags & REDIS_STREAMING))
+        return;
+    ilistDel(&server.streaming_clients, &c->stream.node);
+    decrRefCount(c->stream.o);
+    c->stream.o = NULL;
+    c->stream.lenblock = NULL;
+    c->flags &= ~REDIS_STREAMING;
+}
+
+int hashTypeStreaming(robj *o)
+{
+    ilistIter it;
+    ilistNode *ln;
+
+    // 分批回复的客户端持有对象的一个引用，只被数据库引用的对象不可能正在分批回复
+    if (o->refcount == 1)
+        return 0;
+
+    ilistRewind(&server.streaming_clients, &it, AL_START_HEAD);
+    while ((ln = ilistNext(&it)) != NULL)
+    {
+        if (ilistEntry(ln, redisClient, stream.node)->stream.o == o)
+            return 1;
+    }
+    return 0;
+}
+
+/**************************命令实现****************************************/
+
+robj *hashTypeLookupWriteOrCreate(redisClient *c, robj *key)
+{
+    robj *o = lookupKeyWrite(c->db, key);
+
+    if (o == NULL)
+    {
+        o = createHashObject();
+        dbAdd(c->db, key, o);
+    }
+    else if (o->type != REDIS_HASH)
+    {
+        addReply(c, shared.wrongtypeerr);
+        return NULL;
+    }
+    return o;
+}
+
+void hincrbyCommand(redisClient *c)
+{
+    long long incr, value;
+    char *err;
+    robj *o;
+
+    if (getLongLongFromObject(c->argv[3], &incr) != REDIS_OK)
+    {
+        addReplyError(c, "value is not an integer or out of range");
+        return;
+    }
+    if ((o = hashTypeLookupWriteOrCreate(c, c->argv[1])) == NULL)
+        return;
+    hashTypeTryConversion(o, c->argv, 2, 2);
+    hashTypeTryObjectEncoding(o, &c->argv[2], NULL);
+    if (hashTypeIncrBy(o, c->argv[2], incr, &value, &err) != REDIS_OK)
+    {
+        addReplyError(c, err);
+        return;
+    }
+    addReplyLongLong(c, value);
+    // signalModifiedKey(c->db, c->argv[1]);
+    notifyKeyspaceEvent(REDIS_NOTIFY_HASH, "hincrby", c->argv[1], c->db->id);
+}
+
+static void genericHgetallCommand(redisClient *c, int flags)
+{
+    robj *o;
+
+    if ((o = lookupKeyReadOrReply(c, c->argv[1], shared.emptymultibulk)) == NULL)
+        return;
+    if (o->type != REDIS_HASH)
+    {
+        addReply(c, shared.wrongtypeerr);
+        return;
+    }
+    hashTypeStreamReply(c, o, flags);
+}
+
+void hkeysCommand(redisClient *c)
+{
+    genericHgetallCommand(c, REDIS_HASH_KEY);
+}
+
+void hvalsCommand(redisClient *c)
+{
+    genericHgetallCommand(c, REDIS_HASH_VALUE);
+}
+
+void hgetallCommand(redisClient *c)
+{
+    genericHgetallCommand(c, REDIS_HASH_KEY | REDIS_HASH_VALUE);
+}
+
+void hscanCommand(redisClient *c)
+{
+    robj *o;
+    unsigned long cursor;
+
+    if (parseScanCursorOrReply(c, c->argv[2], &cursor) == REDIS_ERR)
+        return;
+    if ((o = lookupKeyReadOrReply(c, c->argv[1], shared.emptyscan)) == NULL)
+        return;
+    if (o->type != REDIS_HASH)
+    {
+        addReply(c, shared.wrongtypeerr);
+        return;
+    }
+    scanGenericCommand(c, o, cursor);
+}
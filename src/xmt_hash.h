@@ -35,8 +35,11 @@ typedef struct
 
 // 创建一个压缩列表编码的哈希对象
 robj *createHashObject(void);
+// 释放哈希对象的值，以及它的域索引和访问记录
+void freeHashObject(robj *o);
 
-// 将 ZIPLIST 编码转换成 HT 编码
+// 在 ZIPLIST 和 HT 编码之间转换，HT 转换成 ZIPLIST 时有过长的域或值则保持不变
+// ZIPLIST 中的值都是整数时转换成 INTHT 编码，值直接保存在字典节点中；之后写入非整数的值时再原地转换成 HT
 void hashTypeConvert(robj *o, int enc);
 // 对 argv 数组中的多个对象进行检查，看是否需要将对象的编码从ZIPLIST转换成 HT
 void hashTypeTryConversion(robj *subject, robj **argv, int start, int end);
@@ -67,11 +70,42 @@ void hashTypeCurrentFromZiplist(hashTypeIterator *hi, int what,
                                 unsigned char **vstr,
                                 unsigned int *vlen,
                                 long long *vll);
-// 从字典编码的哈希中取出所指向节点的 field 或者 value 。
+// 从字典编码的哈希中取出所指向节点的 field 或者 value 。INTHT 编码没有值对象，只能取出 field
 void hashTypeCurrentFromHashTable(hashTypeIterator *hi, int what, robj **dst);
 //  这个函数返回一个增加了引用计数的对象，或者一个新对象。
 //  当使用完返回对象之后，调用者需要对对象执行 decrRefCount() 。
 robj *hashTypeCurrentObject(hashTypeIterator *hi, int what);
-// robj *hashTypeLookupWriteOrCreate(redisClient *c, robj *key);
+// 将哈希中的域和（或）值回复给客户端，flags 为 REDIS_HASH_KEY 和 REDIS_HASH_VALUE 的组合，
+// 分别对应 HKEYS 、 HVALS 和 HGETALL 。ziplist 编码时直接从节点的字节中生成回复，不会创建对象
+void hashTypeReplyAll(redisClient *c, robj *o, int flags);
+// 给域 field 的整数值加上 incr ，域不存在时当作 0 ，结果保存到 *result
+// 值不是整数或者结果溢出时返回 REDIS_ERR ，*err 为错误信息。INTHT 编码时直接修改字典节点中的整数
+int hashTypeIncrBy(robj *o, robj *field, long long incr, long long *result, char **err);
+// 按写操作查找键 key 的哈希对象，不存在时创建一个空哈希并加入数据库，类型不对时回复错误并返回 NULL
+robj *hashTypeLookupWriteOrCreate(redisClient *c, robj *key);
+
+// 分批回复：HT 编码的哈希可能有上百万个域，一次回复会让事件循环停顿很久
+// 这里用 dictScan 按桶回复，每个时间片结束时记下游标，之后的事件循环接着回复
+// 回复期间字典不会收缩，也不会转换编码，每个域最多回复一次
+
+// 与 hashTypeReplyAll 相同，但 HT 编码时只回复一个时间片，剩下的由 handleStreamingClients 完成
+void hashTypeStreamReply(redisClient *c, robj *o, int flags);
+// 为每个分批回复的客户端生成一个时间片的回复，在每次事件循环结束、进入休眠之前调用
+void handleStreamingClients(void);
+// 释放客户端时调用，放弃没有完成的分批回复
+void hashTypeStreamAbort(redisClient *c);
+// 检查哈希对象是否正在被分批回复
+int hashTypeStreaming(robj *o);
+
+// HINCRBY key field increment
+void hincrbyCommand(redisClient *c);
+// HKEYS key
+void hkeysCommand(redisClient *c);
+// HVALS key
+void hvalsCommand(redisClient *c);
+// HGETALL key
+void hgetallCommand(redisClient *c);
+// HSCAN key cursor [COUNT count]
+void hscanCommand(redisClient *c);
 
 #endif
@@ -1,5 +1,6 @@
 #include "xmt_list.h"
 #include "xmmalloc.h"
+#include "xmadaptive.h"
 
 robj *createListObject(void)
 {
@@ -27,11 +28,13 @@ void freeListObject(robj *o)
         listRelease((list *)o->ptr);
         break;
     case REDIS_ENCODING_ZIPLIST:
+        objectFreeSkipIndex(o);
         xm_free(o->ptr);
         break;
     default:
         // redisPanic("Unknown list encoding type");
     }
+    objectFreeAccess(o);
 }
 
 void listTypeTryConversion(robj *subject, robj *value)
@@ -45,13 +48,38 @@ void listTypeTryConversion(robj *subject, robj *value)
         listTypeConvert(subject, REDIS_ENCODING_LINKEDLIST);
 }
 
+// 记录一次访问，并在自适应模式下根据键的冷热调整编码：
+// 热键超过缩小之后的边界条件就提前转换为双端链表，冷键足够小时转换回压缩列表
+// 读操作只记录访问，编码留到下一次写入时再调整
+static void listTypeAdapt(robj *subject, int write)
+{
+    objectTrackAccess(subject, write);
+    if (!server.encoding_adaptive || !write)
+        return;
+
+    if (subject->encoding == REDIS_ENCODING_ZIPLIST &&
+        objectEncodingExceeds(subject, ziplistLen(subject->ptr), server.list_max_ziplist_entries))
+    {
+        listTypeConvert(subject, REDIS_ENCODING_LINKEDLIST);
+    }
+    else if (subject->encoding == REDIS_ENCODING_LINKEDLIST &&
+             objectEncodingShouldCompact(subject, listLength((list *)subject->ptr),
+                                         server.list_max_ziplist_entries))
+    {
+        listTypeConvert(subject, REDIS_ENCODING_ZIPLIST);
+        if (subject->encoding == REDIS_ENCODING_ZIPLIST)
+            server.stat_encoding_demotions++;
+    }
+}
+
 void listTypePush(robj *subject, robj *value, int where)
 {
+    listTypeAdapt(subject, 1);
     // 检查是否需要转换编码？
     listTypeTryConversion(subject, value);
-    // 压缩列表的长度过长，也需要转换编码
+    // 推入之后压缩列表的长度过长，也需要转换编码，自适应模式下冷键和热键的边界条件不同
     if (subject->encoding == REDIS_ENCODING_ZIPLIST &&
-        ziplistLen(subject->ptr) >= server.list_max_ziplist_entries)
+        objectEncodingExceeds(subject, ziplistLen(subject->ptr) + 1, server.list_max_ziplist_entries))
         listTypeConvert(subject, REDIS_ENCODING_LINKEDLIST);
 
     // 压缩列表的插入工作
@@ -62,6 +90,9 @@ void listTypePush(robj *subject, robj *value, int where)
         // 因为ziplistPush不会识别long类型的内容
         value = getDecodedObject(value);
         subject->ptr = ziplistPush(subject->ptr, value->ptr, sdslen(value->ptr), pos);
+        // 推入表头会让所有节点后移，推入表尾不影响已有节点的偏移量
+        if (pos == ZIPLIST_HEAD)
+            objectTouchSkipIndex(subject, ziplistIndex(subject->ptr, 0));
         // 注意引用次数减一
         decrRefCount(value);
     }
@@ -90,6 +121,8 @@ robj *listTypePop(robj *subject, int where)
 
     robj *value = NULL;
 
+    listTypeAdapt(subject, 1);
+
     if (subject->encoding == REDIS_ENCODING_ZIPLIST)
     {
         unsigned char *p;
@@ -116,6 +149,7 @@ robj *listTypePop(robj *subject, int where)
             }
             // 从 ziplist 中删除被弹出元素
             subject->ptr = ziplistDelete(subject->ptr, &p);
+            objectTouchSkipIndex(subject, p);
         }
     }
     // 双端链表
@@ -174,11 +208,16 @@ listTypeIterator *listTypeInitIterator(robj *subject, long index, unsigned char
 
     if (li->encoding == REDIS_ENCODING_ZIPLIST)
     {
-        li->zi = ziplistIndex(subject->ptr, index);
+        // 节点较多时借助跳跃索引定位，否则退化为 ziplistIndex
+        li->zi = ziplistSkipIndexSeek(objectGetSkipIndex(subject), subject->ptr, index);
     }
     else if (li->encoding == REDIS_ENCODING_LINKEDLIST)
     {
+        // 长链表建立位置索引之后 listIndex 为 O(log n)
+        if (listLength((list *)subject->ptr) >= REDIS_LIST_INDEX_MIN_ENTRIES)
+            listEnableIndex(subject->ptr);
         li->ln = listIndex(subject->ptr, index);
+        li->index = index < 0 ? index + (long)listLength((list *)subject->ptr) : index;
     }
     else
     {
@@ -213,13 +252,20 @@ int listTypeNext(listTypeIterator *li, listTypeEntry *entry)
     {
         // 记录当前节点到 entry
         entry->ln = li->ln;
+        entry->index = li->index;
         // 移动迭代器的指针
         if (entry->ln != NULL)
         {
             if (li->direction == REDIS_TAIL)
+            {
                 li->ln = li->ln->next;
+                li->index++;
+            }
             else
+            {
                 li->ln = li->ln->prev;
+                li->index--;
+            }
             return 1;
         }
     }
@@ -283,27 +329,30 @@ void listTypeInsert(listTypeEntry *entry, robj *value, int where)
             }
             else
             {
-                // 插入到到节点之后
+                // 插入到到节点之后，新节点占据 next 原来的偏移量
+                size_t offset = next - (unsigned char *)subject->ptr;
                 subject->ptr = ziplistInsert(subject->ptr, next, value->ptr, sdslen(value->ptr));
+                objectTouchSkipIndex(subject, (unsigned char *)subject->ptr + offset);
             }
         }
         // 插到节点之前
         else
         {
+            size_t offset = entry->zi - (unsigned char *)subject->ptr;
             subject->ptr = ziplistInsert(subject->ptr, entry->zi, value->ptr, sdslen(value->ptr));
+            objectTouchSkipIndex(subject, (unsigned char *)subject->ptr + offset);
         }
         decrRefCount(value);
     }
     else if (entry->li->encoding == REDIS_ENCODING_LINKEDLIST)
     {
-        if (where == REDIS_TAIL)
-        {
-            listInsertNode(subject->ptr, entry->ln, value, AL_START_TAIL);
-        }
-        else
-        {
-            listInsertNode(subject->ptr, entry->ln, value, AL_START_HEAD);
-        }
+        // 给出节点的位置，位置索引原地更新
+        long pos = where == REDIS_TAIL ? entry->index + 1 : entry->index;
+
+        listInsertNodeWithIndex(subject->ptr, entry->ln, value, where == REDIS_TAIL, entry->index);
+        // 迭代器指向的节点在新节点之后时，位置后移一位
+        if (entry->li->index >= pos)
+            entry->li->index++;
         incrRefCount(value);
     }
     else
@@ -341,6 +390,7 @@ void listTypeDelete(listTypeEntry *entry)
         unsigned char *p = entry->zi;
 
         li->subject->ptr = ziplistDelete(li->subject->ptr, &p);
+        objectTouchSkipIndex(li->subject, p);
 
         // 删除节点之后，更新迭代器的指针
         if (li->direction == REDIS_TAIL)
@@ -356,10 +406,12 @@ void listTypeDelete(listTypeEntry *entry)
             next = entry->ln->next;
         else
             next = entry->ln->prev;
-        // 删除当前节点
-        listDelNode(li->subject->ptr, entry->ln);
-        // 删除节点之后，更新迭代器的指针
+        // 删除当前节点，给出节点的位置，位置索引原地更新
+        listDelNodeWithIndex(li->subject->ptr, entry->ln, entry->index);
+        // 删除节点之后，更新迭代器的指针，向表尾迭代时下一个节点前移了一位
         li->ln = next;
+        if (li->direction == REDIS_TAIL)
+            li->index--;
     }
     else
     {
@@ -388,10 +440,100 @@ void listTypeConvert(robj *subject, int enc)
         // 更新编码
         subject->encoding = REDIS_ENCODING_LINKEDLIST;
 
-        // 释放原来的 ziplist
+        // 释放原来的 ziplist 及其跳跃索引
+        objectFreeSkipIndex(subject);
         xm_free(subject->ptr);
 
         // 更新对象值指针
         subject->ptr = l;
     }
-}
\ No newline at end of file
+    // 转换回压缩列表，有过长的值时保持双端链表编码
+    else if (enc == REDIS_ENCODING_ZIPLIST && subject->encoding == REDIS_ENCODING_LINKEDLIST)
+    {
+        unsigned char *zl = ziplistNew();
+        listIter iter;
+        listNode *ln;
+
+        listRewind(subject->ptr, &iter);
+        while ((ln = listNext(&iter)) != NULL)
+        {
+            robj *value = listNodeValue(ln);
+
+            if (sdsEncodedObject(value) && sdslen(value->ptr) > server.list_max_ziplist_value)
+            {
+                xm_free(zl);
+                return;
+            }
+            value = getDecodedObject(value);
+            zl = ziplistPush(zl, value->ptr, sdslen(value->ptr), ZIPLIST_TAIL);
+            decrRefCount(value);
+        }
+
+        listRelease(subject->ptr);
+        subject->encoding = REDIS_ENCODING_ZIPLIST;
+        subject->ptr = zl;
+    }
+}
+
+void listTypeReplyRange(redisClient *c, robj *subject, long start, long end)
+{
+    long llen;
+    long rangelen;
+
+    listTypeAdapt(subject, 0);
+    llen = listTypeLength(subject);
+
+    // 将负数索引转换成正数索引
+    if (start < 0)
+        start = llen + start;
+    if (end < 0)
+        end = llen + end;
+    if (start < 0)
+        start = 0;
+
+    // 起始索引大于结束索引，或者起始索引越界，回复空列表
+    if (start > end || start >= llen)
+    {
+        addReplyMultiBulkLen(c, 0);
+        return;
+    }
+    if (end >= llen)
+        end = llen - 1;
+    rangelen = (end - start) + 1;
+
+    addReplyMultiBulkLen(c, rangelen);
+
+    if (subject->encoding == REDIS_ENCODING_ZIPLIST)
+    {
+        unsigned char *zl = subject->ptr;
+        unsigned char *p = ziplistSkipIndexSeek(objectGetSkipIndex(subject), zl, start);
+
+        // 节点的值直接复制到输出缓冲区
+        while (rangelen--)
+        {
+            addReplyZiplistEntry(c, p);
+            p = ziplistNext(zl, p);
+        }
+    }
+    else if (subject->encoding == REDIS_ENCODING_LINKEDLIST)
+    {
+        listNode *ln;
+
+        // 如果起始索引更靠近表尾，那么从表尾开始查找
+        if (start > llen / 2)
+            start -= llen;
+        if (llen >= REDIS_LIST_INDEX_MIN_ENTRIES)
+            listEnableIndex(subject->ptr);
+        ln = listIndex(subject->ptr, start);
+
+        while (rangelen--)
+        {
+            addReplyBulk(c, listNodeValue(ln));
+            ln = ln->next;
+        }
+    }
+    else
+    {
+        //redisPanic("Unknown list encoding");
+    }
+}
@@ -8,6 +8,9 @@
 #include "xmclient.h"
 
 
+// 双端链表编码的列表节点数量达到这个值时，第一次按位置访问就为其建立位置索引
+#define REDIS_LIST_INDEX_MIN_ENTRIES 1024
+
 //列表迭代器对象
 typedef struct
 {
@@ -21,6 +24,8 @@ typedef struct
     unsigned char *zi;
     // 链表节点的指针，迭代双端链表编码的列表时使用
     listNode *ln;
+    // ln 在链表中的位置，在中间插入和删除时用来原地更新位置索引
+    long index;
 } listTypeIterator;
 
 // 迭代列表时使用的记录结构，用于保存迭代器，以及迭代器返回的列表节点。
@@ -32,6 +37,8 @@ typedef struct
     unsigned char *zi;
     // 双端链表节点指针
     listNode *ln;
+    // ln 在链表中的位置
+    long index;
 } listTypeEntry;
 
 
@@ -66,5 +73,8 @@ void listTypeInsert(listTypeEntry *entry, robj *value, int where);
 int listTypeEqual(listTypeEntry *entry, robj *o);
 // 删除 entry 所指向的节点
 void listTypeDelete(listTypeEntry *entry);
-//  将列表的底层编码从压缩列表转换成双端链表
+//  在压缩列表和双端链表之间转换列表的底层编码，转换成压缩列表时有过长的值则保持不变
 void listTypeConvert(robj *subject, int enc);
+// 将列表 [start, end] 范围内的元素回复给客户端，索引规则和 LRANGE 相同
+// ziplist 编码时直接从节点的字节中生成回复，不会为元素创建对象
+void listTypeReplyRange(redisClient *c, robj *subject, long start, long end);
@@ -1,5 +1,9 @@
 #include "xmt_set.h"
 #include "xmmalloc.h"
+#include "xmadaptive.h"
+#include "xmrand.h"
+
+#include <string.h>
 
 dictType setDictType = {
     dictEncObjHash,            /* hash function */
@@ -26,6 +30,26 @@ robj *createIntsetObject(void)
     return o;
 }
 
+void freeSetObject(robj *o)
+{
+    switch (o->encoding)
+    {
+    case REDIS_ENCODING_HT:
+        dictRelease((dict *)o->ptr);
+        break;
+    case REDIS_ENCODING_INTSET:
+        xm_free(o->ptr);
+        break;
+    case REDIS_ENCODING_ROARING:
+        roaringFree(o->ptr);
+        break;
+    default:
+        // redisPanic("Unknown set encoding type");
+        break;
+    }
+    objectFreeAccess(o);
+}
+
 robj *setTypeCreate(robj *value)
 {
     if (isObjectRepresentableAsLongLong(value, NULL) == REDIS_OK)
@@ -36,6 +60,8 @@ robj *setTypeCreate(robj *value)
 int setTypeAdd(robj *subject, robj *value)
 {
     long long llval;
+
+    objectTrackAccess(subject, 1);
     // 字典
     if (subject->encoding == REDIS_ENCODING_HT)
     {
@@ -57,9 +83,10 @@ int setTypeAdd(robj *subject, robj *value)
             if (success)
             {
                 // 添加成功
-                // 检查集合在添加新元素之后是否需要转换为字典
-                if (intsetLen(subject->ptr) > server.set_max_intset_entries)
-                    setTypeConvert(subject, REDIS_ENCODING_HT);
+                // 检查集合在添加新元素之后是否需要转换
+                // 元素都是整数，改用压缩位图，比字典省得多。自适应模式下热键会更早转换
+                if (objectEncodingExceeds(subject, intsetLen(subject->ptr), server.set_max_intset_entries))
+                    setTypeConvert(subject, REDIS_ENCODING_ROARING);
                 return 1;
             }
         }
@@ -74,6 +101,22 @@ int setTypeAdd(robj *subject, robj *value)
             return 1;
         }
     }
+    // 压缩位图
+    else if (subject->encoding == REDIS_ENCODING_ROARING)
+    {
+        if (isObjectRepresentableAsLongLong(value, &llval) == REDIS_OK)
+        {
+            return roaringAdd(subject->ptr, llval);
+        }
+        // 和 intset 一样，遇到不是整数的元素就转换为字典
+        else
+        {
+            setTypeConvert(subject, REDIS_ENCODING_HT);
+            dictAdd(subject->ptr, value, NULL);
+            incrRefCount(value);
+            return 1;
+        }
+    }
     else
     {
         // redisPanic("Unknown set encoding");
@@ -83,6 +126,44 @@ int setTypeAdd(robj *subject, robj *value)
     return 0;
 }
 
+int setTypeAddMany(robj *subject, robj **values, int count)
+{
+    int64_t *llvals;
+    long long llval;
+    uint32_t added;
+    int i;
+
+    if (subject->encoding == REDIS_ENCODING_INTSET && count > 1)
+    {
+        llvals = xm_malloc(sizeof(int64_t) * count);
+        for (i = 0; i < count; i++)
+        {
+            if (isObjectRepresentableAsLongLong(values[i], &llval) != REDIS_OK)
+                break;
+            llvals[i] = llval;
+        }
+        // 全部是整数，一次归并进 intset
+        if (i == count)
+        {
+            objectTrackAccess(subject, 1);
+            subject->ptr = intsetAddMany(subject->ptr, llvals, count, &added);
+            xm_free(llvals);
+            if (objectEncodingExceeds(subject, intsetLen(subject->ptr), server.set_max_intset_entries))
+                setTypeConvert(subject, REDIS_ENCODING_ROARING);
+            return added;
+        }
+        xm_free(llvals);
+        // 有不是整数的值，集合无论如何都要转换为字典，先转换再逐个添加
+        setTypeConvert(subject, REDIS_ENCODING_HT);
+        dictExpand(subject->ptr, setTypeSize(subject) + count);
+    }
+
+    added = 0;
+    for (i = 0; i < count; i++)
+        added += setTypeAdd(subject, values[i]);
+    return added;
+}
+
 int setTypeRemove(robj *setobj, robj *value)
 {
     long long llval;
@@ -109,6 +190,11 @@ int setTypeRemove(robj *setobj, robj *value)
                 return 1;
         }
     }
+    else if (setobj->encoding == REDIS_ENCODING_ROARING)
+    {
+        if (isObjectRepresentableAsLongLong(value, &llval) == REDIS_OK)
+            return roaringRemove(setobj->ptr, llval);
+    }
     else
     {
         // redisPanic("Unknown set encoding");
@@ -122,6 +208,8 @@ int setTypeIsMember(robj *subject, robj *value)
 {
     long long llval;
 
+    objectTrackAccess(subject, 0);
+
     if (subject->encoding == REDIS_ENCODING_HT)
     {
         return dictFind((dict *)subject->ptr, value) != NULL;
@@ -133,6 +221,11 @@ int setTypeIsMember(robj *subject, robj *value)
             return intsetFind((intset *)subject->ptr, llval);
         }
     }
+    else if (subject->encoding == REDIS_ENCODING_ROARING)
+    {
+        if (isObjectRepresentableAsLongLong(value, &llval) == REDIS_OK)
+            return roaringContains((roaring *)subject->ptr, llval);
+    }
     else
     {
         // redisPanic("Unknown set encoding");
@@ -156,6 +249,10 @@ setTypeIterator *setTypeInitIterator(robj *subject)
     {
         si->ii = 0;
     }
+    else if (si->encoding == REDIS_ENCODING_ROARING)
+    {
+        roaringInitIterator(subject->ptr, &si->ri);
+    }
     else
     {
         //redisPanic("Unknown set encoding");
@@ -190,6 +287,11 @@ int setTypeNext(setTypeIterator *si, robj **objele, int64_t *llele)
         if (!intsetGet(si->subject->ptr, si->ii++, llele))
             return -1;
     }
+    else if (si->encoding == REDIS_ENCODING_ROARING)
+    {
+        if (!roaringNext(&si->ri, llele))
+            return -1;
+    }
     // 返回编码
     return si->encoding;
 }
@@ -210,6 +312,7 @@ robj *setTypeNextObject(setTypeIterator *si)
         return NULL;
     // INTSET 返回一个整数值，需要为这个值创建对象
     case REDIS_ENCODING_INTSET:
+    case REDIS_ENCODING_ROARING:
         return createStringObjectFromLongLong(intele);
     // HT 本身已经返回对象了，只需执行 incrRefCount()
     case REDIS_ENCODING_HT:
@@ -234,6 +337,10 @@ int setTypeRandomElement(robj *setobj, robj **objele, int64_t *llele)
     {
         *llele = intsetRandom(setobj->ptr);
     }
+    else if (setobj->encoding == REDIS_ENCODING_ROARING)
+    {
+        *llele = roaringRandom(setobj->ptr);
+    }
     else
     {
         // redisPanic("Unknown set encoding");
@@ -253,6 +360,10 @@ unsigned long setTypeSize(robj *subject)
     {
         return intsetLen((intset *)subject->ptr);
     }
+    else if (subject->encoding == REDIS_ENCODING_ROARING)
+    {
+        return roaringCard((roaring *)subject->ptr);
+    }
     else
     {
         // redisPanic("Unknown set encoding");
@@ -272,7 +383,7 @@ void setTypeConvert(robj *setobj, int enc)
         robj *element;
 
         // 预先扩展空间
-        dictExpand(d, intsetLen(setobj->ptr));
+        dictExpand(d, setTypeSize(setobj));
 
         // 遍历集合，并将元素添加到字典中
         si = setTypeInitIterator(setobj);
@@ -283,14 +394,582 @@ void setTypeConvert(robj *setobj, int enc)
         }
         setTypeReleaseIterator(si);
 
-        // 更新集合的编码
+        // 释放原来的集合，更新集合的编码和值对象
+        freeSetObject(setobj);
         setobj->encoding = REDIS_ENCODING_HT;
-        xm_free(setobj->ptr);
-        // 更新集合的值对象
         setobj->ptr = d;
     }
+    else if (enc == REDIS_ENCODING_ROARING && setobj->encoding == REDIS_ENCODING_INTSET)
+    {
+        roaring *r = roaringNew();
+        int64_t intele;
+        uint32_t i;
+
+        // intset 是有序的，元素总是追加到最后一个容器的末尾
+        for (i = 0; intsetGet(setobj->ptr, i, &intele); i++)
+            roaringAdd(r, intele);
+
+        xm_free(setobj->ptr);
+        setobj->encoding = REDIS_ENCODING_ROARING;
+        setobj->ptr = r;
+    }
     else
     {
         //redisPanic("Unsupported set conversion");
     }
 }
+
+/**************************多集合交集****************************************/
+
+// 最小的集合中的元素到另一个集合中的探测方式
+#define SET_PROBE_INTSET 0  // 整数在 intset 中查找
+#define SET_PROBE_ROARING 1 // 整数在压缩位图中查找
+#define SET_PROBE_DICT 2    // 对象或整数在字典中查找
+
+static int setTypeSizeCompare(const void *a, const void *b)
+{
+    unsigned long sa = setTypeSize(*(robj **)a), sb = setTypeSize(*(robj **)b);
+    return (sa > sb) - (sa < sb);
+}
+
+// 在集合 set 中查找元素，objele 为 NULL 时按整数 llele 查找
+static int setTypeProbe(robj *set, int probe, robj *objele, int64_t llele)
+{
+    long long llval;
+
+    if (objele != NULL && probe != SET_PROBE_DICT)
+    {
+        // 不能表示为整数的对象一定不在整数集合中
+        if (isObjectRepresentableAsLongLong(objele, &llval) != REDIS_OK)
+            return 0;
+        llele = llval;
+    }
+
+    if (probe == SET_PROBE_INTSET)
+    {
+        return intsetFind(set->ptr, llele);
+    }
+    else if (probe == SET_PROBE_ROARING)
+    {
+        return roaringContains(set->ptr, llele);
+    }
+    else if (objele != NULL)
+    {
+        return dictFind(set->ptr, objele) != NULL;
+    }
+    else
+    {
+        // 整数编码的字符串对象，只在栈上使用，比较时不会被释放
+        robj tmp;
+        tmp.type = REDIS_STRING;
+        tmp.encoding = REDIS_ENCODING_INT;
+        tmp.refcount = 1;
+        tmp.ptr = (void *)(long)llele;
+        return dictFind(set->ptr, &tmp) != NULL;
+    }
+}
+
+unsigned long setTypeInter(robj **sets, int setnum, setTypeMemberProc *proc, void *privdata)
+{
+    robj *stackbuf[16], **sorted;
+    int stackprobe[16], *probes;
+    unsigned long count = 0;
+    int i, allintset = 1;
+
+    if (setnum == 0)
+        return 0;
+    // 有一个集合为空，交集就是空集
+    for (i = 0; i < setnum; i++)
+    {
+        if (sets[i] == NULL || setTypeSize(sets[i]) == 0)
+            return 0;
+        if (sets[i]->encoding != REDIS_ENCODING_INTSET)
+            allintset = 0;
+    }
+
+    sorted = setnum <= 16 ? stackbuf : xm_malloc(sizeof(robj *) * setnum);
+    probes = setnum <= 16 ? stackprobe : xm_malloc(sizeof(int) * setnum);
+    memcpy(sorted, sets, sizeof(robj *) * setnum);
+    qsort(sorted, setnum, sizeof(robj *), setTypeSizeCompare);
+
+    if (allintset)
+    {
+        // 全部是 intset ，归并的结果本身就是有序的整数数组
+        intset **iss = xm_malloc(sizeof(intset *) * setnum), *res;
+        int64_t v;
+        uint32_t j;
+
+        for (i = 0; i < setnum; i++)
+            iss[i] = sorted[i]->ptr;
+        res = intsetIntersect(iss, setnum);
+        for (j = 0; intsetGet(res, j, &v); j++)
+            proc(privdata, NULL, v);
+        count = intsetLen(res);
+        xm_free(res);
+        xm_free(iss);
+    }
+    else
+    {
+        setTypeIterator *si;
+        robj *objele;
+        int64_t llele;
+        int encoding;
+
+        // 每个集合的探测方式只由它的编码决定，事先选好
+        for (i = 1; i < setnum; i++)
+        {
+            if (sorted[i]->encoding == REDIS_ENCODING_INTSET)
+                probes[i] = SET_PROBE_INTSET;
+            else if (sorted[i]->encoding == REDIS_ENCODING_ROARING)
+                probes[i] = SET_PROBE_ROARING;
+            else
+                probes[i] = SET_PROBE_DICT;
+        }
+
+        // 遍历最小的集合，其他集合从小到大探测，越早失败越省事
+        si = setTypeInitIterator(sorted[0]);
+        while ((encoding = setTypeNext(si, &objele, &llele)) != -1)
+        {
+            if (encoding != REDIS_ENCODING_HT)
+                objele = NULL;
+            for (i = 1; i < setnum; i++)
+                if (!setTypeProbe(sorted[i], probes[i], objele, llele))
+                    break;
+            if (i == setnum)
+            {
+                proc(privdata, objele, llele);
+                count++;
+            }
+        }
+        setTypeReleaseIterator(si);
+    }
+
+    if (sorted != stackbuf)
+        xm_free(sorted);
+    if (probes != stackprobe)
+        xm_free(probes);
+    return count;
+}
+
+static void setTypeReplyMember(void *privdata, robj *objele, int64_t llele)
+{
+    redisClient *c = privdata;
+
+    if (objele != NULL)
+        addReplyBulk(c, objele);
+    else
+        addReplyBulkLongLong(c, llele);
+}
+
+void setTypeInterReply(redisClient *c, robj **sets, int setnum)
+{
+    // 交集的大小事先不知道，先占位，算完之后再填
+    void *replylen = addDeferredMultiBulkLength(c);
+    unsigned long count = setTypeInter(sets, setnum, setTypeReplyMember, c);
+    setDeferredMultiBulkLength(c, replylen, count);
+}
+
+// setTypeInterStore 的中间状态
+typedef struct setInterStoreState
+{
+    // 结果集合
+    robj *dst;
+    // 还没有加入 dst 的整数元素
+    int64_t *ints;
+    unsigned long len, cap;
+} setInterStoreState;
+
+static void setTypeStoreMember(void *privdata, robj *objele, int64_t llele)
+{
+    setInterStoreState *st = privdata;
+    long long llval;
+
+    // 不能表示为整数的对象直接加入，集合会在第一次遇到时转换为字典
+    if (objele != NULL)
+    {
+        if (isObjectRepresentableAsLongLong(objele, &llval) != REDIS_OK)
+        {
+            setTypeAdd(st->dst, objele);
+            return;
+        }
+        llele = llval;
+    }
+    if (st->len == st->cap)
+    {
+        st->cap = st->cap ? st->cap * 2 : 16;
+        st->ints = xm_realloc(st->ints, sizeof(int64_t) * st->cap);
+    }
+    st->ints[st->len++] = llele;
+}
+
+robj *setTypeInterStore(robj **sets, int setnum)
+{
+    setInterStoreState st;
+    unsigned long i;
+
+    st.dst = createIntsetObject();
+    st.ints = NULL;
+    st.len = st.cap = 0;
+    setTypeInter(sets, setnum, setTypeStoreMember, &st);
+
+    if (st.dst->encoding == REDIS_ENCODING_INTSET)
+    {
+        st.dst->ptr = intsetAddMany(st.dst->ptr, st.ints, st.len, NULL);
+        if (intsetLen(st.dst->ptr) > server.set_max_intset_entries)
+            setTypeConvert(st.dst, REDIS_ENCODING_ROARING);
+    }
+    else
+    {
+        // 已经是字典，整数只能创建对象之后加入
+        for (i = 0; i < st.len; i++)
+        {
+            robj *o = createStringObjectFromLongLong(st.ints[i]);
+            setTypeAdd(st.dst, o);
+            decrRefCount(o);
+        }
+    }
+    xm_free(st.ints);
+    return st.dst;
+}
+
+/**************************批量随机取样****************************************/
+
+// count * SET_RANDOM_DENSE_RATIO 超过集合大小时，一次遍历整个集合完成取样，
+// 否则随机定位元素，重复的直接跳过
+#define SET_RANDOM_DENSE_RATIO 3
+
+
+static int setIndexCompare(const void *a, const void *b)
+{
+    uint64_t ia = *(const uint64_t *)a, ib = *(const uint64_t *)b;
+    return (ia > ib) - (ia < ib);
+}
+
+// 从 [0, size) 中均匀地选出 count 个不同的下标，按从小到大的顺序返回，count 不能超过 size
+// 选出的下标较多时逐个决定每个下标是否入选（Knuth 的选择取样），
+// 较少时用 Floyd 算法，只需要 count 次随机数，用开放寻址的散列表判重
+static uint64_t *setSampleIndexes(uint64_t size, unsigned long count)
+{
+    uint64_t *idx = xm_malloc(sizeof(uint64_t) * (count ? count : 1));
+    uint64_t i, j, t, *slots, mask;
+    unsigned long n = 0;
+
+    if (count * SET_RANDOM_DENSE_RATIO > size)
+    {
+        for (i = 0; i < size && n < count; i++)
+        {
+            // 剩下 size - i 个下标中还要选 count - n 个
+            if (xm_random_below(size - i) < count - n)
+                idx[n++] = i;
+        }
+        return idx;
+    }
+
+    for (mask = 16; mask < count * 2; mask *= 2)
+        ;
+    slots = xm_calloc(mask * sizeof(uint64_t));
+    mask--;
+    for (j = size - count; j < size; j++)
+    {
+        // 槽中保存下标加一，0 表示空槽
+        t = xm_random_below(j + 1);
+        for (i = (t * 0x9e3779b97f4a7c15ULL) >> 7 & mask; slots[i] != 0 && slots[i] != t + 1; i = (i + 1) & mask)
+            ;
+        // t 已经入选就改选 j ，j 之前从未出现过
+        if (slots[i] != 0)
+        {
+            t = j;
+            for (i = (t * 0x9e3779b97f4a7c15ULL) >> 7 & mask; slots[i] != 0; i = (i + 1) & mask)
+                ;
+        }
+        slots[i] = t + 1;
+        idx[n++] = t;
+    }
+    xm_free(slots);
+    qsort(idx, n, sizeof(uint64_t), setIndexCompare);
+    return idx;
+}
+
+// 从字典中随机取出 count 个不同的节点保存到 des ，count 必须小于字典大小
+// 用开放寻址的散列表去掉已经取过的节点，count 不超过字典大小的 1/3 ，重复的概率不高
+static void setSampleDictEntries(dict *d, dictEntry **des, unsigned long count)
+{
+    dictEntry *de, **slots;
+    unsigned long n = 0, mask, i;
+
+    for (mask = 16; mask < count * 2; mask *= 2)
+        ;
+    slots = xm_calloc(mask * sizeof(dictEntry *));
+    mask--;
+    while (n < count)
+    {
+        de = dictGetRandomKey(d);
+        for (i = ((uintptr_t)de >> 4) * 0x9e3779b97f4a7c15ULL >> 7 & mask;
+             slots[i] != NULL && slots[i] != de; i = (i + 1) & mask)
+            ;
+        if (slots[i] == NULL)
+        {
+            slots[i] = de;
+            des[n++] = de;
+        }
+    }
+    xm_free(slots);
+}
+
+// 把集合中的所有元素交给 proc
+static unsigned long setTypeEmitAll(robj *set, setTypeMemberProc *proc, void *privdata)
+{
+    setTypeIterator *si = setTypeInitIterator(set);
+    unsigned long n = 0;
+    robj *objele;
+    int64_t llele;
+
+    while (setTypeNext(si, &objele, &llele) != -1)
+    {
+        proc(privdata, set->encoding == REDIS_ENCODING_HT ? objele : NULL, llele);
+        n++;
+    }
+    setTypeReleaseIterator(si);
+    return n;
+}
+
+unsigned long setTypeRandomElements(robj *set, unsigned long count, setTypeMemberProc *proc, void *privdata)
+{
+    unsigned long size = setTypeSize(set), i;
+    uint64_t *idx;
+    int64_t llele;
+
+    if (count >= size)
+        return setTypeEmitAll(set, proc, privdata);
+    if (count == 0)
+        return 0;
+
+    if (set->encoding == REDIS_ENCODING_INTSET)
+    {
+        // 直接按下标取出
+        idx = setSampleIndexes(size, count);
+        for (i = 0; i < count; i++)
+        {
+            intsetGet(set->ptr, idx[i], &llele);
+            proc(privdata, NULL, llele);
+        }
+        xm_free(idx);
+    }
+    else if (set->encoding == REDIS_ENCODING_ROARING)
+    {
+        int64_t *values = xm_malloc(sizeof(int64_t) * count);
+
+        idx = setSampleIndexes(size, count);
+        roaringSelectMany(set->ptr, idx, count, values);
+        for (i = 0; i < count; i++)
+            proc(privdata, NULL, values[i]);
+        xm_free(values);
+        xm_free(idx);
+    }
+    else if (set->encoding == REDIS_ENCODING_HT)
+    {
+        if (count * SET_RANDOM_DENSE_RATIO > size)
+        {
+            // 遍历字典，每个元素按还需要的个数和剩下的个数决定是否入选
+            dictIterator *di = dictGetIterator(set->ptr);
+            dictEntry *de;
+            unsigned long seen = 0, n = 0;
+
+            while (n < count && (de = dictNext(di)) != NULL)
+            {
+                if (xm_random_below(size - seen++) < count - n)
+                {
+                    proc(privdata, dictGetKey(de), 0);
+                    n++;
+                }
+            }
+            dictReleaseIterator(di);
+        }
+        else
+        {
+            dictEntry **des = xm_malloc(sizeof(dictEntry *) * count);
+
+            setSampleDictEntries(set->ptr, des, count);
+            for (i = 0; i < count; i++)
+                proc(privdata, dictGetKey(des[i]), 0);
+            xm_free(des);
+        }
+    }
+    else
+    {
+        // redisPanic("Unknown set encoding");
+    }
+    return count;
+}
+
+// 清空集合，保持原来的编码
+static void setTypeClear(robj *set)
+{
+    if (set->encoding == REDIS_ENCODING_INTSET)
+    {
+        xm_free(set->ptr);
+        set->ptr = intsetNew();
+    }
+    else if (set->encoding == REDIS_ENCODING_ROARING)
+    {
+        roaringFree(set->ptr);
+        set->ptr = roaringNew();
+    }
+    else if (set->encoding == REDIS_ENCODING_HT)
+    {
+        dictRelease(set->ptr);
+        set->ptr = dictCreate(&setDictType, NULL);
+    }
+}
+
+// 弹出的字典元素交给 proc 之后随即从集合中删除并减少引用计数，proc 只能在调用期间使用 objele
+unsigned long setTypePopRandom(robj *set, unsigned long count, setTypeMemberProc *proc, void *privdata)
+{
+    unsigned long size = setTypeSize(set), i;
+    uint64_t *idx;
+
+    if (count >= size)
+    {
+        count = setTypeEmitAll(set, proc, privdata);
+        setTypeClear(set);
+        return count;
+    }
+    if (count == 0)
+        return 0;
+
+    if (set->encoding == REDIS_ENCODING_INTSET)
+    {
+        // 选中的下标本来就是有序的，取出元素之后一次删除
+        uint32_t *pos = xm_malloc(sizeof(uint32_t) * count);
+        int64_t llele;
+
+        idx = setSampleIndexes(size, count);
+        for (i = 0; i < count; i++)
+        {
+            pos[i] = idx[i];
+            intsetGet(set->ptr, pos[i], &llele);
+            proc(privdata, NULL, llele);
+        }
+        set->ptr = intsetRemovePositions(set->ptr, pos, count);
+        xm_free(pos);
+        xm_free(idx);
+    }
+    else if (set->encoding == REDIS_ENCODING_ROARING)
+    {
+        int64_t *values = xm_malloc(sizeof(int64_t) * count);
+
+        // 先按排位取出全部元素，再删除，删除会改变后面元素的排位
+        idx = setSampleIndexes(size, count);
+        roaringSelectMany(set->ptr, idx, count, values);
+        for (i = 0; i < count; i++)
+        {
+            proc(privdata, NULL, values[i]);
+            roaringRemove(set->ptr, values[i]);
+        }
+        xm_free(values);
+        xm_free(idx);
+    }
+    else if (set->encoding == REDIS_ENCODING_HT)
+    {
+        if (count * SET_RANDOM_DENSE_RATIO > size)
+        {
+            // 弹出的元素很多时，把留下的元素复制到新字典，比逐个删除更快
+            dict *keep = dictCreate(&setDictType, NULL);
+            dictIterator *di = dictGetIterator(set->ptr);
+            dictEntry *de;
+            unsigned long seen = 0, n = 0;
+
+            dictExpand(keep, size - count);
+            while ((de = dictNext(di)) != NULL)
+            {
+                robj *objele = dictGetKey(de);
+
+                if (n < count && xm_random_below(size - seen) < count - n)
+                {
+                    proc(privdata, objele, 0);
+                    n++;
+                }
+                else
+                {
+                    dictAdd(keep, objele, NULL);
+                    incrRefCount(objele);
+                }
+                seen++;
+            }
+            dictReleaseIterator(di);
+            dictRelease(set->ptr);
+            set->ptr = keep;
+        }
+        else
+        {
+            dictEntry **des = xm_malloc(sizeof(dictEntry *) * count);
+
+            setSampleDictEntries(set->ptr, des, count);
+            for (i = 0; i < count; i++)
+            {
+                proc(privdata, dictGetKey(des[i]), 0);
+                dictDelete(set->ptr, dictGetKey(des[i]));
+            }
+            xm_free(des);
+            if (htNeedsResize(set->ptr))
+                dictResize(set->ptr);
+        }
+    }
+    else
+    {
+        // redisPanic("Unknown set encoding");
+    }
+    return count;
+}
+
+void setTypeRandomReply(redisClient *c, robj *set, long count)
+{
+    robj *objele;
+    int64_t llele;
+    long i;
+
+    // count 为负数时元素可以重复，逐个随机取出
+    if (count < 0)
+    {
+        addReplyMultiBulkLen(c, -count);
+        for (i = 0; i < -count; i++)
+        {
+            if (setTypeRandomElement(set, &objele, &llele) == REDIS_ENCODING_HT)
+                addReplyBulk(c, objele);
+            else
+                addReplyBulkLongLong(c, llele);
+        }
+        return;
+    }
+
+    addReplyMultiBulkLen(c, (unsigned long)count < setTypeSize(set) ? count : (long)setTypeSize(set));
+    setTypeRandomElements(set, count, setTypeReplyMember, c);
+}
+
+void setTypePopReply(redisClient *c, robj *set, long count)
+{
+    if (count < 0)
+    {
+        addReplyError(c, "index out of range");
+        return;
+    }
+    addReplyMultiBulkLen(c, (unsigned long)count < setTypeSize(set) ? count : (long)setTypeSize(set));
+    setTypePopRandom(set, count, setTypeReplyMember, c);
+}
+
+void sscanCommand(redisClient *c)
+{
+    robj *o;
+    unsigned long cursor;
+
+    if (parseScanCursorOrReply(c, c->argv[2], &cursor) == REDIS_ERR)
+        return;
+    if ((o = lookupKeyReadOrReply(c, c->argv[1], shared.emptyscan)) == NULL)
+        return;
+    if (o->type != REDIS_SET)
+    {
+        addReply(c, shared.wrongtypeerr);
+        return;
+    }
+    scanGenericCommand(c, o, cursor);
+}
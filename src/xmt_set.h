@@ -3,12 +3,14 @@
 
 #include "xmobject.h"
 #include "xmintset.h"
+#include "xmroaring.h"
 #include "xmdict.h"
 
 #include "xmt_string.h"
 
 #include "xmredis.h"
 #include "xmserver.h"
+#include "xmclient.h"
 
 // 集合对象的迭代器
 typedef struct
@@ -21,6 +23,8 @@ typedef struct
     int ii; 
     // 字典迭代器，编码为 HT 时使用
     dictIterator *di;
+    // 压缩位图迭代器，编码为 ROARING 时使用
+    roaringIterator ri;
 } setTypeIterator;
 
 // 创建一个字典编码的集合对象。
@@ -35,6 +39,9 @@ void freeSetObject(robj *o);
 robj *setTypeCreate(robj *value);
 // 在集合中添加一个对象。添加成功返回 1 ，如果元素已经存在，返回 0
 int setTypeAdd(robj *subject, robj *value);
+// 在集合中添加 count 个对象，返回实际添加的个数，用于多个参数的 SADD
+// INTSET 编码并且所有值都是整数时，用 intsetAddMany 一次归并完成
+int setTypeAddMany(robj *subject, robj **values, int count);
 // 在集合中删除一个对象。删除成功返回 1 ，因为元素不存在而导致删除失败返回 0
 int setTypeRemove(robj *subject, robj *value);
 // 判断对象是否在集合中，查找成功返回1，失败返回0
@@ -57,8 +64,42 @@ robj *setTypeNextObject(setTypeIterator *si);
 // 从非空集合中随机取出一个元素。
 int setTypeRandomElement(robj *setobj, robj **objele, int64_t *llele);
 unsigned long setTypeSize(robj *subject);
-// 将集合对象 setobj 的编码转换为 REDIS_ENCODING_HT 
-// 新创建的结果字典会被预先分配为和原来的集合一样大。
+// 将集合对象 setobj 的编码转换为 enc
+// 可以从 INTSET 或 ROARING 转换为 REDIS_ENCODING_HT ，新创建的结果字典会被预先分配为和原来的集合一样大。
+// 也可以从 INTSET 转换为 REDIS_ENCODING_ROARING
 void setTypeConvert(robj *subject, int enc);
 
+/**************************多集合交集****************************************/
+
+// 交集中的每个元素都会传给这个回调
+// 元素来自 INTSET 或 ROARING 编码的集合时 objele 为 NULL ，值保存在 llele 中，
+// 否则 objele 指向集合中的对象，没有增加引用计数
+typedef void setTypeMemberProc(void *privdata, robj *objele, int64_t llele);
+
+// 求 sets[0..setnum) 的交集，结果逐个交给 proc ，返回交集的元素个数，sets 中的元素可以为 NULL （空集合）
+// 集合按 setTypeSize 从小到大排序，遍历最小的集合，到其他集合中探测；
+// 探测方式按每对集合的编码事先选好：全部是 intset 时直接归并，整数探测 intset/压缩位图，
+// 对象探测字典，整数探测字典时用栈上的整数对象，不分配内存
+unsigned long setTypeInter(robj **sets, int setnum, setTypeMemberProc *proc, void *privdata);
+// 把交集作为多条批量回复发送给客户端，元素边计算边写入回复
+void setTypeInterReply(redisClient *c, robj **sets, int setnum);
+// 把交集保存到一个新的集合对象中返回，整数元素攒在一起用 intsetAddMany 一次加入
+robj *setTypeInterStore(robj **sets, int setnum);
+
+/**************************批量随机取样****************************************/
+
+// 随机取出 count 个不同的元素逐个交给 proc ，count 不小于集合大小时取出全部元素，返回取出的元素个数
+// intset 和压缩位图按下标取样，字典成批取出随机节点；count 接近集合大小时改为遍历一次集合
+unsigned long setTypeRandomElements(robj *set, unsigned long count, setTypeMemberProc *proc, void *privdata);
+// 随机弹出 count 个不同的元素逐个交给 proc ，返回弹出的元素个数
+// objele 在 proc 返回之后就可能被集合释放，proc 要保留元素时必须自己 incrRefCount 或者复制一份
+unsigned long setTypePopRandom(robj *set, unsigned long count, setTypeMemberProc *proc, void *privdata);
+// SRANDMEMBER key count 的回复，count 为负数时元素可以重复
+void setTypeRandomReply(redisClient *c, robj *set, long count);
+// SPOP key count 的回复
+void setTypePopReply(redisClient *c, robj *set, long count);
+
+// SSCAN key cursor [COUNT count]
+void sscanCommand(redisClient *c);
+
 #endif
\ No newline at end of file
@@ -6,6 +6,9 @@
 #include <stdlib.h>
 #include <math.h>
 #include <errno.h>
+#include <limits.h>
+#include <string.h>
+#include <ctype.h>
 
 robj *createRawStringObject(char *ptr, size_t len)
 {
@@ -1,6 +1,14 @@
 #include "xmt_zset.h"
+#include "xmt_set.h"
+#include "xmnotify.h"
 #include "xmmalloc.h"
 
+#include <assert.h>
+#include <math.h>
+#include <string.h>
+#include <strings.h>
+
+// BTREE 和 TSERIES 编码的字典，键是成员对象，和 B+ 树（块序列）各持有一个引用，值是分值
 dictType zsetDictType = {
     dictEncObjHash,            /* hash function */
     NULL,                      /* key dup */
@@ -10,17 +18,73 @@ dictType zsetDictType = {
     NULL                       /* val destructor */
 };
 
+// SKIPLIST 编码的字典，键是跳跃表节点中嵌入的成员对象，也就是节点本身，没有值
+// 键的内存属于跳跃表节点，字典不负责释放
+dictType zsetNodeDictType = {
+    dictEncObjHash,       /* hash function */
+    NULL,                 /* key dup */
+    NULL,                 /* val dup */
+    dictEncObjKeyCompare, /* key compare */
+    NULL,                 /* key destructor */
+    NULL                  /* val destructor */
+};
+
 robj *createZsetObject(void)
 {
     zset *zs = xm_malloc(sizeof(*zs));
     robj *o;
-    zs->dict = dictCreate(&zsetDictType, NULL);
+    zs->dict = dictCreate(&zsetNodeDictType, NULL);
     zs->zsl = zslCreate();
+    zs->zbt = NULL;
+    zs->zts = NULL;
+    zs->zlx = NULL;
     o = createObject(REDIS_ZSET, zs);
     o->encoding = REDIS_ENCODING_SKIPLIST;
     return o;
 }
 
+robj *createZsetBtreeObject(void)
+{
+    zset *zs = xm_malloc(sizeof(*zs));
+    robj *o;
+    zs->dict = dictCreate(&zsetDictType, NULL);
+    zs->zsl = NULL;
+    zs->zbt = zbtCreate();
+    zs->zts = NULL;
+    zs->zlx = NULL;
+    o = createObject(REDIS_ZSET, zs);
+    o->encoding = REDIS_ENCODING_BTREE;
+    return o;
+}
+
+robj *createZsetTseriesObject(void)
+{
+    zset *zs = xm_malloc(sizeof(*zs));
+    robj *o;
+    zs->dict = dictCreate(&zsetDictType, NULL);
+    zs->zsl = NULL;
+    zs->zbt = NULL;
+    zs->zts = ztsCreate();
+    zs->zlx = NULL;
+    o = createObject(REDIS_ZSET, zs);
+    o->encoding = REDIS_ENCODING_TSERIES;
+    return o;
+}
+
+robj *createZsetLexsetObject(double score)
+{
+    zset *zs = xm_malloc(sizeof(*zs));
+    robj *o;
+    zs->dict = NULL;
+    zs->zsl = NULL;
+    zs->zbt = NULL;
+    zs->zts = NULL;
+    zs->zlx = zlxCreate(score);
+    o = createObject(REDIS_ZSET, zs);
+    o->encoding = REDIS_ENCODING_LEXSET;
+    return o;
+}
+
 // 创建一个 ZIPLIST 编码的有序集合
 robj *createZsetZiplistObject(void)
 {
@@ -41,7 +105,25 @@ void freeZsetObject(robj *o)
         zslFree(zs->zsl);
         xm_free(zs);
         break;
+    case REDIS_ENCODING_BTREE:
+        zs = o->ptr;
+        dictRelease(zs->dict);
+        zbtFree(zs->zbt);
+        xm_free(zs);
+        break;
+    case REDIS_ENCODING_TSERIES:
+        zs = o->ptr;
+        dictRelease(zs->dict);
+        ztsFree(zs->zts);
+        xm_free(zs);
+        break;
+    case REDIS_ENCODING_LEXSET:
+        zs = o->ptr;
+        zlxFree(zs->zlx);
+        xm_free(zs);
+        break;
     case REDIS_ENCODING_ZIPLIST:
+        objectFreeSkipIndex(o);
         xm_free(o->ptr);
         break;
     default:
@@ -436,10 +518,9 @@ unsigned char *zzlInsertAt(unsigned char *zl, unsigned char *eptr, robj *ele, do
     return zl;
 }
 
-/* 将 ele 成员和它的分值 score 添加到 ziplist 里面
- * ziplist 里的各个节点按 score 值从小到大排列
- * 这个函数假设 elem 不存在于有序集*/
-unsigned char *zzlInsert(unsigned char *zl, robj *ele, double score)
+/* 和 zzlInsert 相同，并把新元素的成员节点在 ziplist 中的偏移量保存到 *offset 中，
+ * 调用者用它让插入位置之后的跳跃索引失效 */
+static unsigned char *zzlInsertWithOffset(unsigned char *zl, robj *ele, double score, size_t *offset)
 {
 
     // 指向 ziplist 第一个节点
@@ -461,6 +542,7 @@ unsigned char *zzlInsert(unsigned char *zl, robj *ele, double score)
             // 遇到第一个 score 值比输入 score 大的节点
             // 那么将新节点插入在这个节点的前面，
             // 让节点在 ziplist 里根据 score 从小到大排列
+            *offset = eptr - zl;
             zl = zzlInsertAt(zl, eptr, ele, score);
             break;
         }
@@ -472,6 +554,7 @@ unsigned char *zzlInsert(unsigned char *zl, robj *ele, double score)
             // 但如果eptr更小，继续循环，在下一个节点插入
             if (zzlCompareElements(eptr, ele->ptr, sdslen(ele->ptr)) > 0)
             {
+                *offset = eptr - zl;
                 zl = zzlInsertAt(zl, eptr, ele, score);
                 break;
             }
@@ -482,19 +565,36 @@ unsigned char *zzlInsert(unsigned char *zl, robj *ele, double score)
         eptr = ziplistNext(zl, sptr);
     }
 
-    // 如果都没找到，到了队尾
+    // 如果都没找到，到了队尾，新节点占据原来表尾标记的位置
     if (eptr == NULL)
+    {
+        *offset = ziplistBlobLen(zl) - 1;
         zl = zzlInsertAt(zl, NULL, ele, score);
+    }
 
     decrRefCount(ele);
     return zl;
 }
 
-unsigned char *zzlDeleteRangeByScore(unsigned char *zl, zrangespec *range, unsigned long *deleted)
+/* 将 ele 成员和它的分值 score 添加到 ziplist 里面
+ * ziplist 里的各个节点按 score 值从小到大排列
+ * 这个函数假设 elem 不存在于有序集*/
+unsigned char *zzlInsert(unsigned char *zl, robj *ele, double score)
+{
+    size_t offset;
+
+    return zzlInsertWithOffset(zl, ele, score, &offset);
+}
+
+/* 删除 ziplist 中分值在给定范围内的元素，si 为 ziplist 的跳跃索引，可以为 NULL 。
+ * 第一个被删除的节点之后的索引槽会失效，由这个函数负责截掉。
+ * 如果 deleted 不为 NULL ，那么在删除操作完成之后，将删除元素的数量保存到 *deleted 中*/
+unsigned char *zzlDeleteRangeByScore(unsigned char *zl, zlSkipIndex *si, zrangespec *range, unsigned long *deleted)
 {
     unsigned char *eptr, *sptr;
     double score;
     unsigned long num = 0;
+    size_t offset;
 
     if (deleted != NULL)
         *deleted = 0;
@@ -503,6 +603,7 @@ unsigned char *zzlDeleteRangeByScore(unsigned char *zl, zrangespec *range, unsig
     eptr = zzlFirstInRange(zl, range);
     if (eptr == NULL)
         return zl;
+    offset = eptr - zl;
 
     // 一直删除节点，直到遇到不在范围内的值为止
     // 节点中的值都是有序的
@@ -524,15 +625,19 @@ unsigned char *zzlDeleteRangeByScore(unsigned char *zl, zrangespec *range, unsig
         }
     }
 
+    if (num)
+        ziplistSkipIndexTouch(si, zl, zl + offset);
     if (deleted != NULL)
         *deleted = num;
     return zl;
 }
 
-unsigned char *zzlDeleteRangeByLex(unsigned char *zl, zlexrangespec *range, unsigned long *deleted)
+/* 删除 ziplist 中成员在给定字典序范围内的元素，si 的用法和 zzlDeleteRangeByScore 相同*/
+unsigned char *zzlDeleteRangeByLex(unsigned char *zl, zlSkipIndex *si, zlexrangespec *range, unsigned long *deleted)
 {
     unsigned char *eptr, *sptr;
     unsigned long num = 0;
+    size_t offset;
 
     if (deleted != NULL)
         *deleted = 0;
@@ -540,6 +645,7 @@ unsigned char *zzlDeleteRangeByLex(unsigned char *zl, zlexrangespec *range, unsi
     eptr = zzlFirstInLexRange(zl, range);
     if (eptr == NULL)
         return zl;
+    offset = eptr - zl;
 
     while ((sptr = ziplistNext(zl, eptr)) != NULL)
     {
@@ -555,6 +661,8 @@ unsigned char *zzlDeleteRangeByLex(unsigned char *zl, zlexrangespec *range, unsi
         }
     }
 
+    if (num)
+        ziplistSkipIndexTouch(si, zl, zl + offset);
     if (deleted != NULL)
         *deleted = num;
 
@@ -563,10 +671,13 @@ unsigned char *zzlDeleteRangeByLex(unsigned char *zl, zlexrangespec *range, unsi
 
 /* 删除 ziplist 中所有在给定排位范围内的元素。
  * start 和 end 索引都是包括在内的。并且它们都以 1 为起始值。
+ * si 的用法和 zzlDeleteRangeByScore 相同，同时用来定位第一个被删除的节点。
  * 如果 deleted 不为 NULL ，那么在删除操作完成之后，将删除元素的数量保存到 *deleted 中*/
-unsigned char *zzlDeleteRangeByRank(unsigned char *zl, unsigned int start, unsigned int end, unsigned long *deleted)
+unsigned char *zzlDeleteRangeByRank(unsigned char *zl, zlSkipIndex *si, unsigned int start, unsigned int end, unsigned long *deleted)
 {
     unsigned int num = (end - start) + 1;
+    unsigned char *p;
+    size_t offset;
 
     if (deleted)
         *deleted = num;
@@ -574,11 +685,60 @@ unsigned char *zzlDeleteRangeByRank(unsigned char *zl, unsigned int start, unsig
     // 每个元素占用两个节点，所以删除的个数其实要乘以 2
     // 并且因为 ziplist 的索引以 0 为起始值，而 zzl 的起始值为 1 ，
     // 所以需要 start - 1
+    if ((p = ziplistSkipIndexSeek(si, zl, 2 * (start - 1))) == NULL)
+        return zl;
+    offset = p - zl;
     zl = ziplistDeleteRange(zl, 2 * (start - 1), 2 * num);
+    ziplistSkipIndexTouch(si, zl, zl + offset);
 
     return zl;
 }
 
+/* 返回 ziplist 编码的有序集合中排位为 rank 的元素的成员节点，rank 以 1 为起始值。
+ * si 为 ziplist 的跳跃索引，可以为 NULL 。排位超出范围时返回 NULL */
+unsigned char *zzlGetElementByRank(unsigned char *zl, zlSkipIndex *si, unsigned long rank)
+{
+    // 每个元素占用两个节点，成员位于偶数索引上
+    if (rank == 0 || rank > zzlLength(zl))
+        return NULL;
+    return ziplistSkipIndexSeek(si, zl, 2 * (rank - 1));
+}
+
+/* 返回 eptr 所指向的成员在 ziplist 编码的有序集合中的排位，以 1 为起始值。
+ * si 为 ziplist 的跳跃索引，可以为 NULL */
+unsigned long zzlGetRank(unsigned char *zl, zlSkipIndex *si, unsigned char *eptr)
+{
+    return ziplistSkipIndexRank(si, zl, eptr) / 2 + 1;
+}
+
+unsigned long zzlRankOfFirstInRange(unsigned char *zl, zlSkipIndex *si, zrangespec *range)
+{
+    unsigned char *eptr = zzlFirstInRange(zl, range);
+
+    return eptr ? zzlGetRank(zl, si, eptr) : 0;
+}
+
+unsigned long zzlRankOfLastInRange(unsigned char *zl, zlSkipIndex *si, zrangespec *range)
+{
+    unsigned char *eptr = zzlLastInRange(zl, range);
+
+    return eptr ? zzlGetRank(zl, si, eptr) : 0;
+}
+
+unsigned long zzlRankOfFirstInLexRange(unsigned char *zl, zlSkipIndex *si, zlexrangespec *range)
+{
+    unsigned char *eptr = zzlFirstInLexRange(zl, range);
+
+    return eptr ? zzlGetRank(zl, si, eptr) : 0;
+}
+
+unsigned long zzlRankOfLastInLexRange(unsigned char *zl, zlSkipIndex *si, zlexrangespec *range)
+{
+    unsigned char *eptr = zzlLastInLexRange(zl, range);
+
+    return eptr ? zzlGetRank(zl, si, eptr) : 0;
+}
+
 /**************************************************************************/
 unsigned int zsetLength(robj *zobj)
 {
@@ -591,6 +751,18 @@ unsigned int zsetLength(robj *zobj)
     {
         length = ((zset *)zobj->ptr)->zsl->length;
     }
+    else if (zobj->encoding == REDIS_ENCODING_BTREE)
+    {
+        length = ((zset *)zobj->ptr)->zbt->length;
+    }
+    else if (zobj->encoding == REDIS_ENCODING_TSERIES)
+    {
+        length = ((zset *)zobj->ptr)->zts->length;
+    }
+    else if (zobj->encoding == REDIS_ENCODING_LEXSET)
+    {
+        length = ((zset *)zobj->ptr)->zlx->length;
+    }
     else
     {
         //redisPanic("Unknown sorted set encoding");
@@ -610,7 +782,8 @@ void zsetConvert(robj *zobj, int encoding)
     if (zobj->encoding == encoding)
         return;
 
-    // 从 ZIPLIST 编码转换为 SKIPLIST 编码
+    // 从 ZIPLIST 编码转换为 SKIPLIST 、BTREE 、TSERIES 或者 LEXSET 编码
+    // 转换为 LEXSET 编码之前调用者需要用 zsetScoresAreEqual 确认分值都相同
     if (zobj->encoding == REDIS_ENCODING_ZIPLIST)
     {
         unsigned char *zl = zobj->ptr;
@@ -618,15 +791,30 @@ void zsetConvert(robj *zobj, int encoding)
         unsigned char *vstr;
         unsigned int vlen;
         long long vlong;
+        zslBulkLoader bl;
 
-        assert(encoding == REDIS_ENCODING_SKIPLIST);
+        assert(encoding == REDIS_ENCODING_SKIPLIST || encoding == REDIS_ENCODING_BTREE ||
+               encoding == REDIS_ENCODING_TSERIES || encoding == REDIS_ENCODING_LEXSET);
 
         // 创建有序集合结构
         zs = xm_malloc(sizeof(*zs));
-        // 字典
-        zs->dict = dictCreate(&zsetDictType, NULL);
-        // 跳跃表
-        zs->zsl = zslCreate();
+        // 字典，LEXSET 编码不需要字典
+        zs->dict = encoding == REDIS_ENCODING_LEXSET
+                       ? NULL
+                       : dictCreate(encoding == REDIS_ENCODING_SKIPLIST ? &zsetNodeDictType : &zsetDictType, NULL);
+        // 跳跃表、B+ 树、块序列或者成员序列
+        zs->zsl = encoding == REDIS_ENCODING_SKIPLIST ? zslCreate() : NULL;
+        zs->zbt = encoding == REDIS_ENCODING_BTREE ? zbtCreate() : NULL;
+        zs->zts = encoding == REDIS_ENCODING_TSERIES ? ztsCreate() : NULL;
+        zs->zlx = encoding == REDIS_ENCODING_LEXSET
+                      ? zlxCreate(zzlLength(zl) ? zzlGetScore(ziplistIndex(zl, 1)) : 0)
+                      : NULL;
+        // 元素个数已知，字典一次扩展到位，填充的过程中不会触发渐进式 rehash
+        if (zs->dict)
+            dictExpand(zs->dict, zzlLength(zl));
+        // ziplist 中的元素已经按分值排好序，逐个追加到跳跃表的表尾
+        if (zs->zsl)
+            zslBulkLoadInit(&bl, zs->zsl);
 
         // 有序集合在 ziplist 中的排列：
         //
@@ -649,20 +837,43 @@ void zsetConvert(robj *zobj, int encoding)
             else
                 ele = createStringObject((char *)vstr, vlen);
 
-            // 将成员和分值分别关联到跳跃表和字典中
-            node = zslInsert(zs->zsl, score, ele);
-            dictAdd(zs->dict, ele, &node->score);
-            incrRefCount(ele);
+            // 将成员和分值分别关联到跳跃表（B+ 树、块序列）和字典中
+            if (zs->zsl)
+            {
+                // 成员被复制到节点中，字典以节点中的成员为键
+                node = zslBulkLoadAppend(&bl, score, ele);
+                dictAdd(zs->dict, &node->obj, NULL);
+                decrRefCount(ele);
+            }
+            else if (zs->zlx)
+            {
+                // 分值都相同，成员按字典序排列，每次都追加到表尾
+                zlxInsert(zs->zlx, ele);
+                decrRefCount(ele);
+            }
+            else
+            {
+                // 元素是有序的，块序列每次都追加到表尾
+                if (zs->zbt)
+                    zbtInsert(zs->zbt, score, ele);
+                else
+                    ztsInsert(zs->zts, (long long)score, ele);
+                dictSetDoubleVal(dictAddRaw(zs->dict, ele), score);
+                incrRefCount(ele);
+            }
 
             // 移动指针，指向下个元素
             zzlNext(zl, &eptr, &sptr);
         }
-        // 释放原来的 ziplist
+        if (zs->zsl)
+            zslBulkLoadFinish(&bl);
+        // 释放原来的 ziplist 及其跳跃索引
+        objectFreeSkipIndex(zobj);
         xm_free(zobj->ptr);
 
         // 更新对象的值，以及编码方式
         zobj->ptr = zs;
-        zobj->encoding = REDIS_ENCODING_SKIPLIST;
+        zobj->encoding = encoding;
     }
     // 从 SKIPLIST 转换为 ZIPLIST 编码
     else if (zobj->encoding == REDIS_ENCODING_SKIPLIST)
@@ -689,7 +900,7 @@ void zsetConvert(robj *zobj, int encoding)
         while (node)
         {
             // 取出解码后的值对象
-            ele = getDecodedObject(node->obj);
+            ele = getDecodedObject(&node->obj);
             // 添加元素到 ziplist，都是有序的
             zl = zzlInsertAt(zl, NULL, ele, node->score);
             decrRefCount(ele);
@@ -705,8 +916,1423 @@ void zsetConvert(robj *zobj, int encoding)
         zobj->ptr = zl;
         zobj->encoding = REDIS_ENCODING_ZIPLIST;
     }
+    // 从 BTREE 转换为 ZIPLIST 编码
+    else if (zobj->encoding == REDIS_ENCODING_BTREE)
+    {
+        unsigned char *zl = ziplistNew();
+        zbtPos p;
+
+        assert(encoding == REDIS_ENCODING_ZIPLIST);
+
+        zs = zobj->ptr;
+        dictRelease(zs->dict);
+
+        // 沿着叶子节点的链表按顺序遍历所有元素
+        p.leaf = zs->zbt->head;
+        p.i = 0;
+        if (zs->zbt->length > 0)
+        {
+            do
+            {
+                ele = getDecodedObject(zbtPosObj(&p));
+                zl = zzlInsertAt(zl, NULL, ele, zbtPosScore(&p));
+                decrRefCount(ele);
+            } while (zbtNext(&p));
+        }
+        zbtFree(zs->zbt);
+        xm_free(zs);
+
+        zobj->ptr = zl;
+        zobj->encoding = REDIS_ENCODING_ZIPLIST;
+    }
+    // 从 TSERIES 转换为 ZIPLIST 、SKIPLIST 或者 BTREE 编码
+    // 插入非整数分值之前，或者插入经常落在中间时，需要先转换为 SKIPLIST 或者 BTREE 编码
+    else if (zobj->encoding == REDIS_ENCODING_TSERIES)
+    {
+        unsigned char *zl = NULL;
+        zslBulkLoader bl;
+        ztsPos p;
+
+        assert(encoding == REDIS_ENCODING_ZIPLIST || encoding == REDIS_ENCODING_SKIPLIST ||
+               encoding == REDIS_ENCODING_BTREE);
+
+        // 块序列持有成员对象的引用，先释放字典不会释放成员
+        // BTREE 编码的字典和 TSERIES 编码相同，直接保留
+        zs = zobj->ptr;
+        if (encoding != REDIS_ENCODING_BTREE)
+            dictRelease(zs->dict);
+        if (encoding == REDIS_ENCODING_ZIPLIST)
+        {
+            zl = ziplistNew();
+        }
+        else if (encoding == REDIS_ENCODING_SKIPLIST)
+        {
+            zs->dict = dictCreate(&zsetNodeDictType, NULL);
+            dictExpand(zs->dict, zs->zts->length);
+            zs->zsl = zslCreate();
+            zslBulkLoadInit(&bl, zs->zsl);
+        }
+        else
+        {
+            zs->zbt = zbtCreate();
+        }
+
+        // 按顺序遍历所有块，元素是有序的，都追加到表尾
+        if (ztsGetElementByRank(zs->zts, 1, &p))
+        {
+            do
+            {
+                if (zl)
+                {
+                    ele = getDecodedObject(ztsPosObj(&p));
+                    zl = zzlInsertAt(zl, NULL, ele, (double)ztsPosScore(&p));
+                    decrRefCount(ele);
+                }
+                else if (zs->zsl)
+                {
+                    node = zslBulkLoadAppend(&bl, (double)ztsPosScore(&p), ztsPosObj(&p));
+                    dictAdd(zs->dict, &node->obj, NULL);
+                }
+                else
+                {
+                    // 块序列释放时会减少成员的引用计数，B+ 树需要自己的一个引用
+                    incrRefCount(ztsPosObj(&p));
+                    zbtInsert(zs->zbt, (double)ztsPosScore(&p), ztsPosObj(&p));
+                }
+            } while (ztsNext(&p));
+        }
+        ztsFree(zs->zts);
+        zs->zts = NULL;
+
+        if (zl)
+        {
+            xm_free(zs);
+            zobj->ptr = zl;
+        }
+        else if (zs->zsl)
+        {
+            zslBulkLoadFinish(&bl);
+        }
+        zobj->encoding = encoding;
+    }
+    // 从 LEXSET 转换为 ZIPLIST 或者 SKIPLIST 编码
+    // 插入不同的分值之前需要先转换为 SKIPLIST 编码
+    else if (zobj->encoding == REDIS_ENCODING_LEXSET)
+    {
+        unsigned char *zl = NULL;
+        zslBulkLoader bl;
+        zlexset *zlx;
+        zlxPos p;
+
+        assert(encoding == REDIS_ENCODING_ZIPLIST || encoding == REDIS_ENCODING_SKIPLIST);
+
+        zs = zobj->ptr;
+        zlx = zs->zlx;
+        if (encoding == REDIS_ENCODING_ZIPLIST)
+        {
+            zl = ziplistNew();
+        }
+        else
+        {
+            zs->dict = dictCreate(&zsetNodeDictType, NULL);
+            dictExpand(zs->dict, zlx->length);
+            zs->zsl = zslCreate();
+            zslBulkLoadInit(&bl, zs->zsl);
+        }
+
+        // 成员序列中只有成员的字节，每个成员都要创建对象
+        zlxPosInit(&p, zlx);
+        if (zlxGetElementByRank(zlx, 1, &p))
+        {
+            do
+            {
+                ele = createStringObject(zlxPosKey(&p), sdslen(zlxPosKey(&p)));
+                if (zl)
+                {
+                    zl = zzlInsertAt(zl, NULL, ele, zlx->score);
+                }
+                else
+                {
+                    node = zslBulkLoadAppend(&bl, zlx->score, ele);
+                    dictAdd(zs->dict, &node->obj, NULL);
+                }
+                decrRefCount(ele);
+            } while (zlxNext(&p));
+        }
+        zlxPosRelease(&p);
+        zlxFree(zlx);
+        zs->zlx = NULL;
+
+        if (zl)
+        {
+            xm_free(zs);
+            zobj->ptr = zl;
+        }
+        else
+        {
+            zslBulkLoadFinish(&bl);
+        }
+        zobj->encoding = encoding;
+    }
     else
     {
         // redisPanic("Unknown sorted set encoding");
     }
 }
+
+int zsetScoresAreIntegers(robj *zobj)
+{
+    if (zobj->encoding == REDIS_ENCODING_ZIPLIST)
+    {
+        unsigned char *eptr = ziplistIndex(zobj->ptr, 0);
+        unsigned char *sptr = eptr ? ziplistNext(zobj->ptr, eptr) : NULL;
+
+        for (; eptr != NULL; zzlNext(zobj->ptr, &eptr, &sptr))
+            if (!ztsScoreIsInteger(zzlGetScore(sptr)))
+                return 0;
+    }
+    else if (zobj->encoding == REDIS_ENCODING_SKIPLIST)
+    {
+        zskiplistNode *node = ((zset *)zobj->ptr)->zsl->header->level[0].forward;
+
+        for (; node != NULL; node = node->level[0].forward)
+            if (!ztsScoreIsInteger(node->score))
+                return 0;
+    }
+    else if (zobj->encoding == REDIS_ENCODING_BTREE)
+    {
+        zbtree *zbt = ((zset *)zobj->ptr)->zbt;
+        zbtPos p = {zbt->head, 0};
+
+        if (zbt->length == 0)
+            return 1;
+        do
+        {
+            if (!ztsScoreIsInteger(zbtPosScore(&p)))
+                return 0;
+        } while (zbtNext(&p));
+    }
+    else if (zobj->encoding == REDIS_ENCODING_LEXSET)
+    {
+        return ztsScoreIsInteger(((zset *)zobj->ptr)->zlx->score);
+    }
+    return 1;
+}
+
+int zsetScoresAreEqual(robj *zobj, double *score)
+{
+    unsigned long len = zsetLength(zobj);
+    zsetRangeIterator it;
+    unsigned char *eptr;
+    robj *obj;
+    double last;
+
+    if (len == 0)
+        return 0;
+    if (zobj->encoding == REDIS_ENCODING_LEXSET)
+    {
+        *score = ((zset *)zobj->ptr)->zlx->score;
+        return 1;
+    }
+    // 元素按分值排序，第一个和最后一个元素的分值相同时所有分值都相同
+    zsetRangeInit(&it, zobj, 1, 1, 0);
+    zsetRangeNext(&it, &eptr, &obj, score);
+    zsetRangeRelease(&it);
+    zsetRangeInit(&it, zobj, len, len, 0);
+    zsetRangeNext(&it, &eptr, &obj, &last);
+    zsetRangeRelease(&it);
+    return *score == last;
+}
+
+int zsetScore(robj *zobj, robj *ele, double *score)
+{
+    dictEntry *de;
+
+    if (zobj->encoding == REDIS_ENCODING_ZIPLIST)
+        return zzlFind(zobj->ptr, ele, score) != NULL;
+    // 没有字典，在成员序列中二分查找
+    if (zobj->encoding == REDIS_ENCODING_LEXSET)
+    {
+        if (zlxGetRank(((zset *)zobj->ptr)->zlx, ele) == 0)
+            return 0;
+        *score = ((zset *)zobj->ptr)->zlx->score;
+        return 1;
+    }
+
+    if ((de = dictFind(((zset *)zobj->ptr)->dict, ele)) == NULL)
+        return 0;
+    if (zobj->encoding == REDIS_ENCODING_SKIPLIST)
+        *score = zsetNodeFromKey(dictGetKey(de))->score;
+    else
+        *score = dictGetDoubleVal(de);
+    return 1;
+}
+
+// 压缩列表超过边界条件时选择转换之后的编码，appended 表示触发转换的元素是追加到表尾的
+// LEXSET 和 TSERIES 编码只适合特定的访问模式，需要分别打开 zset_lexset_index 和 zset_tseries_index
+static int zsetIndexEncoding(robj *zobj, int appended)
+{
+    double score;
+
+    // 分值都相同（比如自动补全）时只按成员排序，使用前缀压缩的成员序列
+    if (server.zset_lexset_index && zsetScoresAreEqual(zobj, &score))
+        return REDIS_ENCODING_LEXSET;
+    // 分值都是整数并且按分值顺序追加（比如毫秒时间戳）时使用块序列，分值按差值压缩
+    // 块序列在中间插入时要更新之后所有块的排位，插入不在表尾时不选择块序列
+    if (server.zset_tseries_index && appended && zsetScoresAreIntegers(zobj))
+        return REDIS_ENCODING_TSERIES;
+    return server.zset_btree_index ? REDIS_ENCODING_BTREE : REDIS_ENCODING_SKIPLIST;
+}
+
+// 块序列中的插入和删除经常落在中间时，每次都要更新之后所有块的排位，转换为 SKIPLIST 或者 BTREE 编码
+// 删除只增加计数，留到下一次插入时检查
+static void zsetTseriesCheck(robj *zobj)
+{
+    if (zobj->encoding == REDIS_ENCODING_TSERIES && ztsTooManyMiddleOps(((zset *)zobj->ptr)->zts))
+        zsetConvert(zobj, server.zset_btree_index ? REDIS_ENCODING_BTREE : REDIS_ENCODING_SKIPLIST);
+}
+
+int zsetAdd(robj *zobj, double score, robj *ele)
+{
+    unsigned char *eptr;
+    zskiplistNode *node;
+    dictEntry *de;
+    zset *zs;
+    double curscore;
+
+    if (zobj->encoding == REDIS_ENCODING_ZIPLIST)
+    {
+        size_t offset;
+
+        // 跳跃索引只在删除和插入的位置之后失效
+        if ((eptr = zzlFind(zobj->ptr, ele, &curscore)) != NULL)
+        {
+            // 分值改变时删除之后重新按顺序插入
+            if (score != curscore)
+            {
+                offset = eptr - (unsigned char *)zobj->ptr;
+                zobj->ptr = zzlDelete(zobj->ptr, eptr);
+                objectTouchSkipIndex(zobj, (unsigned char *)zobj->ptr + offset);
+                zobj->ptr = zzlInsertWithOffset(zobj->ptr, ele, score, &offset);
+                objectTouchSkipIndex(zobj, (unsigned char *)zobj->ptr + offset);
+            }
+            return 0;
+        }
+        zobj->ptr = zzlInsertWithOffset(zobj->ptr, ele, score, &offset);
+        objectTouchSkipIndex(zobj, (unsigned char *)zobj->ptr + offset);
+        // 元素个数或者成员长度超过限制时转换为 SKIPLIST 、BTREE 、TSERIES 或者 LEXSET 编码
+        if (zzlLength(zobj->ptr) > server.zset_max_ziplist_entries ||
+            stringObjectLen(ele) > server.zset_max_ziplist_value)
+            zsetConvert(zobj, zsetIndexEncoding(zobj, ziplistIndex(zobj->ptr, -2) ==
+                                                          (unsigned char *)zobj->ptr + offset));
+        return 1;
+    }
+
+    // 块序列只能保存整数分值
+    if (zobj->encoding == REDIS_ENCODING_TSERIES && !ztsScoreIsInteger(score))
+        zsetConvert(zobj, server.zset_btree_index ? REDIS_ENCODING_BTREE : REDIS_ENCODING_SKIPLIST);
+    // 成员序列只有一个共同的分值
+    if (zobj->encoding == REDIS_ENCODING_LEXSET && score != ((zset *)zobj->ptr)->zlx->score)
+        zsetConvert(zobj, REDIS_ENCODING_SKIPLIST);
+
+    zs = zobj->ptr;
+    if (zobj->encoding == REDIS_ENCODING_LEXSET)
+        return zlxInsert(zs->zlx, ele);
+    de = dictFind(zs->dict, ele);
+    if (zobj->encoding == REDIS_ENCODING_SKIPLIST)
+    {
+        if (de != NULL)
+        {
+            node = zsetNodeFromKey(dictGetKey(de));
+            if (node->score == score)
+                return 0;
+            // 字典的键在节点中，先从字典中删除，再删除节点
+            curscore = node->score;
+            dictDelete(zs->dict, ele);
+            zslDelete(zs->zsl, curscore, ele);
+        }
+        node = zslInsert(zs->zsl, score, ele);
+        dictAdd(zs->dict, &node->obj, NULL);
+        return de == NULL;
+    }
+
+    // BTREE 和 TSERIES 编码：排序索引和字典各持有成员的一个引用
+    if (de != NULL)
+    {
+        curscore = dictGetDoubleVal(de);
+        if (curscore == score)
+            return 0;
+        // 排序索引中的成员对象继续使用，换一个位置插入
+        ele = dictGetKey(de);
+        incrRefCount(ele);
+        if (zobj->encoding == REDIS_ENCODING_BTREE)
+        {
+            zbtDelete(zs->zbt, curscore, ele);
+            zbtInsert(zs->zbt, score, ele);
+        }
+        else
+        {
+            ztsDelete(zs->zts, (long long)curscore, ele);
+            ztsInsert(zs->zts, (long long)score, ele);
+        }
+        dictSetDoubleVal(de, score);
+        zsetTseriesCheck(zobj);
+        return 0;
+    }
+    incrRefCount(ele);
+    if (zobj->encoding == REDIS_ENCODING_BTREE)
+        zbtInsert(zs->zbt, score, ele);
+    else
+        ztsInsert(zs->zts, (long long)score, ele);
+    dictSetDoubleVal(dictAddRaw(zs->dict, ele), score);
+    incrRefCount(ele);
+    zsetTseriesCheck(zobj);
+    return 1;
+}
+
+void zscanCommand(redisClient *c)
+{
+    robj *o;
+    unsigned long cursor;
+
+    if (parseScanCursorOrReply(c, c->argv[2], &cursor) == REDIS_ERR)
+        return;
+    if ((o = lookupKeyReadOrReply(c, c->argv[1], shared.emptyscan)) == NULL)
+        return;
+    if (o->type != REDIS_ZSET)
+    {
+        addReply(c, shared.wrongtypeerr);
+        return;
+    }
+    scanGenericCommand(c, o, cursor);
+}
+
+/**************************按范围计数和遍历****************************************/
+
+void zsetRangeRanks(robj *zobj, zrangespec *range, unsigned long *first, unsigned long *last)
+{
+    if (zobj->encoding == REDIS_ENCODING_ZIPLIST)
+    {
+        zlSkipIndex *si = objectGetSkipIndex(zobj);
+
+        *first = zzlRankOfFirstInRange(zobj->ptr, si, range);
+        *last = *first ? zzlRankOfLastInRange(zobj->ptr, si, range) : 0;
+    }
+    else if (zobj->encoding == REDIS_ENCODING_SKIPLIST)
+    {
+        zskiplist *zsl = ((zset *)zobj->ptr)->zsl;
+
+        *first = zslRankOfFirstInRange(zsl, range);
+        *last = *first ? zslRankOfLastInRange(zsl, range) : 0;
+    }
+    else if (zobj->encoding == REDIS_ENCODING_BTREE)
+    {
+        zbtree *zbt = ((zset *)zobj->ptr)->zbt;
+
+        *first = zbtRankOfFirstInRange(zbt, range);
+        *last = *first ? zbtRankOfLastInRange(zbt, range) : 0;
+    }
+    else if (zobj->encoding == REDIS_ENCODING_TSERIES)
+    {
+        ztseries *zts = ((zset *)zobj->ptr)->zts;
+
+        *first = ztsRankOfFirstInRange(zts, range);
+        *last = *first ? ztsRankOfLastInRange(zts, range) : 0;
+    }
+    else if (zobj->encoding == REDIS_ENCODING_LEXSET)
+    {
+        zlexset *zlx = ((zset *)zobj->ptr)->zlx;
+
+        // 分值都相同，要么所有元素都在范围内，要么都不在
+        *first = zlx->length && zslValueGteMin(zlx->score, range) && zslValueLteMax(zlx->score, range);
+        *last = *first ? zlx->length : 0;
+    }
+    else
+    {
+        // redisPanic("Unknown sorted set encoding");
+        *first = *last = 0;
+    }
+}
+
+void zsetLexRangeRanks(robj *zobj, zlexrangespec *range, unsigned long *first, unsigned long *last)
+{
+    if (zobj->encoding == REDIS_ENCODING_ZIPLIST)
+    {
+        zlSkipIndex *si = objectGetSkipIndex(zobj);
+
+        *first = zzlRankOfFirstInLexRange(zobj->ptr, si, range);
+        *last = *first ? zzlRankOfLastInLexRange(zobj->ptr, si, range) : 0;
+    }
+    else if (zobj->encoding == REDIS_ENCODING_SKIPLIST)
+    {
+        zskiplist *zsl = ((zset *)zobj->ptr)->zsl;
+
+        *first = zslRankOfFirstInLexRange(zsl, range);
+        *last = *first ? zslRankOfLastInLexRange(zsl, range) : 0;
+    }
+    else if (zobj->encoding == REDIS_ENCODING_BTREE)
+    {
+        zbtree *zbt = ((zset *)zobj->ptr)->zbt;
+
+        *first = zbtRankOfFirstInLexRange(zbt, range);
+        *last = *first ? zbtRankOfLastInLexRange(zbt, range) : 0;
+    }
+    else if (zobj->encoding == REDIS_ENCODING_TSERIES)
+    {
+        ztseries *zts = ((zset *)zobj->ptr)->zts;
+
+        *first = ztsRankOfFirstInLexRange(zts, range);
+        *last = *first ? ztsRankOfLastInLexRange(zts, range) : 0;
+    }
+    else if (zobj->encoding == REDIS_ENCODING_LEXSET)
+    {
+        zlexset *zlx = ((zset *)zobj->ptr)->zlx;
+
+        *first = zlxRankOfFirstInLexRange(zlx, range);
+        *last = *first ? zlxRankOfLastInLexRange(zlx, range) : 0;
+    }
+    else
+    {
+        // redisPanic("Unknown sorted set encoding");
+        *first = *last = 0;
+    }
+}
+
+// 由范围两端的排位得到范围内的元素个数，first 为 0 表示范围内没有元素
+static unsigned long zsetCountFromRanks(unsigned long first, unsigned long last)
+{
+    return (first && last >= first) ? last - first + 1 : 0;
+}
+
+int zsetLimitRanks(unsigned long first, unsigned long last, long offset, long count, int reverse,
+                   unsigned long *start, unsigned long *end)
+{
+    unsigned long n = zsetCountFromRanks(first, last);
+
+    if (offset < 0 || (unsigned long)offset >= n)
+        return 0;
+    n -= offset;
+    if (count >= 0 && (unsigned long)count < n)
+        n = count;
+    if (n == 0)
+        return 0;
+
+    if (reverse)
+    {
+        *end = last - offset;
+        *start = *end - n + 1;
+    }
+    else
+    {
+        *start = first + offset;
+        *end = *start + n - 1;
+    }
+    return 1;
+}
+
+void zsetRangeInit(zsetRangeIterator *it, robj *zobj, unsigned long start, unsigned long end, int reverse)
+{
+    unsigned long rank = reverse ? end : start;
+
+    it->zobj = zobj;
+    it->reverse = reverse;
+    it->remaining = end - start + 1;
+    if (zobj->encoding == REDIS_ENCODING_ZIPLIST)
+    {
+        // 跳跃索引直接定位到第 rank 个元素，不用从表头或表尾逐个跳过
+        it->eptr = zzlGetElementByRank(zobj->ptr, objectGetSkipIndex(zobj), rank);
+        it->sptr = it->eptr ? ziplistNext(zobj->ptr, it->eptr) : NULL;
+    }
+    else if (zobj->encoding == REDIS_ENCODING_SKIPLIST)
+    {
+        it->node = zslGetElementByRank(((zset *)zobj->ptr)->zsl, rank);
+    }
+    else if (zobj->encoding == REDIS_ENCODING_BTREE)
+    {
+        if (!zbtGetElementByRank(((zset *)zobj->ptr)->zbt, rank, &it->pos))
+            it->pos.leaf = NULL;
+    }
+    else if (zobj->encoding == REDIS_ENCODING_TSERIES)
+    {
+        // 二分查找块头定位到块，只需要在一个块中解码
+        it->tpos.zts = ((zset *)zobj->ptr)->zts;
+        if (!ztsGetElementByRank(it->tpos.zts, rank, &it->tpos))
+            it->tpos.b = it->tpos.zts->nblocks;
+    }
+    else
+    {
+        zlxPosInit(&it->lpos, ((zset *)zobj->ptr)->zlx);
+        zlxGetElementByRank(it->lpos.zlx, rank, &it->lpos);
+        it->lstarted = 0;
+    }
+}
+
+int zsetRangeNext(zsetRangeIterator *it, unsigned char **eptr, robj **obj, double *score)
+{
+    robj *zobj = it->zobj;
+
+    if (it->remaining == 0)
+        return 0;
+    it->remaining--;
+
+    if (zobj->encoding == REDIS_ENCODING_ZIPLIST)
+    {
+        if (it->eptr == NULL)
+            return 0;
+        *eptr = it->eptr;
+        *obj = NULL;
+        *score = zzlGetScore(it->sptr);
+        if (it->reverse)
+            zzlPrev(zobj->ptr, &it->eptr, &it->sptr);
+        else
+            zzlNext(zobj->ptr, &it->eptr, &it->sptr);
+    }
+    else if (zobj->encoding == REDIS_ENCODING_SKIPLIST)
+    {
+        if (it->node == NULL)
+            return 0;
+        *eptr = NULL;
+        *obj = &it->node->obj;
+        *score = it->node->score;
+        it->node = it->reverse ? it->node->backward : it->node->level[0].forward;
+    }
+    else if (zobj->encoding == REDIS_ENCODING_BTREE)
+    {
+        if (it->pos.leaf == NULL)
+            return 0;
+        *eptr = NULL;
+        *obj = zbtPosObj(&it->pos);
+        *score = zbtPosScore(&it->pos);
+        if (it->reverse)
+            zbtPrev(&it->pos);
+        else
+            zbtNext(&it->pos);
+    }
+    else if (zobj->encoding == REDIS_ENCODING_TSERIES)
+    {
+        if (!ztsPosValid(&it->tpos))
+            return 0;
+        *eptr = NULL;
+        *obj = ztsPosObj(&it->tpos);
+        *score = (double)ztsPosScore(&it->tpos);
+        if (it->reverse)
+            ztsPrev(&it->tpos);
+        else
+            ztsNext(&it->tpos);
+    }
+    else
+    {
+        // 返回的对象指向 lpos 中解码出来的成员，调用者用完上一个元素之后才能移动
+        if (it->lstarted && zlxPosValid(&it->lpos))
+        {
+            if (it->reverse)
+                zlxPrev(&it->lpos);
+            else
+                zlxNext(&it->lpos);
+        }
+        it->lstarted = 1;
+        if (!zlxPosValid(&it->lpos))
+            return 0;
+        it->lobj.type = REDIS_STRING;
+        it->lobj.encoding = REDIS_ENCODING_RAW;
+        it->lobj.refcount = 1;
+        it->lobj.ptr = zlxPosKey(&it->lpos);
+        *eptr = NULL;
+        *obj = &it->lobj;
+        *score = it->lpos.zlx->score;
+    }
+    return 1;
+}
+
+void zsetRangeRelease(zsetRangeIterator *it)
+{
+    if (it->zobj->encoding == REDIS_ENCODING_LEXSET)
+        zlxPosRelease(&it->lpos);
+}
+
+// 回复排位在 [start, end] 之间的元素，withscores 为 1 时每个成员后面跟着它的分值
+static void zsetRangeReply(redisClient *c, robj *zobj, unsigned long start, unsigned long end,
+                           int reverse, int withscores)
+{
+    zsetRangeIterator it;
+    unsigned char *eptr;
+    robj *obj;
+    double score;
+
+    addReplyMultiBulkLen(c, (end - start + 1) * (withscores ? 2 : 1));
+    zsetRangeInit(&it, zobj, start, end, reverse);
+    while (zsetRangeNext(&it, &eptr, &obj, &score))
+    {
+        if (eptr)
+            addReplyZiplistEntry(c, eptr);
+        else
+            addReplyBulk(c, obj);
+        if (withscores)
+            addReplyDouble(c, score);
+    }
+    zsetRangeRelease(&it);
+}
+
+// ZCOUNT key min max
+// 只计算范围两端的排位，不遍历范围内的元素
+void zcountCommand(redisClient *c)
+{
+    robj *zobj;
+    zrangespec range;
+    unsigned long first, last;
+
+    if (zslParseRange(c->argv[2], c->argv[3], &range) != REDIS_OK)
+    {
+        addReplyError(c, "min or max is not a float");
+        return;
+    }
+    if ((zobj = lookupKeyReadOrReply(c, c->argv[1], shared.czero)) == NULL)
+        return;
+    if (zobj->type != REDIS_ZSET)
+    {
+        addReply(c, shared.wrongtypeerr);
+        return;
+    }
+    zsetRangeRanks(zobj, &range, &first, &last);
+    addReplyLongLong(c, zsetCountFromRanks(first, last));
+}
+
+// ZLEXCOUNT key min max
+void zlexcountCommand(redisClient *c)
+{
+    robj *zobj;
+    zlexrangespec range;
+    unsigned long first, last;
+
+    if (zslParseLexRange(c->argv[2], c->argv[3], &range) != REDIS_OK)
+    {
+        addReplyError(c, "min or max not valid string range item");
+        return;
+    }
+    if ((zobj = lookupKeyReadOrReply(c, c->argv[1], shared.czero)) == NULL)
+    {
+        zslFreeLexRange(&range);
+        return;
+    }
+    if (zobj->type != REDIS_ZSET)
+    {
+        zslFreeLexRange(&range);
+        addReply(c, shared.wrongtypeerr);
+        return;
+    }
+    zsetLexRangeRanks(zobj, &range, &first, &last);
+    zslFreeLexRange(&range);
+    addReplyLongLong(c, zsetCountFromRanks(first, last));
+}
+
+// ZRANGE / ZREVRANGE key start stop [WITHSCORES]
+static void zrangeGenericCommand(redisClient *c, int reverse)
+{
+    robj *zobj;
+    long long start, end, llen;
+    int withscores = 0;
+
+    if (getLongLongFromObject(c->argv[2], &start) != REDIS_OK ||
+        getLongLongFromObject(c->argv[3], &end) != REDIS_OK)
+    {
+        addReplyError(c, "value is not an integer or out of range");
+        return;
+    }
+    if (c->argc == 5 && !strcasecmp(c->argv[4]->ptr, "withscores"))
+    {
+        withscores = 1;
+    }
+    else if (c->argc >= 5)
+    {
+        addReplyError(c, "syntax error");
+        return;
+    }
+    if ((zobj = lookupKeyReadOrReply(c, c->argv[1], shared.emptymultibulk)) == NULL)
+        return;
+    if (zobj->type != REDIS_ZSET)
+    {
+        addReply(c, shared.wrongtypeerr);
+        return;
+    }
+
+    // 负数下标从表尾开始计算
+    llen = zsetLength(zobj);
+    if (start < 0)
+        start = llen + start;
+    if (end < 0)
+        end = llen + end;
+    if (start < 0)
+        start = 0;
+    if (start > end || start >= llen)
+    {
+        addReply(c, shared.emptymultibulk);
+        return;
+    }
+    if (end >= llen)
+        end = llen - 1;
+
+    // 下标 start 就是从某一端跳过 start 个元素，和 LIMIT 的换算方式相同
+    {
+        unsigned long first, last;
+
+        zsetLimitRanks(1, llen, start, end - start + 1, reverse, &first, &last);
+        zsetRangeReply(c, zobj, first, last, reverse, withscores);
+    }
+}
+
+void zrangeCommand(redisClient *c)
+{
+    zrangeGenericCommand(c, 0);
+}
+
+void zrevrangeCommand(redisClient *c)
+{
+    zrangeGenericCommand(c, 1);
+}
+
+// ZRANGEBYSCORE key min max [WITHSCORES] [LIMIT offset count]
+// ZREVRANGEBYSCORE key max min [WITHSCORES] [LIMIT offset count]
+// ZRANGEBYLEX key min max [LIMIT offset count]
+// ZREVRANGEBYLEX key max min [LIMIT offset count]
+// 范围和 LIMIT 先换算成排位，再按排位直接定位到第一个要回复的元素，跳过 offset 个元素不需要逐个前进
+static void zrangebyGenericCommand(redisClient *c, int reverse, int lex)
+{
+    zrangespec range;
+    zlexrangespec lexrange;
+    robj *zobj, *minobj, *maxobj;
+    long long offset = 0, count = -1;
+    unsigned long first, last, start, end;
+    int withscores = 0, pos;
+
+    // 反向的命令先给出最大值
+    minobj = reverse ? c->argv[3] : c->argv[2];
+    maxobj = reverse ? c->argv[2] : c->argv[3];
+
+    for (pos = 4; pos < c->argc;)
+    {
+        int remaining = c->argc - pos;
+
+        if (!lex && remaining >= 1 && !strcasecmp(c->argv[pos]->ptr, "withscores"))
+        {
+            withscores = 1;
+            pos++;
+        }
+        else if (remaining >= 3 && !strcasecmp(c->argv[pos]->ptr, "limit"))
+        {
+            if (getLongLongFromObject(c->argv[pos + 1], &offset) != REDIS_OK ||
+                getLongLongFromObject(c->argv[pos + 2], &count) != REDIS_OK)
+            {
+                addReplyError(c, "value is not an integer or out of range");
+                return;
+            }
+            pos += 3;
+        }
+        else
+        {
+            addReplyError(c, "syntax error");
+            return;
+        }
+    }
+
+    if (lex ? zslParseLexRange(minobj, maxobj, &lexrange) != REDIS_OK
+            : zslParseRange(minobj, maxobj, &range) != REDIS_OK)
+    {
+        addReplyError(c, lex ? "min or max not valid string range item" : "min or max is not a float");
+        return;
+    }
+
+    zobj = lookupKeyReadOrReply(c, c->argv[1], shared.emptymultibulk);
+    if (zobj != NULL && zobj->type != REDIS_ZSET)
+    {
+        addReply(c, shared.wrongtypeerr);
+        zobj = NULL;
+    }
+    else if (zobj != NULL)
+    {
+        if (lex)
+            zsetLexRangeRanks(zobj, &lexrange, &first, &last);
+        else
+            zsetRangeRanks(zobj, &range, &first, &last);
+
+        if (zsetLimitRanks(first, last, offset, count, reverse, &start, &end))
+            zsetRangeReply(c, zobj, start, end, reverse, withscores);
+        else
+            addReply(c, shared.emptymultibulk);
+    }
+    if (lex)
+        zslFreeLexRange(&lexrange);
+}
+
+void zrangebyscoreCommand(redisClient *c)
+{
+    zrangebyGenericCommand(c, 0, 0);
+}
+
+void zrevrangebyscoreCommand(redisClient *c)
+{
+    zrangebyGenericCommand(c, 1, 0);
+}
+
+void zrangebylexCommand(redisClient *c)
+{
+    zrangebyGenericCommand(c, 0, 1);
+}
+
+void zrevrangebylexCommand(redisClient *c)
+{
+    zrangebyGenericCommand(c, 1, 1);
+}
+
+/**************************按范围删除****************************************/
+
+void zremrangebyscoreCommand(redisClient *c)
+{
+    robj *key = c->argv[1];
+    robj *zobj;
+    zset *zs;
+    zrangespec range;
+    unsigned long deleted = 0;
+    int keyremoved = 0;
+
+    if (zslParseRange(c->argv[2], c->argv[3], &range) != REDIS_OK)
+    {
+        addReplyError(c, "min or max is not a float");
+        return;
+    }
+    if ((zobj = lookupKeyWriteOrReply(c, key, shared.czero)) == NULL)
+        return;
+    if (zobj->type != REDIS_ZSET)
+    {
+        addReply(c, shared.wrongtypeerr);
+        return;
+    }
+
+    if (zobj->encoding == REDIS_ENCODING_ZIPLIST)
+    {
+        zobj->ptr = zzlDeleteRangeByScore(zobj->ptr, objectGetSkipIndex(zobj), &range, &deleted);
+    }
+    else
+    {
+        zs = zobj->ptr;
+        if (zobj->encoding == REDIS_ENCODING_SKIPLIST)
+            deleted = zslDeleteRangeByScore(zs->zsl, &range, zs->dict);
+        else if (zobj->encoding == REDIS_ENCODING_BTREE)
+            deleted = zbtDeleteRangeByScore(zs->zbt, &range, zs->dict);
+        else if (zobj->encoding == REDIS_ENCODING_TSERIES)
+        {
+            // 整个落在范围内的块直接释放，删除旧数据时不用逐个元素改写
+            deleted = ztsDeleteRangeByScore(zs->zts, &range, zs->dict);
+        }
+        else if (zslValueGteMin(zs->zlx->score, &range) && zslValueLteMax(zs->zlx->score, &range))
+        {
+            // 分值都相同，要么全部删除，要么都不删除
+            deleted = zlxDeleteRangeByRank(zs->zlx, 1, zs->zlx->length);
+        }
+        if (zs->dict && htNeedsResize(zs->dict))
+            dictResize(zs->dict);
+    }
+    if (zsetLength(zobj) == 0)
+    {
+        dbDelete(c->db, key);
+        keyremoved = 1;
+    }
+
+    if (deleted)
+    {
+        // signalModifiedKey(c->db, key);
+        notifyKeyspaceEvent(REDIS_NOTIFY_ZSET, "zremrangebyscore", key, c->db->id);
+        if (keyremoved)
+            notifyKeyspaceEvent(REDIS_NOTIFY_GENERIC, "del", key, c->db->id);
+    }
+    // server.dirty += deleted;
+    addReplyLongLong(c, deleted);
+}
+
+/**************************多集合并集、交集****************************************/
+
+// 并集、交集的一个输入集合，以及遍历它时的状态
+typedef struct zsetOpSrc
+{
+    // 有序集合或者集合对象，为 NULL 时表示空集合
+    robj *subject;
+    // 权重
+    double weight;
+    // ZIPLIST 编码时指向当前的成员和分值
+    unsigned char *eptr, *sptr;
+    // SKIPLIST 编码时指向当前节点
+    zskiplistNode *node;
+    // BTREE 编码时指向当前元素
+    zbtPos pos;
+    // TSERIES 编码时指向当前元素
+    ztsPos tpos;
+    // LEXSET 编码时指向当前元素
+    zlxPos lpos;
+    // 集合对象的迭代器
+    setTypeIterator *si;
+} zsetOpSrc;
+
+// 结果中的一个元素
+// owned 为 1 时 ele 是遍历时新创建的对象，否则指向输入集合中的成员，没有增加引用计数
+typedef struct zsetOpElement
+{
+    robj *ele;
+    double score;
+    int owned;
+} zsetOpElement;
+
+static unsigned long zsetOpSrcLength(zsetOpSrc *src)
+{
+    if (src->subject == NULL)
+        return 0;
+    return src->subject->type == REDIS_ZSET ? zsetLength(src->subject) : setTypeSize(src->subject);
+}
+
+static void zsetOpSrcInit(zsetOpSrc *src)
+{
+    robj *o = src->subject;
+
+    if (o == NULL)
+        return;
+    if (o->type == REDIS_SET)
+    {
+        src->si = setTypeInitIterator(o);
+    }
+    else if (o->encoding == REDIS_ENCODING_ZIPLIST)
+    {
+        src->eptr = ziplistIndex(o->ptr, 0);
+        src->sptr = src->eptr ? ziplistNext(o->ptr, src->eptr) : NULL;
+    }
+    else if (o->encoding == REDIS_ENCODING_SKIPLIST)
+    {
+        src->node = ((zset *)o->ptr)->zsl->header->level[0].forward;
+    }
+    else if (o->encoding == REDIS_ENCODING_BTREE)
+    {
+        src->pos.leaf = ((zset *)o->ptr)->zbt->head;
+        src->pos.i = 0;
+        if (src->pos.leaf->n == 0)
+            src->pos.leaf = NULL;
+    }
+    else if (o->encoding == REDIS_ENCODING_TSERIES)
+    {
+        src->tpos.zts = ((zset *)o->ptr)->zts;
+        if (!ztsGetElementByRank(src->tpos.zts, 1, &src->tpos))
+            src->tpos.b = src->tpos.zts->nblocks;
+    }
+    else
+    {
+        zlxPosInit(&src->lpos, ((zset *)o->ptr)->zlx);
+        zlxGetElementByRank(src->lpos.zlx, 1, &src->lpos);
+    }
+}
+
+static void zsetOpSrcRelease(zsetOpSrc *src)
+{
+    if (src->subject == NULL)
+        return;
+    if (src->subject->type == REDIS_SET)
+        setTypeReleaseIterator(src->si);
+    else if (src->subject->encoding == REDIS_ENCODING_LEXSET)
+        zlxPosRelease(&src->lpos);
+}
+
+// 取出下一个元素的成员和未加权的分值，集合中元素的分值为 1 ，没有更多元素时返回 0
+// 跳跃表、B+ 树、块序列和字典中的成员直接返回；ziplist 、成员序列和整数集合中的成员要新创建对象，*owned 为 1 ，由调用者释放
+static int zsetOpSrcNext(zsetOpSrc *src, robj **ele, double *score, int *owned)
+{
+    robj *o = src->subject;
+
+    if (o == NULL)
+        return 0;
+    if (o->type == REDIS_SET)
+    {
+        int64_t llele;
+        int encoding = setTypeNext(src->si, ele, &llele);
+
+        if (encoding == -1)
+            return 0;
+        *owned = encoding != REDIS_ENCODING_HT;
+        if (*owned)
+            *ele = createStringObjectFromLongLong(llele);
+        *score = 1.0;
+    }
+    else if (o->encoding == REDIS_ENCODING_ZIPLIST)
+    {
+        unsigned char *vstr;
+        unsigned int vlen;
+        long long vlong;
+
+        if (src->eptr == NULL)
+            return 0;
+        ziplistGet(src->eptr, &vstr, &vlen, &vlong);
+        *ele = vstr ? createStringObject((char *)vstr, vlen) : createStringObjectFromLongLong(vlong);
+        *owned = 1;
+        *score = zzlGetScore(src->sptr);
+        zzlNext(o->ptr, &src->eptr, &src->sptr);
+    }
+    else if (o->encoding == REDIS_ENCODING_SKIPLIST)
+    {
+        if (src->node == NULL)
+            return 0;
+        *ele = &src->node->obj;
+        *owned = 0;
+        *score = src->node->score;
+        src->node = src->node->level[0].forward;
+    }
+    else if (o->encoding == REDIS_ENCODING_BTREE)
+    {
+        if (src->pos.leaf == NULL)
+            return 0;
+        *ele = zbtPosObj(&src->pos);
+        *owned = 0;
+        *score = zbtPosScore(&src->pos);
+        zbtNext(&src->pos);
+    }
+    else if (o->encoding == REDIS_ENCODING_TSERIES)
+    {
+        if (!ztsPosValid(&src->tpos))
+            return 0;
+        *ele = ztsPosObj(&src->tpos);
+        *owned = 0;
+        *score = (double)ztsPosScore(&src->tpos);
+        ztsNext(&src->tpos);
+    }
+    else
+    {
+        if (!zlxPosValid(&src->lpos))
+            return 0;
+        *ele = createStringObject(zlxPosKey(&src->lpos), sdslen(zlxPosKey(&src->lpos)));
+        *owned = 1;
+        *score = src->lpos.zlx->score;
+        zlxNext(&src->lpos);
+    }
+    return 1;
+}
+
+// 在输入集合中查找成员 ele ，找到时把未加权的分值保存到 *score 并返回 1
+static int zsetOpSrcFind(zsetOpSrc *src, robj *ele, double *score)
+{
+    robj *o = src->subject;
+    dictEntry *de;
+
+    if (o->type == REDIS_SET)
+    {
+        *score = 1.0;
+        return setTypeIsMember(o, ele);
+    }
+    if (o->encoding == REDIS_ENCODING_ZIPLIST)
+        return zzlFind(o->ptr, ele, score) != NULL;
+    if (o->encoding == REDIS_ENCODING_LEXSET)
+        return zsetScore(o, ele, score);
+
+    if ((de = dictFind(((zset *)o->ptr)->dict, ele)) == NULL)
+        return 0;
+    if (o->encoding == REDIS_ENCODING_SKIPLIST)
+        *score = zsetNodeFromKey(dictGetKey(de))->score;
+    else
+        *score = dictGetDoubleVal(de);
+    return 1;
+}
+
+// 把 val 聚合到 *target 中，inf 和 -inf 相加得到的 NaN 当作 0
+static inline void zsetOpAggregate(double *target, double val, int aggregate)
+{
+    if (aggregate == REDIS_AGGR_SUM)
+    {
+        *target = *target + val;
+        if (isnan(*target))
+            *target = 0.0;
+    }
+    else if (aggregate == REDIS_AGGR_MIN)
+    {
+        *target = val < *target ? val : *target;
+    }
+    else
+    {
+        *target = val > *target ? val : *target;
+    }
+}
+
+// 加权之后的分值，0 乘以 inf 得到的 NaN 当作 0
+static inline double zsetOpWeighted(double score, double weight)
+{
+    double v = score * weight;
+    return isnan(v) ? 0.0 : v;
+}
+
+static int zsetOpSrcLengthCompare(const void *a, const void *b)
+{
+    unsigned long la = zsetOpSrcLength((zsetOpSrc *)a), lb = zsetOpSrcLength((zsetOpSrc *)b);
+    return (la > lb) - (la < lb);
+}
+
+static int zsetOpElementCompare(const void *a, const void *b)
+{
+    const zsetOpElement *x = a, *y = b;
+
+    if (x->score != y->score)
+        return x->score < y->score ? -1 : 1;
+    return compareStringObjects(x->ele, y->ele);
+}
+
+static void zsetOpAppend(zsetOpElement **res, unsigned long *len, unsigned long *cap,
+                         robj *ele, double score, int owned)
+{
+    if (*len == *cap)
+    {
+        *cap = *cap ? *cap * 2 : 16;
+        *res = xm_realloc(*res, sizeof(zsetOpElement) * *cap);
+    }
+    (*res)[*len].ele = ele;
+    (*res)[*len].score = score;
+    (*res)[*len].owned = owned;
+    (*len)++;
+}
+
+// 用按 (score, member) 排好序的元素创建有序集合
+// 元素个数和成员长度都不超过限制时直接按顺序追加到 ziplist ，否则逐个追加到跳跃表的表尾
+static robj *zsetCreateFromSorted(zsetOpElement *res, unsigned long len)
+{
+    zskiplistNode *node;
+    zslBulkLoader bl;
+    robj *dst, *ele;
+    zset *zs;
+    unsigned long i;
+
+    if (len <= server.zset_max_ziplist_entries)
+    {
+        for (i = 0; i < len; i++)
+            if (stringObjectLen(res[i].ele) > server.zset_max_ziplist_value)
+                break;
+        if (i == len)
+        {
+            dst = createZsetZiplistObject();
+            for (i = 0; i < len; i++)
+            {
+                ele = getDecodedObject(res[i].ele);
+                dst->ptr = zzlInsertAt(dst->ptr, NULL, ele, res[i].score);
+                decrRefCount(ele);
+            }
+            return dst;
+        }
+    }
+
+    dst = createZsetObject();
+    zs = dst->ptr;
+    dictExpand(zs->dict, len);
+    zslBulkLoadInit(&bl, zs->zsl);
+    for (i = 0; i < len; i++)
+    {
+        node = zslBulkLoadAppend(&bl, res[i].score, res[i].ele);
+        dictAdd(zs->dict, &node->obj, NULL);
+    }
+    zslBulkLoadFinish(&bl);
+    return dst;
+}
+
+robj *zsetUnionInterStore(robj **sets, double *weights, int setnum, int op, int aggregate)
+{
+    zsetOpSrc stackbuf[16], *src;
+    zsetOpElement *res = NULL;
+    unsigned long len = 0, cap = 0, maxlen = 0, sumlen = 0, i;
+    robj *ele, *dst = NULL;
+    double score, value;
+    int j, owned;
+
+    src = setnum <= 16 ? stackbuf : xm_malloc(sizeof(zsetOpSrc) * setnum);
+    for (j = 0; j < setnum; j++)
+    {
+        src[j].subject = sets[j];
+        src[j].weight = weights ? weights[j] : 1.0;
+        if (zsetOpSrcLength(&src[j]) > maxlen)
+            maxlen = zsetOpSrcLength(&src[j]);
+        sumlen += zsetOpSrcLength(&src[j]);
+    }
+
+    if (op == REDIS_OP_INTER)
+    {
+        // 遍历最小的集合，其他集合从小到大探测，有一个集合为空时交集为空
+        qsort(src, setnum, sizeof(zsetOpSrc), zsetOpSrcLengthCompare);
+        if (setnum > 0 && zsetOpSrcLength(&src[0]) > 0)
+        {
+            zsetOpSrcInit(&src[0]);
+            while (zsetOpSrcNext(&src[0], &ele, &score, &owned))
+            {
+                score = zsetOpWeighted(score, src[0].weight);
+                for (j = 1; j < setnum; j++)
+                {
+                    if (!zsetOpSrcFind(&src[j], ele, &value))
+                        break;
+                    zsetOpAggregate(&score, zsetOpWeighted(value, src[j].weight), aggregate);
+                }
+                // 最小的集合中成员不重复，不需要再去重
+                if (j == setnum)
+                    zsetOpAppend(&res, &len, &cap, ele, score, owned);
+                else if (owned)
+                    decrRefCount(ele);
+            }
+            zsetOpSrcRelease(&src[0]);
+        }
+    }
+    else
+    {
+        // 字典把成员映射到它在 res 中的下标，分值直接在 res 中聚合，不为每个成员创建分值对象
+        // 字典按所有输入的元素总数一次扩展到位，累加的过程中不会 rehash ，冲突链也很短；
+        // 数组按最大的输入集合预先分配，并集至少有这么大
+        dict *acc = dictCreate(&zsetNodeDictType, NULL);
+        dictEntry *de;
+
+        dictExpand(acc, sumlen);
+        cap = maxlen;
+        res = xm_malloc(sizeof(zsetOpElement) * (cap ? cap : 1));
+        for (j = 0; j < setnum; j++)
+        {
+            zsetOpSrcInit(&src[j]);
+            while (zsetOpSrcNext(&src[j], &ele, &score, &owned))
+            {
+                score = zsetOpWeighted(score, src[j].weight);
+                if ((de = dictFind(acc, ele)) != NULL)
+                {
+                    zsetOpAggregate(&res[dictGetUnsignedIntegerVal(de)].score, score, aggregate);
+                    if (owned)
+                        decrRefCount(ele);
+                }
+                else
+                {
+                    de = dictAddRaw(acc, ele);
+                    dictSetUnsignedIntegerVal(de, len);
+                    zsetOpAppend(&res, &len, &cap, ele, score, owned);
+                }
+            }
+            zsetOpSrcRelease(&src[j]);
+        }
+        dictRelease(acc);
+    }
+
+    // 结果按 (score, member) 排序之后一次性构建，成员都被复制到目标集合中
+    if (len > 0)
+    {
+        qsort(res, len, sizeof(zsetOpElement), zsetOpElementCompare);
+        dst = zsetCreateFromSorted(res, len);
+    }
+
+    for (i = 0; i < len; i++)
+        if (res[i].owned)
+            decrRefCount(res[i].ele);
+    xm_free(res);
+    if (src != stackbuf)
+        xm_free(src);
+    return dst;
+}
+
+// ZUNIONSTORE / ZINTERSTORE destination numkeys key [key ...] [WEIGHTS weight [weight ...]] [AGGREGATE SUM|MIN|MAX]
+static void zunionInterGenericCommand(redisClient *c, robj *dstkey, int op)
+{
+    robj **sets = NULL, *dstobj;
+    double *weights = NULL;
+    long long numkeys;
+    int i, j, setnum, aggregate = REDIS_AGGR_SUM;
+
+    if (getLongLongFromObject(c->argv[2], &numkeys) != REDIS_OK)
+    {
+        addReplyError(c, "value is not an integer or out of range");
+        return;
+    }
+    if (numkeys < 1)
+    {
+        addReplyError(c, "at least 1 input key is needed for ZUNIONSTORE/ZINTERSTORE");
+        return;
+    }
+    if (numkeys > c->argc - 3)
+    {
+        addReplyError(c, "syntax error");
+        return;
+    }
+    setnum = numkeys;
+
+    sets = xm_malloc(sizeof(robj *) * setnum);
+    weights = xm_malloc(sizeof(double) * setnum);
+    for (i = 0; i < setnum; i++)
+    {
+        // 有序集合和集合都可以作为输入，不存在的键当作空集合
+        sets[i] = lookupKeyWrite(c->db, c->argv[3 + i]);
+        if (sets[i] != NULL && sets[i]->type != REDIS_ZSET && sets[i]->type != REDIS_SET)
+        {
+            addReply(c, shared.wrongtypeerr);
+            goto cleanup;
+        }
+        weights[i] = 1.0;
+    }
+
+    for (j = 3 + setnum; j < c->argc;)
+    {
+        int remaining = c->argc - j;
+
+        if (remaining >= setnum + 1 && !strcasecmp(c->argv[j]->ptr, "weights"))
+        {
+            for (j++, i = 0; i < setnum; i++, j++)
+            {
+                if (getDoubleFromObject(c->argv[j], &weights[i]) != REDIS_OK)
+                {
+                    addReplyError(c, "weight value is not a float");
+                    goto cleanup;
+                }
+            }
+        }
+        else if (remaining >= 2 && !strcasecmp(c->argv[j]->ptr, "aggregate"))
+        {
+            if (!strcasecmp(c->argv[j + 1]->ptr, "sum"))
+                aggregate = REDIS_AGGR_SUM;
+            else if (!strcasecmp(c->argv[j + 1]->ptr, "min"))
+                aggregate = REDIS_AGGR_MIN;
+            else if (!strcasecmp(c->argv[j + 1]->ptr, "max"))
+                aggregate = REDIS_AGGR_MAX;
+            else
+            {
+                addReplyError(c, "syntax error");
+                goto cleanup;
+            }
+            j += 2;
+        }
+        else
+        {
+            addReplyError(c, "syntax error");
+            goto cleanup;
+        }
+    }
+
+    // 输入集合全部读完之后才写入目标键，目标键也可以是输入之一
+    dstobj = zsetUnionInterStore(sets, weights, setnum, op, aggregate);
+    if (dstobj != NULL)
+    {
+        setKey(c->db, dstkey, dstobj);
+        addReplyLongLong(c, zsetLength(dstobj));
+        decrRefCount(dstobj);
+        notifyKeyspaceEvent(REDIS_NOTIFY_ZSET, op == REDIS_OP_UNION ? "zunionstore" : "zinterstore",
+                            dstkey, c->db->id);
+    }
+    else
+    {
+        // 结果为空时删除目标键
+        if (dbDelete(c->db, dstkey))
+        {
+            // signalModifiedKey(c->db, dstkey);
+            notifyKeyspaceEvent(REDIS_NOTIFY_GENERIC, "del", dstkey, c->db->id);
+        }
+        addReply(c, shared.czero);
+    }
+
+cleanup:
+    xm_free(sets);
+    xm_free(weights);
+}
+
+void zunionstoreCommand(redisClient *c)
+{
+    zunionInterGenericCommand(c, c->argv[1], REDIS_OP_UNION);
+}
+
+void zinterstoreCommand(redisClient *c)
+{
+    zunionInterGenericCommand(c, c->argv[1], REDIS_OP_INTER);
+}
@@ -4,6 +4,9 @@
 #include "xmobject.h"
 #include "xmdict.h"
 #include "xmskiplist.h"
+#include "xmbtree.h"
+#include "xmtseries.h"
+#include "xmlexset.h"
 #include "xmzplist.h"
 
 #include "xmt_string.h"
@@ -15,6 +18,8 @@ typedef struct zset {
 
     // 字典，键为成员，值为分值
     // 用于支持 O(1) 复杂度的按成员取分值操作
+    // SKIPLIST 编码时键是跳跃表节点中嵌入的成员，通过键就能得到节点和分值，没有值；
+    // BTREE 编码时分值直接保存在字典节点中；LEXSET 编码时为 NULL
     dict *dict;
 
     // 跳跃表，按分值排序成员
@@ -22,25 +27,154 @@ typedef struct zset {
     // 以及范围操作
     zskiplist *zsl;
 
+    // B+ 树，BTREE 编码时代替跳跃表，其他编码时为 NULL
+    zbtree *zbt;
+
+    // 差值编码的块序列，TSERIES 编码时代替跳跃表，其他编码时为 NULL
+    ztseries *zts;
+
+    // 前缀压缩的成员序列，LEXSET 编码时代替跳跃表和字典，其他编码时为 NULL
+    zlexset *zlx;
+
 } zset;
 
 
+// 根据 SKIPLIST 编码的有序集合字典中的键，取出对应的跳跃表节点
+#define zsetNodeFromKey(key) ((zskiplistNode *)(key))
+
 robj *createZsetObject(void);
 robj *createZsetZiplistObject(void);
+// 创建一个 BTREE 编码的有序集合
+robj *createZsetBtreeObject(void);
+// 创建一个 TSERIES 编码的有序集合，只能保存整数分值
+robj *createZsetTseriesObject(void);
+// 创建一个 LEXSET 编码的有序集合，所有成员的分值都是 score
+robj *createZsetLexsetObject(double score);
 void freeZsetObject(robj *o);
 
 //  取出 sptr 指向节点所保存的有序集合元素的分值
 double zzlGetScore(unsigned char *sptr);
+// 用 sptr 指向的节点保存的值创建一个对象，使用完需要减少引用计数
+robj *ziplistGetObject(unsigned char *sptr);
 // 根据 eptr 和 sptr ，移动它们分别指向下个成员和下个分值。如果后面已经没有元素，那么两个指针都被设为 NULL 
 void zzlNext(unsigned char *zl, unsigned char **eptr, unsigned char **sptr);
 // 根据 eptr 和 sptr ，移动它们分别指向前一个成员和分值。如果前面已经没有元素，那么两个指针都被设为 NULL 
 void zzlPrev(unsigned char *zl, unsigned char **eptr, unsigned char **sptr);
+// 将 ele 成员和它的分值 score 按分值顺序添加到 ziplist 中，返回新的 ziplist
+unsigned char *zzlInsert(unsigned char *zl, robj *ele, double score);
+// 查找成员 ele ，找到时返回成员节点并把分值保存到 *score ，没有找到时返回 NULL
+unsigned char *zzlFind(unsigned char *zl, robj *ele, double *score);
+// 返回排位为 rank 的元素的成员节点，rank 以 1 为起始值。si 为 objectGetSkipIndex 返回的跳跃索引，可以为 NULL
+// 通过 zzl* 函数修改 ziplist 之后，调用者需要用 objectTouchSkipIndex 通知被修改的位置
+unsigned char *zzlGetElementByRank(unsigned char *zl, zlSkipIndex *si, unsigned long rank);
+// 返回 eptr 所指向的成员的排位，以 1 为起始值。si 可以为 NULL
+unsigned long zzlGetRank(unsigned char *zl, zlSkipIndex *si, unsigned char *eptr);
+// 返回第一个（最后一个）在范围内的元素的排位，以 1 为起始值，没有时返回 0 。si 可以为 NULL
+unsigned long zzlRankOfFirstInRange(unsigned char *zl, zlSkipIndex *si, zrangespec *range);
+unsigned long zzlRankOfLastInRange(unsigned char *zl, zlSkipIndex *si, zrangespec *range);
+unsigned long zzlRankOfFirstInLexRange(unsigned char *zl, zlSkipIndex *si, zlexrangespec *range);
+unsigned long zzlRankOfLastInLexRange(unsigned char *zl, zlSkipIndex *si, zlexrangespec *range);
+// 删除分值（字典序、排位）在范围内的元素，删除的数量保存到 *deleted 中。si 可以为 NULL ，函数自己会截掉失效的索引槽
+unsigned char *zzlDeleteRangeByScore(unsigned char *zl, zlSkipIndex *si, zrangespec *range, unsigned long *deleted);
+unsigned char *zzlDeleteRangeByLex(unsigned char *zl, zlSkipIndex *si, zlexrangespec *range, unsigned long *deleted);
+unsigned char *zzlDeleteRangeByRank(unsigned char *zl, zlSkipIndex *si, unsigned int start, unsigned int end, unsigned long *deleted);
+
 
+/**************************按范围计数和遍历****************************************/
+
+// 按排位遍历有序集合中的一段元素，排位以 1 为起始值
+// 按分值、字典序的范围以及 LIMIT 都先换算成排位，一次 O(log N) 的按排位查找就能定位到起点，
+// 之后每个元素只需要移动一步，不用逐个跳过 offset 个元素，也不用逐个检查元素是否还在范围内
+typedef struct zsetRangeIterator
+{
+    robj *zobj;
+    // 是否从后往前遍历
+    int reverse;
+    // 还没有取出的元素个数
+    unsigned long remaining;
+    // ZIPLIST 编码时指向当前的成员和分值
+    unsigned char *eptr, *sptr;
+    // SKIPLIST 编码时指向当前节点
+    zskiplistNode *node;
+    // BTREE 编码时指向当前元素
+    zbtPos pos;
+    // TSERIES 编码时指向当前元素
+    ztsPos tpos;
+    // LEXSET 编码时指向当前元素，lobj 是指向 lpos 中成员的对象，取出下一个元素时才移动 lpos
+    zlxPos lpos;
+    robj lobj;
+    int lstarted;
+} zsetRangeIterator;
+
+// 计算第一个和最后一个在范围内的元素的排位，范围内没有元素时 *first 为 0
+void zsetRangeRanks(robj *zobj, zrangespec *range, unsigned long *first, unsigned long *last);
+void zsetLexRangeRanks(robj *zobj, zlexrangespec *range, unsigned long *first, unsigned long *last);
+// 在排位 [first, last] 之内跳过 offset 个元素，再取最多 count 个元素，count 为负数时不限个数
+// reverse 为 1 时从 last 开始往前数。取出的元素的排位范围保存到 [*start, *end] ，没有元素时返回 0
+int zsetLimitRanks(unsigned long first, unsigned long last, long offset, long count, int reverse,
+                   unsigned long *start, unsigned long *end);
+// 初始化迭代器，遍历排位在 [start, end] 之间的元素，reverse 为 1 时从 end 开始往前遍历
+// 调用者需要保证 1 <= start <= end <= zsetLength(zobj)
+void zsetRangeInit(zsetRangeIterator *it, robj *zobj, unsigned long start, unsigned long end, int reverse);
+// 取出当前元素并移动到下一个元素，没有更多元素时返回 0
+// ZIPLIST 编码时 *eptr 指向成员节点，*obj 为 NULL ；其他编码时 *eptr 为 NULL ，*obj 指向成员对象，没有增加引用计数
+// LEXSET 编码时 *obj 只在下一次调用之前有效，需要保留时要复制
+int zsetRangeNext(zsetRangeIterator *it, unsigned char **eptr, robj **obj, double *score);
+// 释放迭代器占用的资源
+void zsetRangeRelease(zsetRangeIterator *it);
 
 unsigned int zsetLength(robj *zobj);
 void zsetConvert(robj *zobj, int encoding);
+// 有序集合中的分值是否都可以用 TSERIES 编码保存
+int zsetScoresAreIntegers(robj *zobj);
+// 有序集合中的分值是否都相同，可以用 LEXSET 编码保存，相同时把分值保存到 *score ，空集合返回 0
+int zsetScoresAreEqual(robj *zobj, double *score);
+// 取出成员 ele 的分值保存到 *score ，成员不存在时返回 0
+int zsetScore(robj *zobj, robj *ele, double *score);
+// 添加成员 ele ，分值为 score ，成员已经存在时更新它的分值。新添加了成员返回 1 ，否则返回 0
+// 不接管 ele 的引用。ziplist 超过长度限制、TSERIES 编码遇到非整数分值、LEXSET 编码遇到不同的分值时先转换为 SKIPLIST 编码
+int zsetAdd(robj *zobj, double score, robj *ele);
 unsigned long zslGetRank(zskiplist *zsl, double score, robj *o);
 
+/**************************多集合并集、交集****************************************/
+
+#define REDIS_OP_UNION 0
+#define REDIS_OP_INTER 1
+
+// 聚合方式
+#define REDIS_AGGR_SUM 1
+#define REDIS_AGGR_MIN 2
+#define REDIS_AGGR_MAX 3
+
+// 求 sets[0..setnum) 加权之后的并集（交集），同一个成员的分值按 aggregate 聚合，weights 为 NULL 时权重都是 1
+// sets 中可以有集合对象，元素的分值视为 1 ，也可以有 NULL （空集合）
+// 交集遍历最小的集合，到其他集合中从小到大探测；并集用一个预先分配的字典记录成员在结果数组中的下标，分值在数组中聚合
+// 结果排好序之后一次性构建 ziplist 或跳跃表，返回新的有序集合对象，结果为空时返回 NULL
+robj *zsetUnionInterStore(robj **sets, double *weights, int setnum, int op, int aggregate);
 
+// ZSCAN key cursor [COUNT count]
+void zscanCommand(redisClient *c);
+// ZCOUNT key min max
+void zcountCommand(redisClient *c);
+// ZLEXCOUNT key min max
+void zlexcountCommand(redisClient *c);
+// ZRANGE key start stop [WITHSCORES]
+void zrangeCommand(redisClient *c);
+// ZREVRANGE key start stop [WITHSCORES]
+void zrevrangeCommand(redisClient *c);
+// ZRANGEBYSCORE key min max [WITHSCORES] [LIMIT offset count]
+void zrangebyscoreCommand(redisClient *c);
+// ZREVRANGEBYSCORE key max min [WITHSCORES] [LIMIT offset count]
+void zrevrangebyscoreCommand(redisClient *c);
+// ZRANGEBYLEX key min max [LIMIT offset count]
+void zrangebylexCommand(redisClient *c);
+// ZREVRANGEBYLEX key max min [LIMIT offset count]
+void zrevrangebylexCommand(redisClient *c);
+// ZREMRANGEBYSCORE key min max
+void zremrangebyscoreCommand(redisClient *c);
+// ZUNIONSTORE destination numkeys key [key ...] [WEIGHTS weight [weight ...]] [AGGREGATE SUM|MIN|MAX]
+void zunionstoreCommand(redisClient *c);
+// ZINTERSTORE destination numkeys key [key ...] [WEIGHTS weight [weight ...]] [AGGREGATE SUM|MIN|MAX]
+void zinterstoreCommand(redisClient *c);
 
 #endif
\ No newline at end of file
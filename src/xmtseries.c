@@ -0,0 +1,632 @@
+#include "xmtseries.h"
+#include "xmmalloc.h"
+
+#include "xmt_string.h"
+
+#include <string.h>
+
+// 查找时使用的单调谓词：对序列中从小到大排列的元素，返回值是若干个 0 之后跟着若干个 1
+// 成员通过块和下标传入，只按分值就能判断时不用访问块中的成员
+typedef int ztsPredicate(long long score, ztsBlock *block, int i, void *arg);
+
+/*********************************变长整数***********************************/
+
+// 每个字节保存 7 位，低位在前，除了最后一个字节以外最高位都是 1
+// 所以从一个差值的末尾往前找到上一个最高位为 0 的字节，就能找到它的起始位置，可以反向解码
+
+static inline unsigned int ztsVarintLen(unsigned long long v)
+{
+    unsigned int len = 1;
+
+    while (v >= 0x80)
+    {
+        v >>= 7;
+        len++;
+    }
+    return len;
+}
+
+static inline unsigned int ztsVarintEncode(unsigned char *p, unsigned long long v)
+{
+    unsigned int len = 0;
+
+    while (v >= 0x80)
+    {
+        p[len++] = (unsigned char)(v | 0x80);
+        v >>= 7;
+    }
+    p[len++] = (unsigned char)v;
+    return len;
+}
+
+static inline unsigned int ztsVarintDecode(const unsigned char *p, unsigned long long *v)
+{
+    unsigned long long x = 0;
+    unsigned int len = 0, shift = 0;
+
+    do
+    {
+        x |= (unsigned long long)(p[len] & 0x7f) << shift;
+        shift += 7;
+    } while (p[len++] & 0x80);
+    *v = x;
+    return len;
+}
+
+/***********************************块*************************************/
+
+// 在块头数组的第 b 个位置腾出一个空位
+static void ztsHeadersInsert(ztseries *zts, unsigned long b)
+{
+    if (zts->nblocks == zts->capacity)
+    {
+        zts->capacity = zts->capacity ? zts->capacity * 2 : 4;
+        zts->headers = xm_realloc(zts->headers, sizeof(ztsHeader) * zts->capacity);
+    }
+    memmove(zts->headers + b + 1, zts->headers + b, sizeof(ztsHeader) * (zts->nblocks - b));
+    zts->nblocks++;
+}
+
+// 从块头数组中移走从第 b 个开始的 n 个块头，块本身由调用者释放
+static void ztsHeadersRemove(ztseries *zts, unsigned long b, unsigned long n)
+{
+    memmove(zts->headers + b, zts->headers + b + n, sizeof(ztsHeader) * (zts->nblocks - b - n));
+    zts->nblocks -= n;
+}
+
+// 从第 b 个块开始重新计算每个块之前的元素个数
+static void ztsUpdateRanks(ztseries *zts, unsigned long b)
+{
+    unsigned long rank = b ? zts->headers[b - 1].rank + zts->headers[b - 1].count : 0;
+
+    for (; b < zts->nblocks; b++)
+    {
+        zts->headers[b].rank = rank;
+        rank += zts->headers[b].count;
+    }
+}
+
+// 解码块中所有元素的分值
+static void ztsDecodeBlock(ztsHeader *h, long long *scores)
+{
+    unsigned long long delta;
+    unsigned int off = 0;
+    int i;
+
+    scores[0] = h->first;
+    for (i = 1; i < h->count; i++)
+    {
+        off += ztsVarintDecode(h->block->deltas + off, &delta);
+        scores[i] = scores[i - 1] + (long long)delta;
+    }
+}
+
+// n 个有序分值差值编码之后占用的字节数
+static size_t ztsEncodedBytes(long long *scores, int n)
+{
+    size_t bytes = 0;
+    int i;
+
+    for (i = 1; i < n; i++)
+        bytes += ztsVarintLen((unsigned long long)(scores[i] - scores[i - 1]));
+    return bytes;
+}
+
+// 把 n 个元素编码到 h 的块中，调用者需要保证放得下
+static void ztsEncodeBlock(ztsHeader *h, long long *scores, robj **objs, int n)
+{
+    unsigned int used = 0;
+    int i;
+
+    for (i = 1; i < n; i++)
+        used += ztsVarintEncode(h->block->deltas + used, (unsigned long long)(scores[i] - scores[i - 1]));
+    memmove(h->block->objs, objs, sizeof(robj *) * n);
+    h->first = scores[0];
+    h->last = scores[n - 1];
+    h->count = n;
+    h->used = used;
+}
+
+// 用 n 个元素重写第 b 个块，n 为 0 时删除这个块，放不下时分裂成两个块
+// 调用者之后需要从第 b 个块开始更新排位
+static void ztsRewriteBlock(ztseries *zts, unsigned long b, long long *scores, robj **objs, int n)
+{
+    size_t total, prefix;
+    int k;
+
+    if (n == 0)
+    {
+        xm_free(zts->headers[b].block);
+        ztsHeadersRemove(zts, b, 1);
+        return;
+    }
+    if (n <= ZTS_BLOCK_ENTRIES && ztsEncodedBytes(scores, n) <= ZTS_BLOCK_BYTES)
+    {
+        ztsEncodeBlock(&zts->headers[b], scores, objs, n);
+        return;
+    }
+
+    // 先按元素个数平分，某一半的差值放不下时按字节数平分
+    // 后一半的第一个元素不用保存差值，两半的字节数都不超过总数的一半
+    k = n / 2;
+    if (ztsEncodedBytes(scores, k) > ZTS_BLOCK_BYTES || ztsEncodedBytes(scores + k, n - k) > ZTS_BLOCK_BYTES)
+    {
+        total = ztsEncodedBytes(scores, n);
+        prefix = 0;
+        for (k = 1; k < n - 1; k++)
+        {
+            prefix += ztsVarintLen((unsigned long long)(scores[k] - scores[k - 1]));
+            if (prefix > total / 2)
+                break;
+        }
+    }
+    ztsHeadersInsert(zts, b + 1);
+    zts->headers[b + 1].block = xm_malloc(sizeof(ztsBlock));
+    ztsEncodeBlock(&zts->headers[b], scores, objs, k);
+    ztsEncodeBlock(&zts->headers[b + 1], scores + k, objs + k, n - k);
+}
+
+// 在块头数组中二分查找第一个最后一个元素满足 pred 的块，没有时返回 nblocks
+static unsigned long ztsFindBlock(ztseries *zts, ztsPredicate *pred, void *arg)
+{
+    unsigned long lo = 0, hi = zts->nblocks, mid;
+    ztsHeader *h;
+
+    while (lo < hi)
+    {
+        mid = lo + (hi - lo) / 2;
+        h = &zts->headers[mid];
+        if (pred(h->last, h->block, h->count - 1, arg))
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
+    return lo;
+}
+
+// 让 p 指向第 b 个块的第一个元素
+static void ztsPosBlockStart(ztsPos *p, ztseries *zts, unsigned long b)
+{
+    p->zts = zts;
+    p->b = b;
+    p->i = 0;
+    p->off = 0;
+    if (b < zts->nblocks)
+        p->score = zts->headers[b].first;
+}
+
+// 让 p 指向第 b 个块的最后一个元素
+static void ztsPosBlockEnd(ztsPos *p, ztseries *zts, unsigned long b)
+{
+    p->zts = zts;
+    p->b = b;
+    p->i = zts->headers[b].count - 1;
+    p->off = zts->headers[b].used;
+    p->score = zts->headers[b].last;
+}
+
+// 找到第一个使 pred 为真的元素，保存到 *p ，返回它之前的元素个数
+// 没有这样的元素时 p 不指向任何元素，返回值为序列的元素个数
+static unsigned long ztsSearch(ztseries *zts, ztsPredicate *pred, void *arg, ztsPos *p)
+{
+    unsigned long b = ztsFindBlock(zts, pred, arg);
+    ztsBlock *block;
+
+    ztsPosBlockStart(p, zts, b);
+    if (b == zts->nblocks)
+        return zts->length;
+    // 块中最后一个元素满足 pred ，一定能在这个块中找到
+    block = zts->headers[b].block;
+    while (!pred(p->score, block, p->i, arg))
+        ztsNext(p);
+    return zts->headers[b].rank + p->i;
+}
+
+/*************************************************************/
+
+ztseries *ztsCreate(void)
+{
+    ztseries *zts = xm_malloc(sizeof(*zts));
+
+    zts->headers = NULL;
+    zts->nblocks = zts->capacity = 0;
+    zts->length = 0;
+    zts->middle = 0;
+    return zts;
+}
+
+void ztsFree(ztseries *zts)
+{
+    unsigned long b;
+    int i;
+
+    for (b = 0; b < zts->nblocks; b++)
+    {
+        for (i = 0; i < zts->headers[b].count; i++)
+            decrRefCount(zts->headers[b].block->objs[i]);
+        xm_free(zts->headers[b].block);
+    }
+    xm_free(zts->headers);
+    xm_free(zts);
+}
+
+int ztsScoreIsInteger(double score)
+{
+    // NaN 和无穷大在范围检查时就被排除
+    return score >= -ZTS_SCORE_MAX && score <= ZTS_SCORE_MAX && score == (double)(long long)score;
+}
+
+int ztsNext(ztsPos *p)
+{
+    ztsHeader *h = &p->zts->headers[p->b];
+    unsigned long long delta;
+
+    if (++p->i < h->count)
+    {
+        p->off += ztsVarintDecode(h->block->deltas + p->off, &delta);
+        p->score += (long long)delta;
+        return 1;
+    }
+    ztsPosBlockStart(p, p->zts, p->b + 1);
+    return ztsPosValid(p);
+}
+
+int ztsPrev(ztsPos *p)
+{
+    unsigned char *deltas;
+    unsigned long long delta;
+    unsigned int start;
+
+    if (p->i > 0)
+    {
+        deltas = p->zts->headers[p->b].block->deltas;
+        // 当前元素的差值在 off 之前结束，往前找到它的第一个字节
+        start = p->off - 1;
+        while (start > 0 && (deltas[start - 1] & 0x80))
+            start--;
+        ztsVarintDecode(deltas + start, &delta);
+        p->score -= (long long)delta;
+        p->off = start;
+        p->i--;
+        return 1;
+    }
+    if (p->b == 0)
+    {
+        p->b = p->zts->nblocks;
+        return 0;
+    }
+    ztsPosBlockEnd(p, p->zts, p->b - 1);
+    return 1;
+}
+
+/***********************************查找*************************************/
+
+static int ztsPredGteMin(long long score, ztsBlock *block, int i, void *arg)
+{
+    return zslValueGteMin((double)score, arg);
+}
+
+static int ztsPredGtMax(long long score, ztsBlock *block, int i, void *arg)
+{
+    return !zslValueLteMax((double)score, arg);
+}
+
+static int ztsPredLexGteMin(long long score, ztsBlock *block, int i, void *arg)
+{
+    return zslLexValueGteMin(block->objs[i], arg);
+}
+
+static int ztsPredLexGtMax(long long score, ztsBlock *block, int i, void *arg)
+{
+    return !zslLexValueLteMax(block->objs[i], arg);
+}
+
+// 用来查找给定元素的谓词参数
+typedef struct ztsKey
+{
+    long long score;
+    robj *obj;
+} ztsKey;
+
+static int ztsPredGteKey(long long score, ztsBlock *block, int i, void *arg)
+{
+    ztsKey *key = arg;
+
+    if (score != key->score)
+        return score > key->score;
+    return compareStringObjects(block->objs[i], key->obj) >= 0;
+}
+
+static int ztsIsInRange(ztseries *zts, zrangespec *range)
+{
+    // 先排除总为空的范围值
+    if (range->min > range->max ||
+        (range->min == range->max && (range->minex || range->maxex)))
+        return 0;
+    if (zts->length == 0)
+        return 0;
+    // 最大的元素小于最小值，或者最小的元素大于最大值
+    if (!zslValueGteMin((double)zts->headers[zts->nblocks - 1].last, range) ||
+        !zslValueLteMax((double)zts->headers[0].first, range))
+        return 0;
+    return 1;
+}
+
+static int ztsIsInLexRange(ztseries *zts, zlexrangespec *range)
+{
+    ztsHeader *tail;
+
+    if (compareStringObjectsForLexRange(range->min, range->max) > 0 ||
+        (compareStringObjects(range->min, range->max) == 0 &&
+         (range->minex || range->maxex)))
+        return 0;
+    if (zts->length == 0)
+        return 0;
+    tail = &zts->headers[zts->nblocks - 1];
+    if (!zslLexValueGteMin(tail->block->objs[tail->count - 1], range) ||
+        !zslLexValueLteMax(zts->headers[0].block->objs[0], range))
+        return 0;
+    return 1;
+}
+
+unsigned long ztsGetRank(ztseries *zts, long long score, robj *o)
+{
+    ztsKey key = {score, o};
+    unsigned long rank;
+    ztsPos p;
+
+    rank = ztsSearch(zts, ztsPredGteKey, &key, &p);
+    if (!ztsPosValid(&p) || ztsPosScore(&p) != score || !equalStringObjects(ztsPosObj(&p), o))
+        return 0;
+    return rank + 1;
+}
+
+int ztsGetElementByRank(ztseries *zts, unsigned long rank, ztsPos *p)
+{
+    unsigned long lo = 0, hi, mid;
+
+    if (rank < 1 || rank > zts->length)
+        return 0;
+    // 转换为以 0 为起始值的排位，找到最后一个之前的元素个数不超过它的块
+    rank--;
+    hi = zts->nblocks - 1;
+    while (lo < hi)
+    {
+        mid = lo + (hi - lo + 1) / 2;
+        if (zts->headers[mid].rank <= rank)
+            lo = mid;
+        else
+            hi = mid - 1;
+    }
+    ztsPosBlockStart(p, zts, lo);
+    for (rank -= zts->headers[lo].rank; rank > 0; rank--)
+        ztsNext(p);
+    return 1;
+}
+
+// 返回满足 gte 的第一个元素的排位，还要不满足 gt 才算在范围内
+static unsigned long ztsRankOfFirst(ztseries *zts, ztsPredicate *gte, ztsPredicate *gt, void *range)
+{
+    unsigned long rank;
+    ztsPos p;
+
+    rank = ztsSearch(zts, gte, range, &p);
+    if (!ztsPosValid(&p) || gt(ztsPosScore(&p), zts->headers[p.b].block, p.i, range))
+        return 0;
+    return rank + 1;
+}
+
+// 不满足 gt 的元素个数就是最后一个不大于最大值的元素的排位，它还要满足 gte 才算在范围内
+static unsigned long ztsRankOfLast(ztseries *zts, ztsPredicate *gte, ztsPredicate *gt, void *range)
+{
+    unsigned long rank;
+    ztsPos p;
+
+    rank = ztsSearch(zts, gt, range, &p);
+    if (rank == 0)
+        return 0;
+    if (!ztsPosValid(&p))
+        ztsPosBlockEnd(&p, zts, zts->nblocks - 1);
+    else
+        ztsPrev(&p);
+    return gte(ztsPosScore(&p), zts->headers[p.b].block, p.i, range) ? rank : 0;
+}
+
+unsigned long ztsRankOfFirstInRange(ztseries *zts, zrangespec *range)
+{
+    if (!ztsIsInRange(zts, range))
+        return 0;
+    return ztsRankOfFirst(zts, ztsPredGteMin, ztsPredGtMax, range);
+}
+
+unsigned long ztsRankOfLastInRange(ztseries *zts, zrangespec *range)
+{
+    if (!ztsIsInRange(zts, range))
+        return 0;
+    return ztsRankOfLast(zts, ztsPredGteMin, ztsPredGtMax, range);
+}
+
+unsigned long ztsRankOfFirstInLexRange(ztseries *zts, zlexrangespec *range)
+{
+    if (!ztsIsInLexRange(zts, range))
+        return 0;
+    return ztsRankOfFirst(zts, ztsPredLexGteMin, ztsPredLexGtMax, range);
+}
+
+unsigned long ztsRankOfLastInLexRange(ztseries *zts, zlexrangespec *range)
+{
+    if (!ztsIsInLexRange(zts, range))
+        return 0;
+    return ztsRankOfLast(zts, ztsPredLexGteMin, ztsPredLexGtMax, range);
+}
+
+/*******************************插入和删除*********************************/
+
+void ztsInsert(ztseries *zts, long long score, robj *obj)
+{
+    long long scores[ZTS_BLOCK_ENTRIES + 1];
+    robj *objs[ZTS_BLOCK_ENTRIES + 1];
+    ztsKey key = {score, obj};
+    unsigned long long delta;
+    ztsHeader *h;
+    unsigned long b;
+    int i, n;
+
+    // 比最后一个元素大，追加到最后一个块的末尾，块已满时新建一个块
+    h = zts->nblocks ? &zts->headers[zts->nblocks - 1] : NULL;
+    if (h == NULL || !ztsPredGteKey(h->last, h->block, h->count - 1, &key))
+    {
+        delta = h ? (unsigned long long)(score - h->last) : 0;
+        if (h == NULL || h->count == ZTS_BLOCK_ENTRIES || h->used + ztsVarintLen(delta) > ZTS_BLOCK_BYTES)
+        {
+            ztsHeadersInsert(zts, zts->nblocks);
+            h = &zts->headers[zts->nblocks - 1];
+            h->block = xm_malloc(sizeof(ztsBlock));
+            h->rank = zts->length;
+            h->first = score;
+            h->count = h->used = 0;
+        }
+        else
+        {
+            h->used += ztsVarintEncode(h->block->deltas + h->used, delta);
+        }
+        h->block->objs[h->count++] = obj;
+        h->last = score;
+        zts->length++;
+        if (zts->middle > 0)
+            zts->middle--;
+        return;
+    }
+
+    // 插入到中间，找到第一个最后一个元素不小于 (score, obj) 的块，解码之后插入再重新编码
+    b = ztsFindBlock(zts, ztsPredGteKey, &key);
+    h = &zts->headers[b];
+    n = h->count;
+    ztsDecodeBlock(h, scores);
+    memcpy(objs, h->block->objs, sizeof(robj *) * n);
+    for (i = 0; !ztsPredGteKey(scores[i], h->block, i, &key); i++)
+        ;
+    memmove(scores + i + 1, scores + i, sizeof(long long) * (n - i));
+    memmove(objs + i + 1, objs + i, sizeof(robj *) * (n - i));
+    scores[i] = score;
+    objs[i] = obj;
+    // 插入到最后一个块之外的块都要更新之后所有块的排位
+    if (b + 1 < zts->nblocks)
+        zts->middle += ZTS_MIDDLE_WEIGHT;
+    ztsRewriteBlock(zts, b, scores, objs, n + 1);
+    zts->length++;
+    ztsUpdateRanks(zts, b);
+}
+
+int ztsDelete(ztseries *zts, long long score, robj *obj)
+{
+    long long scores[ZTS_BLOCK_ENTRIES];
+    robj *objs[ZTS_BLOCK_ENTRIES];
+    ztsKey key = {score, obj};
+    ztsHeader *h;
+    unsigned long b;
+    int i, n;
+
+    b = ztsFindBlock(zts, ztsPredGteKey, &key);
+    if (b == zts->nblocks)
+        return 0;
+    h = &zts->headers[b];
+    n = h->count;
+    ztsDecodeBlock(h, scores);
+    for (i = 0; !ztsPredGteKey(scores[i], h->block, i, &key); i++)
+        ;
+    if (scores[i] != score || !equalStringObjects(h->block->objs[i], obj))
+        return 0;
+
+    memcpy(objs, h->block->objs, sizeof(robj *) * n);
+    decrRefCount(objs[i]);
+    memmove(scores + i, scores + i + 1, sizeof(long long) * (n - i - 1));
+    memmove(objs + i, objs + i + 1, sizeof(robj *) * (n - i - 1));
+    // 两个差值合并成一个之后不会变长，不需要分裂
+    // 删除最后一个块之外的元素同样要更新之后所有块的排位
+    if (b + 1 < zts->nblocks)
+        zts->middle += ZTS_MIDDLE_WEIGHT;
+    ztsRewriteBlock(zts, b, scores, objs, n - 1);
+    zts->length--;
+    ztsUpdateRanks(zts, b);
+    return 1;
+}
+
+/*********************************范围删除***********************************/
+
+unsigned long ztsDeleteRangeByRank(ztseries *zts, unsigned long start, unsigned long end, dict *dict)
+{
+    long long scores[ZTS_BLOCK_ENTRIES];
+    robj *objs[ZTS_BLOCK_ENTRIES];
+    unsigned long first, b, dropfrom = 0, drop = 0;
+    ztsHeader *h;
+    ztsPos p;
+    int i, n, lo, hi;
+
+    if (end > zts->length)
+        end = zts->length;
+    if (start < 1 || start > end)
+        return 0;
+
+    ztsGetElementByRank(zts, start, &p);
+    first = p.b;
+    for (b = first; b < zts->nblocks && zts->headers[b].rank < end; b++)
+    {
+        h = &zts->headers[b];
+        // 范围和这个块的交集在块中的下标
+        lo = start > h->rank + 1 ? start - h->rank - 1 : 0;
+        hi = end - h->rank < h->count ? end - h->rank - 1 : h->count - 1;
+        for (i = lo; i <= hi; i++)
+        {
+            // 字典和序列各持有成员对象的一个引用
+            dictDelete(dict, h->block->objs[i]);
+            decrRefCount(h->block->objs[i]);
+        }
+
+        // 整个块都在范围内，直接释放，这些块在块头数组中是连续的一段
+        if (lo == 0 && hi == h->count - 1)
+        {
+            if (drop++ == 0)
+                dropfrom = b;
+            xm_free(h->block);
+            continue;
+        }
+        // 只有范围两端的块需要重新编码剩下的元素
+        ztsDecodeBlock(h, scores);
+        for (i = 0, n = 0; i < h->count; i++)
+        {
+            if (i >= lo && i <= hi)
+                continue;
+            scores[n] = scores[i];
+            objs[n++] = h->block->objs[i];
+        }
+        ztsEncodeBlock(h, scores, objs, n);
+    }
+    ztsHeadersRemove(zts, dropfrom, drop);
+    zts->length -= end - start + 1;
+    ztsUpdateRanks(zts, first);
+    return end - start + 1;
+}
+
+unsigned long ztsDeleteRangeByScore(ztseries *zts, zrangespec *range, dict *dict)
+{
+    unsigned long first = ztsRankOfFirstInRange(zts, range);
+
+    if (first == 0)
+        return 0;
+    return ztsDeleteRangeByRank(zts, first, ztsRankOfLastInRange(zts, range), dict);
+}
+
+unsigned long ztsDeleteRangeByLex(ztseries *zts, zlexrangespec *range, dict *dict)
+{
+    unsigned long first = ztsRankOfFirstInLexRange(zts, range);
+
+    if (first == 0)
+        return 0;
+    return ztsDeleteRangeByRank(zts, first, ztsRankOfLastInLexRange(zts, range), dict);
+}
+
+size_t ztsBytes(ztseries *zts)
+{
+    return sizeof(*zts) + sizeof(ztsHeader) * zts->capacity + sizeof(ztsBlock) * zts->nblocks;
+}
@@ -0,0 +1,121 @@
+#ifndef HXM_TSERIES_H
+#define HXM_TSERIES_H
+
+#include "xmobject.h"
+#include "xmdict.h"
+#include "xmskiplist.h"
+
+/*
+分值都是整数的有序集合的排序索引，适合以毫秒时间戳为分值、基本按时间顺序追加的数据
+
+元素按 (score, member) 排序，依次保存在固定大小的块中。
+块中第一个元素的分值保存在块头中，之后每个元素只保存和前一个元素的分值之差，
+差值用 7 位一组的变长整数编码，相邻时间戳的差通常只需要一到两个字节。
+
+所有块头连续保存在一个数组中，块头记录块中第一个和最后一个元素的分值，以及块之前的元素个数，
+所以按分值和按排位查找都先在块头数组中二分查找到块，再在块内顺序解码，不需要访问其他块。
+
+追加到表尾时只需要在最后一个块的末尾写入一个差值，块满时新建一个块，复杂度为 O(1) 。
+在中间插入或删除元素时重新编码所在的块，块放不下时分裂成两个。
+按范围删除时，整个落在范围内的块直接释放，只有两端的块需要重新编码。
+*/
+
+// 每个块最多的元素个数
+#define ZTS_BLOCK_ENTRIES 128
+// 每个块保存差值的字节数，毫秒时间戳间隔一秒左右时差值占两个字节，和元素个数的上限差不多同时用满
+#define ZTS_BLOCK_BYTES 256
+// 一个 64 位差值编码之后最多占用的字节数
+#define ZTS_VARINT_MAX 10
+// 可以保存的分值的绝对值上限，超过这个值的整数不能用 double 精确表示
+#define ZTS_SCORE_MAX (1LL << 53)
+// 在中间插入或删除一个元素时 middle 增加的权重，追加一个元素时 middle 减一
+#define ZTS_MIDDLE_WEIGHT 4
+// middle 超过这个值时，插入和删除经常落在中间，每次都要更新之后所有块的排位，不再适合块序列
+#define ZTS_MIDDLE_LIMIT 256
+
+typedef struct ztsBlock
+{
+    // 第 2 个到最后一个元素和前一个元素的分值之差
+    unsigned char deltas[ZTS_BLOCK_BYTES];
+    // 元素的成员
+    robj *objs[ZTS_BLOCK_ENTRIES];
+} ztsBlock;
+
+// 查找、追加和更新排位只需要访问块头，不用访问块本身
+typedef struct ztsHeader
+{
+    // 块中第一个和最后一个元素的分值
+    long long first, last;
+    // 这个块之前的元素个数
+    unsigned long rank;
+    // 元素个数，以及 deltas 中已经使用的字节数
+    unsigned short count, used;
+    ztsBlock *block;
+} ztsHeader;
+
+typedef struct ztseries
+{
+    // 块头数组，按分值从小到大排列
+    ztsHeader *headers;
+    // 块的个数，以及块头数组的容量
+    unsigned long nblocks, capacity;
+    // 元素个数
+    unsigned long length;
+    // 在中间插入和删除的次数按 ZTS_MIDDLE_WEIGHT 加权，减去追加的次数，不小于 0
+    unsigned long middle;
+} ztseries;
+
+// 指向序列中的一个元素
+// off 是块中下一个元素的差值的起始位置，score 是当前元素的分值，沿着块顺序移动时不用从头解码
+typedef struct ztsPos
+{
+    ztseries *zts;
+    // 所在的块在块头数组中的下标，等于 nblocks 时表示不指向任何元素
+    unsigned long b;
+    int i;
+    unsigned int off;
+    long long score;
+} ztsPos;
+
+#define ztsPosScore(p) ((p)->score)
+#define ztsPosObj(p) ((p)->zts->headers[(p)->b].block->objs[(p)->i])
+#define ztsPosValid(p) ((p)->b < (p)->zts->nblocks)
+// 插入和删除是否经常落在中间，调用者应该转换为其他编码
+#define ztsTooManyMiddleOps(zts) ((zts)->middle > ZTS_MIDDLE_LIMIT)
+
+// 创建一个空的序列
+ztseries *ztsCreate(void);
+// 释放序列，以及序列中所有成员对象的引用
+void ztsFree(ztseries *zts);
+// 分值是否可以保存在序列中，也就是绝对值不超过 ZTS_SCORE_MAX 的整数
+int ztsScoreIsInteger(double score);
+// 插入成员 obj ，分值为 score ，序列接管调用者持有的 obj 的引用
+// 调用者需要保证序列中没有相同的成员。比所有元素都大的元素直接追加到表尾
+void ztsInsert(ztseries *zts, long long score, robj *obj);
+// 删除分值为 score 的成员 obj ，删除成功返回 1 ，元素不存在返回 0
+int ztsDelete(ztseries *zts, long long score, robj *obj);
+
+// 将 p 移动到下一个（前一个）元素，已经没有元素时返回 0
+int ztsNext(ztsPos *p);
+int ztsPrev(ztsPos *p);
+
+// 返回给定成员和分值的元素的排位，以 1 为起始值，元素不存在时返回 0
+unsigned long ztsGetRank(ztseries *zts, long long score, robj *o);
+// 找到排位为 rank 的元素（以 1 为起始值）保存到 *p ，rank 超出范围时返回 0
+int ztsGetElementByRank(ztseries *zts, unsigned long rank, ztsPos *p);
+// 返回第一个（最后一个）在范围内的元素的排位，以 1 为起始值，没有时返回 0
+unsigned long ztsRankOfFirstInRange(ztseries *zts, zrangespec *range);
+unsigned long ztsRankOfLastInRange(ztseries *zts, zrangespec *range);
+unsigned long ztsRankOfFirstInLexRange(ztseries *zts, zlexrangespec *range);
+unsigned long ztsRankOfLastInLexRange(ztseries *zts, zlexrangespec *range);
+
+// 删除所有分值（成员）在给定范围之内的元素，同时从字典中删除，返回被删除的元素个数
+unsigned long ztsDeleteRangeByScore(ztseries *zts, zrangespec *range, dict *dict);
+unsigned long ztsDeleteRangeByLex(ztseries *zts, zlexrangespec *range, dict *dict);
+// 删除排位在 [start, end] 之内的元素，排位以 1 为起始值，同时从字典中删除
+unsigned long ztsDeleteRangeByRank(ztseries *zts, unsigned long start, unsigned long end, dict *dict);
+
+// 返回序列占用的内存字节数
+size_t ztsBytes(ztseries *zts);
+
+#endif
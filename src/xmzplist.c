@@ -1172,6 +1172,397 @@ size_t ziplistBlobLen(unsigned char *zl)
     return intrev32ifbe(ZIPLIST_BYTES(zl));
 }
 
+/****************************位置跳跃索引******************************/
+
+zlSkipIndex *ziplistSkipIndexCreate(unsigned int step)
+{
+    zlSkipIndex *si = xm_malloc(sizeof(*si));
+    si->step = step ? step : ZIPLIST_SKIP_INDEX_STEP;
+    si->valid = 0;
+    si->size = 0;
+    si->offsets = NULL;
+    return si;
+}
+
+void ziplistSkipIndexRelease(zlSkipIndex *si)
+{
+    if (si == NULL)
+        return;
+    xm_free(si->offsets);
+    xm_free(si);
+}
+
+// 在索引末尾追加一个槽，空间不足时成倍扩展
+static void zipSkipIndexAppend(zlSkipIndex *si, uint32_t offset)
+{
+    if (si->valid == si->size)
+    {
+        si->size = si->size ? si->size * 2 : 8;
+        si->offsets = xm_realloc(si->offsets, si->size * sizeof(uint32_t));
+    }
+    si->offsets[si->valid++] = offset;
+}
+
+// 从最后一个有效槽开始向后遍历，补全索引直到覆盖第 slot 个槽，或者到达列表末端
+// 返回补全之后的有效槽数量
+static unsigned int zipSkipIndexExtend(zlSkipIndex *si, unsigned char *zl, unsigned int slot)
+{
+    unsigned char *p;
+    unsigned int i;
+
+    // 第 0 个槽总是表头节点
+    if (si->valid == 0)
+    {
+        if (ZIPLIST_ENTRY_HEAD(zl)[0] == ZIP_END)
+            return 0;
+        zipSkipIndexAppend(si, ZIPLIST_HEADER_SIZE);
+    }
+
+    while (si->valid <= slot)
+    {
+        p = zl + si->offsets[si->valid - 1];
+        for (i = 0; i < si->step && p[0] != ZIP_END; i++)
+            p += zipRawEntryLength(p);
+        // 后面已经没有第 valid*step 个节点了
+        if (p[0] == ZIP_END)
+            break;
+        zipSkipIndexAppend(si, p - zl);
+    }
+    return si->valid;
+}
+
+void ziplistSkipIndexTouch(zlSkipIndex *si, unsigned char *zl, unsigned char *p)
+{
+    uint32_t offset;
+    unsigned int min, max, mid;
+
+    if (si == NULL)
+        return;
+    if (p == NULL)
+    {
+        si->valid = 0;
+        return;
+    }
+
+    // 插入时新节点占据 p 原来的偏移量和索引，删除时后继节点前移到 p，
+    // 两种情况下偏移量小于等于 p 的槽仍然指向正确的索引，只需截掉之后的槽
+    offset = p - zl;
+    min = 0;
+    max = si->valid;
+    while (min < max)
+    {
+        mid = (min + max) / 2;
+        if (si->offsets[mid] <= offset)
+            min = mid + 1;
+        else
+            max = mid;
+    }
+    si->valid = min;
+}
+
+unsigned char *ziplistSkipIndexSeek(zlSkipIndex *si, unsigned char *zl, int index)
+{
+    unsigned char *p;
+    unsigned int len, slot, i;
+
+    if (si == NULL)
+        return ziplistIndex(zl, index);
+
+    // 负数索引在长度已知时转换为正数索引，离表尾足够近时直接从表尾向前遍历
+    if (index < 0)
+    {
+        len = intrev16ifbe(ZIPLIST_LENGTH(zl));
+        if (len == UINT16_MAX)
+            return ziplistIndex(zl, index);
+        if ((unsigned int)(-index) > len)
+            return NULL;
+        if ((unsigned int)(-index - 1) <= (len + index) % si->step)
+            return ziplistIndex(zl, index);
+        index += len;
+    }
+
+    // 定位到不超过 index 的最近一个槽
+    slot = index / si->step;
+    if (zipSkipIndexExtend(si, zl, slot) <= slot)
+        return NULL;
+
+    // 从槽开始最多遍历 step - 1 个节点
+    p = zl + si->offsets[slot];
+    for (i = slot * si->step; i < (unsigned int)index && p[0] != ZIP_END; i++)
+        p += zipRawEntryLength(p);
+
+    return (p[0] == ZIP_END) ? NULL : p;
+}
+
+unsigned int ziplistSkipIndexRank(zlSkipIndex *si, unsigned char *zl, unsigned char *p)
+{
+    unsigned char *q;
+    uint32_t offset = p - zl;
+    unsigned int rank = 0, min, max, mid, valid;
+
+    if (si != NULL)
+    {
+        // 让索引覆盖到 p 所在的位置
+        while (si->valid == 0 || si->offsets[si->valid - 1] < offset)
+        {
+            valid = si->valid;
+            if (zipSkipIndexExtend(si, zl, valid) == valid)
+                break;
+        }
+        if (si->valid > 0)
+        {
+            // 找到偏移量不超过 p 的最后一个槽
+            min = 0;
+            max = si->valid;
+            while (min < max)
+            {
+                mid = (min + max) / 2;
+                if (si->offsets[mid] <= offset)
+                    min = mid + 1;
+                else
+                    max = mid;
+            }
+            rank = (min - 1) * si->step;
+            q = zl + si->offsets[min - 1];
+        }
+        else
+        {
+            q = ZIPLIST_ENTRY_HEAD(zl);
+        }
+    }
+    else
+    {
+        q = ZIPLIST_ENTRY_HEAD(zl);
+    }
+
+    // 从槽开始向后数到 p
+    while (q < p && q[0] != ZIP_END)
+    {
+        q += zipRawEntryLength(q);
+        rank++;
+    }
+    return rank;
+}
+
+/****************************哈希域索引******************************/
+
+// 字符串的散列值，FNV-1a
+static uint32_t zipHashIndexHashString(unsigned char *s, unsigned int slen)
+{
+    uint32_t h = 2166136261u;
+    unsigned int i;
+
+    for (i = 0; i < slen; i++)
+    {
+        h ^= s[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+// 整数的散列值，ziplist 会把能转换成整数的字符串保存为整数，所以这类域按整数值计算
+static uint32_t zipHashIndexHashInteger(long long value)
+{
+    uint64_t x = (uint64_t)value;
+
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    return (uint32_t)x;
+}
+
+// 要查找的域的散列值，和同一个域保存到 ziplist 之后的散列值相同
+static uint32_t zipHashIndexHashKey(unsigned char *s, unsigned int slen)
+{
+    long long value;
+    unsigned char encoding;
+
+    if (zipTryEncoding(s, slen, &value, &encoding))
+        return zipHashIndexHashInteger(value);
+    return zipHashIndexHashString(s, slen);
+}
+
+// ziplist 中一个域节点的散列值
+static uint32_t zipHashIndexHashEntry(unsigned char *p)
+{
+    unsigned char *sval;
+    unsigned int slen;
+    long long lval;
+
+    ziplistGet(p, &sval, &slen, &lval);
+    if (sval)
+        return zipHashIndexHashString(sval, slen);
+    return zipHashIndexHashInteger(lval);
+}
+
+// 散列值的高 8 位作为指纹，0 留给空槽
+static uint8_t zipHashIndexFingerprint(uint32_t h)
+{
+    uint8_t fp = h >> 24;
+    return fp ? fp : 1;
+}
+
+static void zipHashIndexInsert(zlHashIndex *hi, uint32_t h, uint16_t offset)
+{
+    uint32_t mask = hi->size - 1, i = h & mask;
+
+    while (hi->fingerprints[i] != 0)
+        i = (i + 1) & mask;
+    hi->fingerprints[i] = zipHashIndexFingerprint(h);
+    hi->offsets[i] = offset;
+    hi->used++;
+}
+
+// 根据 zl 重建索引，zl 太大放不下 16 位偏移量时返回 0
+static int zipHashIndexBuild(zlHashIndex *hi, unsigned char *zl)
+{
+    size_t bytes = ziplistBlobLen(zl);
+    uint32_t size = 16, fields;
+    unsigned char *p;
+
+    if (bytes > UINT16_MAX)
+    {
+        hi->bytes = 0;
+        return 0;
+    }
+
+    // 装载因子不超过 1/2
+    fields = ziplistLen(zl) / 2;
+    while (size < fields * 2)
+        size *= 2;
+    if (size != hi->size)
+    {
+        hi->size = size;
+        hi->fingerprints = xm_realloc(hi->fingerprints, size);
+        hi->offsets = xm_realloc(hi->offsets, size * sizeof(uint16_t));
+    }
+    memset(hi->fingerprints, 0, size);
+    hi->used = 0;
+
+    p = ZIPLIST_ENTRY_HEAD(zl);
+    while (p[0] != ZIP_END)
+    {
+        zipHashIndexInsert(hi, zipHashIndexHashEntry(p), p - zl);
+        // 跳过值节点
+        p += zipRawEntryLength(p);
+        p += zipRawEntryLength(p);
+    }
+    hi->bytes = bytes;
+    return 1;
+}
+
+zlHashIndex *ziplistHashIndexCreate(void)
+{
+    zlHashIndex *hi = xm_malloc(sizeof(*hi));
+    hi->size = 0;
+    hi->used = 0;
+    hi->bytes = 0;
+    hi->fingerprints = NULL;
+    hi->offsets = NULL;
+    return hi;
+}
+
+void ziplistHashIndexRelease(zlHashIndex *hi)
+{
+    if (hi == NULL)
+        return;
+    xm_free(hi->fingerprints);
+    xm_free(hi->offsets);
+    xm_free(hi);
+}
+
+void ziplistHashIndexReset(zlHashIndex *hi)
+{
+    if (hi != NULL)
+        hi->bytes = 0;
+}
+
+unsigned char *ziplistHashIndexFind(zlHashIndex *hi, unsigned char *zl, unsigned char *s, unsigned int slen)
+{
+    unsigned char *p;
+    uint32_t h, mask, i;
+    uint8_t fp;
+
+    // 没有索引，或者索引过期并且无法重建，从表头开始逐个对比域
+    if (hi == NULL || (hi->bytes != ziplistBlobLen(zl) && !zipHashIndexBuild(hi, zl)))
+    {
+        p = ziplistIndex(zl, ZIPLIST_HEAD);
+        return p ? ziplistFind(p, s, slen, 1) : NULL;
+    }
+
+    h = zipHashIndexHashKey(s, slen);
+    fp = zipHashIndexFingerprint(h);
+    mask = hi->size - 1;
+    for (i = h & mask; hi->fingerprints[i] != 0; i = (i + 1) & mask)
+    {
+        // 指纹不同或者是墓碑的槽不需要读取 ziplist
+        if (hi->fingerprints[i] == fp && hi->offsets[i] != 0 &&
+            ziplistCompare(zl + hi->offsets[i], s, slen))
+            return zl + hi->offsets[i];
+    }
+    return NULL;
+}
+
+void ziplistHashIndexAdd(zlHashIndex *hi, unsigned char *zl, unsigned char *fptr)
+{
+    size_t offset = fptr - zl, bytes = ziplistBlobLen(zl);
+
+    // 在表尾推入节点不会移动已有的节点，新的域节点占据原来表尾标记的位置，
+    // 不满足这一点说明索引在推入之前就已经过期了
+    if (hi == NULL || hi->bytes == 0 || hi->bytes != offset + 1)
+        return;
+    if (bytes > UINT16_MAX || (hi->used + 1) * 4 > hi->size * 3)
+    {
+        hi->bytes = 0;
+        return;
+    }
+    zipHashIndexInsert(hi, zipHashIndexHashEntry(fptr), offset);
+    hi->bytes = bytes;
+}
+
+void ziplistHashIndexRemove(zlHashIndex *hi, unsigned char *zl, unsigned char *fptr)
+{
+    uint32_t mask, i;
+    uint16_t offset = fptr - zl;
+
+    if (hi == NULL || hi->bytes != ziplistBlobLen(zl))
+        return;
+
+    mask = hi->size - 1;
+    for (i = zipHashIndexHashEntry(fptr) & mask; hi->fingerprints[i] != 0; i = (i + 1) & mask)
+    {
+        if (hi->offsets[i] == offset)
+        {
+            // 留下墓碑，保证后面的槽仍然能被探测到
+            hi->offsets[i] = 0;
+            return;
+        }
+    }
+}
+
+void ziplistHashIndexMove(zlHashIndex *hi, unsigned char *zl, size_t oldbytes, size_t from, long delta)
+{
+    size_t bytes = ziplistBlobLen(zl);
+    uint32_t i;
+
+    if (hi == NULL || hi->bytes == 0)
+        return;
+    if (hi->bytes != oldbytes || bytes > UINT16_MAX)
+    {
+        hi->bytes = 0;
+        return;
+    }
+    if (delta != 0)
+    {
+        for (i = 0; i < hi->size; i++)
+        {
+            if (hi->fingerprints[i] != 0 && hi->offsets[i] > from)
+                hi->offsets[i] += delta;
+        }
+    }
+    hi->bytes = bytes;
+}
+
 void ziplistRepr(unsigned char *zl)
 {
     unsigned char *p;
@@ -1,7 +1,52 @@
+#ifndef HXM_ZIPLIST_H
+#define HXM_ZIPLIST_H
+
 #define ZIPLIST_HEAD 0
 #define ZIPLIST_TAIL 1
 
 #include "stdlib.h"
+#include <stdint.h>
+
+// 位置跳跃索引默认每隔多少个节点记录一次偏移量
+#define ZIPLIST_SKIP_INDEX_STEP 16
+// 节点数量达到这个值的 ziplist 才会为其建立跳跃索引
+#define ZIPLIST_SKIP_INDEX_MIN_ENTRIES 128
+
+// ziplist 的位置跳跃索引，独立于 ziplist 之外保存，不会被持久化
+// 第 i 个槽记录第 i*step 个节点相对于 zl 的字节偏移量
+// 修改 ziplist 只会改变修改位置之后的节点，所以只需截断之后的槽，需要时再向后补全
+typedef struct zlSkipIndex
+{
+    // 每隔 step 个节点记录一次偏移量
+    unsigned int step;
+    // offsets 中有效的槽数量
+    unsigned int valid;
+    // offsets 数组的容量
+    unsigned int size;
+    // 偏移量数组
+    uint32_t *offsets;
+} zlSkipIndex;
+
+// 域的数量达到这个值的哈希 ziplist 才会为其建立域索引
+#define ZIPLIST_HASH_INDEX_MIN_FIELDS 16
+
+// 哈希 ziplist 的域索引，独立于 ziplist 之外保存，不会被持久化
+// 开放寻址的散列表，每个槽保存域的 1 字节指纹和域节点相对于 zl 的 2 字节偏移量，
+// 查找时只有指纹相同的槽才需要和 ziplist 中的节点对比。
+// ziplist 超过 64KB 时偏移量放不下，这时不建立索引，退化为线性查找
+typedef struct zlHashIndex
+{
+    // 槽的数量，总是 2 的幂
+    uint32_t size;
+    // 已经占用的槽数量，包括删除域之后留下的墓碑
+    uint32_t used;
+    // 索引对应的 ziplist 的总字节数，为 0 或者和 ziplist 不一致时表示索引需要重建
+    uint32_t bytes;
+    // 每个槽的指纹，0 表示空槽
+    uint8_t *fingerprints;
+    // 每个槽中域节点的偏移量，指纹不为 0 而偏移量为 0 表示墓碑
+    uint16_t *offsets;
+} zlHashIndex;
 
 // 创建并返回一个新的 ziplist
 unsigned char *ziplistNew(void);
@@ -30,4 +75,34 @@ unsigned int ziplistLen(unsigned char *zl);
 // 返回整个 ziplist 占用的内存字节数
 size_t ziplistBlobLen(unsigned char *zl);
 // 打印ziplist的一些基本参数
-void ziplistRepr(unsigned char *zl);
\ No newline at end of file
+void ziplistRepr(unsigned char *zl);
+
+// 创建一个每隔 step 个节点记录一次偏移量的跳跃索引
+zlSkipIndex *ziplistSkipIndexCreate(unsigned int step);
+// 释放跳跃索引
+void ziplistSkipIndexRelease(zlSkipIndex *si);
+// 在 zl 的 p 位置插入或删除节点之后调用，使位于 p 之后的槽失效。p 为 NULL 时清空整个索引
+void ziplistSkipIndexTouch(zlSkipIndex *si, unsigned char *zl, unsigned char *p);
+// 和 ziplistIndex 相同，但借助跳跃索引从最近的槽开始遍历。si 为 NULL 时退化为 ziplistIndex
+unsigned char *ziplistSkipIndexSeek(zlSkipIndex *si, unsigned char *zl, int index);
+// 返回 p 所指向节点的索引（从 0 开始），si 为 NULL 时从表头开始计数
+unsigned int ziplistSkipIndexRank(zlSkipIndex *si, unsigned char *zl, unsigned char *p);
+
+// 创建一个空的域索引，第一次查找时才会建立
+zlHashIndex *ziplistHashIndexCreate(void);
+// 释放域索引
+void ziplistHashIndexRelease(zlHashIndex *hi);
+// 使索引失效，下一次查找时重建
+void ziplistHashIndexReset(zlHashIndex *hi);
+// 在按域、值交替保存的 zl 中查找域 s ，返回域节点的指针，找不到返回 NULL 。
+// 索引过期时先重建，hi 为 NULL 或者 zl 太大时退化为 ziplistFind
+unsigned char *ziplistHashIndexFind(zlHashIndex *hi, unsigned char *zl, unsigned char *s, unsigned int slen);
+// 在 zl 的表尾推入新的域和值之后调用，fptr 指向新的域节点
+void ziplistHashIndexAdd(zlHashIndex *hi, unsigned char *zl, unsigned char *fptr);
+// 删除 fptr 指向的域之前调用，把它的槽改为墓碑
+void ziplistHashIndexRemove(zlHashIndex *hi, unsigned char *zl, unsigned char *fptr);
+// 修改 zl 之后调用，oldbytes 为修改之前 zl 的总字节数，
+// 偏移量大于 from 的域节点都向后移动了 delta 字节，其他节点没有变化
+void ziplistHashIndexMove(zlHashIndex *hi, unsigned char *zl, size_t oldbytes, size_t from, long delta);
+
+#endif
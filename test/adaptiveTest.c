@@ -0,0 +1,112 @@
+#include "test.h"
+#include "xmadaptive.h"
+#include "xmt_list.h"
+#include "xmserver.h"
+#include "xmobject.h"
+
+#include <stdio.h>
+
+// 在时刻 clock 对 o 做 n 次读（write 为 0）或写操作
+static void track(robj *o, int write, int n, unsigned int clock)
+{
+    while (n--)
+        objectTrackAccessAt(o, write, clock);
+}
+
+int main()
+{
+    robj *o, *w, *ele;
+    unsigned int clock = 1000;
+    int i, ok;
+
+    createSharedObjects();
+    registerObjectTypes();
+    server.encoding_adaptive = 1;
+
+    // 读和写分别计数，只有读达到阈值时只是读热
+    o = createZiplistObject();
+    track(o, 0, REDIS_ENCODING_HOT_READS - 1, clock);
+    ok = objectAccessState(o) == 0;
+    track(o, 0, 1, clock);
+    ok = ok && objectAccessState(o) == OBJECT_ACCESS_READ_HOT && server.stat_encoding_hot_keys == 1;
+    test_cond("Reads make a key read-hot", ok);
+    test_cond("Read-hot key shrinks the limit by READ_HOT",
+              !objectEncodingExceeds(o, 512 / REDIS_ENCODING_READ_HOT_FACTOR, 512) &&
+                  objectEncodingExceeds(o, 512 / REDIS_ENCODING_READ_HOT_FACTOR + 1, 512));
+
+    // 写热的阈值更低，边界条件缩小得更多
+    w = createZiplistObject();
+    track(w, 1, REDIS_ENCODING_HOT_WRITES, clock);
+    ok = objectAccessState(w) == OBJECT_ACCESS_WRITE_HOT && server.stat_encoding_hot_keys == 2;
+    test_cond("Writes make a key write-hot", ok);
+    test_cond("Write-hot key shrinks the limit by WRITE_HOT",
+              !objectEncodingExceeds(w, 512 / REDIS_ENCODING_WRITE_HOT_FACTOR, 512) &&
+                  objectEncodingExceeds(w, 512 / REDIS_ENCODING_WRITE_HOT_FACTOR + 1, 512));
+    track(w, 0, REDIS_ENCODING_HOT_READS, clock);
+    test_cond("Both states are kept", objectAccessState(w) == (OBJECT_ACCESS_READ_HOT | OBJECT_ACCESS_WRITE_HOT) &&
+                                          server.stat_encoding_hot_keys == 2);
+
+    // 计数每个周期减半，降到 HOT 以下但不低于 COLD 时仍然是热键
+    clock += REDIS_ENCODING_DECAY_SECONDS;
+    track(o, 0, 1, clock);
+    ok = objectAccessState(o) == OBJECT_ACCESS_READ_HOT;
+    clock += 2 * REDIS_ENCODING_DECAY_SECONDS;
+    track(o, 0, 1, clock);
+    ok = ok && objectAccessState(o) == OBJECT_ACCESS_READ_HOT;
+    test_cond("Decayed key stays hot above the cold threshold", ok);
+
+    // 同样次数的读，从冷的状态开始不会成为热键
+    ele = createZiplistObject();
+    track(ele, 0, REDIS_ENCODING_COLD_READS + 1, clock);
+    test_cond("Same count from cold is not hot", objectAccessState(ele) == 0);
+    decrRefCount(ele);
+
+    // 再衰减一个周期之后低于 COLD ，离开热状态，读写都冷
+    clock += REDIS_ENCODING_DECAY_SECONDS;
+    track(o, 0, 1, clock);
+    ok = objectAccessState(o) == OBJECT_ACCESS_COLD && server.stat_encoding_hot_keys == 1;
+    test_cond("Key becomes cold below the cold threshold", ok);
+    test_cond("Cold key grows the limit by COLD",
+              !objectEncodingExceeds(o, 512 * REDIS_ENCODING_COLD_FACTOR, 512) &&
+                  objectEncodingExceeds(o, 512 * REDIS_ENCODING_COLD_FACTOR + 1, 512));
+    test_cond("Only small cold keys are compacted",
+              objectEncodingShouldCompact(o, 256, 512) && !objectEncodingShouldCompact(o, 257, 512) &&
+                  !objectEncodingShouldCompact(w, 10, 512));
+
+    // 读写的状态分别衰减，写的计数很久没有增加之后写热的状态先消失
+    clock += 4 * REDIS_ENCODING_DECAY_SECONDS;
+    track(w, 0, REDIS_ENCODING_HOT_READS, clock);
+    test_cond("Write-hot decays separately", objectAccessState(w) == OBJECT_ACCESS_READ_HOT);
+
+    // 释放对象时删除访问记录，热键数量跟着减少
+    decrRefCount(w);
+    test_cond("Freeing a hot key drops the record", server.stat_encoding_hot_keys == 0);
+    decrRefCount(o);
+
+    // 写热的列表提前转换为双端链表，关闭自适应模式时按配置的边界条件转换
+    server.list_max_ziplist_entries = 512;
+    server.list_max_ziplist_value = 64;
+    o = createZiplistObject();
+    for (i = 0; i < 200; i++)
+    {
+        ele = createStringObjectFromLongLong(i);
+        listTypePush(o, ele, REDIS_TAIL);
+        decrRefCount(ele);
+    }
+    ok = o->encoding == REDIS_ENCODING_LINKEDLIST && listTypeLength(o) == 200;
+    decrRefCount(o);
+    server.encoding_adaptive = 0;
+    o = createZiplistObject();
+    for (i = 0; i < 200; i++)
+    {
+        ele = createStringObjectFromLongLong(i);
+        listTypePush(o, ele, REDIS_TAIL);
+        decrRefCount(ele);
+    }
+    ok = ok && o->encoding == REDIS_ENCODING_ZIPLIST && objectAccessState(o) == 0;
+    decrRefCount(o);
+    test_cond("Write-hot list converts early", ok);
+
+    test_report();
+    return 0;
+}
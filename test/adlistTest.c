@@ -2,6 +2,15 @@
 #include "xmadlist.h"
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+long long usec(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (((long long)tv.tv_sec) * 1000000) + tv.tv_usec;
+}
 
 void printlist(list *l)
 {
@@ -47,5 +56,175 @@ int main()
     listDelNode(l, node);
     printlist(l);
 
+    // 侵入式链表：节点嵌入在结构体中，迭代时允许删除当前节点
+    {
+        struct item
+        {
+            int v;
+            ilistNode node;
+        } items[5];
+        ilist il = {{0}}, moved;
+        ilistIter it;
+        ilistNode *n;
+        int i, sum = 0, order = 1, expect;
+
+        for (i = 0; i < 5; i++)
+        {
+            items[i].v = i;
+            ilistAddTail(&il, &items[i].node);
+        }
+        ilistRewind(&il, &it, AL_START_HEAD);
+        while ((n = ilistNext(&it)) != NULL)
+        {
+            struct item *e = ilistEntry(n, struct item, node);
+            if (e->v % 2)
+                ilistDel(&il, n);
+        }
+        test_cond("intrusive list delete while iterating", ilistLength(&il) == 3);
+
+        ilistMove(&moved, &il);
+        expect = 4;
+        ilistRewind(&moved, &it, AL_START_TAIL);
+        while ((n = ilistNext(&it)) != NULL)
+        {
+            struct item *e = ilistEntry(n, struct item, node);
+            sum += e->v;
+            if (e->v != expect)
+                order = 0;
+            expect -= 2;
+        }
+        test_cond("intrusive list move keeps order", ilistLength(&il) == 0 && ilistFirst(&il) == NULL &&
+                                                         ilistLength(&moved) == 3 && sum == 6 && order);
+    }
+
+    // 位置索引和逐个遍历的结果必须一致
+    {
+        list *a = listCreate(), *b = listCreate();
+        long i, j, index, ok = 1;
+
+        listEnableIndex(b);
+        for (i = 0; i < 20000 && ok; i++)
+        {
+            long v = rand();
+            long len = listLength(a);
+            int op = rand() % 6;
+
+            if (op == 0)
+            {
+                listAddNodeHead(a, (void *)v);
+                listAddNodeHead(b, (void *)v);
+            }
+            else if (op == 1)
+            {
+                listAddNodeTail(a, (void *)v);
+                listAddNodeTail(b, (void *)v);
+            }
+            else if (op == 2 || op == 3)
+            {
+                index = rand() % (len + 1);
+                listInsertNodeAt(a, index, (void *)v);
+                listInsertNodeAt(b, index, (void *)v);
+            }
+            else if (op == 4 && len > 0)
+            {
+                // 删除表头、表尾或中间节点
+                index = (rand() % 3 == 0) ? 0 : (rand() % 2 ? len - 1 : rand() % len);
+                listDelNode(a, listIndex(a, index));
+                listDelNode(b, listIndex(b, index));
+            }
+            else if (op == 5 && len > 1)
+            {
+                listRotate(a);
+                listRotate(b);
+            }
+
+            for (j = 0; j < 4 && listLength(a); j++)
+            {
+                index = rand() % (2 * listLength(a)) - listLength(a);
+                if (listIndex(a, index)->value != listIndex(b, index)->value)
+                    ok = 0;
+            }
+        }
+        test_cond("indexed list matches plain list", ok && listLength(a) == listLength(b));
+        listRelease(a);
+        listRelease(b);
+    }
+
+    // 给出位置的中间插入和删除原地更新索引，索引一直有效，结果和逐个遍历一致
+    {
+        list *a = listCreate(), *b = listCreate();
+        listNode *na, *nb;
+        long i, j, index, ok = 1;
+
+        for (i = 0; i < 2000; i++)
+        {
+            listAddNodeTail(a, (void *)i);
+            listAddNodeTail(b, (void *)i);
+        }
+        listEnableIndex(b);
+        for (i = 0; i < 20000 && ok; i++)
+        {
+            long v = rand();
+            long len = listLength(a);
+
+            index = rand() % len;
+            na = listIndex(a, index);
+            nb = listIndex(b, index);
+            if (rand() % 2 || len < 100)
+            {
+                int after = rand() % 2;
+                listInsertNode(a, na, (void *)v, after);
+                listInsertNodeWithIndex(b, nb, (void *)v, after, index);
+            }
+            else
+            {
+                listDelNode(a, na);
+                listDelNodeWithIndex(b, nb, index);
+            }
+            ok = b->index->valid;
+            for (j = 0; j < 4 && ok; j++)
+            {
+                index = rand() % listLength(a);
+                ok = listIndex(a, index)->value == listIndex(b, index)->value;
+            }
+        }
+        test_cond("middle insert and delete keep the index valid", ok && listLength(a) == listLength(b));
+        listRelease(a);
+        listRelease(b);
+    }
+
+    // 在千万级别的链表上比较按位置访问的耗时
+    {
+        list *big = listCreate();
+        long i, num = 10000000, lookups = 100;
+        long long start;
+
+        for (i = 0; i < num; i++)
+            listAddNodeTail(big, (void *)i);
+
+        start = usec();
+        for (i = 0; i < lookups; i++)
+            listIndex(big, rand() % num);
+        printf("%ld lookups without index, %ld element list, %lldusec\n", lookups, num, usec() - start);
+
+        start = usec();
+        listEnableIndex(big);
+        printf("build index, %ld element list, %lldusec\n", num, usec() - start);
+
+        start = usec();
+        for (i = 0; i < lookups * 10000; i++)
+            listIndex(big, rand() % num);
+        printf("%ld lookups with index, %ld element list, %lldusec\n", lookups * 10000, num, usec() - start);
+
+        start = usec();
+        for (i = 0; i < lookups * 1000; i++)
+            listInsertNodeAt(big, rand() % listLength(big), (void *)i);
+        printf("%ld inserts with index, %ld element list, %lldusec\n", lookups * 1000, num, usec() - start);
+
+        test_cond("indexed lookup after inserts", listLength(big) == num + lookups * 1000 &&
+                                                      listIndex(big, -1)->value == (void *)(num - 1));
+        listRelease(big);
+    }
+
     test_report();
 }
\ No newline at end of file
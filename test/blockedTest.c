@@ -0,0 +1,193 @@
+#include "test.h"
+#include "xmblocked.h"
+#include "xmt_list.h"
+#include "xmt_string.h"
+#include "xmmalloc.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define NUMCLIENTS 200
+
+static unsigned int dbSdsHash(const void *key)
+{
+    return dictGenHashFunction(key, sdslen((sds)key));
+}
+
+static void dbSdsDestructor(void *privdata, void *val)
+{
+    DICT_NOTUSED(privdata);
+    sdsfree(val);
+}
+
+// 数据库键空间，键为 sds ，值为对象
+static dictType dbDictType = {
+    dbSdsHash,                /* hash function */
+    NULL,                     /* key dup */
+    NULL,                     /* val dup */
+    dictSdsKeyCompare,        /* key compare */
+    dbSdsDestructor,          /* key destructor */
+    dictRedisObjectDestructor /* val destructor */
+};
+
+static redisDb db;
+
+static redisClient *createTestClient(void)
+{
+    redisClient *c = xm_calloc(sizeof(*c));
+
+    c->db = &db;
+    ilistInit(&c->reply);
+    return c;
+}
+
+// 比较客户端收到的回复，之后清空回复缓冲区
+static int replyIs(redisClient *c, const char *s)
+{
+    int ok = c->bufpos == (int)strlen(s) && memcmp(c->buf, s, c->bufpos) == 0;
+
+    c->bufpos = 0;
+    return ok;
+}
+
+// 检查超时堆是否满足小根堆的性质，并且每个客户端记录的位置正确
+static int heapIsValid(void)
+{
+    unsigned long i;
+
+    for (i = 0; i < server.bpop_timeouts_used; i++)
+    {
+        if (server.bpop_timeouts[i]->bpop.heap_index != (long)i)
+            return 0;
+        if (i > 0 && server.bpop_timeouts[(i - 1) / 2]->bpop.timeout > server.bpop_timeouts[i]->bpop.timeout)
+            return 0;
+    }
+    return 1;
+}
+
+// 在 key 上阻塞客户端
+static void block(redisClient *c, const char *key, mstime_t timeout, robj *target, int where)
+{
+    robj *k = createStringObject((char *)key, strlen(key));
+
+    blockForKeys(c, &k, 1, timeout, target, where);
+    decrRefCount(k);
+}
+
+// 创建只有一个元素的列表键 key ，会让等待这个键的客户端就绪
+static void addList(const char *key, const char *value)
+{
+    robj *k = createStringObject((char *)key, strlen(key));
+    robj *v = createStringObject((char *)value, strlen(value));
+    robj *o = createZiplistObject();
+
+    listTypePush(o, v, REDIS_TAIL);
+    dbAdd(&db, k, o);
+    decrRefCount(v);
+    decrRefCount(k);
+}
+
+int main()
+{
+    redisClient *clients[NUMCLIENTS], *c;
+    char key[32];
+    int i, ok;
+
+    createSharedObjects();
+    registerObjectTypes();
+    ilistInit(&server.ready_keys);
+    db.dict = dictCreate(&dbDictType, NULL);
+    db.expires = dictCreate(&dbDictType, NULL);
+    db.blocking_keys = dictCreate(&keylistDictType, NULL);
+    db.ready_keys = dictCreate(&setDictType, NULL);
+
+    // 随机的超时时间插入超时堆，一部分客户端永不超时，不进入堆
+    ok = 1;
+    for (i = 0; i < NUMCLIENTS; i++)
+    {
+        clients[i] = createTestClient();
+        snprintf(key, sizeof(key), "k%d", i % 5);
+        block(clients[i], key, i % 10 == 0 ? 0 : 1 + rand() % 1000, NULL, REDIS_HEAD);
+        ok = ok && heapIsValid();
+    }
+    ok = ok && server.bpop_timeouts_used == NUMCLIENTS - NUMCLIENTS / 10 && server.bpop_blocked_clients == NUMCLIENTS;
+    test_cond("Timeout heap keeps its order on insert", ok);
+
+    // 提前解除阻塞的客户端从堆的中间删除
+    ok = 1;
+    for (i = 0; i < NUMCLIENTS; i += 3)
+    {
+        unblockClient(clients[i]);
+        ok = ok && clients[i]->bpop.heap_index == -1 && heapIsValid();
+    }
+    test_cond("Timeout heap keeps its order on removal from the middle", ok);
+
+    // 只有超时时间不晚于 now 的客户端超时，收到空回复
+    handleBlockedClientsTimeout(500);
+    ok = heapIsValid();
+    for (i = 0; i < NUMCLIENTS; i++)
+    {
+        c = clients[i];
+        if (i % 3 == 0)
+            ok = ok && c->bufpos == 0;
+        else if (c->bpop.timeout != 0 && c->bpop.timeout <= 500)
+            ok = ok && !(c->flags & REDIS_BLOCKED) && replyIs(c, "*-1\r\n");
+        else
+            ok = ok && (c->flags & REDIS_BLOCKED) && c->bufpos == 0;
+    }
+    test_cond("Only expired clients time out", ok);
+
+    // 解除全部阻塞之后，键的等待链表、超时堆和计数都被清理干净
+    for (i = 0; i < NUMCLIENTS; i++)
+        unblockClient(clients[i]);
+    ok = dictSize(db.blocking_keys) == 0 && server.bpop_timeouts_used == 0 && server.bpop_blocked_clients == 0;
+    for (i = 0; i < NUMCLIENTS; i++)
+        ok = ok && dictSize(clients[i]->bpop.keys) == 0 && !(clients[i]->flags & REDIS_BLOCKED);
+    test_cond("unblockClient cleans up keys, heap and counters", ok);
+
+    // 在多个键上阻塞的 BRPOPLPUSH 客户端，解除阻塞时释放目标键
+    {
+        robj *keys[2], *target = createStringObject("dst", 3);
+
+        c = clients[0];
+        keys[0] = createStringObject("a", 1);
+        keys[1] = createStringObject("b", 1);
+        blockForKeys(c, keys, 2, 100, target, REDIS_TAIL);
+        ok = dictSize(db.blocking_keys) == 2 && target->refcount == 2 && server.bpop_timeouts_used == 1;
+        unblockClient(c);
+        ok = ok && dictSize(db.blocking_keys) == 0 && target->refcount == 1 && c->bpop.target == NULL &&
+             server.bpop_timeouts_used == 0;
+        decrRefCount(keys[0]);
+        decrRefCount(keys[1]);
+        decrRefCount(target);
+        test_cond("unblockClient releases every key and the target", ok);
+    }
+
+    // 同一个键上的客户端按阻塞的先后顺序服务，列表弹空之后剩下的客户端继续阻塞
+    block(clients[1], "q", 0, NULL, REDIS_HEAD);
+    block(clients[2], "q", 0, NULL, REDIS_HEAD);
+    addList("q", "x");
+    handleClientsBlockedOnLists();
+    ok = replyIs(clients[1], "*2\r\n$1\r\nq\r\n$1\r\nx\r\n") && clients[2]->bufpos == 0 &&
+         (clients[2]->flags & REDIS_BLOCKED) && dictSize(db.dict) == 0 && dictSize(db.ready_keys) == 0;
+    unblockClient(clients[2]);
+    test_cond("Blocked clients are served in FIFO order", ok);
+
+    // BRPOPLPUSH 创建的目标列表在同一次调用中让等待它的客户端就绪
+    {
+        robj *target = createStringObject("dst", 3);
+
+        block(clients[3], "src", 0, target, REDIS_TAIL);
+        block(clients[4], "dst", 0, NULL, REDIS_HEAD);
+        decrRefCount(target);
+        addList("src", "v");
+        handleClientsBlockedOnLists();
+        ok = replyIs(clients[3], "$1\r\nv\r\n") && replyIs(clients[4], "*2\r\n$3\r\ndst\r\n$1\r\nv\r\n") &&
+             dictSize(db.dict) == 0 && dictSize(db.ready_keys) == 0 && dictSize(db.blocking_keys) == 0 &&
+             server.bpop_blocked_clients == 0;
+        test_cond("Keys made ready while serving are served in the same call", ok);
+    }
+
+    test_report();
+    return 0;
+}
@@ -0,0 +1,135 @@
+#include "xmt_zset.h"
+#include "xmbtree.h"
+#include "xmskiplist.h"
+#include "xmobject.h"
+#include "xmmalloc.h"
+#include "xmsds.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+跳跃表和 B+ 树的对比测试，两者插入同样的成员，依次测量：
+插入、ZRANK 、按排位查找、从随机位置开始取 100 个元素的范围查询，以及逐个删除所有元素
+
+用法：btreeBench [元素个数]，默认 1000000 个元素，分值是随机的 double ，成员是 "member:N"
+*/
+
+#define LOOKUPS 100000
+#define RANGE_LEN 100
+
+int main(int argc, char **argv)
+{
+    unsigned long n = argc > 1 ? strtoul(argv[1], NULL, 10) : 1000000;
+    unsigned long i, j, sum = 0;
+    robj **objs = xm_malloc(sizeof(robj *) * n);
+    double *scores = xm_malloc(sizeof(double) * n);
+    unsigned long *picks = xm_malloc(sizeof(unsigned long) * LOOKUPS);
+    zskiplist *zsl = zslCreate();
+    zbtree *zbt = zbtCreate();
+    zskiplistNode *node;
+    zbtPos p;
+    char buf[32];
+    long long start, zsltime[5], zbttime[5];
+
+    srand(1);
+    createSharedObjects();
+    registerObjectTypes();
+    for (i = 0; i < n; i++)
+    {
+        snprintf(buf, sizeof(buf), "member:%lu", i);
+        objs[i] = createStringObject(buf, strlen(buf));
+        scores[i] = (double)rand() / RAND_MAX * 1e9;
+    }
+    for (i = 0; i < LOOKUPS; i++)
+        picks[i] = (unsigned long)rand() % n;
+
+    // 插入
+    start = ustime();
+    for (i = 0; i < n; i++)
+        zslInsert(zsl, scores[i], objs[i]);
+    zsltime[0] = ustime() - start;
+    start = ustime();
+    for (i = 0; i < n; i++)
+    {
+        incrRefCount(objs[i]);
+        zbtInsert(zbt, scores[i], objs[i]);
+    }
+    zbttime[0] = ustime() - start;
+
+    // ZRANK
+    start = ustime();
+    for (i = 0; i < LOOKUPS; i++)
+        sum += zslGetRank(zsl, scores[picks[i]], objs[picks[i]]);
+    zsltime[1] = ustime() - start;
+    start = ustime();
+    for (i = 0; i < LOOKUPS; i++)
+        sum -= zbtGetRank(zbt, scores[picks[i]], objs[picks[i]]);
+    zbttime[1] = ustime() - start;
+
+    // 按排位查找
+    start = ustime();
+    for (i = 0; i < LOOKUPS; i++)
+        sum += (unsigned long)zslGetElementByRank(zsl, picks[i] + 1)->score;
+    zsltime[2] = ustime() - start;
+    start = ustime();
+    for (i = 0; i < LOOKUPS; i++)
+    {
+        zbtGetElementByRank(zbt, picks[i] + 1, &p);
+        sum -= (unsigned long)zbtPosScore(&p);
+    }
+    zbttime[2] = ustime() - start;
+
+    // 从一个分值开始向后取 RANGE_LEN 个元素，和 ZRANGEBYSCORE ... LIMIT 0 100 一样
+    start = ustime();
+    for (i = 0; i < LOOKUPS; i++)
+    {
+        zrangespec range = {scores[picks[i]], 1e9, 0, 0};
+
+        node = zslFirstInRange(zsl, &range);
+        for (j = 0; j < RANGE_LEN && node != NULL; j++, node = node->level[0].forward)
+            sum += sdslen(node->obj.ptr);
+    }
+    zsltime[3] = ustime() - start;
+    start = ustime();
+    for (i = 0; i < LOOKUPS; i++)
+    {
+        zrangespec range = {scores[picks[i]], 1e9, 0, 0};
+        int more = zbtFirstInRange(zbt, &range, &p);
+
+        for (j = 0; j < RANGE_LEN && more; j++, more = zbtNext(&p))
+            sum -= sdslen(zbtPosObj(&p)->ptr);
+    }
+    zbttime[3] = ustime() - start;
+
+    printf("N=%lu, B+ tree %zu bytes (%.1f B/elem)\n", n, zbtBytes(zbt), (double)zbtBytes(zbt) / n);
+
+    // 逐个删除
+    start = ustime();
+    for (i = 0; i < n; i++)
+        zslDelete(zsl, scores[i], objs[i]);
+    zsltime[4] = ustime() - start;
+    start = ustime();
+    for (i = 0; i < n; i++)
+        zbtDelete(zbt, scores[i], objs[i]);
+    zbttime[4] = ustime() - start;
+
+    printf("           insert      ZRANK    by-rank   range(%d)  delete-all\n", RANGE_LEN);
+    printf("skiplist  %7.2fs  %7.2fus  %7.2fus  %7.2fus  %7.2fs\n", zsltime[0] / 1e6, (double)zsltime[1] / LOOKUPS,
+           (double)zsltime[2] / LOOKUPS, (double)zsltime[3] / LOOKUPS, zsltime[4] / 1e6);
+    printf("btree     %7.2fs  %7.2fus  %7.2fus  %7.2fus  %7.2fs\n", zbttime[0] / 1e6, (double)zbttime[1] / LOOKUPS,
+           (double)zbttime[2] / LOOKUPS, (double)zbttime[3] / LOOKUPS, zbttime[4] / 1e6);
+    // 使用一下结果，避免查找被编译器优化掉
+    if (sum == 1)
+        printf("\n");
+
+    zslFree(zsl);
+    zbtFree(zbt);
+    for (i = 0; i < n; i++)
+        decrRefCount(objs[i]);
+    xm_free(objs);
+    xm_free(scores);
+    xm_free(picks);
+    return 0;
+}
@@ -0,0 +1,281 @@
+#include "test.h"
+#include "xmbtree.h"
+#include "xmskiplist.h"
+#include "xmdict.h"
+#include "xmobject.h"
+#include "xmt_string.h"
+#include "xmmalloc.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+// 跳跃表的字典以节点中嵌入的成员为键，不负责释放
+static dictType nodeDictType = {
+    dictEncObjHash,       /* hash function */
+    NULL,                 /* key dup */
+    NULL,                 /* val dup */
+    dictEncObjKeyCompare, /* key compare */
+    NULL,                 /* key destructor */
+    NULL                  /* val destructor */
+};
+
+// B+ 树的字典持有成员的一个引用，值是分值
+static dictType objDictType = {
+    dictEncObjHash,            /* hash function */
+    NULL,                      /* key dup */
+    NULL,                      /* val dup */
+    dictEncObjKeyCompare,      /* key compare */
+    dictRedisObjectDestructor, /* key destructor */
+    NULL                       /* val destructor */
+};
+
+// 跳跃表和 B+ 树，各自带一个以成员为键的字典
+typedef struct pair
+{
+    zskiplist *zsl;
+    dict *sd;
+    zbtree *zbt;
+    dict *bd;
+} pair;
+
+static void pairInit(pair *zp)
+{
+    zp->zsl = zslCreate();
+    zp->sd = dictCreate(&nodeDictType, NULL);
+    zp->zbt = zbtCreate();
+    zp->bd = dictCreate(&objDictType, NULL);
+}
+
+static void pairFree(pair *zp)
+{
+    dictRelease(zp->sd);
+    zslFree(zp->zsl);
+    dictRelease(zp->bd);
+    zbtFree(zp->zbt);
+}
+
+// 往跳跃表和 B+ 树中插入同样的元素
+// 跳跃表复制成员，字典以节点中的成员为键；B+ 树和它的字典各持有 ele 的一个引用
+static void pairAdd(pair *zp, double score, robj *ele)
+{
+    zskiplistNode *node;
+
+    node = zslInsert(zp->zsl, score, ele);
+    dictAdd(zp->sd, &node->obj, NULL);
+
+    incrRefCount(ele);
+    zbtInsert(zp->zbt, score, ele);
+    dictSetDoubleVal(dictAddRaw(zp->bd, ele), score);
+    incrRefCount(ele);
+}
+
+static void pairDel(pair *zp, double score, robj *ele, int *ok)
+{
+    // 跳跃表的字典键在节点中，要先从字典中删除
+    dictDelete(zp->sd, ele);
+    *ok = *ok && zslDelete(zp->zsl, score, ele) == zbtDelete(zp->zbt, score, ele);
+    dictDelete(zp->bd, ele);
+}
+
+// 检查两者按顺序遍历的结果相同，并且排位一致
+static int sameAsSkiplist(zskiplist *zsl, zbtree *zbt)
+{
+    zskiplistNode *x = zsl->header->level[0].forward;
+    unsigned long rank = 1;
+    zbtPos p;
+
+    if (zsl->length != zbt->length)
+        return 0;
+    if (zbt->length == 0)
+        return 1;
+    p.leaf = zbt->head;
+    p.i = 0;
+    while (x)
+    {
+        if (p.leaf == NULL || x->score != zbtPosScore(&p) || !equalStringObjects(&x->obj, zbtPosObj(&p)))
+            return 0;
+        if (rank % 17 == 0 && zbtGetRank(zbt, x->score, &x->obj) != rank)
+            return 0;
+        x = x->level[0].forward;
+        zbtNext(&p);
+        rank++;
+    }
+    return p.leaf == NULL;
+}
+
+static robj *randomMember(int range)
+{
+    char buf[32];
+    int len = snprintf(buf, sizeof(buf), "m%d", rand() % range);
+    return createStringObject(buf, len);
+}
+
+int main()
+{
+    robj *ele;
+    pair zp;
+    zbtPos p;
+    zskiplistNode *node;
+    int i, ok, found;
+
+    createSharedObjects();
+
+    // 空树
+    {
+        zrangespec range = {0, 10, 0, 0};
+        zbtree *zbt = zbtCreate();
+        test_cond("Empty tree has no range", !zbtFirstInRange(zbt, &range, &p) && !zbtLastInRange(zbt, &range, &p));
+        test_cond("Empty tree has no rank", !zbtGetElementByRank(zbt, 1, &p));
+        zbtFree(zbt);
+    }
+
+    pairInit(&zp);
+
+    // 随机插入删除，和跳跃表的结果对照，节点会反复分裂和合并
+    {
+        ok = 1;
+        for (i = 0; i < 200000 && ok; i++)
+        {
+            dictEntry *de;
+
+            ele = randomMember(30000);
+            de = dictFind(zp.sd, ele);
+            if (de == NULL && rand() % 3)
+                pairAdd(&zp, (double)(rand() % 1000), ele);
+            else if (de != NULL && rand() % 2)
+                pairDel(&zp, ((zskiplistNode *)dictGetKey(de))->score, ele, &ok);
+            decrRefCount(ele);
+        }
+        test_cond("Random insert/delete matches skiplist", ok && sameAsSkiplist(zp.zsl, zp.zbt));
+        test_cond("Tree is not degenerate", zp.zbt->height > 2 && zp.zbt->length > 10000);
+    }
+
+    // 按排位查找
+    {
+        ok = 1;
+        for (i = 1; i <= (int)zp.zsl->length && ok; i += 1 + rand() % 7)
+        {
+            node = zslGetElementByRank(zp.zsl, i);
+            ok = zbtGetElementByRank(zp.zbt, i, &p) && zbtPosScore(&p) == node->score &&
+                 equalStringObjects(zbtPosObj(&p), &node->obj);
+        }
+        test_cond("Element by rank", ok && !zbtGetElementByRank(zp.zbt, zp.zbt->length + 1, &p));
+
+        ele = createStringObject("missing", 7);
+        test_cond("Rank of missing member", zbtGetRank(zp.zbt, 5, ele) == 0);
+        decrRefCount(ele);
+    }
+
+    // 分值范围，包括开区间、闭区间以及没有元素的范围
+    {
+        ok = 1;
+        for (i = 0; i < 5000 && ok; i++)
+        {
+            zrangespec range;
+            zskiplistNode *first, *last;
+            zbtPos pf, pl;
+
+            range.min = rand() % 1100 - 50;
+            range.max = range.min + rand() % 20 - 2;
+            range.minex = rand() % 2;
+            range.maxex = rand() % 2;
+            if (i % 10 == 0)
+                range.min += 0.5;
+
+            first = zslFirstInRange(zp.zsl, &range);
+            last = zslLastInRange(zp.zsl, &range);
+            found = zbtFirstInRange(zp.zbt, &range, &pf);
+            ok = found == (first != NULL) && zbtLastInRange(zp.zbt, &range, &pl) == (last != NULL);
+            if (ok && first)
+                ok = equalStringObjects(zbtPosObj(&pf), &first->obj) && equalStringObjects(zbtPosObj(&pl), &last->obj);
+            ok = ok && zbtIsInRange(zp.zbt, &range) == zslIsInRange(zp.zsl, &range);
+        }
+        test_cond("First/last in score range", ok);
+
+        ok = 1;
+        for (i = 0; i < 5000 && ok; i++)
+        {
+            zrangespec range;
+
+            range.min = rand() % 1100 - 50;
+            range.max = range.min + rand() % 20 - 2;
+            range.minex = rand() % 2;
+            range.maxex = rand() % 2;
+            ok = zbtRankOfFirstInRange(zp.zbt, &range) == zslRankOfFirstInRange(zp.zsl, &range) &&
+                 zbtRankOfLastInRange(zp.zbt, &range) == zslRankOfLastInRange(zp.zsl, &range);
+        }
+        test_cond("Rank of score range ends", ok);
+    }
+
+    // 范围删除
+    {
+        zrangespec range = {100, 200, 0, 1};
+        unsigned long a, b;
+
+        a = zslDeleteRangeByScore(zp.zsl, &range, zp.sd);
+        b = zbtDeleteRangeByScore(zp.zbt, &range, zp.bd);
+        test_cond("Delete range by score", a == b && a > 0 && sameAsSkiplist(zp.zsl, zp.zbt));
+
+        a = zslDeleteRangeByRank(zp.zsl, 10, 5000, zp.sd);
+        b = zbtDeleteRangeByRank(zp.zbt, 10, 5000, zp.bd);
+        test_cond("Delete range by rank", a == b && a == 4991 && sameAsSkiplist(zp.zsl, zp.zbt));
+        test_cond("Dict is kept in sync", dictSize(zp.bd) == zp.zbt->length);
+    }
+
+    pairFree(&zp);
+
+    // 分值都相同时的字典序范围
+    {
+        zlexrangespec range;
+        char buf[32];
+
+        pairInit(&zp);
+        for (i = 0; i < 3000; i++)
+        {
+            ele = createStringObject(buf, snprintf(buf, sizeof(buf), "%05d", i * 3));
+            pairAdd(&zp, 0, ele);
+            decrRefCount(ele);
+        }
+
+        ok = 1;
+        for (i = 0; i < 2000 && ok; i++)
+        {
+            zskiplistNode *first, *last;
+            zbtPos pf, pl;
+            int lo = rand() % 9200, hi = lo + rand() % 40;
+
+            range.min = i % 50 == 0 ? shared.minstring : createStringObject(buf, snprintf(buf, sizeof(buf), "%05d", lo));
+            range.max = i % 70 == 0 ? shared.maxstring : createStringObject(buf, snprintf(buf, sizeof(buf), "%05d", hi));
+            range.minex = rand() % 2;
+            range.maxex = rand() % 2;
+
+            first = zslFirstInLexRange(zp.zsl, &range);
+            last = zslLastInLexRange(zp.zsl, &range);
+            ok = zbtFirstInLexRange(zp.zbt, &range, &pf) == (first != NULL) &&
+                 zbtLastInLexRange(zp.zbt, &range, &pl) == (last != NULL);
+            if (ok && first)
+                ok = equalStringObjects(zbtPosObj(&pf), &first->obj) && equalStringObjects(zbtPosObj(&pl), &last->obj);
+            ok = ok && zbtRankOfFirstInLexRange(zp.zbt, &range) == zslRankOfFirstInLexRange(zp.zsl, &range) &&
+                 zbtRankOfLastInLexRange(zp.zbt, &range) == zslRankOfLastInLexRange(zp.zsl, &range);
+            if (range.min != shared.minstring)
+                decrRefCount(range.min);
+            if (range.max != shared.maxstring)
+                decrRefCount(range.max);
+        }
+        test_cond("First/last in lex range", ok);
+
+        range.min = createStringObject("01000", 5);
+        range.max = createStringObject("02000", 5);
+        range.minex = range.maxex = 0;
+        test_cond("Delete range by lex",
+                  zslDeleteRangeByLex(zp.zsl, &range, zp.sd) == zbtDeleteRangeByLex(zp.zbt, &range, zp.bd) &&
+                      sameAsSkiplist(zp.zsl, zp.zbt));
+        decrRefCount(range.min);
+        decrRefCount(range.max);
+
+        pairFree(&zp);
+    }
+
+    test_report();
+    return 0;
+}
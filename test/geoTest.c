@@ -0,0 +1,198 @@
+#include "test.h"
+#include "xmt_geo.h"
+#include "xmt_zset.h"
+#include "xmgeohash.h"
+#include "xmobject.h"
+#include "xmrand.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#define POINTS 5000
+
+static double lon[POINTS], lat[POINTS];
+
+static double randomBetween(double min, double max)
+{
+    return min + (max - min) * (xm_random() >> 11) / 9007199254740992.0;
+}
+
+// 按位置的 geohash 分值排序
+static int compareByScore(const void *a, const void *b)
+{
+    uint64_t sa, sb;
+
+    geohashEncodeScore(lon[*(const int *)a], lat[*(const int *)a], &sa);
+    geohashEncodeScore(lon[*(const int *)b], lat[*(const int *)b], &sb);
+    return sa < sb ? -1 : sa > sb;
+}
+
+static robj *member(int i)
+{
+    char buf[32];
+    return createStringObject(buf, snprintf(buf, sizeof(buf), "p%d", i));
+}
+
+// 用暴力遍历验证半径查询：结果个数一致、都在圆内，并且按距离排好序
+static int checkSearch(robj *zobj, double *lon, double *lat, int n, double clon, double clat,
+                       double radius, int sort, size_t count)
+{
+    geoArray ga;
+    double prev;
+    size_t i, expected = 0;
+    int j, ok = 1;
+
+    for (j = 0; j < n; j++)
+    {
+        double dlon, dlat;
+        uint64_t score;
+
+        // 位置保存的是格子中心，用解码之后的坐标计算距离
+        geohashEncodeScore(lon[j], lat[j], &score);
+        geohashDecodeScore(score, &dlon, &dlat);
+        if (geohashGetDistance(clon, clat, dlon, dlat) <= radius)
+            expected++;
+    }
+    if (count && expected > count)
+        expected = count;
+
+    geoArrayInit(&ga, sort, count);
+    geoSearch(zobj, clon, clat, radius, &ga);
+    ok = ga.used == expected;
+    prev = sort == GEO_SORT_DESC ? INFINITY : -1;
+    for (i = 0; i < ga.used && ok; i++)
+    {
+        double d = geohashGetDistance(clon, clat, ga.array[i].longitude, ga.array[i].latitude);
+        ok = d <= radius * (1 + 1e-9);
+        if (sort == GEO_SORT_ASC)
+            ok = ok && d >= prev;
+        else if (sort == GEO_SORT_DESC)
+            ok = ok && d <= prev;
+        prev = d;
+    }
+    geoArrayFree(&ga);
+    return ok;
+}
+
+int main()
+{
+    uint64_t score;
+    robj *zobjs[4], *ele;
+    int order[POINTS];
+    int i, k, ok;
+
+    createSharedObjects();
+    registerObjectTypes();
+    xm_srandom(2026);
+
+    // 同一批位置分别保存在四种编码的有序集合中
+    server.zset_max_ziplist_entries = 128;
+    server.zset_max_ziplist_value = 64;
+    zobjs[0] = createZsetZiplistObject();
+    zobjs[1] = createZsetObject();
+    zobjs[2] = createZsetBtreeObject();
+    zobjs[3] = createZsetTseriesObject();
+    for (i = 0; i < POINTS; i++)
+    {
+        // 大部分位置集中在一个城市附近
+        if (i % 5)
+        {
+            lon[i] = randomBetween(116.0, 116.8);
+            lat[i] = randomBetween(39.6, 40.2);
+        }
+        else
+        {
+            lon[i] = randomBetween(GEO_LONG_MIN, GEO_LONG_MAX);
+            lat[i] = randomBetween(GEO_LAT_MIN, GEO_LAT_MAX);
+        }
+        geohashEncodeScore(lon[i], lat[i], &score);
+        ele = member(i);
+        for (k = 0; k < 3; k++)
+            zsetAdd(zobjs[k], (double)score, ele);
+        decrRefCount(ele);
+        order[i] = i;
+    }
+    // 块序列按分值顺序追加，插入都落在中间时会转换为其他编码
+    qsort(order, POINTS, sizeof(int), compareByScore);
+    for (i = 0; i < POINTS; i++)
+    {
+        geohashEncodeScore(lon[order[i]], lat[order[i]], &score);
+        ele = member(order[i]);
+        zsetAdd(zobjs[3], (double)score, ele);
+        decrRefCount(ele);
+    }
+    // 压缩列表超过边界条件之后默认转换为跳跃表
+    ok = zobjs[0]->encoding == REDIS_ENCODING_SKIPLIST && zobjs[3]->encoding == REDIS_ENCODING_TSERIES;
+    for (k = 0; k < 4; k++)
+        ok = ok && zsetLength(zobjs[k]) == POINTS;
+    // 更新已有成员的位置不增加元素
+    ele = member(0);
+    geohashEncodeScore(lon[0], lat[0], &score);
+    for (k = 0; k < 4; k++)
+        ok = ok && zsetAdd(zobjs[k], (double)score + 1, ele) == 0 && zsetAdd(zobjs[k], (double)score, ele) == 0 &&
+             zsetLength(zobjs[k]) == POINTS;
+    decrRefCount(ele);
+    test_cond("Add locations to every encoding", ok);
+
+    ok = 1;
+    for (i = 0; i < 50 && ok; i++)
+    {
+        double clon = randomBetween(116.0, 116.8), clat = randomBetween(39.6, 40.2);
+        double radius = randomBetween(100, 30000);
+
+        for (k = 0; k < 4 && ok; k++)
+            ok = checkSearch(zobjs[k], lon, lat, POINTS, clon, clat, radius, GEO_SORT_NONE, 0);
+    }
+    test_cond("Radius search matches brute force", ok);
+
+    ok = 1;
+    for (i = 0; i < 50 && ok; i++)
+    {
+        double clon = randomBetween(116.0, 116.8), clat = randomBetween(39.6, 40.2);
+        double radius = randomBetween(1000, 30000);
+
+        for (k = 0; k < 4 && ok; k++)
+            ok = checkSearch(zobjs[k], lon, lat, POINTS, clon, clat, radius, GEO_SORT_ASC, 0) &&
+                 checkSearch(zobjs[k], lon, lat, POINTS, clon, clat, radius, GEO_SORT_DESC, 0);
+    }
+    test_cond("Radius search sorted by distance", ok);
+
+    // COUNT 只保留最近（最远）的几个位置，和完整排序之后的前几个相同
+    ok = 1;
+    for (i = 0; i < 50 && ok; i++)
+    {
+        double clon = randomBetween(116.0, 116.8), clat = randomBetween(39.6, 40.2);
+        double radius = randomBetween(1000, 30000);
+        geoArray all, top;
+        size_t j;
+
+        for (k = 0; k < 4 && ok; k++)
+        {
+            int sort = k % 2 ? GEO_SORT_DESC : GEO_SORT_ASC;
+
+            geoArrayInit(&all, sort, 0);
+            geoArrayInit(&top, sort, 10);
+            geoSearch(zobjs[k], clon, clat, radius, &all);
+            geoSearch(zobjs[k], clon, clat, radius, &top);
+            ok = top.used == (all.used < 10 ? all.used : 10);
+            for (j = 0; j < top.used && ok; j++)
+                ok = top.array[j].hav == all.array[j].hav;
+            geoArrayFree(&all);
+            geoArrayFree(&top);
+        }
+    }
+    test_cond("Radius search with COUNT keeps the nearest", ok);
+
+    // 半径很大时格子回绕，每个位置也只返回一次
+    ok = 1;
+    for (k = 0; k < 4 && ok; k++)
+        ok = checkSearch(zobjs[k], lon, lat, POINTS, 0, 0, 20000000, GEO_SORT_ASC, 0);
+    test_cond("Huge radius returns every location once", ok);
+
+    for (k = 0; k < 4; k++)
+        freeZsetObject(zobjs[k]);
+
+    test_report();
+    return 0;
+}
@@ -0,0 +1,91 @@
+#include "test.h"
+#include "xmgeohash.h"
+#include "xmrand.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+static double randomBetween(double min, double max)
+{
+    return min + (max - min) * (xm_random() >> 11) / 9007199254740992.0;
+}
+
+int main()
+{
+    GeoHashBits hash, n;
+    GeoHashArea area;
+    GeoHashNeighbors neighbors;
+    GeoHashRadius r;
+    GeoHashCircle circle;
+    uint64_t score, min, max;
+    double x, y;
+    int i, ok;
+
+    xm_srandom(2026);
+
+    // 编码之后解码，误差不超过最小格子的一半
+    ok = 1;
+    for (i = 0; i < 10000; i++)
+    {
+        double a = randomBetween(GEO_LONG_MIN, GEO_LONG_MAX), b = randomBetween(GEO_LAT_MIN, GEO_LAT_MAX);
+        ok = ok && geohashEncodeScore(a, b, &score) && score < (1ULL << 52);
+        ok = ok && geohashDecodeScore(score, &x, &y) && fabs(x - a) < 360.0 / (1 << 26) && fabs(y - b) < 171.0 / (1 << 26);
+    }
+    test_cond("Encode and decode round trip", ok);
+
+    test_cond("Out of range coordinates are rejected",
+              !geohashEncode(0, 86, GEO_STEP_MAX, &hash) && !geohashEncode(181, 0, GEO_STEP_MAX, &hash) &&
+                  geohashEncode(180, GEO_LAT_MAX, GEO_STEP_MAX, &hash));
+
+    // 格子包含被编码的位置，格子的分值区间包含位置的 52 位分值
+    geohashEncode(13.361389, 38.115556, 10, &hash);
+    geohashDecode(hash, &area);
+    geohashScoreRange(hash, &min, &max);
+    geohashEncodeScore(13.361389, 38.115556, &score);
+    test_cond("Area contains the point",
+              area.longitude.min <= 13.361389 && area.longitude.max > 13.361389 &&
+                  area.latitude.min <= 38.115556 && area.latitude.max > 38.115556 && score >= min && score < max);
+
+    // 相邻格子和中心格子共享一条边
+    geohashNeighbors(&hash, &neighbors);
+    geohashDecode(neighbors.north, &r.area);
+    ok = fabs(r.area.latitude.min - area.latitude.max) < 1e-9 && r.area.longitude.min == area.longitude.min;
+    geohashDecode(neighbors.south_west, &r.area);
+    ok = ok && fabs(r.area.latitude.max - area.latitude.min) < 1e-9 &&
+         fabs(r.area.longitude.max - area.longitude.min) < 1e-9;
+    // 经度方向越过 180 度时回绕
+    geohashEncode(179.99, 0, 10, &n);
+    geohashNeighbors(&n, &neighbors);
+    geohashDecode(neighbors.east, &r.area);
+    ok = ok && r.area.longitude.min == -180;
+    test_cond("Neighbors share an edge and wrap around", ok);
+
+    // Palermo 到 Catania 约 166274 米
+    x = geohashGetDistance(13.361389, 38.115556, 15.087269, 37.502669);
+    geohashCircleInit(&circle, 13.361389, 38.115556, 166300);
+    test_cond("Haversine distance",
+              fabs(x - 166274.15) < 1 && geohashCircleHav(&circle, 15.087269, 37.502669) <= circle.maxhav &&
+                  fabs(geohashHavToDistance(geohashCircleHav(&circle, 15.087269, 37.502669)) - x) < 1e-6);
+
+    // 9 个格子覆盖包含整个圆的矩形
+    ok = 1;
+    for (i = 0; i < 1000 && ok; i++)
+    {
+        double clon = randomBetween(-170, 170), clat = randomBetween(-60, 60);
+        double radius = randomBetween(10, 200000), dlat = radius / 6372797.560856 * 180 / M_PI;
+
+        ok = geohashGetAreasByRadius(clon, clat, radius, &r);
+        geohashDecode(r.hash, &area);
+        ok = ok && area.longitude.min <= clon && area.longitude.max >= clon;
+        // 没有被排除的北侧格子时，中心格子本身要覆盖圆的北端
+        if (GEOHASH_IS_ZERO(r.neighbors.north))
+            ok = ok && area.latitude.max >= clat + dlat;
+        if (GEOHASH_IS_ZERO(r.neighbors.south))
+            ok = ok && area.latitude.min <= clat - dlat;
+    }
+    test_cond("Radius areas cover the circle", ok);
+
+    test_report();
+    return 0;
+}
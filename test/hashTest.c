@@ -0,0 +1,259 @@
+#include "test.h"
+#include "xmt_hash.h"
+#include "xmdb.h"
+#include "xmobject.h"
+#include "xmmalloc.h"
+#include "xmsds.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+#define FIELDS 20000
+
+static robj *field(int i)
+{
+    char buf[32];
+    return createStringObject(buf, snprintf(buf, sizeof(buf), "f%d", i));
+}
+
+// 第 i 个域的值，有正有负
+static long long fieldValue(int i)
+{
+    return (long long)i * 7 - 1000;
+}
+
+static int setInt(robj *o, int i, long long v)
+{
+    robj *f = field(i), *val = createStringObjectFromLongLong(v);
+    int update = hashTypeSet(o, f, val);
+
+    decrRefCount(f);
+    decrRefCount(val);
+    return update;
+}
+
+// 域 i 的值是否是整数 v
+static int hasInt(robj *o, int i, long long v)
+{
+    robj *f = field(i), *val = hashTypeGetObject(o, f);
+    long long ll;
+    int ok = val != NULL && getLongLongFromObject(val, &ll) == REDIS_OK && ll == v;
+
+    decrRefCount(f);
+    if (val)
+        decrRefCount(val);
+    return ok;
+}
+
+// 取出客户端的全部回复，并清空回复缓冲区和回复链表
+static sds takeReply(redisClient *c)
+{
+    sds s = sdsnewlen(c->buf, c->bufpos);
+    ilistIter it;
+    ilistNode *ln;
+
+    ilistRewind(&c->reply, &it, AL_START_HEAD);
+    while ((ln = ilistNext(&it)) != NULL)
+    {
+        clientReplyBlock *b = ilistEntry(ln, clientReplyBlock, node);
+        s = sdscatlen(s, b->buf, b->used);
+    }
+    freeClientReplyList(c);
+    c->bufpos = 0;
+    return s;
+}
+
+// 读取 *p 处以 prefix 开头的长度行，并移动到下一行
+static long readLen(char **p, char prefix)
+{
+    long len;
+
+    if (**p != prefix)
+        return -1;
+    len = strtol(*p + 1, p, 10);
+    *p += 2;
+    return len;
+}
+
+// 读取 *p 处的批量回复，内容复制到 buf 中
+static int readBulk(char **p, char *buf, size_t size)
+{
+    long len = readLen(p, '$');
+
+    if (len < 0 || (size_t)len >= size)
+        return 0;
+    memcpy(buf, *p, len);
+    buf[len] = '\0';
+    *p += len + 2;
+    return 1;
+}
+
+// 读取 n / 2 个域值对，检查值是否正确，seen 记录每个域出现的次数
+static int readPairs(char **p, long n, int *seen)
+{
+    char f[64], v[64];
+    long i;
+
+    for (i = 0; i < n; i += 2)
+    {
+        int k;
+
+        if (!readBulk(p, f, sizeof(f)) || !readBulk(p, v, sizeof(v)) || f[0] != 'f')
+            return 0;
+        k = atoi(f + 1);
+        if (k < 0 || k >= FIELDS || strtoll(v, NULL, 10) != fieldValue(k))
+            return 0;
+        seen[k]++;
+    }
+    return 1;
+}
+
+int main()
+{
+    robj *o, *f, *val;
+    redisClient *c;
+    long long result;
+    char *err;
+    int i, ok;
+
+    createSharedObjects();
+    registerObjectTypes();
+    server.hash_max_ziplist_entries = 64;
+    server.hash_max_ziplist_value = 64;
+    ilistInit(&server.streaming_clients);
+
+    // 值都是整数的 ziplist 超过边界条件之后转换为 INTHT 编码
+    o = createHashObject();
+    ok = 1;
+    for (i = 0; i < 100; i++)
+    {
+        ok = ok && setInt(o, i, fieldValue(i)) == 0;
+        ok = ok && o->encoding == (i < 64 ? REDIS_ENCODING_ZIPLIST : REDIS_ENCODING_INTHT);
+    }
+    for (i = 0; i < 100 && ok; i++)
+        ok = hasInt(o, i, fieldValue(i));
+    test_cond("Convert an integer ziplist to intht", ok && hashTypeLength(o) == 100);
+
+    // 更新为整数时保持 INTHT 编码，写入非整数的值之后原地转换为 HT 编码
+    ok = setInt(o, 3, 42) == 1 && o->encoding == REDIS_ENCODING_INTHT && hasInt(o, 3, 42);
+    f = field(5);
+    val = createStringObject("abc", 3);
+    ok = ok && hashTypeSet(o, f, val) == 1 && o->encoding == REDIS_ENCODING_HT;
+    decrRefCount(val);
+    val = hashTypeGetObject(o, f);
+    ok = ok && val != NULL && sdsEncodedObject(val) && strcmp(val->ptr, "abc") == 0;
+    decrRefCount(val);
+    decrRefCount(f);
+    ok = ok && hasInt(o, 3, 42) && hasInt(o, 99, fieldValue(99)) && hashTypeLength(o) == 100;
+    test_cond("Convert intht to ht on a non-integer value", ok);
+    decrRefCount(o);
+
+    // 有一个值不是整数时直接转换为 HT 编码
+    o = createHashObject();
+    f = field(0);
+    val = createStringObject("1.5", 3);
+    hashTypeSet(o, f, val);
+    decrRefCount(val);
+    decrRefCount(f);
+    for (i = 1; i < 100; i++)
+        setInt(o, i, fieldValue(i));
+    test_cond("Convert a mixed ziplist to ht", o->encoding == REDIS_ENCODING_HT && hasInt(o, 50, fieldValue(50)));
+    decrRefCount(o);
+
+    // HINCRBY 直接修改 INTHT 节点中的整数，溢出时返回错误并保持原来的值
+    o = createHashObject();
+    for (i = 0; i < 100; i++)
+        setInt(o, i, fieldValue(i));
+    f = field(10);
+    ok = hashTypeIncrBy(o, f, 5, &result, &err) == REDIS_OK && result == fieldValue(10) + 5 &&
+         hasInt(o, 10, fieldValue(10) + 5);
+    decrRefCount(f);
+    f = field(1000);
+    ok = ok && hashTypeIncrBy(o, f, -3, &result, &err) == REDIS_OK && result == -3 && hashTypeLength(o) == 101;
+    decrRefCount(f);
+    test_cond("HINCRBY on intht", ok && o->encoding == REDIS_ENCODING_INTHT);
+
+    setInt(o, 20, LLONG_MAX);
+    setInt(o, 21, LLONG_MIN);
+    f = field(20);
+    err = NULL;
+    ok = hashTypeIncrBy(o, f, 1, &result, &err) == REDIS_ERR && err != NULL && hasInt(o, 20, LLONG_MAX);
+    ok = ok && hashTypeIncrBy(o, f, -1, &result, &err) == REDIS_OK && result == LLONG_MAX - 1;
+    decrRefCount(f);
+    f = field(21);
+    err = NULL;
+    ok = ok && hashTypeIncrBy(o, f, -1, &result, &err) == REDIS_ERR && err != NULL && hasInt(o, 21, LLONG_MIN);
+    decrRefCount(f);
+    test_cond("HINCRBY overflow on intht", ok && o->encoding == REDIS_ENCODING_INTHT);
+    decrRefCount(o);
+
+    // 大的 INTHT 哈希
+    o = createHashObject();
+    for (i = 0; i < FIELDS; i++)
+        setInt(o, i, fieldValue(i));
+    c = xm_calloc(sizeof(*c));
+    ilistInit(&c->reply);
+
+    // HGETALL 分批回复：时间片很短，需要多次事件循环才能回复完，每个域正好回复一次
+    {
+        int *seen = xm_calloc(sizeof(int) * FIELDS);
+        int rounds = 0;
+        sds reply;
+        char *p;
+
+        server.stream_time_budget = 1;
+        hashTypeStreamReply(c, o, REDIS_HASH_KEY | REDIS_HASH_VALUE);
+        ok = o->encoding == REDIS_ENCODING_INTHT && (c->flags & REDIS_STREAMING) && hashTypeStreaming(o);
+        while (c->flags & REDIS_STREAMING)
+        {
+            handleStreamingClients();
+            rounds++;
+        }
+        reply = takeReply(c);
+        p = reply;
+        ok = ok && rounds > 1 && !hashTypeStreaming(o) && readLen(&p, '*') == 2 * FIELDS &&
+             readPairs(&p, 2 * FIELDS, seen) && *p == '\0';
+        for (i = 0; i < FIELDS && ok; i++)
+            ok = seen[i] == 1;
+        test_cond("HGETALL streams an intht hash", ok);
+        sdsfree(reply);
+        xm_free(seen);
+        server.stream_time_budget = 0;
+    }
+
+    // HSCAN 按游标遍历，每个域至少返回一次
+    {
+        int *seen = xm_calloc(sizeof(int) * FIELDS);
+        unsigned long cursor = 0;
+        char buf[64];
+        sds reply;
+        char *p;
+        long n;
+
+        ok = 1;
+        c->argc = 3;
+        do
+        {
+            scanGenericCommand(c, o, cursor);
+            reply = takeReply(c);
+            p = reply;
+            ok = readLen(&p, '*') == 2 && readBulk(&p, buf, sizeof(buf));
+            cursor = strtoul(buf, NULL, 10);
+            n = readLen(&p, '*');
+            ok = ok && n >= 0 && n % 2 == 0 && readPairs(&p, n, seen) && *p == '\0';
+            sdsfree(reply);
+        } while (ok && cursor != 0);
+        for (i = 0; i < FIELDS && ok; i++)
+            ok = seen[i] >= 1;
+        test_cond("HSCAN over an intht hash", ok);
+        xm_free(seen);
+    }
+
+    xm_free(c);
+    decrRefCount(o);
+
+    test_report();
+    return 0;
+}
@@ -1,8 +1,10 @@
 #include "test.h"
 #include "xmintset.h"
 #include "xmendianconv.h"
+#include "xmmalloc.h"
 
 #include <stdlib.h>
+#include <string.h>
 #include <sys/time.h>
 #include <stdio.h>
 
@@ -69,7 +71,7 @@ void checkConsistency(intset *is)
 {
     int i;
 
-    for (i = 0; i < (intrev32ifbe(is->length) - 1); i++)
+    for (i = 0; i + 1 < intrev32ifbe(is->length); i++)
     {
         uint32_t encoding = intrev32ifbe(is->encoding);
 
@@ -102,6 +104,42 @@ static uint8_t _intsetValueEncoding(int64_t v)
         return INTSET_ENC_INT16;
 }
 
+// 创建一个有 size 个元素的 int32 编码集合，相邻元素的差在 [1, maxstep] 之间随机
+intset *createSortedSet(int size, int maxstep)
+{
+    intset *is = xm_malloc(sizeof(intset) + size * sizeof(int32_t));
+    int32_t v = 0;
+    int i;
+
+    is->encoding = intrev32ifbe(INTSET_ENC_INT32);
+    is->length = intrev32ifbe(size);
+    for (i = 0; i < size; i++)
+    {
+        v += 1 + rand() % maxstep;
+        ((int32_t *)is->contents)[i] = intrev32ifbe(v);
+    }
+    return is;
+}
+
+// 用 intsetFind 逐个检查的方式计算集合运算的结果，作为对照
+intset *naiveSetOp(intset *a, intset *b, int op)
+{
+    intset *res = intsetNew();
+    int64_t v;
+    uint32_t i;
+
+    for (i = 0; intsetGet(a, i, &v); i++)
+    {
+        uint8_t inb = intsetFind(b, v);
+        if ((op == 0 && inb) || op == 1 || (op == 2 && !inb))
+            res = intsetAdd(res, v, NULL);
+    }
+    if (op == 1)
+        for (i = 0; intsetGet(b, i, &v); i++)
+            res = intsetAdd(res, v, NULL);
+    return res;
+}
+
 int main()
 {
     uint8_t success;
@@ -231,6 +269,275 @@ int main()
         printf("%ld lookups, %ld element set, %lldusec\n", num, size, usec() - start);
     }
 
+    printf("Find many: ");
+    {
+        int bits, i, n = 4096;
+        int64_t values[4096];
+        uint8_t found[4096];
+
+        // 三种编码都检查，候选值一半取自集合，一半随机，还包括编码范围之外的值
+        for (bits = 16; bits <= 64; bits *= 2)
+        {
+            is = createSet(bits == 16 ? 15 : bits - 4, 2000);
+            if (bits == 64)
+                is = intsetAdd(is, -4294967295LL, NULL);
+            for (i = 0; i < n; i++)
+            {
+                if (i % 2 && intsetLen(is) > 0)
+                    intsetGet(is, rand() % intsetLen(is), &values[i]);
+                else
+                    values[i] = (int64_t)rand() * rand() - RAND_MAX;
+            }
+            values[0] = INT64_MAX;
+            values[1] = INT64_MIN;
+            intsetFindMany(is, values, n, found);
+            for (i = 0; i < n; i++)
+                assert(found[i] == intsetFind(is, values[i]));
+            xm_free(is);
+        }
+        ok();
+    }
+
+    printf("Stress find many: ");
+    {
+        long num = 100000, size = 10000;
+        int i, bits = 20;
+        long long start;
+        int64_t *values = malloc(sizeof(int64_t) * num);
+        uint8_t *found = malloc(num);
+        is = createSet(bits, size);
+
+        for (i = 0; i < num; i++)
+            values[i] = rand() % ((1 << bits) - 1);
+        start = usec();
+        intsetFindMany(is, values, num, found);
+        printf("%ld lookups, %ld element set, %lldusec\n", num, size, usec() - start);
+        free(values);
+        free(found);
+    }
+
+    printf("Add many: ");
+    {
+        int iter, i, n;
+        int64_t values[600];
+        uint32_t added, expectAdded;
+        intset *expect;
+
+        // 随机的批次，包括重复值、已经存在的值和需要升级编码的值
+        for (iter = 0; iter < 300; iter++)
+        {
+            is = createSet(10, rand() % 200);
+            expect = intsetNew();
+            for (i = 0; i < (int)intsetLen(is); i++)
+            {
+                int64_t v;
+                intsetGet(is, i, &v);
+                expect = intsetAdd(expect, v, NULL);
+            }
+            n = rand() % 600;
+            for (i = 0; i < n; i++)
+            {
+                int r = rand() % 10;
+                if (r == 0)
+                    values[i] = (int64_t)rand() * 100000;
+                else if (r == 1)
+                    values[i] = -100000 - rand();
+                else if (r == 2 && i > 0)
+                    values[i] = values[rand() % i];
+                else
+                    values[i] = rand() % 2048;
+            }
+            expectAdded = 0;
+            for (i = 0; i < n; i++)
+            {
+                uint8_t success;
+                expect = intsetAdd(expect, values[i], &success);
+                expectAdded += success;
+            }
+            is = intsetAddMany(is, values, n, &added);
+            checkConsistency(is);
+            assert(added == expectAdded);
+            assert(intsetBlobLen(is) == intsetBlobLen(expect));
+            assert(memcmp(is, expect, intsetBlobLen(is)) == 0);
+            xm_free(is);
+            xm_free(expect);
+        }
+        ok();
+    }
+
+    printf("Remove positions: ");
+    {
+        int iter, i, len;
+        uint32_t pos[300], n;
+        intset *expect;
+
+        // 随机选一部分下标删除，和从后往前逐个 intsetRemove 的结果对照
+        for (iter = 0; iter < 300; iter++)
+        {
+            is = createSet((iter % 3 == 0) ? 32 : 16, 300);
+            len = intsetLen(is);
+            expect = xm_malloc(intsetBlobLen(is));
+            memcpy(expect, is, intsetBlobLen(is));
+            n = 0;
+            for (i = 0; i < len; i++)
+            {
+                if (rand() % 4 == 0 || (iter % 10 == 0))
+                    pos[n++] = i;
+            }
+            for (i = n - 1; i >= 0; i--)
+            {
+                int64_t v;
+                intsetGet(expect, pos[i], &v);
+                expect = intsetRemove(expect, v, NULL);
+            }
+            is = intsetRemovePositions(is, pos, n);
+            checkConsistency(is);
+            assert(intsetBlobLen(is) == intsetBlobLen(expect));
+            assert(memcmp(is, expect, intsetBlobLen(is)) == 0);
+            xm_free(is);
+            xm_free(expect);
+        }
+        ok();
+    }
+
+    printf("Stress add many: ");
+    {
+        int i, j, batch = 1000, rounds = 20;
+        long long start, t1, t2;
+        int64_t values[1000];
+        intset *a = createSortedSet(100000, 3), *b = xm_malloc(intsetBlobLen(a));
+
+        memcpy(b, a, intsetBlobLen(a));
+
+        // 每轮向 10 万元素的集合添加 1000 个随机值，对比逐个 intsetAdd
+        t1 = t2 = 0;
+        for (j = 0; j < rounds; j++)
+        {
+            for (i = 0; i < batch; i++)
+                values[i] = rand() % 400000;
+            start = usec();
+            for (i = 0; i < batch; i++)
+                a = intsetAdd(a, values[i], NULL);
+            t1 += usec() - start;
+            start = usec();
+            b = intsetAddMany(b, values, batch, NULL);
+            t2 += usec() - start;
+        }
+        assert(memcmp(a, b, intsetBlobLen(a)) == 0);
+        printf("%d batches of %d: intsetAdd %lldusec, intsetAddMany %lldusec\n", rounds, batch, t1, t2);
+        xm_free(a);
+        xm_free(b);
+    }
+
+    printf("Set operations: ");
+    {
+        int bitsa[] = {12, 20, 40}, bitsb[] = {12, 20, 40}, sizes[] = {0, 1, 50, 3000};
+        int x, y, sa, sb, op, iter;
+        intset *a, *b, *sets[3], *res, *expect;
+
+        // 覆盖三种编码的两两组合，以及大小相近和相差悬殊两种情况
+        for (x = 0; x < 3; x++)
+            for (y = 0; y < 3; y++)
+                for (sa = 0; sa < 4; sa++)
+                    for (sb = 0; sb < 4; sb++)
+                    {
+                        a = createSet(bitsa[x], sizes[sa]);
+                        b = createSet(bitsb[y], sizes[sb]);
+                        if (x == 2)
+                            a = intsetAdd(a, -5, NULL);
+                        for (op = 0; op < 3; op++)
+                        {
+                            sets[0] = a;
+                            sets[1] = b;
+                            if (op == 0)
+                                res = intsetIntersect(sets, 2);
+                            else if (op == 1)
+                                res = intsetUnion(sets, 2);
+                            else
+                                res = intsetDiff(sets, 2);
+                            expect = naiveSetOp(a, b, op);
+                            checkConsistency(res);
+                            assert(intsetBlobLen(res) == intsetBlobLen(expect));
+                            assert(memcmp(res, expect, intsetBlobLen(res)) == 0);
+                            xm_free(res);
+                            xm_free(expect);
+                        }
+                        xm_free(a);
+                        xm_free(b);
+                    }
+
+        // 多个集合
+        for (iter = 0; iter < 20; iter++)
+        {
+            intset *t;
+            for (x = 0; x < 3; x++)
+                sets[x] = createSet(10, 200 + rand() % 600);
+            res = intsetIntersect(sets, 3);
+            t = naiveSetOp(sets[0], sets[1], 0);
+            expect = naiveSetOp(t, sets[2], 0);
+            assert(memcmp(res, expect, intsetBlobLen(res)) == 0);
+            xm_free(res), xm_free(t), xm_free(expect);
+            res = intsetDiff(sets, 3);
+            t = naiveSetOp(sets[0], sets[1], 2);
+            expect = naiveSetOp(t, sets[2], 2);
+            assert(memcmp(res, expect, intsetBlobLen(res)) == 0);
+            xm_free(res), xm_free(t), xm_free(expect);
+            res = intsetUnion(sets, 3);
+            t = naiveSetOp(sets[0], sets[1], 1);
+            expect = naiveSetOp(t, sets[2], 1);
+            assert(memcmp(res, expect, intsetBlobLen(res)) == 0);
+            xm_free(res), xm_free(t), xm_free(expect);
+            for (x = 0; x < 3; x++)
+                xm_free(sets[x]);
+        }
+        ok();
+    }
+
+    printf("Stress set operations:\n");
+    {
+        int sizea[] = {1000, 100000}, sizeb[] = {1000000, 100000};
+        int c, i;
+        long long start, t1, t2;
+        intset *sets[2], *res;
+        int64_t v;
+
+        for (c = 0; c < 2; c++)
+        {
+            // 直接填写底层数组，逐个 intsetAdd 百万级的集合太慢
+            // 两个集合的值域相同，大约一半元素重合
+            sets[0] = createSortedSet(sizea[c], 4 * sizeb[c] / sizea[c] - 1);
+            sets[1] = createSortedSet(sizeb[c], 3);
+
+            // 对照：遍历小集合，逐个在大集合中查找
+            start = usec();
+            res = intsetNew();
+            for (i = 0; intsetGet(sets[0], i, &v); i++)
+                if (intsetFind(sets[1], v))
+                    res = intsetAdd(res, v, NULL);
+            t1 = usec() - start;
+            xm_free(res);
+
+            start = usec();
+            res = intsetIntersect(sets, 2);
+            t2 = usec() - start;
+            printf("  %ux%u inter: find loop %lldusec, intsetIntersect %lldusec\n",
+                   intsetLen(sets[0]), intsetLen(sets[1]), t1, t2);
+            xm_free(res);
+
+            start = usec();
+            res = intsetUnion(sets, 2);
+            printf("  %ux%u union: %lldusec\n", intsetLen(sets[0]), intsetLen(sets[1]), usec() - start);
+            xm_free(res);
+
+            start = usec();
+            res = intsetDiff(sets, 2);
+            printf("  %ux%u diff: %lldusec\n", intsetLen(sets[0]), intsetLen(sets[1]), usec() - start);
+            xm_free(res);
+            xm_free(sets[0]);
+            xm_free(sets[1]);
+        }
+    }
+
     printf("Stress add+delete: ");
     {
         int i, v1, v2;
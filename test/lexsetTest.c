@@ -0,0 +1,276 @@
+#include "test.h"
+#include "xmlexset.h"
+#include "xmskiplist.h"
+#include "xmdict.h"
+#include "xmobject.h"
+#include "xmt_string.h"
+#include "xmmalloc.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// 跳跃表的字典以节点中嵌入的成员为键，不负责释放
+static dictType nodeDictType = {
+    dictEncObjHash,       /* hash function */
+    NULL,                 /* key dup */
+    NULL,                 /* val dup */
+    dictEncObjKeyCompare, /* key compare */
+    NULL,                 /* key destructor */
+    NULL                  /* val destructor */
+};
+
+// 分值都为 0 的跳跃表和它的字典，以及成员序列
+typedef struct pair
+{
+    zskiplist *zsl;
+    dict *sd;
+    zlexset *zlx;
+} pair;
+
+// 往跳跃表和成员序列中插入同样的成员
+static void pairAdd(pair *zp, robj *ele, int *ok)
+{
+    zskiplistNode *node;
+    int added = dictFind(zp->sd, ele) == NULL;
+
+    if (added)
+    {
+        node = zslInsert(zp->zsl, 0, ele);
+        dictAdd(zp->sd, &node->obj, NULL);
+    }
+    *ok = *ok && zlxInsert(zp->zlx, ele) == added;
+}
+
+static void pairDel(pair *zp, robj *ele, int *ok)
+{
+    // 跳跃表的字典键在节点中，要先从字典中删除
+    int deleted = dictDelete(zp->sd, ele) == DICT_OK;
+
+    if (deleted)
+        zslDelete(zp->zsl, 0, ele);
+    *ok = *ok && zlxDelete(zp->zlx, ele) == deleted;
+}
+
+static int sameKey(sds key, robj *o)
+{
+    return sdslen(key) == sdslen(o->ptr) && memcmp(key, o->ptr, sdslen(key)) == 0;
+}
+
+// 检查两者正向和反向遍历的结果都相同，并且排位一致
+static int sameAsSkiplist(zskiplist *zsl, zlexset *zlx)
+{
+    zskiplistNode *x = zsl->header->level[0].forward;
+    unsigned long rank = 1;
+    int ok = 1;
+    zlxPos p;
+
+    if (zsl->length != zlx->length)
+        return 0;
+    if (zlx->length == 0)
+        return zlx->nblocks == 0 && sdslen(zlx->tail) == 0;
+    zlxPosInit(&p, zlx);
+    zlxGetElementByRank(zlx, 1, &p);
+    for (; x && ok; x = x->level[0].forward, rank++)
+    {
+        ok = zlxPosValid(&p) && sameKey(zlxPosKey(&p), &x->obj);
+        if (rank % 13 == 0)
+            ok = ok && zlxGetRank(zlx, &x->obj) == rank;
+        zlxNext(&p);
+    }
+    ok = ok && !zlxPosValid(&p);
+
+    zlxGetElementByRank(zlx, zlx->length, &p);
+    ok = ok && sameKey(zlx->tail, &zsl->tail->obj);
+    for (x = zsl->tail; x && ok; x = x->backward)
+    {
+        ok = zlxPosValid(&p) && sameKey(zlxPosKey(&p), &x->obj);
+        zlxPrev(&p);
+    }
+    ok = ok && !zlxPosValid(&p);
+    zlxPosRelease(&p);
+    return ok;
+}
+
+// 类似自动补全词库的成员，有大量共同的前缀；偶尔有很长的成员、二进制成员和空字符串
+static robj *randomMember(int range)
+{
+    static const char *prefixes[] = {"user:", "user:profile:", "product:category:", "q:how to ", "q:how do i "};
+    char buf[1024];
+    int len, i, kind = rand() % 100;
+
+    if (kind == 0)
+        return createStringObject("", 0);
+    if (kind == 1)
+    {
+        // 比一个块的字节数限制还长
+        len = 600 + rand() % 300;
+        for (i = 0; i < len; i++)
+            buf[i] = 'a' + rand() % 3;
+        return createStringObject(buf, len);
+    }
+    if (kind == 2)
+    {
+        len = 1 + rand() % 8;
+        for (i = 0; i < len; i++)
+            buf[i] = (char)(rand() % 256);
+        return createStringObject(buf, len);
+    }
+    len = snprintf(buf, sizeof(buf), "%s%d", prefixes[rand() % 5], rand() % range);
+    return createStringObject(buf, len);
+}
+
+int main()
+{
+    robj *ele;
+    pair zp;
+    zlexset *zlx;
+    zlxPos p;
+    zskiplistNode *node;
+    char buf[64];
+    size_t raw;
+    int i, ok;
+
+    createSharedObjects();
+
+    // 空集合
+    {
+        zlexrangespec range = {shared.minstring, shared.maxstring, 0, 0};
+
+        zlx = zlxCreate(0);
+        zlxPosInit(&p, zlx);
+        ele = createStringObject("a", 1);
+        test_cond("Empty lexset has no lex range",
+                  zlxRankOfFirstInLexRange(zlx, &range) == 0 && zlxRankOfLastInLexRange(zlx, &range) == 0);
+        test_cond("Empty lexset has no rank", !zlxGetElementByRank(zlx, 1, &p) && zlxGetRank(zlx, ele) == 0 &&
+                                                  zlxDelete(zlx, ele) == 0);
+        decrRefCount(ele);
+        zlxPosRelease(&p);
+        zlxFree(zlx);
+    }
+
+    zp.zsl = zslCreate();
+    zp.sd = dictCreate(&nodeDictType, NULL);
+    zp.zlx = zlx = zlxCreate(0);
+
+    // 按字典序追加，都走表尾的快速路径，块都是满的
+    {
+        ok = 1;
+        raw = 0;
+        for (i = 0; i < 50000; i++)
+        {
+            ele = createStringObject(buf, snprintf(buf, sizeof(buf), "q:how to %08d", i));
+            raw += sdslen(ele->ptr);
+            pairAdd(&zp, ele, &ok);
+            decrRefCount(ele);
+        }
+        test_cond("Appends match skiplist", ok && sameAsSkiplist(zp.zsl, zlx));
+        test_cond("Appends fill whole blocks", zlx->nblocks == (zlx->length + ZLX_BLOCK_ENTRIES - 1) / ZLX_BLOCK_ENTRIES);
+        // 共同前缀只保存一次，每个成员只剩下几个字节的后缀
+        test_cond("Prefix compression", zlxBytes(zlx) < raw / 2);
+    }
+
+    // 乱序插入和删除，块会被重新编码和分裂，很长的成员单独占一个块
+    {
+        ok = 1;
+        for (i = 0; i < 100000 && ok; i++)
+        {
+            ele = randomMember(30000);
+            if (rand() % 3)
+                pairAdd(&zp, ele, &ok);
+            else
+                pairDel(&zp, ele, &ok);
+            // 修改之间穿插按排位的查找，过期的排位要先更新
+            if (i % 97 == 0)
+                ok = ok && zlxGetRank(zlx, ele) == zslGetRank(zp.zsl, 0, ele);
+            decrRefCount(ele);
+        }
+        test_cond("Random insert/delete matches skiplist", ok && sameAsSkiplist(zp.zsl, zlx));
+    }
+
+    // 按排位和成员查找
+    {
+        ok = 1;
+        zlxPosInit(&p, zlx);
+        for (i = 1; i <= (int)zp.zsl->length && ok; i += 1 + rand() % 7)
+        {
+            node = zslGetElementByRank(zp.zsl, i);
+            ok = zlxGetElementByRank(zlx, i, &p) && sameKey(zlxPosKey(&p), &node->obj) &&
+                 zlxGetRank(zlx, &node->obj) == (unsigned long)i;
+        }
+        test_cond("Element by rank", ok && !zlxGetElementByRank(zlx, zlx->length + 1, &p));
+        zlxPosRelease(&p);
+
+        ok = 1;
+        for (i = 0; i < 10000 && ok; i++)
+        {
+            ele = randomMember(40000);
+            ok = (zlxGetRank(zlx, ele) != 0) == (dictFind(zp.sd, ele) != NULL);
+            decrRefCount(ele);
+        }
+        test_cond("Member lookup without dict", ok);
+    }
+
+    // 字典序范围，端点可能是已有的成员、成员的前缀，也可能是 "-" 和 "+"
+    {
+        ok = 1;
+        for (i = 0; i < 20000 && ok; i++)
+        {
+            zlexrangespec range;
+
+            range.min = i % 50 == 0 ? shared.minstring : randomMember(30000);
+            range.max = i % 70 == 0 ? shared.maxstring : randomMember(30000);
+            if (i % 3 == 0 && range.min != shared.minstring)
+                sdsrange(range.min->ptr, 0, rand() % 8);
+            range.minex = rand() % 2;
+            range.maxex = rand() % 2;
+            ok = zlxRankOfFirstInLexRange(zlx, &range) == zslRankOfFirstInLexRange(zp.zsl, &range) &&
+                 zlxRankOfLastInLexRange(zlx, &range) == zslRankOfLastInLexRange(zp.zsl, &range);
+            if (range.min != shared.minstring)
+                decrRefCount(range.min);
+            if (range.max != shared.maxstring)
+                decrRefCount(range.max);
+        }
+        test_cond("Rank of lex range ends", ok);
+    }
+
+    // 范围删除，中间的块整块释放
+    {
+        zlexrangespec range;
+        unsigned long a, b, nblocks = zlx->nblocks;
+
+        a = zslDeleteRangeByRank(zp.zsl, 100, 20000, zp.sd);
+        b = zlxDeleteRangeByRank(zlx, 100, 20000);
+        test_cond("Delete range by rank", a == b && a == 19901 && sameAsSkiplist(zp.zsl, zlx) &&
+                                              zlx->nblocks + a / ZLX_BLOCK_ENTRIES <= nblocks + 2);
+
+        range.min = createStringObject("user:1", 6);
+        range.max = createStringObject("user:profile:2", 14);
+        range.minex = 0;
+        range.maxex = 1;
+        test_cond("Delete range by lex", zslDeleteRangeByLex(zp.zsl, &range, zp.sd) == zlxDeleteRangeByLex(zlx, &range) &&
+                                             sameAsSkiplist(zp.zsl, zlx));
+        decrRefCount(range.min);
+        decrRefCount(range.max);
+
+        // 删除最后的元素之后，表尾的快速路径仍然正确
+        a = zlx->length;
+        zslDeleteRangeByRank(zp.zsl, a - 50, a, zp.sd);
+        zlxDeleteRangeByRank(zlx, a - 50, a);
+        ok = 1;
+        for (i = 0; i < 2000; i++)
+        {
+            ele = randomMember(30000);
+            pairAdd(&zp, ele, &ok);
+            decrRefCount(ele);
+        }
+        test_cond("Tail is kept after deletes", ok && sameAsSkiplist(zp.zsl, zlx));
+    }
+
+    dictRelease(zp.sd);
+    zslFree(zp.zsl);
+    zlxFree(zlx);
+
+    test_report();
+    return 0;
+}
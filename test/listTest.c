@@ -0,0 +1,123 @@
+#include "test.h"
+#include "xmt_list.h"
+#include "xmclient.h"
+#include "xmzplist.h"
+#include "xmmalloc.h"
+
+#include <stdio.h>
+#include <string.h>
+
+// 列表中的元素，整数会被 ziplist 编码为整数节点
+static const char *elements[] = {"foo", "12", "-3", "a longer string value", "1234567890123", ""};
+#define NUMELEMENTS ((long)(sizeof(elements) / sizeof(elements[0])))
+
+static redisClient *createTestClient(void)
+{
+    redisClient *c = xm_calloc(sizeof(*c));
+
+    ilistInit(&c->reply);
+    return c;
+}
+
+// 比较客户端收到的回复，之后清空回复缓冲区
+static int replyIs(redisClient *c, sds s)
+{
+    int ok = c->bufpos == (int)sdslen(s) && memcmp(c->buf, s, c->bufpos) == 0;
+
+    c->bufpos = 0;
+    sdsfree(s);
+    return ok;
+}
+
+// 按 LRANGE 的规则逐个拼出 [start, end] 的回复
+static sds expectedRange(long start, long end)
+{
+    sds s = sdsempty();
+    long i;
+
+    if (start < 0)
+        start += NUMELEMENTS;
+    if (end < 0)
+        end += NUMELEMENTS;
+    if (start < 0)
+        start = 0;
+    if (end >= NUMELEMENTS)
+        end = NUMELEMENTS - 1;
+    if (start > end || start >= NUMELEMENTS)
+        return sdscat(s, "*0\r\n");
+
+    s = sdscatprintf(s, "*%ld\r\n", end - start + 1);
+    for (i = start; i <= end; i++)
+        s = sdscatprintf(s, "$%d\r\n%s\r\n", (int)strlen(elements[i]), elements[i]);
+    return s;
+}
+
+int main()
+{
+    static const long ranges[][2] = {
+        {0, -1}, {1, 2}, {-2, -1}, {-100, 1}, {3, 100}, {-100, 100}, {4, 2}, {6, 10}, {-100, -50}, {-1, -2}};
+    redisClient *c;
+    robj *zl, *ll, *ele;
+    unsigned char *p;
+    long i;
+    int ok;
+
+    createSharedObjects();
+    registerObjectTypes();
+    server.list_max_ziplist_entries = 128;
+    server.list_max_ziplist_value = 64;
+    c = createTestClient();
+
+    zl = createZiplistObject();
+    for (i = 0; i < NUMELEMENTS; i++)
+    {
+        ele = createStringObject((char *)elements[i], strlen(elements[i]));
+        listTypePush(zl, ele, REDIS_TAIL);
+        decrRefCount(ele);
+    }
+    ll = createZiplistObject();
+    for (i = 0; i < NUMELEMENTS; i++)
+    {
+        ele = createStringObject((char *)elements[i], strlen(elements[i]));
+        listTypePush(ll, ele, REDIS_TAIL);
+        decrRefCount(ele);
+    }
+    listTypeConvert(ll, REDIS_ENCODING_LINKEDLIST);
+    ok = zl->encoding == REDIS_ENCODING_ZIPLIST && ll->encoding == REDIS_ENCODING_LINKEDLIST;
+
+    // 整数节点和字符串节点都回复为批量回复
+    p = ziplistIndex(zl->ptr, 1);
+    addReplyZiplistEntry(c, p);
+    ok = ok && replyIs(c, sdsnew("$2\r\n12\r\n"));
+    p = ziplistIndex(zl->ptr, 4);
+    addReplyZiplistEntry(c, p);
+    ok = ok && replyIs(c, sdsnew("$13\r\n1234567890123\r\n"));
+    p = ziplistIndex(zl->ptr, 0);
+    addReplyZiplistEntry(c, p);
+    ok = ok && replyIs(c, sdsnew("$3\r\nfoo\r\n"));
+    p = ziplistIndex(zl->ptr, 5);
+    addReplyZiplistEntry(c, p);
+    ok = ok && replyIs(c, sdsnew("$0\r\n\r\n"));
+    test_cond("addReplyZiplistEntry on integer and string entries", ok);
+
+    ok = 1;
+    for (i = 0; i < (long)(sizeof(ranges) / sizeof(ranges[0])); i++)
+    {
+        listTypeReplyRange(c, zl, ranges[i][0], ranges[i][1]);
+        ok = ok && replyIs(c, expectedRange(ranges[i][0], ranges[i][1]));
+    }
+    test_cond("LRANGE reply bytes from a ziplist", ok);
+
+    ok = 1;
+    for (i = 0; i < (long)(sizeof(ranges) / sizeof(ranges[0])); i++)
+    {
+        listTypeReplyRange(c, ll, ranges[i][0], ranges[i][1]);
+        ok = ok && replyIs(c, expectedRange(ranges[i][0], ranges[i][1]));
+    }
+    test_cond("LRANGE reply bytes from a linked list", ok);
+
+    decrRefCount(zl);
+    decrRefCount(ll);
+    test_report();
+    return 0;
+}
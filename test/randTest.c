@@ -0,0 +1,44 @@
+#include "test.h"
+#include "xmrand.h"
+
+#include <stdio.h>
+#include <string.h>
+
+int main()
+{
+    uint64_t a[100], b[100];
+    unsigned long buckets[10];
+    int i, ok;
+
+    // 种子相同，序列相同
+    xm_srandom(12345);
+    for (i = 0; i < 100; i++)
+        a[i] = xm_random();
+    xm_srandom(12345);
+    for (i = 0; i < 100; i++)
+        b[i] = xm_random();
+    test_cond("Same seed gives the same sequence", memcmp(a, b, sizeof(a)) == 0);
+
+    xm_srandom(12346);
+    for (i = 0; i < 100; i++)
+        b[i] = xm_random();
+    test_cond("Different seeds give different sequences", memcmp(a, b, sizeof(a)) != 0);
+
+    // 每个取值出现的次数都接近平均值
+    memset(buckets, 0, sizeof(buckets));
+    ok = 1;
+    for (i = 0; i < 1000000; i++)
+    {
+        uint64_t v = xm_random_below(10);
+        if (v >= 10)
+            ok = 0;
+        else
+            buckets[v]++;
+    }
+    for (i = 0; i < 10; i++)
+        ok = ok && buckets[i] > 98000 && buckets[i] < 102000;
+    test_cond("Random below n is in range and uniform", ok);
+
+    test_report();
+    return 0;
+}
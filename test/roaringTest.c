@@ -0,0 +1,276 @@
+#include "test.h"
+#include "xmroaring.h"
+#include "xmintset.h"
+#include "xmmalloc.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// 检查 roaring 和作为对照的 intset 中的元素完全相同，并且顺序一致
+static int sameAsIntset(roaring *r, intset *is)
+{
+    roaringIterator it;
+    int64_t v, expect;
+    uint32_t i = 0;
+
+    if (roaringCard(r) != intsetLen(is))
+        return 0;
+    roaringInitIterator(r, &it);
+    while (roaringNext(&it, &v))
+    {
+        if (!intsetGet(is, i++, &expect) || v != expect)
+            return 0;
+    }
+    return i == intsetLen(is);
+}
+
+// 生成测试用的值：稠密的一段、稀疏的随机值、以及靠近 int64 边界的值
+static int64_t randomValue(int kind)
+{
+    if (kind == 0)
+        return rand() % 20000;
+    else if (kind == 1)
+        return ((int64_t)rand() << 32 | rand()) - ((int64_t)1 << 62);
+    else
+        return (rand() & 1) ? INT64_MAX - rand() % 100 : INT64_MIN + rand() % 100;
+}
+
+static roaring *buildPair(int kind, int n, intset **is)
+{
+    roaring *r = roaringNew();
+    int i;
+
+    *is = intsetNew();
+    for (i = 0; i < n; i++)
+    {
+        int64_t v = randomValue(i % 5 == 0 ? (i / 5) % 3 : kind);
+        roaringAdd(r, v);
+        *is = intsetAdd(*is, v, NULL);
+    }
+    return r;
+}
+
+int main()
+{
+    roaring *r, *r2, *res;
+    intset *is, *is2, *sets[2], *expect;
+    int64_t v;
+    int i, ok;
+
+    // 添加、删除、查找
+    {
+        r = roaringNew();
+        test_cond("Add new value", roaringAdd(r, 5) == 1);
+        test_cond("Add existing value", roaringAdd(r, 5) == 0);
+        test_cond("Add negative value", roaringAdd(r, -5) == 1 && roaringContains(r, -5));
+        test_cond("Contains", roaringContains(r, 5) && !roaringContains(r, 6));
+        test_cond("Remove", roaringRemove(r, 5) == 1 && roaringRemove(r, 5) == 0);
+        test_cond("Card", roaringCard(r) == 1);
+        roaringFree(r);
+    }
+
+    // 随机操作，和 intset 的结果对照，数组和位图之间会来回转换
+    {
+        r = roaringNew();
+        is = intsetNew();
+        ok = 1;
+        for (i = 0; i < 200000 && ok; i++)
+        {
+            int64_t v = rand() % 12000 - 6000;
+            uint8_t added;
+            int removed;
+
+            if (rand() % 3)
+            {
+                is = intsetAdd(is, v, &added);
+                ok = roaringAdd(r, v) == added;
+            }
+            else
+            {
+                is = intsetRemove(is, v, &removed);
+                ok = roaringRemove(r, v) == removed;
+            }
+        }
+        test_cond("Random add/remove matches intset", ok && sameAsIntset(r, is));
+
+        ok = 1;
+        for (i = 0; i < 20000 && ok; i++)
+        {
+            v = rand() % 14000 - 7000;
+            ok = roaringContains(r, v) == intsetFind(is, v);
+        }
+        test_cond("Random lookups match intset", ok);
+
+        ok = 1;
+        for (i = 0; i < (int)intsetLen(is) && ok; i += 7)
+        {
+            int64_t got, expect;
+            intsetGet(is, i, &expect);
+            ok = roaringSelect(r, i, &got) && got == expect;
+        }
+        test_cond("Select by rank", ok && !roaringSelect(r, roaringCard(r), &v));
+
+        {
+            // 每隔几个取一个排位，批量取出的结果和逐个取出相同
+            uint64_t *ranks = xm_malloc(sizeof(uint64_t) * intsetLen(is));
+            int64_t *values = xm_malloc(sizeof(int64_t) * intsetLen(is));
+            uint64_t n = 0;
+
+            for (i = 0; i < (int)intsetLen(is); i += 1 + rand() % 5)
+                ranks[n++] = i;
+            roaringSelectMany(r, ranks, n, values);
+            ok = 1;
+            for (i = 0; i < (int)n && ok; i++)
+                ok = roaringSelect(r, ranks[i], &v) && v == values[i];
+            test_cond("Select many by sorted ranks", ok);
+            xm_free(ranks);
+            xm_free(values);
+        }
+
+        {
+            // 从任意值开始迭代，得到的是 intset 中第一个不小于它的元素开始的后缀
+            roaringIterator it;
+            int64_t from, got, expect;
+            uint32_t pos;
+
+            ok = 1;
+            for (i = 0; i < 2000 && ok; i++)
+            {
+                from = rand() % 14000 - 7000;
+                for (pos = 0; intsetGet(is, pos, &expect) && expect < from; pos++)
+                    ;
+                roaringInitIteratorFrom(r, &it, from);
+                while (ok && roaringNext(&it, &got))
+                    ok = intsetGet(is, pos++, &expect) && got == expect;
+                ok = ok && pos == intsetLen(is);
+                if (i == 1000)
+                    roaringRunOptimize(r);
+            }
+            test_cond("Iterate from value", ok);
+        }
+
+        roaringRunOptimize(r);
+        test_cond("Run optimize keeps elements", sameAsIntset(r, is));
+        ok = 1;
+        for (i = 0; i < 20000 && ok; i++)
+        {
+            v = rand() % 14000 - 7000;
+            if (i % 2)
+            {
+                uint8_t added;
+                is = intsetAdd(is, v, &added);
+                ok = roaringAdd(r, v) == added;
+            }
+            else
+            {
+                ok = roaringContains(r, v) == intsetFind(is, v);
+            }
+        }
+        test_cond("Add after run optimize", ok && sameAsIntset(r, is));
+        roaringFree(r);
+        xm_free(is);
+    }
+
+    // 连续整数会被压缩成区间
+    {
+        size_t before, after;
+        r = roaringNew();
+        for (i = 0; i < 1000000; i++)
+            roaringAdd(r, i);
+        before = roaringBytes(r);
+        roaringRunOptimize(r);
+        after = roaringBytes(r);
+        test_cond("Run containers shrink dense ranges", after < before / 100 && roaringCard(r) == 1000000);
+        {
+            uint64_t ranks[4] = {0, 1, 499999, 999999};
+            int64_t values[4];
+            roaringSelectMany(r, ranks, 4, values);
+            test_cond("Select many from run container", values[0] == 0 && values[1] == 1 &&
+                                                            values[2] == 499999 && values[3] == 999999);
+        }
+        test_cond("Remove from run container", roaringRemove(r, 500000) && !roaringContains(r, 500000) &&
+                                                   roaringContains(r, 499999) && roaringCard(r) == 999999);
+        roaringFree(r);
+    }
+
+    // 交集和并集
+    {
+        int kind;
+        ok = 1;
+        for (kind = 0; kind < 3 && ok; kind++)
+        {
+            r = buildPair(kind, 30000, &is);
+            r2 = buildPair(kind, 20000, &is2);
+            if (kind == 0)
+                roaringRunOptimize(r2);
+            sets[0] = is;
+            sets[1] = is2;
+
+            res = roaringAnd(r, r2);
+            expect = intsetIntersect(sets, 2);
+            ok = ok && sameAsIntset(res, expect);
+            roaringFree(res);
+            xm_free(expect);
+
+            res = roaringOr(r, r2);
+            expect = intsetUnion(sets, 2);
+            ok = ok && sameAsIntset(res, expect);
+            roaringFree(res);
+            xm_free(expect);
+
+            roaringFree(r);
+            roaringFree(r2);
+            xm_free(is);
+            xm_free(is2);
+        }
+        test_cond("And/Or match intset", ok);
+    }
+
+    // 序列化
+    {
+        unsigned char *buf;
+        size_t len;
+        roaring *loaded;
+
+        r = buildPair(0, 50000, &is);
+        for (i = 0; i < 100000; i += 3)
+            roaringAdd(r, i + 1000000), is = intsetAdd(is, i + 1000000, NULL);
+        roaringRunOptimize(r);
+        len = roaringSerializedSize(r);
+        buf = xm_malloc(len);
+        test_cond("Serialize writes the computed size", roaringSerialize(r, buf) == len);
+        loaded = roaringDeserialize(buf, len);
+        test_cond("Deserialize round trip", loaded != NULL && sameAsIntset(loaded, is));
+        if (loaded)
+            roaringFree(loaded);
+
+        test_cond("Truncated buffer is rejected", roaringDeserialize(buf, len - 1) == NULL);
+        ok = 1;
+        for (i = 0; i < 200; i++)
+        {
+            // 随机改动一个字节，要么被拒绝，要么得到一个能正常迭代的集合
+            size_t pos = rand() % len;
+            unsigned char old = buf[pos];
+            buf[pos] ^= 1 << (rand() % 8);
+            loaded = roaringDeserialize(buf, len);
+            if (loaded)
+            {
+                roaringIterator it;
+                uint64_t n = 0;
+                roaringInitIterator(loaded, &it);
+                while (roaringNext(&it, &v))
+                    n++;
+                ok = ok && n == roaringCard(loaded);
+                roaringFree(loaded);
+            }
+            buf[pos] = old;
+        }
+        test_cond("Corrupted buffers are rejected or consistent", ok);
+        xm_free(buf);
+        roaringFree(r);
+        xm_free(is);
+    }
+
+    test_report();
+    return 0;
+}
@@ -0,0 +1,414 @@
+#include "test.h"
+#include "xmdb.h"
+#include "xmt_hash.h"
+#include "xmt_set.h"
+#include "xmt_string.h"
+#include "xmmalloc.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAXELEMENTS 20000
+
+static unsigned int sdsHash(const void *key)
+{
+    return dictGenHashFunction(key, sdslen((sds)key));
+}
+
+static void sdsDestructor(void *privdata, void *val)
+{
+    DICT_NOTUSED(privdata);
+    sdsfree(val);
+}
+
+// 数据库键空间，键为 sds ，值为对象
+static dictType dbDictType = {
+    sdsHash,                  /* hash function */
+    NULL,                     /* key dup */
+    NULL,                     /* val dup */
+    dictSdsKeyCompare,        /* key compare */
+    sdsDestructor,            /* key destructor */
+    dictRedisObjectDestructor /* val destructor */
+};
+
+// 记录返回过的元素，值为返回的次数
+static dictType seenDictType = {
+    sdsHash,           /* hash function */
+    NULL,              /* key dup */
+    NULL,              /* val dup */
+    dictSdsKeyCompare, /* key compare */
+    sdsDestructor,     /* key destructor */
+    NULL               /* val destructor */
+};
+
+static redisDb db;
+static sds elements[MAXELEMENTS];
+
+// 取出客户端的全部回复，包括固定缓冲区和回复链表，之后清空
+static sds replyString(redisClient *c)
+{
+    sds s = sdsnewlen(c->buf, c->bufpos);
+    ilistIter it;
+    ilistNode *ln;
+
+    ilistRewind(&c->reply, &it, AL_START_HEAD);
+    while ((ln = ilistNext(&it)) != NULL)
+    {
+        clientReplyBlock *b = ilistEntry(ln, clientReplyBlock, node);
+        s = sdscatlen(s, b->buf, b->used);
+    }
+    freeClientReplyList(c);
+    c->bufpos = 0;
+    return s;
+}
+
+// 读出 p 处的一个批量回复，返回之后的位置
+static char *readBulk(char *p, sds *out)
+{
+    long len;
+
+    if (*p != '$')
+        return NULL;
+    len = strtol(p + 1, &p, 10);
+    *out = sdsnewlen(p + 2, len);
+    return p + 2 + len + 2;
+}
+
+// 读出 p 处的多条批量回复，元素保存到 elements ，返回元素个数，格式不对时返回 -1
+static long readMultiBulk(char *p, char **end)
+{
+    long n, i;
+
+    if (*p != '*')
+        return -1;
+    n = strtol(p + 1, &p, 10);
+    p += 2;
+    for (i = 0; i < n && p != NULL; i++)
+        p = readBulk(p, &elements[i]);
+    if (p == NULL)
+        return -1;
+    if (end)
+        *end = p;
+    return n;
+}
+
+// 解析 SCAN 的回复，游标保存到 *cursor ，元素保存到 elements ，返回元素个数
+static long parseScanReply(sds reply, unsigned long *cursor)
+{
+    char *p = reply;
+    sds cur;
+    long n;
+
+    if (strncmp(p, "*2\r\n", 4) != 0 || (p = readBulk(p + 4, &cur)) == NULL)
+        return -1;
+    *cursor = strtoul(cur, NULL, 10);
+    sdsfree(cur);
+    n = readMultiBulk(p, &p);
+    return (n >= 0 && *p == '\0') ? n : -1;
+}
+
+static void freeElements(long n)
+{
+    while (n-- > 0)
+        sdsfree(elements[n]);
+}
+
+// 用 argc 个参数执行命令 proc ，参数中的 %lu 会被替换为 cursor
+static void call(redisClient *c, void (*proc)(redisClient *), unsigned long cursor, int argc, ...)
+{
+    robj *argv[8];
+    char buf[32];
+    va_list ap;
+    int i;
+
+    va_start(ap, argc);
+    for (i = 0; i < argc; i++)
+    {
+        const char *s = va_arg(ap, const char *);
+
+        if (!strcmp(s, "%lu"))
+            argv[i] = createStringObject(buf, snprintf(buf, sizeof(buf), "%lu", cursor));
+        else
+            argv[i] = createStringObject((char *)s, strlen(s));
+    }
+    va_end(ap);
+    c->argv = argv;
+    c->argc = argc;
+    proc(c);
+    for (i = 0; i < argc; i++)
+        decrRefCount(argv[i]);
+    c->argv = NULL;
+    c->argc = 0;
+}
+
+// 记录一次返回，返回这个元素被返回过的次数
+static long markSeen(dict *seen, sds ele)
+{
+    dictEntry *de = dictFind(seen, ele);
+
+    if (de == NULL)
+    {
+        dictAdd(seen, sdsdup(ele), NULL);
+        de = dictFind(seen, ele);
+        dictSetSignedIntegerVal(de, 0);
+    }
+    dictSetSignedIntegerVal(de, dictGetSignedIntegerVal(de) + 1);
+    return dictGetSignedIntegerVal(de);
+}
+
+static int wasSeen(dict *seen, const char *ele)
+{
+    sds s = sdsnew(ele);
+    int found = dictFind(seen, s) != NULL;
+
+    sdsfree(s);
+    return found;
+}
+
+static robj *createHashOfSize(int n)
+{
+    robj *o = createHashObject(), *field, *value;
+    char buf[32];
+    int i;
+
+    for (i = 0; i < n; i++)
+    {
+        field = createStringObject(buf, snprintf(buf, sizeof(buf), "f%d", i));
+        value = createStringObject(buf, snprintf(buf, sizeof(buf), "v%d", i));
+        hashTypeSet(o, field, value);
+        decrRefCount(field);
+        decrRefCount(value);
+    }
+    return o;
+}
+
+static void deleteField(robj *o, int i)
+{
+    char buf[32];
+    robj *field = createStringObject(buf, snprintf(buf, sizeof(buf), "f%d", i));
+
+    hashTypeDelete(o, field);
+    decrRefCount(field);
+}
+
+int main()
+{
+    redisClient *c;
+    dict *seen;
+    unsigned long cursor;
+    char buf[32];
+    long n, i;
+    int ok, round;
+
+    createSharedObjects();
+    registerObjectTypes();
+    ilistInit(&server.streaming_clients);
+    server.hash_max_ziplist_entries = 64;
+    server.hash_max_ziplist_value = 64;
+    server.set_max_intset_entries = 512;
+    db.dict = dictCreate(&dbDictType, NULL);
+    db.expires = dictCreate(&dbDictType, NULL);
+    c = xm_calloc(sizeof(*c));
+    c->db = &db;
+    ilistInit(&c->reply);
+
+    // SCAN 期间增删键，一直存在的键至少返回一次
+    for (i = 0; i < 1000; i++)
+    {
+        robj *key = createStringObject(buf, snprintf(buf, sizeof(buf), "key:%ld", i));
+        dbAdd(&db, key, createStringObject("x", 1));
+        decrRefCount(key);
+    }
+    seen = dictCreate(&seenDictType, NULL);
+    cursor = 0;
+    ok = 1;
+    round = 0;
+    do
+    {
+        sds reply;
+
+        call(c, scanCommand, cursor, 4, "scan", "%lu", "count", "10");
+        reply = replyString(c);
+        n = parseScanReply(reply, &cursor);
+        sdsfree(reply);
+        ok = ok && n >= 0;
+        for (i = 0; i < n; i++)
+            markSeen(seen, elements[i]);
+        freeElements(n);
+
+        // 第 20 轮时加入新键，字典扩展；删除 key:900 以后的键
+        if (++round == 20)
+        {
+            for (i = 1000; i < 3000; i++)
+            {
+                robj *key = createStringObject(buf, snprintf(buf, sizeof(buf), "key:%ld", i));
+                dbAdd(&db, key, createStringObject("x", 1));
+                decrRefCount(key);
+            }
+            for (i = 900; i < 1000; i++)
+            {
+                robj *key = createStringObject(buf, snprintf(buf, sizeof(buf), "key:%ld", i));
+                dbDelete(&db, key);
+                decrRefCount(key);
+            }
+        }
+    } while (cursor != 0 && ok);
+    for (i = 0; i < 900 && ok; i++)
+        ok = wasSeen(seen, (snprintf(buf, sizeof(buf), "key:%ld", i), buf));
+    test_cond("SCAN cursor returns every key present throughout", ok && round > 20);
+    dictRelease(seen);
+
+    // 游标不合法时回复错误
+    {
+        robj *arg = createStringObject("12x", 3);
+        sds reply;
+
+        ok = parseScanCursorOrReply(c, arg, &cursor) == REDIS_ERR;
+        reply = replyString(c);
+        ok = ok && !strcmp(reply, "-ERR invalid cursor\r\n");
+        sdsfree(reply);
+        decrRefCount(arg);
+        test_cond("Invalid SCAN cursor is rejected", ok);
+    }
+
+    // HSCAN 返回域和值，分多次返回全部的域
+    {
+        robj *key = createStringObject("h", 1);
+        robj *o = createHashOfSize(500);
+
+        dbAdd(&db, key, o);
+        seen = dictCreate(&seenDictType, NULL);
+        cursor = 0;
+        ok = o->encoding == REDIS_ENCODING_HT;
+        round = 0;
+        do
+        {
+            sds reply;
+
+            call(c, hscanCommand, cursor, 5, "hscan", "h", "%lu", "count", "20");
+            reply = replyString(c);
+            n = parseScanReply(reply, &cursor);
+            sdsfree(reply);
+            ok = ok && n >= 0 && n % 2 == 0;
+            for (i = 0; ok && i < n; i += 2)
+                ok = elements[i][0] == 'f' && elements[i + 1][0] == 'v' &&
+                     !strcmp(elements[i] + 1, elements[i + 1] + 1) && markSeen(seen, elements[i]) == 1;
+            freeElements(n);
+            round++;
+        } while (cursor != 0 && ok);
+        ok = ok && dictSize(seen) == 500 && round > 1;
+        test_cond("HSCAN returns every field with its value", ok);
+        dictRelease(seen);
+        dbDelete(&db, key);
+        decrRefCount(key);
+    }
+
+    // 压缩位图按值的顺序返回，游标是下一个元素的值，负数也能作为起点；
+    // 两次调用之间的增删不会让一直存在的元素被跳过，也不会重复返回
+    {
+        robj *key = createStringObject("s", 1), *o = createIntsetObject(), *ele;
+        long long last = 0, v;
+        int first = 1;
+        unsigned long total = 0;
+
+        for (v = -3000; v <= 3000; v += 3)
+        {
+            ele = createStringObjectFromLongLong(v);
+            setTypeAdd(o, ele);
+            decrRefCount(ele);
+        }
+        dbAdd(&db, key, o);
+        ok = o->encoding == REDIS_ENCODING_ROARING;
+        cursor = 0;
+        round = 0;
+        do
+        {
+            sds reply;
+
+            call(c, sscanCommand, cursor, 5, "sscan", "s", "%lu", "count", "100");
+            reply = replyString(c);
+            n = parseScanReply(reply, &cursor);
+            sdsfree(reply);
+            ok = ok && n >= 0 && n <= 100 && (cursor == 0 || n == 100);
+            for (i = 0; ok && i < n; i++)
+            {
+                v = strtoll(elements[i], NULL, 10);
+                ok = first || v > last;
+                first = 0;
+                last = v;
+                total++;
+            }
+            freeElements(n);
+            // 每一轮都删除后面的一个元素，加入后面的一个新元素
+            if (ok && cursor != 0)
+            {
+                ele = createStringObjectFromLongLong(last + 30 - (last + 30) % 3 + 3);
+                setTypeRemove(o, ele);
+                decrRefCount(ele);
+                ele = createStringObjectFromLongLong(last + 31);
+                setTypeAdd(o, ele);
+                decrRefCount(ele);
+            }
+            round++;
+        } while (cursor != 0 && ok);
+        ok = ok && total == setTypeSize(o) && round > 1;
+        test_cond("SSCAN pages a roaring set in value order", ok);
+        dbDelete(&db, key);
+        decrRefCount(key);
+    }
+
+    // 分批回复：每个时间片只回复一部分域，期间的删除不会让字典收缩，每个域最多回复一次
+    {
+        robj *o = createHashOfSize(5000);
+        unsigned long slots;
+        char *p;
+        sds reply;
+
+        // 先完成渐进式 rehash ，之后槽的数量只会因为收缩而变少
+        while (dictIsRehashing((dict *)o->ptr))
+            dictRehash(o->ptr, 100);
+        server.stream_time_budget = 1;
+        seen = dictCreate(&seenDictType, NULL);
+        hashTypeStreamReply(c, o, REDIS_HASH_KEY | REDIS_HASH_VALUE);
+        ok = (c->flags & REDIS_STREAMING) && hashTypeStreaming(o);
+        slots = dictSlots((dict *)o->ptr);
+        round = 0;
+        while ((c->flags & REDIS_STREAMING) && ok)
+        {
+            // 删掉 f4000 之后的全部域，足以让字典收缩
+            if (round++ == 1)
+                for (i = 4000; i < 5000; i++)
+                    deleteField(o, i);
+            if (round == 2)
+                for (i = 0; i < 3900; i++)
+                    deleteField(o, i);
+            handleStreamingClients();
+            ok = dictSlots((dict *)o->ptr) == slots;
+        }
+        ok = ok && round > 2 && !hashTypeStreaming(o) && ilistLength(&server.streaming_clients) == 0;
+
+        reply = replyString(c);
+        n = readMultiBulk(reply, &p);
+        ok = ok && n >= 0 && n % 2 == 0 && *p == '\0';
+        for (i = 0; ok && i < n; i += 2)
+            ok = !strcmp(elements[i] + 1, elements[i + 1] + 1) && markSeen(seen, elements[i]) == 1;
+        freeElements(n);
+        sdsfree(reply);
+        for (i = 3900; i < 4000 && ok; i++)
+            ok = wasSeen(seen, (snprintf(buf, sizeof(buf), "f%ld", i), buf));
+        test_cond("Streamed HGETALL resumes across slices without duplicates", ok);
+
+        // 回复完之后删除域，字典可以正常收缩
+        deleteField(o, 3900);
+        while (dictIsRehashing((dict *)o->ptr))
+            dictRehash(o->ptr, 100);
+        test_cond("Dict shrinks again after streaming", dictSlots((dict *)o->ptr) < slots);
+        dictRelease(seen);
+        decrRefCount(o);
+    }
+
+    test_report();
+    return 0;
+}
@@ -0,0 +1,107 @@
+#include "xmt_set.h"
+#include "xmobject.h"
+#include "xmmalloc.h"
+#include "xmdict.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/*
+集合批量随机取样的对比测试：SRANDMEMBER key count 取出 count 个不同的元素，
+比较 setTypeRandomElements 一次取样，和调用 count 次以上 setTypeRandomElement 、用临时字典去重的耗时
+
+三种编码的集合各有 N 个元素，count 取集合大小的 1% 、10% 、50% 和 90%
+
+用法：setBench [元素个数]，默认 1000000 个元素
+*/
+
+static void countMember(void *privdata, robj *objele, int64_t llele)
+{
+    (void)objele;
+    (void)llele;
+    (*(unsigned long *)privdata)++;
+}
+
+// 逐个随机取出元素，放入临时字典去重，直到有 count 个不同的元素
+static unsigned long sampleOneByOne(robj *set, unsigned long count)
+{
+    dict *d = dictCreate(&setDictType, NULL);
+    unsigned long n;
+    robj *objele;
+    int64_t llele;
+
+    while (dictSize(d) < count)
+    {
+        if (setTypeRandomElement(set, &objele, &llele) == REDIS_ENCODING_HT)
+            incrRefCount(objele);
+        else
+            objele = createStringObjectFromLongLong(llele);
+        if (dictAdd(d, objele, NULL) != DICT_OK)
+            decrRefCount(objele);
+    }
+    n = dictSize(d);
+    dictRelease(d);
+    return n;
+}
+
+int main(int argc, char **argv)
+{
+    static const double ratios[] = {0.01, 0.1, 0.5, 0.9};
+    static const char *names[] = {"intset", "roaring", "hashtable"};
+    unsigned long n = argc > 1 ? strtoul(argv[1], NULL, 10) : 1000000;
+    unsigned long i, count, got;
+    robj *sets[3], *ele;
+    char buf[32];
+    long long start, bulk, single;
+    int k, r;
+
+    createSharedObjects();
+    registerObjectTypes();
+    srand(1);
+    server.set_max_intset_entries = n * 2;
+
+    sets[0] = createIntsetObject();
+    sets[1] = createIntsetObject();
+    sets[2] = createSetObject();
+    for (i = 0; i < n; i++)
+    {
+        ele = createStringObjectFromLongLong(i * 3);
+        setTypeAdd(sets[0], ele);
+        setTypeAdd(sets[1], ele);
+        decrRefCount(ele);
+
+        ele = createStringObject(buf, snprintf(buf, sizeof(buf), "member:%lu", i));
+        setTypeAdd(sets[2], ele);
+        decrRefCount(ele);
+    }
+    setTypeConvert(sets[1], REDIS_ENCODING_ROARING);
+
+    printf("N=%lu, bulk / one by one with a dedup dict\n", n);
+    printf("ratio");
+    for (k = 0; k < 3; k++)
+        printf("  %21s", names[k]);
+    printf("\n");
+    for (r = 0; r < 4; r++)
+    {
+        count = (unsigned long)(n * ratios[r]);
+        printf("%.2f ", ratios[r]);
+        for (k = 0; k < 3; k++)
+        {
+            got = 0;
+            start = ustime();
+            setTypeRandomElements(sets[k], count, countMember, &got);
+            bulk = ustime() - start;
+
+            start = ustime();
+            if (sampleOneByOne(sets[k], count) != got)
+                printf("(count mismatch) ");
+            single = ustime() - start;
+            printf("  %9.3fs/%9.3fs", bulk / 1e6, single / 1e6);
+        }
+        printf("\n");
+    }
+
+    for (k = 0; k < 3; k++)
+        decrRefCount(sets[k]);
+    return 0;
+}
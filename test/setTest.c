@@ -0,0 +1,270 @@
+#include "test.h"
+#include "xmt_set.h"
+#include "xmclient.h"
+#include "xmmalloc.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// 交集回调收集到的元素，整数和不能表示为整数的对象分开计数
+typedef struct
+{
+    long long vals[4096];
+    unsigned long n;
+    unsigned long objects; // 交给回调的元素中 objele 不为 NULL 的个数
+    unsigned long strings; // 不能表示为整数的元素个数
+} collected;
+
+static void collect(void *privdata, robj *objele, int64_t llele)
+{
+    collected *col = privdata;
+    long long llval;
+
+    if (objele != NULL)
+    {
+        col->objects++;
+        if (isObjectRepresentableAsLongLong(objele, &llval) != REDIS_OK)
+        {
+            col->strings++;
+            return;
+        }
+        llele = llval;
+    }
+    col->vals[col->n++] = llele;
+}
+
+static int compareLongLong(const void *a, const void *b)
+{
+    long long x = *(long long *)a, y = *(long long *)b;
+    return (x > y) - (x < y);
+}
+
+// 收集到的整数排序之后是否恰好为 [0, limit) 中 step 的倍数
+static int collectedMultiples(collected *col, long long step, long long limit)
+{
+    unsigned long i;
+
+    qsort(col->vals, col->n, sizeof(long long), compareLongLong);
+    if (col->n != (unsigned long)((limit + step - 1) / step))
+        return 0;
+    for (i = 0; i < col->n; i++)
+        if (col->vals[i] != (long long)i * step)
+            return 0;
+    return 1;
+}
+
+// 用 setTypeAdd 逐个加入 [0, limit) 中 step 的倍数，raw 为真时元素是字符串编码的对象
+static robj *createMultiples(long long step, long long limit, int raw)
+{
+    robj *set = createIntsetObject(), *ele;
+    char buf[32];
+    long long i;
+
+    for (i = 0; i < limit; i += step)
+    {
+        if (raw)
+            ele = createStringObject(buf, snprintf(buf, sizeof(buf), "%lld", i));
+        else
+            ele = createStringObjectFromLongLong(i);
+        setTypeAdd(set, ele);
+        decrRefCount(ele);
+    }
+    return set;
+}
+
+static void addString(robj *set, const char *s)
+{
+    robj *ele = createStringObject((char *)s, strlen(s));
+    setTypeAdd(set, ele);
+    decrRefCount(ele);
+}
+
+// 取出客户端的全部回复，包括固定缓冲区和回复链表，之后清空
+static sds replyString(redisClient *c)
+{
+    sds s = sdsnewlen(c->buf, c->bufpos);
+    ilistIter it;
+    ilistNode *ln;
+
+    ilistRewind(&c->reply, &it, AL_START_HEAD);
+    while ((ln = ilistNext(&it)) != NULL)
+    {
+        clientReplyBlock *b = ilistEntry(ln, clientReplyBlock, node);
+        s = sdscatlen(s, b->buf, b->used);
+    }
+    freeClientReplyList(c);
+    c->bufpos = 0;
+    return s;
+}
+
+int main()
+{
+    robj *a, *b, *d, *f, *sets[3], *dst;
+    collected col;
+    unsigned long count;
+    int ok;
+
+    createSharedObjects();
+    registerObjectTypes();
+    server.set_max_intset_entries = 512;
+
+    // a: 300 以内 3 的倍数，intset
+    // b: 3000 以内 2 的倍数，超过 set_max_intset_entries ，压缩位图
+    // d: 1000 以内 5 的倍数，元素是字符串编码的对象，再加一个字符串元素，字典
+    // f: 400 以内 4 的倍数，intset
+    a = createMultiples(3, 300, 0);
+    b = createMultiples(2, 3000, 0);
+    d = createMultiples(5, 1000, 1);
+    addString(d, "x");
+    f = createMultiples(4, 400, 0);
+    ok = a->encoding == REDIS_ENCODING_INTSET && b->encoding == REDIS_ENCODING_ROARING &&
+         d->encoding == REDIS_ENCODING_HT && f->encoding == REDIS_ENCODING_INTSET;
+    test_cond("Sources have the expected encodings", ok);
+
+    // 最小的 intset 遍历，到压缩位图和字典中探测，顺序和参数的顺序无关
+    sets[0] = d;
+    sets[1] = b;
+    sets[2] = a;
+    memset(&col, 0, sizeof(col));
+    count = setTypeInter(sets, 3, collect, &col);
+    ok = count == 10 && col.objects == 0 && collectedMultiples(&col, 30, 300);
+    test_cond("Intersect intset, roaring and dict", ok);
+
+    // 整数到字典中探测时使用栈上的整数对象，能和字符串编码的元素匹配
+    sets[0] = a;
+    sets[1] = d;
+    memset(&col, 0, sizeof(col));
+    count = setTypeInter(sets, 2, collect, &col);
+    ok = count == 20 && col.objects == 0 && collectedMultiples(&col, 15, 300);
+    test_cond("Integers probe a dict through a stack object", ok);
+
+    // 最小的集合是字典时，对象到 intset 和压缩位图中探测，不能表示为整数的对象直接被跳过
+    {
+        robj *e = createSetObject();
+
+        addString(e, "6");
+        addString(e, "12");
+        addString(e, "600");
+        addString(e, "x");
+        addString(e, "y");
+        sets[0] = a;
+        sets[1] = b;
+        sets[2] = e;
+        memset(&col, 0, sizeof(col));
+        count = setTypeInter(sets, 3, collect, &col);
+        ok = count == 2 && col.objects == 2 && col.strings == 0 && col.n == 2;
+        qsort(col.vals, col.n, sizeof(long long), compareLongLong);
+        ok = ok && col.vals[0] == 6 && col.vals[1] == 12;
+        test_cond("Dict members probe intset and roaring", ok);
+        decrRefCount(e);
+    }
+
+    // 全部是 intset 时直接归并，结果按从小到大的顺序给出
+    sets[0] = f;
+    sets[1] = a;
+    memset(&col, 0, sizeof(col));
+    count = setTypeInter(sets, 2, collect, &col);
+    ok = count == 25 && col.objects == 0;
+    for (count = 0; ok && count < col.n; count++)
+        ok = col.vals[count] == (long long)count * 12;
+    test_cond("All-intset intersection is merged in order", ok);
+
+    // 回复按元素的顺序生成，长度在算完之后填入
+    {
+        redisClient *c = xm_calloc(sizeof(*c));
+        sds reply, want;
+        int i;
+
+        ilistInit(&c->reply);
+        setTypeInterReply(c, sets, 2);
+        reply = replyString(c);
+        want = sdsnew("*25\r\n");
+        for (i = 0; i < 300; i += 12)
+            want = sdscatprintf(want, "$%d\r\n%d\r\n", (int)(i < 10 ? 1 : i < 100 ? 2 : 3), i);
+        ok = sdscmp(reply, want) == 0;
+        sdsfree(reply);
+        sdsfree(want);
+
+        sets[1] = NULL;
+        setTypeInterReply(c, sets, 2);
+        reply = replyString(c);
+        ok = ok && strcmp(reply, "*0\r\n") == 0;
+        sdsfree(reply);
+        test_cond("SINTER reply bytes", ok);
+        xm_free(c);
+    }
+
+    // 保存交集时，整数元素攒在一起一次加入 intset
+    sets[0] = d;
+    sets[1] = b;
+    sets[2] = a;
+    dst = setTypeInterStore(sets, 3);
+    ok = dst->encoding == REDIS_ENCODING_INTSET && setTypeSize(dst) == 10;
+    decrRefCount(dst);
+    test_cond("Integer intersection is stored as an intset", ok);
+
+    // 结果超过 set_max_intset_entries 时转换为压缩位图
+    {
+        robj *g = createMultiples(4, 6000, 0);
+
+        sets[0] = g;
+        sets[1] = b;
+        dst = setTypeInterStore(sets, 2);
+        ok = dst->encoding == REDIS_ENCODING_ROARING && setTypeSize(dst) == 750;
+        decrRefCount(dst);
+        decrRefCount(g);
+        test_cond("Large integer intersection is stored as roaring", ok);
+    }
+
+    // 有不能表示为整数的元素时结果是字典，整数和字符串元素都在
+    {
+        robj *g = createSetObject(), *h = createSetObject(), *ele;
+
+        addString(g, "a");
+        addString(g, "b");
+        addString(g, "1");
+        addString(g, "2");
+        addString(g, "3");
+        addString(h, "a");
+        addString(h, "2");
+        addString(h, "3");
+        addString(h, "z");
+        sets[0] = g;
+        sets[1] = h;
+        dst = setTypeInterStore(sets, 2);
+        ok = dst->encoding == REDIS_ENCODING_HT && setTypeSize(dst) == 3;
+        ele = createStringObject("a", 1);
+        ok = ok && setTypeIsMember(dst, ele);
+        decrRefCount(ele);
+        ele = createStringObjectFromLongLong(2);
+        ok = ok && setTypeIsMember(dst, ele);
+        decrRefCount(ele);
+        ele = createStringObjectFromLongLong(1);
+        ok = ok && !setTypeIsMember(dst, ele);
+        decrRefCount(ele);
+        decrRefCount(dst);
+        test_cond("Mixed intersection is stored as a dict", ok);
+
+        // 字典中能表示为整数的对象同样攒起来加入 intset
+        decrRefCount(h);
+        h = createSetObject();
+        addString(h, "1");
+        addString(h, "2");
+        addString(h, "q");
+        sets[1] = h;
+        dst = setTypeInterStore(sets, 2);
+        ok = dst->encoding == REDIS_ENCODING_INTSET && setTypeSize(dst) == 2;
+        decrRefCount(dst);
+        test_cond("Integer members of dicts are stored as an intset", ok);
+        decrRefCount(g);
+        decrRefCount(h);
+    }
+
+    decrRefCount(a);
+    decrRefCount(b);
+    decrRefCount(d);
+    decrRefCount(f);
+    test_report();
+    return 0;
+}
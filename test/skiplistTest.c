@@ -3,10 +3,48 @@
 #include "xmsds.h"
 #include "xmmalloc.h"
 #include "xmskiplist.h"
+#include "xmt_string.h"
+
+#include <stdio.h>
+
+// 检查每个节点的排位，以及按排位取出的节点，都和从表头顺序遍历的结果一致
+static int checkRanks(zskiplist *zsl)
+{
+    zskiplistNode *x = zsl->header->level[0].forward, *prev = NULL;
+    unsigned long rank = 1;
+
+    while (x)
+    {
+        if (zslGetRank(zsl, x->score, &x->obj) != rank || zslGetElementByRank(zsl, rank) != x || x->backward != prev)
+            return 0;
+        prev = x;
+        x = x->level[0].forward;
+        rank++;
+    }
+    return rank == zsl->length + 1 && zsl->tail == prev;
+}
+
+// 从表头顺序遍历，数出范围内的元素个数，以及第一个元素的排位
+static unsigned long countByWalking(zskiplist *zsl, zrangespec *range, unsigned long *first)
+{
+    zskiplistNode *x = zsl->header->level[0].forward;
+    unsigned long rank = 1, count = 0;
+
+    *first = 0;
+    for (; x; x = x->level[0].forward, rank++)
+    {
+        if (!zslValueGteMin(x->score, range) || !zslValueLteMax(x->score, range))
+            continue;
+        if (count++ == 0)
+            *first = rank;
+    }
+    return count;
+}
 
 int main()
 {
     zskiplist *zsl;
+    createSharedObjects();
     zsl = zslCreate();
 
     robj *no[10];
@@ -19,15 +57,132 @@ int main()
     for (int i = 0; i < 10; ++i)
     {
         zslInsert(zsl, 10 - i, no[i]);
+        decrRefCount(no[i]);
     }
 
     for (int i = 0; i < 10; ++i)
     {
         zskiplistNode *node;
         node = zslGetElementByRank(zsl, i + 1);
-        robj *o = node->obj;
+        robj *o = &node->obj;
         printf("%s ", o->ptr);
     }
 
     zslFree(zsl);
+    printf("\n");
+
+    // 从有序的输入批量构建
+    {
+        zslBulkLoader bl;
+        robj *o;
+        char buf[32];
+        int i, ok;
+
+        zsl = zslCreate();
+        zslBulkLoadInit(&bl, zsl);
+        for (i = 0; i < 20000; i++)
+        {
+            o = createStringObject(buf, snprintf(buf, sizeof(buf), "%06d", i));
+            zslBulkLoadAppend(&bl, i / 3, o);
+            decrRefCount(o);
+        }
+        zslBulkLoadFinish(&bl);
+        test_cond("Bulk load keeps order and ranks", zsl->length == 20000 && checkRanks(zsl));
+
+        // 在批量构建的表尾继续追加
+        zslBulkLoadInit(&bl, zsl);
+        for (i = 20000; i < 25000; i++)
+        {
+            o = createStringObject(buf, snprintf(buf, sizeof(buf), "%06d", i));
+            zslBulkLoadAppend(&bl, i / 3, o);
+            decrRefCount(o);
+        }
+        zslBulkLoadFinish(&bl);
+        test_cond("Bulk load appends to a non-empty list", zsl->length == 25000 && checkRanks(zsl));
+
+        // 批量构建之后，普通的插入和删除仍然正确
+        ok = 1;
+        for (i = 0; i < 2000; i++)
+        {
+            o = createStringObject(buf, snprintf(buf, sizeof(buf), "x%d", i));
+            zslInsert(zsl, rand() % 9000, o);
+            decrRefCount(o);
+            o = createStringObject(buf, snprintf(buf, sizeof(buf), "%06d", i * 7));
+            ok = ok && zslDelete(zsl, i * 7 / 3, o);
+            decrRefCount(o);
+        }
+        test_cond("Insert/delete after bulk load", ok && zsl->length == 25000 && checkRanks(zsl));
+
+        // 第 i 层的节点数应该接近 length * 0.25^i
+        {
+            zskiplistNode *x;
+            double expect = zsl->length;
+            int level, count;
+
+            ok = 1;
+            for (level = 1; level <= 4; level++)
+            {
+                expect *= ZSKIPLIST_P;
+                for (count = 0, x = zsl->header->level[level].forward; x; x = x->level[level].forward)
+                    count++;
+                ok = ok && count > expect * 0.85 && count < expect * 1.15;
+            }
+            test_cond("Level distribution follows ZSKIPLIST_P", ok);
+        }
+
+        // 由范围两端的排位得到的个数，和遍历数出来的一致
+        ok = 1;
+        for (i = 0; i < 3000 && ok; i++)
+        {
+            zrangespec range;
+            unsigned long first, last, walkfirst, count;
+
+            range.min = rand() % 9000 - 50;
+            range.max = range.min + rand() % 60 - 5;
+            range.minex = rand() % 2;
+            range.maxex = rand() % 2;
+            if (i % 7 == 0)
+                range.max += 0.5;
+
+            count = countByWalking(zsl, &range, &walkfirst);
+            first = zslRankOfFirstInRange(zsl, &range);
+            last = zslRankOfLastInRange(zsl, &range);
+            ok = first == walkfirst && (count ? last - first + 1 == count : last == 0);
+        }
+        test_cond("Range counting by rank", ok);
+        zslFree(zsl);
+    }
+
+    // 分值都相同时按成员计数
+    {
+        zlexrangespec range;
+        robj *o;
+        char buf[32];
+        int i;
+
+        zsl = zslCreate();
+        for (i = 0; i < 1000; i++)
+        {
+            o = createStringObject(buf, snprintf(buf, sizeof(buf), "%04d", i * 2));
+            zslInsert(zsl, 0, o);
+            decrRefCount(o);
+        }
+        range.min = createStringObject("0100", 4);
+        range.max = createStringObject("0199", 4);
+        range.minex = 1;
+        range.maxex = 0;
+        // (0100 到 [0199 之间是 0102 到 0198 ，排位从 52 到 100
+        test_cond("Lex range counting by rank",
+                  zslRankOfFirstInLexRange(zsl, &range) == 52 && zslRankOfLastInLexRange(zsl, &range) == 100);
+        decrRefCount(range.min);
+        decrRefCount(range.max);
+        range.min = shared.minstring;
+        range.max = shared.maxstring;
+        test_cond("Lex range with infinite ends",
+                  zslRankOfFirstInLexRange(zsl, &range) == 1 && zslRankOfLastInLexRange(zsl, &range) == 1000);
+        zslFree(zsl);
+    }
+
+    test_report();
+    return 0;
 }
\ No newline at end of file
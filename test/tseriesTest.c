@@ -0,0 +1,288 @@
+#include "test.h"
+#include "xmtseries.h"
+#include "xmskiplist.h"
+#include "xmdict.h"
+#include "xmobject.h"
+#include "xmt_string.h"
+#include "xmmalloc.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+// 跳跃表的字典以节点中嵌入的成员为键，不负责释放
+static dictType nodeDictType = {
+    dictEncObjHash,       /* hash function */
+    NULL,                 /* key dup */
+    NULL,                 /* val dup */
+    dictEncObjKeyCompare, /* key compare */
+    NULL,                 /* key destructor */
+    NULL                  /* val destructor */
+};
+
+// 块序列的字典持有成员的一个引用，值是分值
+static dictType objDictType = {
+    dictEncObjHash,            /* hash function */
+    NULL,                      /* key dup */
+    NULL,                      /* val dup */
+    dictEncObjKeyCompare,      /* key compare */
+    dictRedisObjectDestructor, /* key destructor */
+    NULL                       /* val destructor */
+};
+
+// 跳跃表和块序列，各自带一个以成员为键的字典
+typedef struct pair
+{
+    zskiplist *zsl;
+    dict *sd;
+    ztseries *zts;
+    dict *td;
+} pair;
+
+static void pairInit(pair *zp)
+{
+    zp->zsl = zslCreate();
+    zp->sd = dictCreate(&nodeDictType, NULL);
+    zp->zts = ztsCreate();
+    zp->td = dictCreate(&objDictType, NULL);
+}
+
+static void pairFree(pair *zp)
+{
+    dictRelease(zp->sd);
+    zslFree(zp->zsl);
+    dictRelease(zp->td);
+    ztsFree(zp->zts);
+}
+
+// 往跳跃表和块序列中插入同样的元素
+// 跳跃表复制成员，字典以节点中的成员为键；块序列和它的字典各持有 ele 的一个引用
+static void pairAdd(pair *zp, long long score, robj *ele)
+{
+    zskiplistNode *node;
+
+    node = zslInsert(zp->zsl, (double)score, ele);
+    dictAdd(zp->sd, &node->obj, NULL);
+
+    incrRefCount(ele);
+    ztsInsert(zp->zts, score, ele);
+    dictSetDoubleVal(dictAddRaw(zp->td, ele), (double)score);
+    incrRefCount(ele);
+}
+
+static void pairDel(pair *zp, long long score, robj *ele, int *ok)
+{
+    // 跳跃表的字典键在节点中，要先从字典中删除
+    dictDelete(zp->sd, ele);
+    *ok = *ok && zslDelete(zp->zsl, (double)score, ele) == ztsDelete(zp->zts, score, ele);
+    dictDelete(zp->td, ele);
+}
+
+// 检查两者正向和反向遍历的结果都相同，并且排位一致
+static int sameAsSkiplist(zskiplist *zsl, ztseries *zts)
+{
+    zskiplistNode *x = zsl->header->level[0].forward;
+    unsigned long rank = 1;
+    ztsPos p;
+
+    if (zsl->length != zts->length)
+        return 0;
+    if (zts->length == 0)
+        return zts->nblocks == 0;
+    ztsGetElementByRank(zts, 1, &p);
+    while (x)
+    {
+        if (!ztsPosValid(&p) || x->score != (double)ztsPosScore(&p) || !equalStringObjects(&x->obj, ztsPosObj(&p)))
+            return 0;
+        if (rank % 17 == 0 && ztsGetRank(zts, (long long)x->score, &x->obj) != rank)
+            return 0;
+        x = x->level[0].forward;
+        ztsNext(&p);
+        rank++;
+    }
+    if (ztsPosValid(&p))
+        return 0;
+
+    ztsGetElementByRank(zts, zts->length, &p);
+    for (x = zsl->tail; x; x = x->backward)
+    {
+        if (!ztsPosValid(&p) || x->score != (double)ztsPosScore(&p) || !equalStringObjects(&x->obj, ztsPosObj(&p)))
+            return 0;
+        ztsPrev(&p);
+    }
+    return !ztsPosValid(&p);
+}
+
+static robj *member(int i)
+{
+    char buf[32];
+    return createStringObject(buf, snprintf(buf, sizeof(buf), "m%d", i));
+}
+
+int main()
+{
+    robj *ele;
+    pair zp;
+    ztsPos p;
+    zskiplistNode *node;
+    long long ts;
+    int i, ok;
+
+    createSharedObjects();
+
+    // 空序列
+    {
+        zrangespec range = {0, 10, 0, 0};
+        ztseries *zts = ztsCreate();
+        test_cond("Empty series has no range",
+                  ztsRankOfFirstInRange(zts, &range) == 0 && ztsRankOfLastInRange(zts, &range) == 0);
+        test_cond("Empty series has no rank", !ztsGetElementByRank(zts, 1, &p));
+        ztsFree(zts);
+    }
+
+    test_cond("Only integer scores fit",
+              ztsScoreIsInteger(1700000000123.0) && ztsScoreIsInteger(-5) && !ztsScoreIsInteger(0.5) &&
+                  !ztsScoreIsInteger(1e300) && !ztsScoreIsInteger(1.0 / 0.0));
+
+    pairInit(&zp);
+
+    // 按时间顺序追加毫秒时间戳，间隔在一秒左右，偶尔有相同的时间戳
+    {
+        ts = 1700000000000LL;
+        for (i = 0; i < 100000; i++)
+        {
+            ts += rand() % 8 ? 900 + rand() % 200 : 0;
+            ele = member(i);
+            pairAdd(&zp, ts, ele);
+            decrRefCount(ele);
+        }
+        test_cond("Appends match skiplist", sameAsSkiplist(zp.zsl, zp.zts));
+        test_cond("Appends fill whole blocks", zp.zts->nblocks <= zp.zts->length / (ZTS_BLOCK_ENTRIES - 8) + 1);
+        test_cond("Appends are not middle inserts", !ztsTooManyMiddleOps(zp.zts) && zp.zts->middle == 0);
+    }
+
+    // 乱序插入和删除，块会被重新编码和分裂
+    {
+        ok = 1;
+        for (i = 0; i < 100000 && ok; i++)
+        {
+            dictEntry *de;
+
+            ele = member(rand() % 150000);
+            de = dictFind(zp.sd, ele);
+            if (de == NULL)
+                pairAdd(&zp, 1700000000000LL + rand() % 200000000, ele);
+            else if (rand() % 2)
+                pairDel(&zp, (long long)((zskiplistNode *)dictGetKey(de))->score, ele, &ok);
+            decrRefCount(ele);
+        }
+        // 时间差很大时一个差值占多个字节，块按字节数分裂
+        for (i = 0; i < 2000; i++)
+        {
+            ele = member(200000 + i);
+            pairAdd(&zp, (rand() % 2 ? 1LL : -1LL) * (rand() * 1000000LL % ZTS_SCORE_MAX), ele);
+            decrRefCount(ele);
+        }
+        test_cond("Random insert/delete matches skiplist", ok && sameAsSkiplist(zp.zsl, zp.zts));
+        test_cond("Random inserts count as middle inserts", ztsTooManyMiddleOps(zp.zts));
+    }
+
+    // 按排位查找
+    {
+        ok = 1;
+        for (i = 1; i <= (int)zp.zsl->length && ok; i += 1 + rand() % 7)
+        {
+            node = zslGetElementByRank(zp.zsl, i);
+            ok = ztsGetElementByRank(zp.zts, i, &p) && (double)ztsPosScore(&p) == node->score &&
+                 equalStringObjects(ztsPosObj(&p), &node->obj);
+        }
+        test_cond("Element by rank", ok && !ztsGetElementByRank(zp.zts, zp.zts->length + 1, &p));
+
+        ele = createStringObject("missing", 7);
+        test_cond("Rank of missing member", ztsGetRank(zp.zts, 1700000000000LL, ele) == 0);
+        decrRefCount(ele);
+    }
+
+    // 分值范围，包括开区间、闭区间、非整数的端点以及没有元素的范围
+    {
+        ok = 1;
+        for (i = 0; i < 5000 && ok; i++)
+        {
+            zrangespec range;
+
+            range.min = 1700000000000LL + rand() % 210000000 - 5000000;
+            range.max = range.min + rand() % 3000000 - 1000;
+            range.minex = rand() % 2;
+            range.maxex = rand() % 2;
+            if (i % 10 == 0)
+                range.min += 0.5;
+            ok = ztsRankOfFirstInRange(zp.zts, &range) == zslRankOfFirstInRange(zp.zsl, &range) &&
+                 ztsRankOfLastInRange(zp.zts, &range) == zslRankOfLastInRange(zp.zsl, &range);
+        }
+        test_cond("Rank of score range ends", ok);
+    }
+
+    // 范围删除
+    {
+        zrangespec range = {-ZTS_SCORE_MAX, 1700000000000LL + 50000000, 0, 1};
+        unsigned long a, b, nblocks = zp.zts->nblocks;
+
+        // 删除最早的数据，除了两端的块以外都整块释放
+        a = zslDeleteRangeByScore(zp.zsl, &range, zp.sd);
+        b = ztsDeleteRangeByScore(zp.zts, &range, zp.td);
+        test_cond("Delete old data by score", a == b && a > 40000 && sameAsSkiplist(zp.zsl, zp.zts) &&
+                                                  zp.zts->nblocks + a / ZTS_BLOCK_ENTRIES <= nblocks + 2);
+
+        a = zslDeleteRangeByRank(zp.zsl, 10, 5000, zp.sd);
+        b = ztsDeleteRangeByRank(zp.zts, 10, 5000, zp.td);
+        test_cond("Delete range by rank", a == b && a == 4991 && sameAsSkiplist(zp.zsl, zp.zts));
+        test_cond("Dict is kept in sync", dictSize(zp.td) == zp.zts->length);
+    }
+
+    pairFree(&zp);
+
+    // 分值都相同时的字典序范围
+    {
+        zlexrangespec range;
+        char buf[32];
+
+        pairInit(&zp);
+        for (i = 0; i < 3000; i++)
+        {
+            ele = createStringObject(buf, snprintf(buf, sizeof(buf), "%05d", i * 3));
+            pairAdd(&zp, 0, ele);
+            decrRefCount(ele);
+        }
+
+        ok = 1;
+        for (i = 0; i < 2000 && ok; i++)
+        {
+            int lo = rand() % 9200, hi = lo + rand() % 40;
+
+            range.min = i % 50 == 0 ? shared.minstring : createStringObject(buf, snprintf(buf, sizeof(buf), "%05d", lo));
+            range.max = i % 70 == 0 ? shared.maxstring : createStringObject(buf, snprintf(buf, sizeof(buf), "%05d", hi));
+            range.minex = rand() % 2;
+            range.maxex = rand() % 2;
+            ok = ztsRankOfFirstInLexRange(zp.zts, &range) == zslRankOfFirstInLexRange(zp.zsl, &range) &&
+                 ztsRankOfLastInLexRange(zp.zts, &range) == zslRankOfLastInLexRange(zp.zsl, &range);
+            if (range.min != shared.minstring)
+                decrRefCount(range.min);
+            if (range.max != shared.maxstring)
+                decrRefCount(range.max);
+        }
+        test_cond("Rank of lex range ends", ok);
+
+        range.min = createStringObject("01000", 5);
+        range.max = createStringObject("02000", 5);
+        range.minex = range.maxex = 0;
+        test_cond("Delete range by lex",
+                  zslDeleteRangeByLex(zp.zsl, &range, zp.sd) == ztsDeleteRangeByLex(zp.zts, &range, zp.td) &&
+                      sameAsSkiplist(zp.zsl, zp.zts));
+        decrRefCount(range.min);
+        decrRefCount(range.max);
+
+        pairFree(&zp);
+    }
+
+    test_report();
+    return 0;
+}
@@ -0,0 +1,148 @@
+#include "test.h"
+#include "xmzplist.h"
+#include "xmmalloc.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+// 生成长度在 [min, max] 之间的随机字符串，有一部分可以编码为整数
+static int randstring(char *target, unsigned int min, unsigned int max)
+{
+    int p = 0;
+    int len = min + rand() % (max - min + 1);
+    int minval, maxval;
+
+    switch (rand() % 3)
+    {
+    case 0:
+        minval = 0;
+        maxval = 255;
+        break;
+    case 1:
+        minval = 48;
+        maxval = 122;
+        break;
+    default:
+        minval = 48;
+        maxval = 52;
+        break;
+    }
+
+    while (p < len)
+        target[p++] = minval + rand() % (maxval - minval + 1);
+    return len;
+}
+
+int main()
+{
+    // 随机插入和删除节点之后，跳跃索引的定位和排位都和 ziplistIndex 一致
+    {
+        int i, j, len, index, op, ok = 1;
+        char buf[64];
+        zlSkipIndex *si = ziplistSkipIndexCreate(4);
+        unsigned char *p, *q, *zl = ziplistNew();
+
+        for (i = 0; i < 20000 && ok; i++)
+        {
+            len = ziplistLen(zl);
+            op = rand() % 4;
+            // 随机在某个位置插入或删除节点，之后通知跳跃索引
+            if (op < 3 || len == 0)
+            {
+                int buflen = randstring(buf, 1, 16);
+                index = len ? rand() % len : 0;
+                p = ziplistIndex(zl, index);
+                if (p == NULL)
+                {
+                    zl = ziplistPush(zl, (unsigned char *)buf, buflen, ZIPLIST_TAIL);
+                }
+                else
+                {
+                    size_t offset = p - zl;
+                    zl = ziplistInsert(zl, p, (unsigned char *)buf, buflen);
+                    ziplistSkipIndexTouch(si, zl, zl + offset);
+                }
+            }
+            else
+            {
+                p = ziplistIndex(zl, rand() % len);
+                zl = ziplistDelete(zl, &p);
+                ziplistSkipIndexTouch(si, zl, p);
+            }
+
+            // 随机抽查正负索引以及排位
+            len = ziplistLen(zl);
+            for (j = 0; j < 4 && ok; j++)
+            {
+                index = (rand() % (2 * len + 4)) - len - 2;
+                p = ziplistIndex(zl, index);
+                q = ziplistSkipIndexSeek(si, zl, index);
+                ok = p == q;
+                if (ok && p != NULL)
+                    ok = ziplistSkipIndexRank(si, zl, p) == (unsigned int)(index < 0 ? index + len : index);
+            }
+        }
+        ziplistSkipIndexRelease(si);
+        xm_free(zl);
+        test_cond("Skip index stays consistent with ziplistIndex", ok);
+    }
+
+    // 随机增删域之后，域索引找到的节点和 ziplistFind 一致
+    {
+        int i, j, buflen, ok = 1;
+        char buf[64];
+        zlHashIndex *hi = ziplistHashIndexCreate();
+        unsigned char *p, *q, *zl = ziplistNew();
+
+        for (i = 0; i < 20000 && ok; i++)
+        {
+            // 域和值交替保存，域取自一个较小的集合，其中一部分可以编码为整数
+            buflen = (rand() % 2) ? sprintf(buf, "%d", rand() % 500) : sprintf(buf, "f%d", rand() % 500);
+            p = ziplistIndex(zl, ZIPLIST_HEAD);
+            p = p ? ziplistFind(p, (unsigned char *)buf, buflen, 1) : NULL;
+            if (p == NULL)
+            {
+                zl = ziplistPush(zl, (unsigned char *)buf, buflen, ZIPLIST_TAIL);
+                buflen = randstring(buf, 1, 40);
+                zl = ziplistPush(zl, (unsigned char *)buf, buflen, ZIPLIST_TAIL);
+                ziplistHashIndexAdd(hi, zl, ziplistIndex(zl, -2));
+            }
+            else if (rand() % 2)
+            {
+                // 删除域和值，之后的节点都向前移动了两个节点的长度
+                size_t foff = p - zl, oldbytes = ziplistBlobLen(zl), oldnext;
+                q = ziplistNext(zl, ziplistNext(zl, p));
+                oldnext = q ? (size_t)(q - zl) : oldbytes - 1;
+                ziplistHashIndexRemove(hi, zl, p);
+                zl = ziplistDelete(zl, &p);
+                zl = ziplistDelete(zl, &p);
+                if ((long)ziplistBlobLen(zl) - (long)oldbytes != (long)(p - zl) - (long)oldnext)
+                    ziplistHashIndexReset(hi);
+                else
+                    ziplistHashIndexMove(hi, zl, oldbytes, foff, (long)(p - zl) - (long)oldnext);
+            }
+            else
+            {
+                // 其他修改方式直接让索引失效
+                zl = ziplistDeleteRange(zl, 0, 2);
+                ziplistHashIndexReset(hi);
+            }
+
+            // 随机抽查存在和不存在的域
+            for (j = 0; j < 4 && ok; j++)
+            {
+                buflen = (rand() % 2) ? sprintf(buf, "%d", rand() % 600) : sprintf(buf, "f%d", rand() % 600);
+                p = ziplistIndex(zl, ZIPLIST_HEAD);
+                p = p ? ziplistFind(p, (unsigned char *)buf, buflen, 1) : NULL;
+                q = ziplistHashIndexFind(hi, zl, (unsigned char *)buf, buflen);
+                ok = p == q;
+            }
+        }
+        ziplistHashIndexRelease(hi);
+        xm_free(zl);
+        test_cond("Hash index finds the same fields as ziplistFind", ok);
+    }
+
+    test_report();
+    return 0;
+}
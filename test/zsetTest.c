@@ -0,0 +1,766 @@
+#include "test.h"
+#include "xmt_zset.h"
+#include "xmt_set.h"
+#include "xmobject.h"
+#include "xmmalloc.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#define UNIVERSE 3000
+
+// 第 k 个输入集合包含成员 m<i> 当且仅当 i 能被 step[k] 整除，分值为 (i * (k + 1)) % 101
+// 编码分别是跳跃表、B+ 树、ziplist 和集合（分值视为 1）
+static const int step[4] = {2, 3, 25, 5};
+
+static double sourceScore(int k, int i)
+{
+    return k == 3 ? 1 : (i * (k + 1)) % 101;
+}
+
+static robj *member(int i)
+{
+    char buf[32];
+    return createStringObject(buf, snprintf(buf, sizeof(buf), "m%d", i));
+}
+
+static robj *createSource(int k)
+{
+    robj *o, *ele;
+    zset *zs;
+    int i;
+
+    if (k == 3)
+        o = createSetObject();
+    else if (k == 2)
+        o = createZsetZiplistObject();
+    else
+        o = k == 0 ? createZsetObject() : createZsetBtreeObject();
+    for (i = 0; i < UNIVERSE; i += step[k])
+    {
+        ele = member(i);
+        if (k == 3)
+        {
+            setTypeAdd(o, ele);
+        }
+        else if (k == 2)
+        {
+            o->ptr = zzlInsert(o->ptr, ele, sourceScore(k, i));
+        }
+        else if (k == 1)
+        {
+            zs = o->ptr;
+            incrRefCount(ele);
+            zbtInsert(zs->zbt, sourceScore(k, i), ele);
+            dictSetDoubleVal(dictAddRaw(zs->dict, ele), sourceScore(k, i));
+            incrRefCount(ele);
+        }
+        else
+        {
+            zskiplistNode *node;
+            zs = o->ptr;
+            node = zslInsert(zs->zsl, sourceScore(k, i), ele);
+            dictAdd(zs->dict, &node->obj, NULL);
+        }
+        decrRefCount(ele);
+    }
+    return o;
+}
+
+// 检查结果和逐个成员直接计算的一致，并且元素按 (score, member) 排列
+static int checkResult(robj *dst, int op, double *weights, int aggregate)
+{
+    unsigned long expected = 0;
+    int i, k, found;
+    double score, want, prev = -INFINITY;
+    robj *ele;
+
+    for (i = 0; i < UNIVERSE; i++)
+    {
+        found = 0;
+        want = 0;
+        for (k = 0; k < 4; k++)
+        {
+            double v;
+
+            if (i % step[k] != 0)
+            {
+                if (op == REDIS_OP_INTER)
+                    break;
+                continue;
+            }
+            v = sourceScore(k, i) * weights[k];
+            if (!found)
+                want = v;
+            else if (aggregate == REDIS_AGGR_SUM)
+                want += v;
+            else if (aggregate == REDIS_AGGR_MIN)
+                want = v < want ? v : want;
+            else
+                want = v > want ? v : want;
+            found = 1;
+        }
+        if (!found || (op == REDIS_OP_INTER && k < 4))
+            continue;
+        expected++;
+
+        ele = member(i);
+        if (dst->encoding == REDIS_ENCODING_ZIPLIST)
+            found = zzlFind(dst->ptr, ele, &score) != NULL;
+        else
+        {
+            dictEntry *de = dictFind(((zset *)dst->ptr)->dict, ele);
+            found = de != NULL;
+            if (found)
+                score = zsetNodeFromKey(dictGetKey(de))->score;
+        }
+        decrRefCount(ele);
+        if (!found || score != want)
+            return 0;
+    }
+    if (zsetLength(dst) != expected)
+        return 0;
+
+    if (dst->encoding == REDIS_ENCODING_SKIPLIST)
+    {
+        zskiplist *zsl = ((zset *)dst->ptr)->zsl;
+        zskiplistNode *x = zsl->header->level[0].forward;
+        unsigned long rank = 1;
+
+        for (; x; x = x->level[0].forward, rank++)
+        {
+            if (x->score < prev || zslGetRank(zsl, x->score, &x->obj) != rank)
+                return 0;
+            prev = x->score;
+        }
+    }
+    return 1;
+}
+
+// 取出迭代器返回的成员的字符串形式
+static sds rangeMember(unsigned char *eptr, robj *obj)
+{
+    unsigned char *vstr;
+    unsigned int vlen;
+    long long vlong;
+
+    if (obj)
+        return sdsdup(obj->ptr);
+    ziplistGet(eptr, &vstr, &vlen, &vlong);
+    return vstr ? sdsnewlen(vstr, vlen) : sdsfromlonglong(vlong);
+}
+
+// 用随机的分值范围、LIMIT 和方向检查迭代器，结果和按分值从头到尾逐个检查再跳过 offset 个元素的结果一致
+// 成员为 m<i> ，分值为 i / 2 ，i 从 0 到 n - 1
+static int checkRangeIterator(robj *zobj, int n)
+{
+    zsetRangeIterator it;
+    unsigned char *eptr;
+    robj *obj;
+    double score;
+    int round, i, ok = 1;
+
+    for (round = 0; round < 2000 && ok; round++)
+    {
+        zrangespec range;
+        unsigned long first, last, start, end;
+        long offset = rand() % 40 - 2, count = rand() % 30 - 3;
+        int reverse = rand() % 2, skipped = 0, taken = 0, want;
+
+        range.min = rand() % (n / 2 + 10) - 5;
+        range.max = range.min + rand() % (n / 4 + 2);
+        range.minex = rand() % 2;
+        range.maxex = rand() % 2;
+
+        zsetRangeRanks(zobj, &range, &first, &last);
+        if (!zsetLimitRanks(first, last, offset, count, reverse, &start, &end))
+            start = end = 0;
+        else
+            zsetRangeInit(&it, zobj, start, end, reverse);
+
+        for (i = reverse ? n - 1 : 0; ok && i >= 0 && i < n; i += reverse ? -1 : 1)
+        {
+            if (!zslValueGteMin(i / 2.0, &range) || !zslValueLteMax(i / 2.0, &range))
+                continue;
+            if (offset < 0 || skipped++ < offset)
+                continue;
+            if (count >= 0 && taken >= count)
+                break;
+            taken++;
+            want = i;
+            if (start == 0 || !zsetRangeNext(&it, &eptr, &obj, &score))
+            {
+                ok = 0;
+                break;
+            }
+            {
+                char buf[32];
+                sds m = rangeMember(eptr, obj);
+                snprintf(buf, sizeof(buf), "m%d", want);
+                ok = score == want / 2.0 && strcmp(m, buf) == 0;
+                sdsfree(m);
+            }
+        }
+        // 迭代器中不应该还有元素
+        if (ok && start != 0)
+            ok = !zsetRangeNext(&it, &eptr, &obj, &score);
+    }
+    return ok;
+}
+
+int main()
+{
+    robj *sets[4], *dst;
+    double ones[4] = {1, 1, 1, 1}, weights[4] = {2, -1, 0.5, 10};
+    int k;
+
+    createSharedObjects();
+    registerObjectTypes();
+    server.zset_max_ziplist_entries = 128;
+    server.zset_max_ziplist_value = 64;
+    for (k = 0; k < 4; k++)
+        sets[k] = createSource(k);
+
+    dst = zsetUnionInterStore(sets, NULL, 4, REDIS_OP_UNION, REDIS_AGGR_SUM);
+    test_cond("Union of all encodings with SUM",
+              dst->encoding == REDIS_ENCODING_SKIPLIST && checkResult(dst, REDIS_OP_UNION, ones, REDIS_AGGR_SUM));
+    freeZsetObject(dst);
+
+    dst = zsetUnionInterStore(sets, weights, 4, REDIS_OP_UNION, REDIS_AGGR_MIN);
+    test_cond("Weighted union with MIN", checkResult(dst, REDIS_OP_UNION, weights, REDIS_AGGR_MIN));
+    freeZsetObject(dst);
+
+    // 交集只有 i 是 150 的倍数的 20 个成员，结果足够小，保存为 ziplist
+    dst = zsetUnionInterStore(sets, weights, 4, REDIS_OP_INTER, REDIS_AGGR_MAX);
+    test_cond("Weighted intersection with MAX",
+              dst->encoding == REDIS_ENCODING_ZIPLIST && checkResult(dst, REDIS_OP_INTER, weights, REDIS_AGGR_MAX));
+    freeZsetObject(dst);
+
+    // 空集合（不存在的键）参与运算
+    {
+        robj *withempty[2] = {sets[0], NULL};
+        test_cond("Intersection with an empty set is empty",
+                  zsetUnionInterStore(withempty, NULL, 2, REDIS_OP_INTER, REDIS_AGGR_SUM) == NULL);
+        dst = zsetUnionInterStore(withempty, ones, 2, REDIS_OP_UNION, REDIS_AGGR_SUM);
+        test_cond("Union with an empty set copies the other one", zsetLength(dst) == zsetLength(sets[0]));
+        freeZsetObject(dst);
+    }
+
+    for (k = 0; k < 3; k++)
+        freeZsetObject(sets[k]);
+    freeSetObject(sets[3]);
+
+    // 按范围遍历，覆盖三种编码
+    {
+        robj *zl, *zs, *zb, *ele;
+        zskiplistNode *node;
+        zset *z;
+        int i;
+
+        zl = createZsetZiplistObject();
+        for (i = 0; i < 100; i++)
+        {
+            ele = member(i);
+            zl->ptr = zzlInsert(zl->ptr, ele, i / 2.0);
+            decrRefCount(ele);
+        }
+        zs = createZsetObject();
+        zb = createZsetBtreeObject();
+        for (i = 0; i < 3000; i++)
+        {
+            ele = member(i);
+            z = zs->ptr;
+            node = zslInsert(z->zsl, i / 2.0, ele);
+            dictAdd(z->dict, &node->obj, NULL);
+            z = zb->ptr;
+            incrRefCount(ele);
+            zbtInsert(z->zbt, i / 2.0, ele);
+            dictSetDoubleVal(dictAddRaw(z->dict, ele), i / 2.0);
+            incrRefCount(ele);
+            decrRefCount(ele);
+        }
+        test_cond("Range iterator on ziplist", checkRangeIterator(zl, 100));
+        test_cond("Range iterator on skiplist", checkRangeIterator(zs, 3000));
+        test_cond("Range iterator on btree", checkRangeIterator(zb, 3000));
+        freeZsetObject(zl);
+        freeZsetObject(zs);
+        freeZsetObject(zb);
+    }
+
+    // zsetAdd 插入和更新 ziplist 之后，跳跃索引只在改动的位置之后失效，按排位查找仍然正确
+    {
+        robj *zl, *ele;
+        zlSkipIndex *si;
+        unsigned long r;
+        int i, ok = 1;
+
+        zl = createZsetZiplistObject();
+        for (i = 0; i < 100; i++)
+        {
+            ele = member(i);
+            zsetAdd(zl, i, ele);
+            decrRefCount(ele);
+        }
+        for (i = 0; i < 2000 && ok; i++)
+        {
+            // 成员有一半已经存在，分值改变时元素移动到新的位置
+            ele = member(rand() % 120);
+            zsetAdd(zl, rand() % 200, ele);
+            decrRefCount(ele);
+            ok = zl->encoding == REDIS_ENCODING_ZIPLIST && (si = objectGetSkipIndex(zl)) != NULL;
+            for (r = 1; ok && r <= zsetLength(zl); r += 7)
+                ok = zzlGetElementByRank(zl->ptr, si, r) == zzlGetElementByRank(zl->ptr, NULL, r);
+        }
+        test_cond("Skip index stays valid across zsetAdd", ok);
+        freeZsetObject(zl);
+    }
+
+    // 超过边界条件之后 zsetAdd 转换为跳跃表，更新分值之后跳跃表和字典仍然一致
+    {
+        robj *zobj, *ele;
+        zset *zs;
+        dictEntry *de;
+        int i, ok = 1;
+
+        zobj = createZsetZiplistObject();
+        for (i = 0; i < 200; i++)
+        {
+            ele = member(i);
+            ok = ok && zsetAdd(zobj, i, ele) == 1;
+            decrRefCount(ele);
+        }
+        ok = ok && zobj->encoding == REDIS_ENCODING_SKIPLIST;
+        for (i = 0; i < 200; i++)
+        {
+            // 分值倒过来，排位也随之倒过来
+            ele = member(i);
+            ok = ok && zsetAdd(zobj, 1000 - i, ele) == 0;
+            decrRefCount(ele);
+        }
+        zs = zobj->ptr;
+        for (i = 0; ok && i < 200; i++)
+        {
+            ele = member(i);
+            de = dictFind(zs->dict, ele);
+            ok = de != NULL && zsetNodeFromKey(dictGetKey(de))->score == 1000 - i &&
+                 zslGetRank(zs->zsl, 1000 - i, ele) == (unsigned long)(200 - i);
+            decrRefCount(ele);
+        }
+        ok = ok && zs->zsl->length == 200 && dictSize(zs->dict) == 200;
+        test_cond("zsetAdd updates scores in a skiplist zset", ok);
+        freeZsetObject(zobj);
+    }
+
+    // 按分值、字典序和排位删除 ziplist 中的一段元素之后，跳跃索引仍然和逐个遍历的结果一致
+    {
+        robj *zl, *ele, *min, *max;
+        zlSkipIndex *si;
+        zrangespec range = {20, 39, 0, 0};
+        zlexrangespec lexrange;
+        unsigned long r, deleted;
+        char buf[32];
+        int i, op, ok = 1;
+
+        min = createStringObject("m020", 4);
+        max = createStringObject("m040", 4);
+        lexrange.min = min;
+        lexrange.max = max;
+        lexrange.minex = 0;
+        lexrange.maxex = 1;
+        for (op = 0; op < 3; op++)
+        {
+            // 字典序范围只在分值都相同时有意义，成员的长度各不相同，删除之后旧的槽不会恰好落在正确的节点上
+            zl = createZsetZiplistObject();
+            for (i = 0; i < 100; i++)
+            {
+                ele = createStringObject(buf, snprintf(buf, sizeof(buf), "m%03d%.*s", i, i % 7, "xxxxxx"));
+                zl->ptr = zzlInsert(zl->ptr, ele, op == 1 ? 0 : i);
+                decrRefCount(ele);
+            }
+            // 先让索引覆盖整个 ziplist
+            si = objectGetSkipIndex(zl);
+            ok = ok && si != NULL && zzlGetElementByRank(zl->ptr, si, 100) != NULL;
+            if (op == 0)
+                zl->ptr = zzlDeleteRangeByScore(zl->ptr, si, &range, &deleted);
+            else if (op == 1)
+                zl->ptr = zzlDeleteRangeByLex(zl->ptr, si, &lexrange, &deleted);
+            else
+                zl->ptr = zzlDeleteRangeByRank(zl->ptr, si, 21, 40, &deleted);
+            ok = ok && deleted == 20 && zsetLength(zl) == 80;
+            for (r = 1; ok && r <= 81; r++)
+                ok = zzlGetElementByRank(zl->ptr, si, r) == zzlGetElementByRank(zl->ptr, NULL, r);
+            freeZsetObject(zl);
+        }
+        decrRefCount(min);
+        decrRefCount(max);
+        test_cond("Skip index stays valid across range deletes", ok);
+    }
+
+    // 和 ziplist 编码之间的转换，B+ 树编码
+    {
+        robj *zobj, *ele;
+        zbtPos p;
+        int i, ok;
+
+        zobj = createZsetZiplistObject();
+        for (i = 0; i < 100; i++)
+        {
+            ele = member(i);
+            zobj->ptr = zzlInsert(zobj->ptr, ele, 100 - i);
+            decrRefCount(ele);
+        }
+        zsetConvert(zobj, REDIS_ENCODING_BTREE);
+        ok = zobj->encoding == REDIS_ENCODING_BTREE && zsetLength(zobj) == 100;
+        ok = ok && zbtGetElementByRank(((zset *)zobj->ptr)->zbt, 1, &p) && zbtPosScore(&p) == 1;
+        test_cond("Convert ziplist to btree", ok);
+        zsetConvert(zobj, REDIS_ENCODING_ZIPLIST);
+        test_cond("Convert btree to ziplist", zobj->encoding == REDIS_ENCODING_ZIPLIST && zsetLength(zobj) == 100 &&
+                                                  zzlGetScore(ziplistIndex(zobj->ptr, 1)) == 1);
+        freeZsetObject(zobj);
+    }
+
+    // 打开 zset_btree_index 之后，超过边界条件的压缩列表转换为 B+ 树编码
+    {
+        robj *zobj, *ele;
+        zbtPos p;
+        int i, ok = 1;
+
+        server.zset_btree_index = 1;
+        zobj = createZsetZiplistObject();
+        for (i = 0; i < 200; i++)
+        {
+            ele = member(i);
+            ok = ok && zsetAdd(zobj, i + 0.5, ele) == 1;
+            ok = ok && zobj->encoding == (i < 128 ? REDIS_ENCODING_ZIPLIST : REDIS_ENCODING_BTREE);
+            decrRefCount(ele);
+        }
+        ok = ok && zsetLength(zobj) == 200 && dictSize(((zset *)zobj->ptr)->dict) == 200;
+        ok = ok && zbtGetElementByRank(((zset *)zobj->ptr)->zbt, 150, &p) && zbtPosScore(&p) == 149.5;
+        // 已经存在的成员只更新分值
+        ele = member(10);
+        ok = ok && zsetAdd(zobj, 1000, ele) == 0 && zbtGetRank(((zset *)zobj->ptr)->zbt, 1000, ele) == 200;
+        decrRefCount(ele);
+        test_cond("Select btree when converting from ziplist", ok);
+        freeZsetObject(zobj);
+
+        server.zset_btree_index = 0;
+        zobj = createZsetZiplistObject();
+        for (i = 0; i < 200; i++)
+        {
+            ele = member(i);
+            zsetAdd(zobj, i + 0.5, ele);
+            decrRefCount(ele);
+        }
+        test_cond("Select skiplist by default", zobj->encoding == REDIS_ENCODING_SKIPLIST);
+        freeZsetObject(zobj);
+    }
+
+    // 和 ziplist 、跳跃表、B+ 树编码之间的转换，块序列编码
+    {
+        robj *zobj, *ele;
+        zset *zs;
+        int i, ok;
+
+        zobj = createZsetZiplistObject();
+        for (i = 0; i < 100; i++)
+        {
+            ele = member(i);
+            zobj->ptr = zzlInsert(zobj->ptr, ele, 1000 - i * 10);
+            decrRefCount(ele);
+        }
+        ok = zsetScoresAreIntegers(zobj);
+        zsetConvert(zobj, REDIS_ENCODING_TSERIES);
+        zs = zobj->ptr;
+        ok = ok && zobj->encoding == REDIS_ENCODING_TSERIES && zsetLength(zobj) == 100 && dictSize(zs->dict) == 100;
+        ele = member(99);
+        ok = ok && ztsGetRank(zs->zts, 10, ele) == 1;
+        decrRefCount(ele);
+        test_cond("Convert ziplist to tseries", ok);
+
+        zsetConvert(zobj, REDIS_ENCODING_SKIPLIST);
+        zs = zobj->ptr;
+        ele = member(0);
+        test_cond("Convert tseries to skiplist",
+                  zobj->encoding == REDIS_ENCODING_SKIPLIST && zs->zsl->length == 100 && dictSize(zs->dict) == 100 &&
+                      zslGetRank(zs->zsl, 1000, ele) == 100 && dictFind(zs->dict, ele) != NULL);
+        decrRefCount(ele);
+        freeZsetObject(zobj);
+
+        zobj = createZsetTseriesObject();
+        for (i = 0; i < 100; i++)
+        {
+            ele = member(i);
+            zsetAdd(zobj, i * 10, ele);
+            decrRefCount(ele);
+        }
+        zsetConvert(zobj, REDIS_ENCODING_BTREE);
+        zs = zobj->ptr;
+        ele = member(42);
+        ok = zobj->encoding == REDIS_ENCODING_BTREE && zs->zts == NULL && zs->zbt->length == 100 &&
+             dictSize(zs->dict) == 100 && zbtGetRank(zs->zbt, 420, ele) == 43;
+        decrRefCount(ele);
+        test_cond("Convert tseries to btree", ok);
+        freeZsetObject(zobj);
+    }
+
+    // 打开 zset_tseries_index 之后，分值都是整数、按分值追加的压缩列表超过边界条件时转换为 TSERIES 编码，
+    // 加入非整数分值之后转换为 SKIPLIST 编码
+    {
+        robj *zobj, *ele;
+        zset *zs;
+        int i, ok = 1;
+
+        zobj = createZsetZiplistObject();
+        for (i = 0; i < 200; i++)
+        {
+            ele = member(i);
+            zsetAdd(zobj, 1700000000000.0 + i * 1000, ele);
+            decrRefCount(ele);
+        }
+        test_cond("Select skiplist for integer scores by default", zobj->encoding == REDIS_ENCODING_SKIPLIST);
+        freeZsetObject(zobj);
+
+        server.zset_tseries_index = 1;
+        zobj = createZsetZiplistObject();
+        for (i = 0; i < 200; i++)
+        {
+            ele = member(i);
+            ok = ok && zsetAdd(zobj, 1700000000000.0 + i * 1000, ele) == 1;
+            ok = ok && zobj->encoding == (i < 128 ? REDIS_ENCODING_ZIPLIST : REDIS_ENCODING_TSERIES);
+            decrRefCount(ele);
+        }
+        zs = zobj->ptr;
+        ele = member(150);
+        ok = ok && zsetLength(zobj) == 200 && ztsGetRank(zs->zts, 1700000150000LL, ele) == 151;
+        test_cond("Select tseries for appended integer scores", ok);
+        ok = zsetAdd(zobj, 0.5, ele) == 0 && zobj->encoding == REDIS_ENCODING_SKIPLIST;
+        zs = zobj->ptr;
+        ok = ok && zs->zsl->length == 200 && zslGetRank(zs->zsl, 0.5, ele) == 1;
+        test_cond("Convert tseries to skiplist on a non-integer score", ok);
+        decrRefCount(ele);
+        freeZsetObject(zobj);
+
+        zobj = createZsetZiplistObject();
+        for (i = 0; i < 200; i++)
+        {
+            ele = member(i);
+            zsetAdd(zobj, i == 7 ? 7.5 : i, ele);
+            decrRefCount(ele);
+        }
+        test_cond("Select skiplist for non-integer scores", zobj->encoding == REDIS_ENCODING_SKIPLIST);
+        freeZsetObject(zobj);
+
+        // 触发转换的元素插入在表头，不是按分值追加
+        zobj = createZsetZiplistObject();
+        for (i = 0; i < 200; i++)
+        {
+            ele = member(i);
+            zsetAdd(zobj, 1000 - i, ele);
+            decrRefCount(ele);
+        }
+        test_cond("Select skiplist when inserts are not appends", zobj->encoding == REDIS_ENCODING_SKIPLIST);
+        freeZsetObject(zobj);
+    }
+
+    // 块序列中的插入经常落在中间时，转换为 SKIPLIST 编码，打开 zset_btree_index 时转换为 BTREE 编码
+    {
+        robj *zobj, *ele;
+        zset *zs;
+        int i, btree, ok;
+
+        for (btree = 0; btree < 2; btree++)
+        {
+            server.zset_btree_index = btree;
+            zobj = createZsetTseriesObject();
+            // 追加不计入中间插入，块序列保持不变
+            for (i = 0; i < 4000; i++)
+            {
+                ele = member(i);
+                zsetAdd(zobj, i * 10, ele);
+                decrRefCount(ele);
+            }
+            ok = zobj->encoding == REDIS_ENCODING_TSERIES;
+            for (i = 0; i < 200 && zobj->encoding == REDIS_ENCODING_TSERIES; i++)
+            {
+                ele = member(4000 + i);
+                zsetAdd(zobj, rand() % 20000 + 5, ele);
+                decrRefCount(ele);
+            }
+            zs = zobj->ptr;
+            ok = ok && i > 1 && i < 200 && zsetLength(zobj) == (unsigned long)(4000 + i) &&
+                 dictSize(zs->dict) == zsetLength(zobj);
+            ele = member(3999);
+            if (btree)
+                ok = ok && zobj->encoding == REDIS_ENCODING_BTREE && zs->zbt->length == zsetLength(zobj) &&
+                     zbtGetRank(zs->zbt, 39990, ele) != 0;
+            else
+                ok = ok && zobj->encoding == REDIS_ENCODING_SKIPLIST && zs->zsl->length == zsetLength(zobj) &&
+                     zslGetRank(zs->zsl, 39990, ele) != 0;
+            decrRefCount(ele);
+            test_cond(btree ? "Convert tseries to btree on middle inserts" : "Convert tseries to skiplist on middle inserts",
+                      ok);
+            freeZsetObject(zobj);
+        }
+        server.zset_btree_index = 0;
+        server.zset_tseries_index = 0;
+    }
+
+    // 和 ziplist 、跳跃表编码之间的转换，成员序列编码
+    {
+        robj *zobj, *ele;
+        zlexset *zlx;
+        zset *zs;
+        double score;
+        int i, ok;
+
+        zobj = createZsetZiplistObject();
+        for (i = 0; i < 100; i++)
+        {
+            ele = createStringObjectFromLongLong(i);
+            zobj->ptr = zzlInsert(zobj->ptr, ele, 5);
+            decrRefCount(ele);
+        }
+        ok = zsetScoresAreEqual(zobj, &score) && score == 5;
+        zsetConvert(zobj, REDIS_ENCODING_LEXSET);
+        zlx = ((zset *)zobj->ptr)->zlx;
+        ele = createStringObject("10", 2);
+        ok = ok && zobj->encoding == REDIS_ENCODING_LEXSET && zsetLength(zobj) == 100 && zlx->score == 5 &&
+             zlxGetRank(zlx, ele) == 3 && zsetScore(zobj, ele, &score) && score == 5;
+        decrRefCount(ele);
+        test_cond("Convert ziplist to lexset", ok);
+
+        // 同样的分值继续保持 LEXSET 编码，不同的分值转换为 SKIPLIST 编码
+        ele = createStringObject("abc", 3);
+        ok = zsetAdd(zobj, 5, ele) == 1 && zsetAdd(zobj, 5, ele) == 0 && zobj->encoding == REDIS_ENCODING_LEXSET;
+        ok = ok && zsetAdd(zobj, 7, ele) == 0 && zobj->encoding == REDIS_ENCODING_SKIPLIST;
+        zs = zobj->ptr;
+        ok = ok && zs->zsl->length == 101 && dictSize(zs->dict) == 101 && zslGetRank(zs->zsl, 7, ele) == 101 &&
+             !zsetScoresAreEqual(zobj, &score);
+        decrRefCount(ele);
+        test_cond("Convert lexset to skiplist on a different score", ok);
+        freeZsetObject(zobj);
+
+        zobj = createZsetLexsetObject(1);
+        for (i = 0; i < 50; i++)
+        {
+            ele = createStringObjectFromLongLong(i);
+            zsetAdd(zobj, 1, ele);
+            decrRefCount(ele);
+        }
+        zsetConvert(zobj, REDIS_ENCODING_ZIPLIST);
+        ele = createStringObjectFromLongLong(49);
+        test_cond("Convert lexset to ziplist", zobj->encoding == REDIS_ENCODING_ZIPLIST && zsetLength(zobj) == 50 &&
+                                                   zsetScore(zobj, ele, &score) && score == 1);
+        decrRefCount(ele);
+        freeZsetObject(zobj);
+    }
+
+    // 成员序列上的 ZRANGEBYLEX 迭代器，正向和反向都和跳跃表一致
+    {
+        robj *zl, *zs, *ele, *o1, *o2;
+        zsetRangeIterator i1, i2;
+        unsigned char *e1, *e2;
+        double s1, s2;
+        unsigned long start, end;
+        int i, ok = 1;
+
+        zl = createZsetLexsetObject(0);
+        zs = createZsetObject();
+        for (i = 0; i < 20000; i++)
+        {
+            ele = member(rand() % 30000);
+            zsetAdd(zl, 0, ele);
+            zsetAdd(zs, 0, ele);
+            decrRefCount(ele);
+        }
+        for (i = 0; i < 500 && ok; i++)
+        {
+            int reverse = rand() % 2;
+
+            start = 1 + rand() % zsetLength(zl);
+            end = start + rand() % 100;
+            if (end > zsetLength(zl))
+                end = zsetLength(zl);
+            zsetRangeInit(&i1, zl, start, end, reverse);
+            zsetRangeInit(&i2, zs, start, end, reverse);
+            while (ok && zsetRangeNext(&i1, &e1, &o1, &s1))
+                ok = zsetRangeNext(&i2, &e2, &o2, &s2) && e1 == NULL && s1 == 0 && s2 == 0 &&
+                     equalStringObjects(o1, o2);
+            ok = ok && !zsetRangeNext(&i2, &e2, &o2, &s2);
+            zsetRangeRelease(&i1);
+            zsetRangeRelease(&i2);
+        }
+        test_cond("Range iterator on lexset matches skiplist", ok && zsetLength(zl) == zsetLength(zs));
+        freeZsetObject(zl);
+        freeZsetObject(zs);
+    }
+
+    // 打开 zset_lexset_index 之后，分值都相同的压缩列表超过边界条件时转换为 LEXSET 编码，
+    // ZRANGEBYLEX 使用的排位和迭代器都可以用
+    {
+        zlexrangespec range;
+        zsetRangeIterator it;
+        unsigned long first, last;
+        unsigned char *eptr;
+        robj *zobj, *ele, *obj, *min, *max;
+        double score;
+        char buf[32];
+        int i, ok = 1;
+
+        zobj = createZsetZiplistObject();
+        for (i = 0; i < 200; i++)
+        {
+            ele = createStringObject(buf, snprintf(buf, sizeof(buf), "user:%03d", i));
+            zsetAdd(zobj, 0, ele);
+            decrRefCount(ele);
+        }
+        test_cond("Select skiplist for equal scores by default", zobj->encoding == REDIS_ENCODING_SKIPLIST);
+        freeZsetObject(zobj);
+
+        server.zset_lexset_index = 1;
+        zobj = createZsetZiplistObject();
+        for (i = 0; i < 200; i++)
+        {
+            ele = createStringObject(buf, snprintf(buf, sizeof(buf), "user:%03d", i));
+            ok = ok && zsetAdd(zobj, 0, ele) == 1;
+            ok = ok && zobj->encoding == (i < 128 ? REDIS_ENCODING_ZIPLIST : REDIS_ENCODING_LEXSET);
+            decrRefCount(ele);
+        }
+        ok = ok && zsetLength(zobj) == 200 && ((zset *)zobj->ptr)->zlx->score == 0;
+        test_cond("Select lexset when converting from ziplist", ok);
+
+        // [user:050 (user:06 ，排位 51 到 60
+        min = createStringObject("[user:050", 9);
+        max = createStringObject("(user:06", 8);
+        zslParseLexRange(min, max, &range);
+        zsetLexRangeRanks(zobj, &range, &first, &last);
+        ok = first == 51 && last == 60;
+        zsetRangeInit(&it, zobj, first, last, 0);
+        for (i = 50; ok && zsetRangeNext(&it, &eptr, &obj, &score); i++)
+        {
+            snprintf(buf, sizeof(buf), "user:%03d", i);
+            ok = score == 0 && strcmp(obj->ptr, buf) == 0;
+        }
+        zsetRangeRelease(&it);
+        test_cond("Lex range on a selected lexset", ok && i == 60);
+        zslFreeLexRange(&range);
+        decrRefCount(min);
+        decrRefCount(max);
+        freeZsetObject(zobj);
+
+        zobj = createZsetZiplistObject();
+        for (i = 0; i < 200; i++)
+        {
+            ele = createStringObjectFromLongLong(i);
+            zsetAdd(zobj, i == 100 ? 1 : 0, ele);
+            decrRefCount(ele);
+        }
+        test_cond("Select another encoding for different scores", zobj->encoding != REDIS_ENCODING_LEXSET);
+        freeZsetObject(zobj);
+        server.zset_lexset_index = 0;
+    }
+
+    test_report();
+    return 0;
+}